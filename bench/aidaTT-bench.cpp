@@ -0,0 +1,171 @@
+// benchmarks of the time critical parts of aidaTT
+
+#include "benchmarks/BenchmarkSuite.hh"
+
+///~ add the benchmarks by their header file(s)
+#include "benchmarks/helixBenchmarks.hh"
+#include "benchmarks/fitBenchmarks.hh"
+#include "SimpleGeometry.hh"
+#include "Instrumentation.hh"
+
+#ifdef AIDATT_USE_STREAMLOG
+#include "streamlog/streamlog.h"
+#endif
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace Benchmarking;
+using namespace std;
+
+void addHelixBenchmarks(BenchmarkSuite& _bench)
+{
+    _bench.addBenchmark(new intersectionBenchmark(intersectionBenchmark::zCylinder));
+    _bench.addBenchmark(new intersectionBenchmark(intersectionBenchmark::zPlane));
+    _bench.addBenchmark(new intersectionBenchmark(intersectionBenchmark::zDisk));
+    _bench.addBenchmark(new intersectionBenchmark(intersectionBenchmark::zCone));
+    _bench.addBenchmark(new intersectionBenchmark(intersectionBenchmark::tiltedPlane));
+    _bench.addBenchmark(new intersectionBenchmark(intersectionBenchmark::zCylinder, true));
+    _bench.addBenchmark(new intersectionBenchmark(intersectionBenchmark::zPlane, true));
+    _bench.addBenchmark(new intersectionBenchmark(intersectionBenchmark::zDisk, true));
+    _bench.addBenchmark(new intersectionBenchmark(intersectionBenchmark::zCone, true));
+    _bench.addBenchmark(new intersectionBenchmark(intersectionBenchmark::tiltedPlane, true));
+    _bench.addBenchmark(new moveHelixBenchmark(false));
+    _bench.addBenchmark(new moveHelixBenchmark(true));
+    _bench.addBenchmark(new jacobianBenchmark);
+    _bench.addBenchmark(new curvilinearJacobianBenchmark);
+    _bench.addBenchmark(new materialBenchmark(false));
+    _bench.addBenchmark(new materialBenchmark(true));
+    _bench.addBenchmark(new betheBlochBenchmark(false));
+    _bench.addBenchmark(new betheBlochBenchmark(true));
+}
+
+
+
+void addFitBenchmarks(BenchmarkSuite& _bench)
+{
+    static const unsigned nHits[] = { 10, 50, 220 };
+
+    for(unsigned f = kalmanFitter ; f <= gblFitter ; ++f)
+        {
+            const fitterKind fitter = fitterKind(f);
+
+            // only the fitters available in this build
+            aidaTT::IFittingAlgorithm* available = createFitter(fitter);
+
+            if(available == 0)
+                continue;
+
+            delete available;
+
+            for(unsigned i = 0 ; i < 3 ; ++i)
+                {
+                    _bench.addBenchmark(new trajectoryFitBenchmark(nHits[i], fitter, false));
+                    _bench.addBenchmark(new trajectoryFitBenchmark(nHits[i], fitter, true));
+                }
+
+            _bench.addBenchmark(new fitResultsBenchmark(220, fitter));
+        }
+}
+
+
+
+void usage()
+{
+    cout << " usage: aidaTT-bench [options]" << endl
+         << "   --json <file>        write the results as JSON to file ('-' for stdout)" << endl
+         << "   --filter <string>    only run the benchmarks whose name contains string" << endl
+         << "   --min-time <s>       minimal time per benchmark in seconds (default 0.5)" << endl
+         << "   --repetitions <n>    number of timed repetitions per benchmark (default 5)" << endl
+         << "   --list               list the benchmarks and exit" << endl;
+}
+
+
+
+int main(int argc, char **argv)
+{
+    string jsonFile;
+    string filter;
+    double minTime = 0.5;
+    unsigned repetitions = 5;
+    bool listOnly = false;
+
+    for(int i = 1 ; i < argc ; ++i)
+        {
+            const string arg = argv[i];
+            const bool hasValue = (i + 1 < argc);
+
+            if(arg == "--json" && hasValue)
+                jsonFile = argv[++i];
+            else if(arg == "--filter" && hasValue)
+                filter = argv[++i];
+            else if(arg == "--min-time" && hasValue)
+                minTime = atof(argv[++i]);
+            else if(arg == "--repetitions" && hasValue)
+                repetitions = atoi(argv[++i]);
+            else if(arg == "--list")
+                listOnly = true;
+            else
+                {
+                    usage();
+                    return (arg == "--help" || arg == "-h" ? 0 : 1);
+                }
+        }
+
+#ifdef AIDATT_USE_STREAMLOG
+    streamlog::out.init(cerr, "aidaTT-bench");
+    streamlog::logscope scope(streamlog::out);
+    scope.setLevel<streamlog::WARNING>();
+#endif
+
+    // the material utilities take the field from the global geometry instance
+    aidaTT::SimpleGeometry fieldGeometry(3.5);
+    aidaTT::SimpleGeometry::installGlobal(&fieldGeometry);
+
+    // with the JSON on stdout the table goes to stderr
+    BenchmarkSuite _bench("aidaTT benchmark suite", (jsonFile == "-" ? &cerr : &cout));
+
+    _bench.setFilter(filter);
+    _bench.setMinTime(minTime);
+    _bench.setRepetitions(repetitions);
+
+    addHelixBenchmarks(_bench);
+    addFitBenchmarks(_bench);
+
+    if(listOnly)
+        {
+            _bench.list();
+            return 0;
+        }
+
+    aidaTT::Instrumentation::reset();
+
+    _bench.run();
+
+    _bench.report();
+
+    // the stages of all benchmarks, if compiled in
+    if(aidaTT::Instrumentation::enabled())
+        (jsonFile == "-" ? cerr : cout) << endl << aidaTT::Instrumentation::snapshot();
+
+    if(jsonFile == "-")
+        {
+            _bench.writeJSON(cout);
+        }
+    else if(!jsonFile.empty())
+        {
+            ofstream json(jsonFile.c_str());
+
+            if(!json)
+                {
+                    cerr << " aidaTT-bench: cannot write " << jsonFile << endl;
+                    return 1;
+                }
+
+            _bench.writeJSON(json);
+        }
+
+    return 0;
+}
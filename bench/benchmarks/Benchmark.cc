@@ -0,0 +1,97 @@
+#include "Benchmark.hh"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    unsigned long nAllocations = 0;
+    unsigned long nAllocatedBytes = 0;
+
+    inline void* countedAllocation(std::size_t size)
+    {
+        ++nAllocations;
+        nAllocatedBytes += size;
+
+        return std::malloc(size > 0 ? size : 1);
+    }
+}
+
+
+
+///~ replacements of the global allocation functions that count the allocations
+void* operator new(std::size_t size)
+{
+    void* ptr = countedAllocation(size);
+
+    if(ptr == 0)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    void* ptr = countedAllocation(size);
+
+    if(ptr == 0)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocation(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocation(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+
+
+namespace Benchmarking
+{
+
+    Benchmark::Benchmark(const std::string& xname, unsigned itemsPerOp, const std::string& itemName) :
+        _checksum(0.), _name(xname), _itemsPerOp(itemsPerOp), _itemName(itemName)
+    {
+    }
+
+
+
+    unsigned long allocationCount()
+    {
+        return nAllocations;
+    }
+
+
+
+    unsigned long allocatedBytes()
+    {
+        return nAllocatedBytes;
+    }
+
+} // namespace Benchmarking
@@ -0,0 +1,53 @@
+#ifndef BENCHMARK_HH
+#define BENCHMARK_HH
+
+#include <string>
+
+namespace Benchmarking
+{
+
+    /** Base class of the benchmarks: run() executes the timed operation nOps times. Everything
+     *  that should not be timed (geometry, start values, ...) is prepared in setUp(), which is
+     *  called once before the first run().
+     *  Results of the operations should be accumulated into _checksum, such that the compiler
+     *  cannot drop the computations.
+     */
+    class Benchmark
+    {
+        public:
+            /// itemsPerOp is the number of items (e.g. hits) processed per operation, for the throughput
+            Benchmark(const std::string& xname, unsigned itemsPerOp = 1, const std::string& itemName = "op");
+            virtual ~Benchmark() {}
+
+            virtual void setUp() {}
+            virtual void run(unsigned nOps) = 0;
+
+            const std::string& name() const { return _name; }
+            unsigned itemsPerOp() const { return _itemsPerOp; }
+            const std::string& itemName() const { return _itemName; }
+            double checksum() const { return _checksum; }
+
+        protected:
+            double _checksum;
+
+        private:
+            std::string _name;
+            unsigned _itemsPerOp;
+            std::string _itemName;
+
+            // Disallowed:
+            Benchmark(const Benchmark&);
+            Benchmark& operator=(const Benchmark&);
+    };
+
+
+    /** The number of calls to the global operator new (all variants) and the number of bytes
+     *  requested since the start of the program. Memory allocated with malloc directly, e.g. by
+     *  the dynamic size Eigen matrices, is not counted. The counters are not thread safe, i.e.
+     *  the benchmarks have to be single threaded.
+     */
+    unsigned long allocationCount();
+    unsigned long allocatedBytes();
+
+} // namespace Benchmarking
+#endif // BENCHMARK_HH
@@ -0,0 +1,241 @@
+#include "BenchmarkSuite.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    typedef std::chrono::steady_clock benchClock;
+
+    /// the results of the benchmarks end up here, such that they are not optimized away
+    volatile double checksumSink = 0.;
+
+    double timeOf(Benchmarking::Benchmark& b, unsigned nOps)
+    {
+        const benchClock::time_point start = benchClock::now();
+
+        b.run(nOps);
+
+        const benchClock::time_point end = benchClock::now();
+
+        return std::chrono::duration<double>(end - start).count();
+    }
+
+    std::string jsonString(const std::string& s)
+    {
+        std::stringstream sst;
+        sst << '"';
+
+        for(unsigned i = 0 ; i < s.size() ; ++i)
+            {
+                if(s[i] == '"' || s[i] == '\\')
+                    sst << '\\';
+                sst << s[i];
+            }
+
+        sst << '"';
+        return sst.str();
+    }
+
+#define BENCH_STRINGIFY_(x) #x
+#define BENCH_STRINGIFY(x) BENCH_STRINGIFY_(x)
+
+    std::string versionString()
+    {
+#ifdef AIDATT_VERSION_MAJOR
+        return BENCH_STRINGIFY(AIDATT_VERSION_MAJOR) "." BENCH_STRINGIFY(AIDATT_VERSION_MINOR) "." BENCH_STRINGIFY(AIDATT_VERSION_PATCH);
+#else
+        return "unknown";
+#endif
+    }
+}
+
+
+
+namespace Benchmarking
+{
+
+    BenchmarkSuite::BenchmarkSuite(const std::string& title, std::ostream* sptr) :
+        _name(title), _osptr(sptr), _benchmarks(), _results(), _filter(), _minTime(0.5), _repetitions(5)
+    {
+    }
+
+
+
+    BenchmarkSuite::~BenchmarkSuite()
+    {
+        for(unsigned i = 0 ; i < _benchmarks.size() ; ++i)
+            delete _benchmarks[i];
+    }
+
+
+
+    void BenchmarkSuite::addBenchmark(Benchmark* b)
+    {
+        _benchmarks.push_back(b);
+    }
+
+
+
+    bool BenchmarkSuite::_selected(const Benchmark& b) const
+    {
+        return _filter.empty() || b.name().find(_filter) != std::string::npos;
+    }
+
+
+
+    void BenchmarkSuite::list() const
+    {
+        for(unsigned i = 0 ; i < _benchmarks.size() ; ++i)
+            if(_selected(*_benchmarks[i]))
+                *_osptr << _benchmarks[i]->name() << std::endl;
+    }
+
+
+
+    void BenchmarkSuite::run()
+    {
+        _results.clear();
+
+        for(unsigned i = 0 ; i < _benchmarks.size() ; ++i)
+            {
+                if(!_selected(*_benchmarks[i]))
+                    continue;
+
+                _results.push_back(_measure(*_benchmarks[i]));
+
+                const BenchmarkResult& r = _results.back();
+
+                *_osptr << "  " << std::left << std::setw(40) << r.name << std::right
+                        << std::fixed << std::setprecision(1) << std::setw(14) << r.nsPerOp << " ns/op"
+                        << std::setprecision(2) << std::setw(10) << r.allocationsPerOp << " allocs/op"
+                        << std::defaultfloat << std::endl;
+            }
+    }
+
+
+
+    BenchmarkResult BenchmarkSuite::_measure(Benchmark& b) const
+    {
+        BenchmarkResult result;
+        result.name = b.name();
+        result.itemName = b.itemName();
+        result.itemsPerOp = b.itemsPerOp();
+
+        b.setUp();
+
+        // warm up the caches and find the number of operations per repetition
+        const double timePerRepetition = _minTime / _repetitions;
+
+        unsigned nOps = 1;
+        double elapsed = timeOf(b, nOps);
+
+        while(elapsed < timePerRepetition && nOps < (1u << 30))
+            {
+                // aim for 20% above the target, but grow by at most a factor 10 per step
+                const double scale = (elapsed > 0. ? 1.2 * timePerRepetition / elapsed : 10.);
+
+                nOps = unsigned(nOps * std::min(std::max(scale, 2.), 10.));
+                elapsed = timeOf(b, nOps);
+            }
+
+        std::vector<double> nsPerOp(_repetitions);
+
+        const unsigned long allocationsBefore = allocationCount();
+        const unsigned long bytesBefore = allocatedBytes();
+
+        for(unsigned i = 0 ; i < _repetitions ; ++i)
+            nsPerOp[i] = 1.e9 * timeOf(b, nOps) / nOps;
+
+        const unsigned long nAllocations = allocationCount() - allocationsBefore;
+        const unsigned long nBytes = allocatedBytes() - bytesBefore;
+
+        checksumSink = checksumSink + b.checksum();
+
+        std::sort(nsPerOp.begin(), nsPerOp.end());
+
+        result.nOps = (unsigned long) nOps * _repetitions;
+        result.nsPerOp = (_repetitions % 2 ? nsPerOp[_repetitions / 2]
+                          : 0.5 * (nsPerOp[_repetitions / 2 - 1] + nsPerOp[_repetitions / 2]));
+        result.minNsPerOp = nsPerOp.front();
+        result.allocationsPerOp = double(nAllocations) / result.nOps;
+        result.bytesPerOp = double(nBytes) / result.nOps;
+        result.opsPerSecond = (result.nsPerOp > 0. ? 1.e9 / result.nsPerOp : 0.);
+        result.itemsPerSecond = result.opsPerSecond * result.itemsPerOp;
+
+        return result;
+    }
+
+
+
+    void BenchmarkSuite::report() const
+    {
+        *_osptr << std::endl << _name << " (aidaTT " << versionString() << ")" << std::endl
+                << std::left << std::setw(40) << "benchmark" << std::right
+                << std::setw(14) << "ns/op" << std::setw(14) << "min ns/op"
+                << std::setw(12) << "allocs/op" << std::setw(12) << "bytes/op"
+                << std::setw(16) << "throughput" << std::endl;
+
+        for(unsigned i = 0 ; i < _results.size() ; ++i)
+            {
+                const BenchmarkResult& r = _results[i];
+
+                std::stringstream throughput;
+                throughput << std::scientific << std::setprecision(3) << r.itemsPerSecond << " " << r.itemName << "/s";
+
+                *_osptr << std::left << std::setw(40) << r.name << std::right << std::fixed
+                        << std::setprecision(1) << std::setw(14) << r.nsPerOp << std::setw(14) << r.minNsPerOp
+                        << std::setprecision(2) << std::setw(12) << r.allocationsPerOp
+                        << std::setprecision(0) << std::setw(12) << r.bytesPerOp
+                        << "  " << throughput.str() << std::defaultfloat << std::endl;
+            }
+    }
+
+
+
+    void BenchmarkSuite::writeJSON(std::ostream& os) const
+    {
+        os << "{" << std::endl
+           << "  \"suite\": " << jsonString(_name) << "," << std::endl
+           << "  \"context\": {" << std::endl
+           << "    \"aidaTT_version\": " << jsonString(versionString()) << "," << std::endl
+#ifdef __VERSION__
+           << "    \"compiler\": " << jsonString(__VERSION__) << "," << std::endl
+#endif
+#ifdef USE_GBL
+           << "    \"gbl\": true," << std::endl
+#else
+           << "    \"gbl\": false," << std::endl
+#endif
+           << "    \"min_time_s\": " << _minTime << "," << std::endl
+           << "    \"repetitions\": " << _repetitions << std::endl
+           << "  }," << std::endl
+           << "  \"benchmarks\": [" << std::endl;
+
+        os << std::setprecision(9);
+
+        for(unsigned i = 0 ; i < _results.size() ; ++i)
+            {
+                const BenchmarkResult& r = _results[i];
+
+                os << "    {" << std::endl
+                   << "      \"name\": " << jsonString(r.name) << "," << std::endl
+                   << "      \"operations\": " << r.nOps << "," << std::endl
+                   << "      \"ns_per_op\": " << r.nsPerOp << "," << std::endl
+                   << "      \"min_ns_per_op\": " << r.minNsPerOp << "," << std::endl
+                   << "      \"allocations_per_op\": " << r.allocationsPerOp << "," << std::endl
+                   << "      \"bytes_per_op\": " << r.bytesPerOp << "," << std::endl
+                   << "      \"ops_per_s\": " << r.opsPerSecond << "," << std::endl
+                   << "      \"item\": " << jsonString(r.itemName) << "," << std::endl
+                   << "      \"items_per_op\": " << r.itemsPerOp << "," << std::endl
+                   << "      \"items_per_s\": " << r.itemsPerSecond << std::endl
+                   << "    }" << (i + 1 < _results.size() ? "," : "") << std::endl;
+            }
+
+        os << "  ]" << std::endl
+           << "}" << std::endl;
+    }
+
+} // namespace Benchmarking
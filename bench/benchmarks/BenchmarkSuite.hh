@@ -0,0 +1,86 @@
+#ifndef BENCHMARKSUITE_HH
+#define BENCHMARKSUITE_HH
+
+#include "Benchmark.hh"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Benchmarking
+{
+
+    /// the measurement of one benchmark
+    struct BenchmarkResult
+    {
+        std::string name;
+        std::string itemName;
+        unsigned itemsPerOp;
+
+        ///< number of timed operations over all repetitions
+        unsigned long nOps;
+
+        ///< median and minimum over the repetitions
+        double nsPerOp;
+        double minNsPerOp;
+
+        double allocationsPerOp;
+        double bytesPerOp;
+
+        ///< from the median time per operation
+        double opsPerSecond;
+        double itemsPerSecond;
+
+        BenchmarkResult() : name(), itemName(), itemsPerOp(1), nOps(0), nsPerOp(0.), minNsPerOp(0.),
+            allocationsPerOp(0.), bytesPerOp(0.), opsPerSecond(0.), itemsPerSecond(0.) {}
+    };
+
+
+    /** Runs the benchmarks: the number of operations per repetition is increased until one
+     *  repetition takes at least minTime/repetitions, then the benchmark is timed for the given
+     *  number of repetitions. Allocations are counted over all timed repetitions.
+     */
+    class BenchmarkSuite
+    {
+        public:
+            BenchmarkSuite(const std::string& title, std::ostream* sptr = &std::cout);
+            ~BenchmarkSuite();
+
+            /// takes ownership of the benchmark
+            void addBenchmark(Benchmark* b);
+
+            /// only run the benchmarks whose name contains filter
+            void setFilter(const std::string& filter) { _filter = filter; }
+
+            /// the minimal total time per benchmark in seconds
+            void setMinTime(double seconds) { _minTime = seconds; }
+            void setRepetitions(unsigned n) { _repetitions = ( n > 0 ? n : 1 ); }
+
+            void list() const;
+            void run();
+            void report() const;
+
+            /// write the context and all results as JSON
+            void writeJSON(std::ostream& os) const;
+
+            const std::vector<BenchmarkResult>& results() const { return _results; }
+
+        private:
+            bool _selected(const Benchmark& b) const;
+            BenchmarkResult _measure(Benchmark& b) const;
+
+            std::string _name;
+            std::ostream* _osptr;
+            std::vector<Benchmark*> _benchmarks;
+            std::vector<BenchmarkResult> _results;
+            std::string _filter;
+            double _minTime;
+            unsigned _repetitions;
+
+            // Disallowed ops:
+            BenchmarkSuite(const BenchmarkSuite&);
+            BenchmarkSuite& operator=(const BenchmarkSuite&);
+    };
+
+} // namespace Benchmarking
+#endif // BENCHMARKSUITE_HH
@@ -0,0 +1,248 @@
+#include "fitBenchmarks.hh"
+
+#include "analyticalPropagation.hh"
+#include "KalmanFitter.hh"
+#include "helixUtils.hh"
+#include "trackParameterizationLCIO.hh"
+#include "aidaTT-Units.hh"
+
+#ifdef USE_GBL
+#include "GBLInterface.hh"
+#endif
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace aidaTT;
+
+namespace
+{
+    const double bz = 3.5;
+
+    /// the resolution of the measurements in cm
+    const double resolution = 1.e-3;
+
+    std::string benchmarkName(const std::string& what, unsigned nHits, Benchmarking::fitterKind fitter, bool reset = false)
+    {
+        std::stringstream sst;
+        sst << what << "/" << Benchmarking::fitterName(fitter) << "/" << nHits << "hits" << (reset ? "/reset" : "");
+        return sst.str();
+    }
+}
+
+
+
+namespace Benchmarking
+{
+
+    const char* fitterName(fitterKind fitter)
+    {
+        return (fitter == gblFitter ? "gbl" : "kalman");
+    }
+
+
+
+    IFittingAlgorithm* createFitter(fitterKind fitter)
+    {
+        if(fitter == kalmanFitter)
+            return new KalmanFitter;
+
+#ifdef USE_GBL
+        return new GBLInterface;
+#else
+        return 0;
+#endif
+    }
+
+
+
+    barrelTrack::barrelTrack(unsigned nHits) :
+        _geometry(new SimpleGeometry(bz)), _seed(), _hits(), _precision(2, 1. / (resolution * resolution))
+    {
+        // nHits equidistant layers
+        std::vector<double> radii;
+
+        for(unsigned i = 0 ; i < nHits ; ++i)
+            radii.push_back(5. + i * 175. / (nHits > 1 ? nHits - 1 : 1));
+
+        _geometry->addBarrel(radii, 300., 0.03);
+
+        // a 5 GeV track
+        Vector5 hp;
+        hp(OMEGA) = convertBr2P_cm * bz / 5.;
+        hp(TANL) = 0.3;
+        hp(PHI0) = 0.5;
+        hp(D0) = 0.005;
+        hp(Z0) = 0.05;
+
+        fiveByFiveMatrix covariance;
+        covariance.Unit();
+
+        _seed.setTrackParameters(hp, covariance, Vector3D());
+
+        // the measurements are displaced from the intersections by up to one sigma in u and v
+        trajectory traj(_seed, _geometry);
+        const IntersectionVec& intersections = traj.getIntersectionsWithSurfaces();
+
+        if(intersections.size() != nHits)
+            throw std::runtime_error("barrelTrack: the track does not cross all layers of the barrel");
+
+        for(unsigned i = 0 ; i < intersections.size() ; ++i)
+            {
+                const ISurface& surface = *intersections[i].second;
+                const Vector3D xx = pointAt(intersections[i].first, _seed);
+
+                const double du = resolution * (int((i * 7) % 11) - 5) / 5.;
+                const double dv = resolution * (int((i * 5) % 7) - 3) / 3.;
+
+                _hits.push_back(xx + du * surface.u(xx) + dv * surface.v(xx));
+            }
+
+        // the hits are within one sigma of the seed, i.e. a fit of the seed must give a chi2/ndf below one
+        KalmanFitter fitter;
+        analyticalPropagation propagation;
+
+        trajectory fitTraj(_seed, &fitter, &propagation, _geometry);
+        addMeasurements(fitTraj, fitTraj.getIntersectionsWithSurfaces());
+        fitTraj.prepareForFitting();
+
+        if(!fitTraj.fit() || fitTraj.fitOutput()->ndf() == 0
+           || !(fitTraj.fitOutput()->chiSquare() < fitTraj.fitOutput()->ndf()))
+            throw std::runtime_error("barrelTrack: the fit of the seed does not give a sane chi2/ndf");
+    }
+
+
+
+    barrelTrack::~barrelTrack()
+    {
+        delete _geometry;
+    }
+
+
+
+    void barrelTrack::addMeasurements(trajectory& traj, const IntersectionVec& intersections) const
+    {
+        for(unsigned i = 0 ; i < intersections.size() ; ++i)
+            traj.addMeasurement(_hits[i], _precision, *intersections[i].second, 0, true);
+    }
+
+
+
+    trajectoryFitBenchmark::trajectoryFitBenchmark(unsigned nHits, fitterKind fitter, bool resetTrajectory) :
+        Benchmark(benchmarkName("trajectoryFit", nHits, fitter, resetTrajectory), nHits, "hit"),
+        _nHits(nHits), _fitterKind(fitter), _resetTrajectory(resetTrajectory),
+        _track(0), _fitter(0), _propagation(0), _trajectory(0)
+    {
+    }
+
+
+
+    trajectoryFitBenchmark::~trajectoryFitBenchmark()
+    {
+        delete _trajectory;
+        delete _propagation;
+        delete _fitter;
+        delete _track;
+    }
+
+
+
+    void trajectoryFitBenchmark::setUp()
+    {
+        if(_track != 0)
+            return;
+
+        _track = new barrelTrack(_nHits);
+        _fitter = createFitter(_fitterKind);
+        _propagation = new analyticalPropagation;
+
+        if(_resetTrajectory)
+            {
+                _trajectory = new trajectory(_track->seed(), _fitter, _propagation, &_track->geometry());
+                _trajectory->reserve(_nHits + 1);
+            }
+    }
+
+
+
+    void trajectoryFitBenchmark::_fit(trajectory& traj)
+    {
+        _track->addMeasurements(traj, traj.getIntersectionsWithSurfaces());
+
+        traj.prepareForFitting();
+
+        if(traj.fit())
+            _checksum += traj.fitOutput()->chiSquare();
+    }
+
+
+
+    void trajectoryFitBenchmark::run(unsigned nOps)
+    {
+        for(unsigned i = 0 ; i < nOps ; ++i)
+            {
+                if(_resetTrajectory)
+                    {
+                        _trajectory->reset(_track->seed());
+                        _fit(*_trajectory);
+                    }
+                else
+                    {
+                        trajectory traj(_track->seed(), _fitter, _propagation, &_track->geometry());
+                        _fit(traj);
+                    }
+            }
+    }
+
+
+
+    fitResultsBenchmark::fitResultsBenchmark(unsigned nHits, fitterKind fitter) :
+        Benchmark(benchmarkName("getAllResults", nHits, fitter), nHits + 1, "label"),
+        _nHits(nHits), _fitterKind(fitter), _track(0), _fitter(0), _propagation(0), _trajectory(0), _results()
+    {
+    }
+
+
+
+    fitResultsBenchmark::~fitResultsBenchmark()
+    {
+        delete _trajectory;
+        delete _propagation;
+        delete _fitter;
+        delete _track;
+    }
+
+
+
+    void fitResultsBenchmark::setUp()
+    {
+        if(_track != 0)
+            return;
+
+        _track = new barrelTrack(_nHits);
+        _fitter = createFitter(_fitterKind);
+        _propagation = new analyticalPropagation;
+
+        _trajectory = new trajectory(_track->seed(), _fitter, _propagation, &_track->geometry());
+
+        _track->addMeasurements(*_trajectory, _trajectory->getIntersectionsWithSurfaces());
+        _trajectory->prepareForFitting();
+
+        if(!_trajectory->fit())
+            throw std::runtime_error(name() + ": the fit failed");
+    }
+
+
+
+    void fitResultsBenchmark::run(unsigned nOps)
+    {
+        const IFitOutput& output = *_trajectory->fitOutput();
+
+        for(unsigned i = 0 ; i < nOps ; ++i)
+            {
+                output.getAllResults(_results);
+                _checksum += _results.back().estimatedParameters().parameters()(OMEGA);
+            }
+    }
+
+} // namespace Benchmarking
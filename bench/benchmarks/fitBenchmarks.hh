@@ -0,0 +1,106 @@
+#ifndef FITBENCHMARKS_HH
+#define FITBENCHMARKS_HH
+
+/// macro benchmarks: building and fitting complete trajectories
+#include "Benchmark.hh"
+#include "SimpleGeometry.hh"
+
+#include "trajectory.hh"
+#include "fitResults.hh"
+
+#include <vector>
+
+namespace Benchmarking
+{
+
+    enum fitterKind { kalmanFitter, gblFitter };
+
+    /// the name of the fitter used in the benchmark names
+    const char* fitterName(fitterKind fitter);
+
+    /// a new fitter of the given kind - NULL if it is not available in this build
+    aidaTT::IFittingAlgorithm* createFitter(fitterKind fitter);
+
+
+    /** A track with one measurement on every layer of a barrel of nHits cylinders between
+     *  5 and 180 cm, as input for the fit benchmarks.
+     */
+    class barrelTrack
+    {
+        public:
+            barrelTrack(unsigned nHits);
+            ~barrelTrack();
+
+            const aidaTT::SimpleGeometry& geometry() const { return *_geometry; }
+            const aidaTT::trackParameters& seed() const { return _seed; }
+
+            /// add the measurements to the trajectory, after its intersections have been computed
+            void addMeasurements(aidaTT::trajectory& traj, const aidaTT::IntersectionVec& intersections) const;
+
+        private:
+            barrelTrack(const barrelTrack&);
+            barrelTrack& operator=(const barrelTrack&);
+
+            aidaTT::SimpleGeometry* _geometry;
+            aidaTT::trackParameters _seed;
+            std::vector<aidaTT::Vector3D> _hits;
+            std::vector<double> _precision;
+    };
+
+
+    /** The full fit of one track: computing the intersections, adding the measurements,
+     *  prepareForFitting() and fit(). Either a new trajectory is created for every track or one
+     *  trajectory is reset().
+     */
+    class trajectoryFitBenchmark : public Benchmark
+    {
+        public:
+            trajectoryFitBenchmark(unsigned nHits, fitterKind fitter, bool resetTrajectory);
+            ~trajectoryFitBenchmark();
+
+            void setUp();
+            void run(unsigned nOps);
+
+        private:
+            trajectoryFitBenchmark(const trajectoryFitBenchmark&);
+            trajectoryFitBenchmark& operator=(const trajectoryFitBenchmark&);
+
+            void _fit(aidaTT::trajectory& traj);
+
+            unsigned _nHits;
+            fitterKind _fitterKind;
+            bool _resetTrajectory;
+
+            barrelTrack* _track;
+            aidaTT::IFittingAlgorithm* _fitter;
+            aidaTT::IPropagation* _propagation;
+            aidaTT::trajectory* _trajectory;
+    };
+
+
+    /// the transformation of the fit output to the fit results at all labels - IFitOutput::getAllResults()
+    class fitResultsBenchmark : public Benchmark
+    {
+        public:
+            fitResultsBenchmark(unsigned nHits, fitterKind fitter);
+            ~fitResultsBenchmark();
+
+            void setUp();
+            void run(unsigned nOps);
+
+        private:
+            fitResultsBenchmark(const fitResultsBenchmark&);
+            fitResultsBenchmark& operator=(const fitResultsBenchmark&);
+
+            unsigned _nHits;
+            fitterKind _fitterKind;
+
+            barrelTrack* _track;
+            aidaTT::IFittingAlgorithm* _fitter;
+            aidaTT::IPropagation* _propagation;
+            aidaTT::trajectory* _trajectory;
+            std::vector<aidaTT::fitResults> _results;
+    };
+
+} // namespace Benchmarking
+#endif // FITBENCHMARKS_HH
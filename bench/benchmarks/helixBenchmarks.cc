@@ -0,0 +1,437 @@
+#include "helixBenchmarks.hh"
+
+#include "helixUtils.hh"
+#include "materialUtils.hh"
+#include "utilities.hh"
+#include "trackParameterizationLCIO.hh"
+#include "aidaTT-Units.hh"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace aidaTT;
+
+namespace
+{
+    /// the number of helices in the samples
+    const unsigned nHelices = 256;
+
+    const double bz = 3.5;
+
+    /// the length of the propagations and moves in cm
+    const double pathLength = 30.;
+}
+
+
+
+namespace Benchmarking
+{
+
+    void makeHelixSample(std::vector<trackParameters>& helices, unsigned n, double bfield)
+    {
+        helices.clear();
+        helices.reserve(n);
+
+        // a low discrepancy sequence - the sample is the same for every run
+        const double golden = 0.5 * (std::sqrt(5.) - 1.);
+
+        fiveByFiveMatrix covariance;
+        covariance.Unit();
+        covariance(OMEGA, OMEGA) = 1.e-8;
+        covariance(TANL, TANL) = 1.e-6;
+        covariance(PHI0, PHI0) = 1.e-6;
+        covariance(D0, D0) = 1.e-4;
+        covariance(Z0, Z0) = 1.e-4;
+
+        for(unsigned i = 0 ; i < n ; ++i)
+            {
+                const double u = std::fmod(i * golden, 1.);
+                const double w = (i + 0.5) / n;
+
+                const double pt = 0.5 * std::pow(20., u);
+                const double charge = (i % 2 ? -1. : 1.);
+
+                Vector5 hp;
+                hp(OMEGA) = charge * convertBr2P_cm * bfield / pt;
+                hp(TANL) = -2. + 4. * std::fmod(3. * u + w, 1.);
+                hp(PHI0) = -M_PI + 2. * M_PI * w;
+                hp(D0) = 0.01 * (2. * u - 1.);
+                hp(Z0) = 0.1 * (2. * w - 1.);
+
+                trackParameters tp;
+                tp.setTrackParameters(hp, covariance, Vector3D());
+
+                helices.push_back(tp);
+            }
+    }
+
+
+
+    intersectionBenchmark::intersectionBenchmark(surfaceKind kind, bool useRecords) :
+        Benchmark(std::string(kind == zCylinder ? "intersectWithZCylinder" :
+                              kind == zPlane ? "intersectWithZPlane" :
+                              kind == zDisk ? "intersectWithZDisk" :
+                              kind == zCone ? "intersectWithZCone" : "intersectWithPlane") + (useRecords ? "/records" : "")),
+        _kind(kind), _useRecords(useRecords), _intersect(0), _geometry(0), _helices(), _targets(), _targetRecords()
+    {
+    }
+
+
+
+    intersectionBenchmark::~intersectionBenchmark()
+    {
+        delete _geometry;
+    }
+
+
+
+    void intersectionBenchmark::setUp()
+    {
+        delete _geometry;
+        _geometry = new SimpleGeometry(bz);
+
+        switch(_kind)
+            {
+                case zCylinder:
+                    _intersect = intersectWithZCylinder;
+                    _geometry->addSurface(new SimpleCylinder(1, 40., 150., 0.03));
+                    break;
+
+                case zPlane:
+                    {
+                        // an octagon of planes around the z axis
+                        _intersect = intersectWithZPlane;
+                        const double width = 2. * 40. * std::tan(M_PI / 8.);
+
+                        for(unsigned i = 0 ; i < 8 ; ++i)
+                            {
+                                const double phi = i * M_PI / 4.;
+                                const Vector3D n(std::cos(phi), std::sin(phi), 0.);
+                                const Vector3D u(-std::sin(phi), std::cos(phi), 0.);
+
+                                _geometry->addSurface(new SimplePlane(i + 1, 40. * n, u, Vector3D(0., 0., 1.), width, 300., 0.03));
+                            }
+                        break;
+                    }
+
+                case zDisk:
+                    _intersect = intersectWithZDisk;
+                    _geometry->addSurface(new SimpleDisk(1, 100., 0., 150., 0.03));
+                    _geometry->addSurface(new SimpleDisk(2, -100., 0., 150., 0.03));
+                    break;
+
+                case zCone:
+                    _intersect = intersectWithZCone;
+                    _geometry->addSurface(new SimpleCone(1, 20., 30., 150., 60., 0.03));
+                    _geometry->addSurface(new SimpleCone(2, -20., 30., -150., 60., 0.03));
+                    break;
+
+                case tiltedPlane:
+                    {
+                        // forward and backward petals tilted by 0.3 rad
+                        _intersect = intersectWithPlane;
+                        const Vector3D u(1., 0., 0.);
+
+                        _geometry->addSurface(new SimplePlane(1, Vector3D(0., 0., 100.), u, Vector3D(0., std::cos(0.3), std::sin(0.3)), 300., 300., 0.03));
+                        _geometry->addSurface(new SimplePlane(2, Vector3D(0., 0., -100.), u, Vector3D(0., std::cos(0.3), -std::sin(0.3)), 300., 300., 0.03));
+                        break;
+                    }
+            }
+
+        // keep the helices that intersect one of the surfaces and remember the surface
+        std::vector<trackParameters> sample;
+        makeHelixSample(sample, nHelices, bz);
+
+        _helices.clear();
+        _targets.clear();
+        _targetRecords.clear();
+
+        const std::vector<const ISurface*>& surfaces = _geometry->getSurfaces();
+        const SurfaceRecords& records = *_geometry->getSurfaceRecords();
+
+        for(unsigned i = 0 ; i < sample.size() ; ++i)
+            for(unsigned j = 0 ; j < surfaces.size() ; ++j)
+                {
+                    double s = 0.;
+                    Vector3D xx;
+
+                    if(_intersect(surfaces[j], sample[i].parameters(), sample[i].referencePoint(), s, xx, 1, true))
+                        {
+                            _helices.push_back(sample[i]);
+                            _targets.push_back(surfaces[j]);
+                            _targetRecords.push_back(&records[j]);
+                            break;
+                        }
+                }
+
+        if(_helices.empty())
+            throw std::runtime_error(name() + ": no helix of the sample intersects the surfaces");
+    }
+
+
+
+    void intersectionBenchmark::run(unsigned nOps)
+    {
+        const unsigned n = _helices.size();
+
+        double s = 0.;
+        Vector3D xx;
+
+        if(_useRecords)
+            {
+                for(unsigned i = 0, k = 0 ; i < nOps ; ++i)
+                    {
+                        if(intersectWithSurface(*_targetRecords[k], _helices[k].parameters(), _helices[k].referencePoint(), s, xx, 1, true))
+                            _checksum += s;
+
+                        if(++k == n)
+                            k = 0;
+                    }
+                return;
+            }
+
+        for(unsigned i = 0, k = 0 ; i < nOps ; ++i)
+            {
+                if(_intersect(_targets[k], _helices[k].parameters(), _helices[k].referencePoint(), s, xx, 1, true))
+                    _checksum += s;
+
+                if(++k == n)
+                    k = 0;
+            }
+    }
+
+
+
+    moveHelixBenchmark::moveHelixBenchmark(bool withCovariance) :
+        Benchmark(withCovariance ? "moveHelixTo/covariance" : "moveHelixTo"),
+        _withCovariance(withCovariance), _helices(), _targets(), _moved()
+    {
+    }
+
+
+
+    void moveHelixBenchmark::setUp()
+    {
+        makeHelixSample(_helices, nHelices, bz);
+
+        _targets.clear();
+
+        for(unsigned i = 0 ; i < _helices.size() ; ++i)
+            _targets.push_back(pointAt(pathLength, _helices[i]));
+    }
+
+
+
+    void moveHelixBenchmark::run(unsigned nOps)
+    {
+        const unsigned n = _helices.size();
+
+        for(unsigned i = 0, k = 0 ; i < nOps ; ++i)
+            {
+                _moved = _helices[k];
+                _checksum += moveHelixTo(_moved, _targets[k], _withCovariance);
+
+                if(++k == n)
+                    k = 0;
+            }
+    }
+
+
+
+    jacobianBenchmark::jacobianBenchmark() :
+        Benchmark("analyticalPropagation::getJacobian"),
+        _propagation(), _qOverP(), _pathLength(), _tStart(), _tEnd(), _jacobian()
+    {
+    }
+
+
+
+    void jacobianBenchmark::setUp()
+    {
+        std::vector<trackParameters> helices;
+        makeHelixSample(helices, nHelices, bz);
+
+        _qOverP.clear();
+        _pathLength.clear();
+        _tStart.clear();
+        _tEnd.clear();
+
+        for(unsigned i = 0 ; i < helices.size() ; ++i)
+            {
+                _qOverP.push_back(calculateQoverP(helices[i], bz));
+                _pathLength.push_back(pathLength / std::cos(calculateLambda(helices[i])));
+                _tStart.push_back(calculateTangent(0., helices[i]));
+                _tEnd.push_back(calculateTangent(pathLength, helices[i]));
+            }
+    }
+
+
+
+    void jacobianBenchmark::run(unsigned nOps)
+    {
+        // getJacobian() is only public in the interface
+        IPropagation& propagation = _propagation;
+
+        const unsigned n = _qOverP.size();
+        const Vector3D bfield(0., 0., bz);
+
+        for(unsigned i = 0, k = 0 ; i < nOps ; ++i)
+            {
+                propagation.getJacobian(_jacobian, _pathLength[k], _qOverP[k], _tStart[k], _tEnd[k], bfield, 0.);
+                _checksum += _jacobian(2, 0);
+
+                if(++k == n)
+                    k = 0;
+            }
+    }
+
+
+
+    curvilinearJacobianBenchmark::curvilinearJacobianBenchmark() :
+        Benchmark("curvilinearToL3Jacobian"), _helices()
+    {
+    }
+
+
+
+    void curvilinearJacobianBenchmark::setUp()
+    {
+        makeHelixSample(_helices, nHelices, bz);
+    }
+
+
+
+    void curvilinearJacobianBenchmark::run(unsigned nOps)
+    {
+        const unsigned n = _helices.size();
+        const Vector3D bfield(0., 0., bz);
+
+        for(unsigned i = 0, k = 0 ; i < nOps ; ++i)
+            {
+                _checksum += curvilinearToL3Jacobian(_helices[k], bfield)(0, 0);
+
+                if(++k == n)
+                    k = 0;
+            }
+    }
+
+
+
+    materialBenchmark::materialBenchmark(bool energyLoss) :
+        Benchmark(energyLoss ? "computeEnergyLoss" : "computeQMS"),
+        _energyLoss(energyLoss), _geometry(0), _helices()
+    {
+    }
+
+
+
+    materialBenchmark::~materialBenchmark()
+    {
+        delete _geometry;
+    }
+
+
+
+    void materialBenchmark::setUp()
+    {
+        delete _geometry;
+        _geometry = new SimpleGeometry(bz);
+        _geometry->addSurface(new SimpleCylinder(1, 40., 150., 0.03));
+
+        std::vector<trackParameters> sample;
+        makeHelixSample(sample, nHelices, bz);
+
+        // only the helices crossing the cylinder, such that the material is computed every time
+        _helices.clear();
+
+        const ISurface* cylinder = _geometry->getSurfaces()[0];
+
+        for(unsigned i = 0 ; i < sample.size() ; ++i)
+            {
+                double s = 0.;
+                Vector3D xx;
+
+                if(intersectWithSurface(cylinder, sample[i], s, xx, 0, true))
+                    _helices.push_back(sample[i]);
+            }
+    }
+
+
+
+    void materialBenchmark::run(unsigned nOps)
+    {
+        const ISurface* cylinder = _geometry->getSurfaces()[0];
+        const unsigned n = _helices.size();
+
+        double energy = 0.;
+        double beta = 0.;
+
+        for(unsigned i = 0, k = 0 ; i < nOps ; ++i)
+            {
+                if(_energyLoss)
+                    _checksum += computeEnergyLoss(cylinder, _helices[k], energy, beta, pionMass);
+                else
+                    _checksum += computeQMS(cylinder, _helices[k].parameters(), _helices[k].referencePoint(), pionMass);
+
+                if(++k == n)
+                    k = 0;
+            }
+    }
+
+
+
+
+    betheBlochBenchmark::betheBlochBenchmark(bool tabulated) :
+        Benchmark(tabulated ? "computeEnergyLoss/tabulated" : "computeEnergyLoss/cached"),
+        _tabulated(tabulated), _geometry(0), _momenta()
+    {
+    }
+
+
+
+    betheBlochBenchmark::~betheBlochBenchmark()
+    {
+        delete _geometry;
+    }
+
+
+
+    void betheBlochBenchmark::setUp()
+    {
+        delete _geometry;
+        _geometry = new SimpleGeometry(bz);
+        _geometry->addSurface(new SimpleCylinder(1, 40., 150., 0.03));
+
+        if(_tabulated)
+            _geometry->tabulateEnergyLoss(std::vector<double>(1, pionMass));
+
+        // the momenta of the helix sample
+        std::vector<trackParameters> sample;
+        makeHelixSample(sample, nHelices, bz);
+
+        _momenta.clear();
+
+        for(unsigned i = 0 ; i < sample.size() ; ++i)
+            _momenta.push_back(std::fabs(convertBr2P_cm * bz / calculateOmega(sample[i])) * std::sqrt(1. + std::pow(calculateTanLambda(sample[i]), 2)));
+    }
+
+
+
+    void betheBlochBenchmark::run(unsigned nOps)
+    {
+        const surfaceMaterial& material = *_geometry->getSurfaceMaterial(_geometry->getSurfaces()[0]);
+        const unsigned n = _momenta.size();
+
+        double energy = 0.;
+        double beta = 0.;
+
+        for(unsigned i = 0, k = 0 ; i < nOps ; ++i)
+            {
+                _checksum += computeEnergyLoss(material, 1., _momenta[k], energy, beta, pionMass);
+
+                if(++k == n)
+                    k = 0;
+            }
+    }
+
+} // namespace Benchmarking
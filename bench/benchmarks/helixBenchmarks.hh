@@ -0,0 +1,144 @@
+#ifndef HELIXBENCHMARKS_HH
+#define HELIXBENCHMARKS_HH
+
+/// micro benchmarks of the helix, propagation and material utilities
+#include "Benchmark.hh"
+#include "SimpleGeometry.hh"
+
+#include "trackParameters.hh"
+#include "analyticalPropagation.hh"
+
+#include <vector>
+
+namespace Benchmarking
+{
+
+    /** A fixed sample of n helices starting close to the origin: pt between 0.5 and 10 GeV in the
+     *  field bz, alternating charge, all azimuth angles and tan(lambda) between -2 and 2.
+     */
+    void makeHelixSample(std::vector<aidaTT::trackParameters>& helices, unsigned n, double bz);
+
+
+    /// the intersection of the helix sample with one surface type - with the ISurface or with its surfaceRecord
+    class intersectionBenchmark : public Benchmark
+    {
+        public:
+            enum surfaceKind { zCylinder, zPlane, zDisk, zCone, tiltedPlane };
+
+            intersectionBenchmark(surfaceKind kind, bool useRecords = false);
+            ~intersectionBenchmark();
+
+            void setUp();
+            void run(unsigned nOps);
+
+        private:
+            intersectionBenchmark(const intersectionBenchmark&);
+            intersectionBenchmark& operator=(const intersectionBenchmark&);
+
+            typedef bool (*intersectionFunction)(const aidaTT::ISurface*, const aidaTT::Vector5&, const aidaTT::Vector3D&,
+                                                 double&, aidaTT::Vector3D&, int, bool);
+
+            surfaceKind _kind;
+            bool _useRecords;
+            intersectionFunction _intersect;
+            aidaTT::SimpleGeometry* _geometry;
+
+            ///< the helices and the surface each of them intersects
+            std::vector<aidaTT::trackParameters> _helices;
+            std::vector<const aidaTT::ISurface*> _targets;
+            std::vector<const aidaTT::surfaceRecord*> _targetRecords;
+    };
+
+
+    /// moveHelixTo() a point on the helix, with or without transporting the covariance matrix
+    class moveHelixBenchmark : public Benchmark
+    {
+        public:
+            moveHelixBenchmark(bool withCovariance);
+
+            void setUp();
+            void run(unsigned nOps);
+
+        private:
+            bool _withCovariance;
+            std::vector<aidaTT::trackParameters> _helices;
+            std::vector<aidaTT::Vector3D> _targets;
+            aidaTT::trackParameters _moved;
+    };
+
+
+    /// analyticalPropagation::getJacobian() over 30 cm
+    class jacobianBenchmark : public Benchmark
+    {
+        public:
+            jacobianBenchmark();
+
+            void setUp();
+            void run(unsigned nOps);
+
+        private:
+            aidaTT::analyticalPropagation _propagation;
+            std::vector<double> _qOverP;
+            std::vector<double> _pathLength;
+            std::vector<aidaTT::Vector3D> _tStart;
+            std::vector<aidaTT::Vector3D> _tEnd;
+            aidaTT::fiveByFiveMatrix _jacobian;
+    };
+
+
+    /// curvilinearToL3Jacobian()
+    class curvilinearJacobianBenchmark : public Benchmark
+    {
+        public:
+            curvilinearJacobianBenchmark();
+
+            void setUp();
+            void run(unsigned nOps);
+
+        private:
+            std::vector<aidaTT::trackParameters> _helices;
+    };
+
+
+    /// computeQMS() or computeEnergyLoss() for the helix sample crossing a cylinder
+    class materialBenchmark : public Benchmark
+    {
+        public:
+            materialBenchmark(bool energyLoss);
+            ~materialBenchmark();
+
+            void setUp();
+            void run(unsigned nOps);
+
+        private:
+            materialBenchmark(const materialBenchmark&);
+            materialBenchmark& operator=(const materialBenchmark&);
+
+            bool _energyLoss;
+            aidaTT::SimpleGeometry* _geometry;
+            std::vector<aidaTT::trackParameters> _helices;
+    };
+
+
+
+    /// computeEnergyLoss() with the precomputed surface material - analytic or tabulated
+    class betheBlochBenchmark : public Benchmark
+    {
+        public:
+            betheBlochBenchmark(bool tabulated);
+            ~betheBlochBenchmark();
+
+            void setUp();
+            void run(unsigned nOps);
+
+        private:
+            betheBlochBenchmark(const betheBlochBenchmark&);
+            betheBlochBenchmark& operator=(const betheBlochBenchmark&);
+
+            bool _tabulated;
+            aidaTT::SimpleGeometry* _geometry;
+            std::vector<double> _momenta;
+    };
+
+} // namespace Benchmarking
+#endif // HELIXBENCHMARKS_HH
@@ -35,3 +35,15 @@ IF( USE_CXX11 )
 ELSE()
   MESSAGE( STATUS "NOT building with CXX11 standard" )
 ENDIF()
+
+OPTION( AIDATT_NATIVE_ARCH "Optimize for the instruction set of the build machine (e.g. AVX2/AVX-512 for the batched helix intersections)" False )
+IF( AIDATT_NATIVE_ARCH )
+  SET( FLAG "-march=native" )
+  CHECK_CXX_COMPILER_FLAG( ${FLAG} CXX_FLAG_WORKS_${FLAG} )
+  IF( ${CXX_FLAG_WORKS_${FLAG}} )
+    MESSAGE ( STATUS "Adding ${FLAG} to CXX_FLAGS" )
+    SET( CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${FLAG}")
+  ELSE()
+    MESSAGE( STATUS "NOT Adding ${FLAG} to CXX_FLAGS" )
+  ENDIF()
+ENDIF()
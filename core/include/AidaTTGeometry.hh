@@ -2,8 +2,8 @@
 
 //
 // This file should only be used when aidaTT is not compiled with DD4hep.
-// It defines the same interface ofr surfaces and vectors as in DD4hep.
-// However, there is now real geometry implementation then ...
+// It defines the same interface for surfaces and vectors as in DD4hep.
+// An implementation of the geometry is given in SimpleGeometry.hh.
 //
 
 #ifndef AidaTTGeometry_hh
@@ -11,8 +11,11 @@
 
 
 #include "Vector3D.hh"
-//#include <ostream>
 #include <bitset>
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <vector>
 
 namespace aidaTT
 {
@@ -101,6 +104,15 @@ namespace aidaTT
     /** Distance to surface */
     virtual double distance(const Vector3D& point) const = 0 ;
 
+    /// the length of the surface along direction u at the origin
+    virtual double length_along_u() const = 0 ;
+
+    /// the length of the surface along direction v at the origin
+    virtual double length_along_v() const = 0 ;
+
+    /// lines that can be used for drawing the surface (at most nMax)
+    virtual std::vector< std::pair<Vector3D, Vector3D> > getLines(unsigned nMax = 100) = 0 ;
+
   } ;
 
   //==============================================================================================
@@ -116,6 +128,24 @@ namespace aidaTT
     /// Destructor
     virtual ~ICylinder() {}
     virtual double radius() const = 0 ;
+    virtual Vector3D center() const = 0 ;
+  };
+
+  //==============================================================================================
+  /** Minimal interface to provide acces to the radii and z range of cone surfaces.
+  * @author F. Gaede, DESY
+  */
+  class ICone
+  {
+
+  public:
+    /// Destructor
+    virtual ~ICone() {}
+    virtual double radius0() const = 0 ;
+    virtual double radius1() const = 0 ;
+    virtual double z0() const = 0 ;
+    virtual double z1() const = 0 ;
+    virtual Vector3D center() const = 0 ;
   };
 
   //==============================================================================================
@@ -140,7 +170,10 @@ namespace aidaTT
 	Helper,
 	ParallelToZ,
 	OrthogonalToZ,
-	Invisible
+	Invisible,
+	Measurement1D,
+	Cone,
+	Unbounded
       } ;
 
     ///default c'tor
@@ -218,6 +251,24 @@ namespace aidaTT
       return _bits[ SurfaceType::OrthogonalToZ ] ;
     }
 
+    /// true if this a conical surface
+    bool isCone() const
+    {
+      return _bits[ SurfaceType::Cone ] ;
+    }
+
+    /// true if the surface only measures in u direction
+    bool isMeasurement1D() const
+    {
+      return _bits[ SurfaceType::Measurement1D ] ;
+    }
+
+    /// true if the surface is not bounded, i.e. insideBounds() only checks the distance
+    bool isUnbounded() const
+    {
+      return _bits[ SurfaceType::Unbounded ] ;
+    }
+
     /// true if surface is not invisble - for drawing only
     bool isVisible() const
     {
@@ -243,6 +294,13 @@ namespace aidaTT
     }
 
 
+    /// true if this is a cone with its axis along Z
+    bool isZCone() const
+    {
+      return (_bits[ SurfaceType::Cone ] &&  _bits[ SurfaceType::ParallelToZ ]) ;
+    }
+
+
     /// true if all properties of otherType are also true for this type.
     bool isSimilar(const SurfaceType& otherType) const
     {
@@ -295,13 +353,55 @@ namespace aidaTT
     
     os << "sensitive[" << t.isSensitive() << "] helper[" << t.isHelper() << "] plane[" << t.isPlane()  << "] cylinder[" << t.isCylinder()
        << "] parallelToZ[" << t.isParallelToZ()  << "] orthogonalToZ[" << t. isOrthogonalToZ()  << "] zCylinder[" << t.isZCylinder()
-       <<  "] zPlane[" << t.isZPlane()  <<  "] zDisk[" << t.isZDisk() << "]"  ;
+       <<  "] zPlane[" << t.isZPlane()  <<  "] zDisk[" << t.isZDisk() << "] cone[" << t.isCone() << "]"  ;
     
     return os ;
   }
   
   
   
+  /** Interface for material description for tracking.
+   *
+   * @author F. Gaede, DESY
+   */
+  class IMaterial
+  {
+
+  public:
+    /// Destructor
+    virtual ~IMaterial() {}
+
+    /// material name
+    virtual std::string name() const = 0 ;
+
+    /// averaged proton number
+    virtual double Z() const = 0 ;
+
+    /// averaged atomic number
+    virtual double A() const = 0 ;
+
+    /// density - units ?
+    virtual double density() const = 0 ;
+
+    /// radiation length - units ?
+    virtual double radiationLength() const = 0 ;
+
+    /// interaction length - units ?
+    virtual double interactionLength() const = 0 ;
+
+  };
+
+  /// dump IMaterial operator
+  inline std::ostream& operator<<( std::ostream& os , const IMaterial& m ) {
+
+    os << "  " << m.name() << ", Z: " << m.Z() << ", A: " << m.A() << ", density: " << m.density()
+       << ", radiationLength: " << m.radiationLength() << ", interactionLength: " << m.interactionLength() ;
+
+    return os ;
+  }
+
+
+
   /// dump ISurface operator
   inline std::ostream& operator<<( std::ostream& os , const ISurface& s ) {
     
@@ -319,28 +419,10 @@ namespace aidaTT
   }
   
   
-  class IMaterial
-  {
-
-  public:
-    /// averaged proton number
-    virtual double getZ() const = 0 ;
-
-    /// averaged atomic number
-    virtual double getA() const = 0 ;
-
-    /// density - units ?
-    virtual double getDensity() const = 0 ;
-
-    /// radiation length - units ?
-    virtual double getRadiationLength() const = 0 ;
-
-    /// interaction length - units ?
-    virtual double getInteractionLength() const = 0 ;
-
-  };
 }
 
 
 
-#endif
+#endif // AidaTTGeometry_hh
+
+#endif // AIDATT_USE_DD4HEP
@@ -0,0 +1,46 @@
+#ifndef IFITOUTPUT_HH
+#define IFITOUTPUT_HH
+
+#include "fitResults.hh"
+
+#include <vector>
+
+namespace aidaTT
+{
+  /** The outcome of a single track fit as returned by IFittingAlgorithm::fitTrajectory().
+   *  The object owns all state of the fit, so that one fitting algorithm can be used
+   *  for many fits at the same time, e.g. from several threads.
+   *  The fit results at a given label are only computed when requested.
+   *
+   *  The label is the index of the element in trajectory::trajectoryElements() - label 0 is the
+   *  initial element at s=0 - and the results are given at the reference point of this element.
+   *  All fitting algorithms follow this convention, whatever numbering they use internally.
+   */
+  class IFitOutput
+  {
+  public:
+    /// true if the fit was successful
+    virtual bool isValid() const = 0;
+
+    /// chi2 of the fit
+    virtual double chiSquare() const = 0;
+
+    /// number of degrees of freedom of the fit
+    virtual unsigned int ndf() const = 0;
+
+    /// weight lost by down-weighting of outliers
+    virtual double weightLost() const = 0;
+
+    /// the fit results at the trajectory element label - NULL if there is no such element, the memory is owned by this object
+    virtual const fitResults* getResults(int label=0) const = 0;
+
+    /** The fit results at all labels in one pass: results[label] is identical to getResults(label)
+     *  for all trajectory elements. The vector is resized, its capacity is reused.
+     */
+    virtual void getAllResults(std::vector<fitResults>& results) const = 0;
+
+    virtual ~IFitOutput(){}
+  };
+}
+
+#endif // IFITOUTPUT_HH
@@ -2,6 +2,7 @@
 #define IFITTINGALGORITHM_HH
 
 #include "fitResults.hh"
+#include "IFitOutput.hh"
 
 namespace aidaTT
 {
@@ -11,7 +12,24 @@ namespace aidaTT
   {
   public:
     virtual bool fit(const trajectory&)   = 0;
+    /// the results of the last call to fit() at the trajectory element label ( see IFitOutput )
     virtual const fitResults* getResults(int label=0) const  = 0;
+
+    /** Fit the trajectory without modifying the fitting algorithm, i.e. this method
+     *  can be called concurrently for different trajectories.
+     *  The caller takes ownership of the returned object.
+     */
+    virtual IFitOutput* fitTrajectory(const trajectory&) const = 0;
+
+    /** Fit the trajectory as above, reusing the memory of the output of a previous fit with this
+     *  algorithm where possible. The ownership of output ( can be NULL ) is passed to the algorithm,
+     *  the caller takes ownership of the returned object. The default implementation deletes output.
+     */
+    virtual IFitOutput* fitTrajectory(const trajectory& traj, IFitOutput* output) const {
+      delete output ;
+      return fitTrajectory( traj ) ;
+    }
+
     virtual ~IFittingAlgorithm(){}
   };
 }
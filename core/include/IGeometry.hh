@@ -3,6 +3,7 @@
 
 #include <vector>
 
+#include "Vector5.hh"
 
 #ifdef AIDATT_USE_DD4HEP
 //
@@ -14,6 +15,8 @@
 namespace aidaTT
 {
   using dd4hep::rec::ISurface ;
+  using dd4hep::rec::SurfaceType ;
+  using dd4hep::rec::long64 ;
   using dd4hep::rec::ICylinder ;
   using dd4hep::rec::ICone ;
   using dd4hep::rec::IMaterial ;
@@ -25,8 +28,7 @@ namespace aidaTT
 
 // include a copy of the interfaces from DD4hep
 #include "AidaTTGeometry.hh"
-// only meaningfull if there is an implementation
-// other than DD4hep....
+// implemented e.g. by the surfaces of the SimpleGeometry
 
 #endif 
 
@@ -35,10 +37,14 @@ namespace aidaTT
 
 namespace aidaTT {
   
+  struct surfaceMaterial ;
+  class SurfaceRecords ;
+  class SurfaceIdMap ;
+
   /** The geometry interface for aidaTT provides
    *  access to the tracking surfaces and the 
    *  B field.
-   *  For the  implementation see DD4hepGeometry.hh.
+   *  For the  implementations see DD4hepGeometry.hh and SimpleGeometry.hh.
    * 
    * @author C.Rosemann, F.gaede, DESY
    * @version $Id:$
@@ -52,7 +58,72 @@ namespace aidaTT {
     
     /// access the B field in Tesla at given position
     virtual Vector3D getBField( const Vector3D& xx) const = 0;
+
+    /// true if the B field is constant and parallel to z (in the tracking volume) - see constantBz()
+    bool hasConstantBField() const { return _constantBField ; }
+
+    /// the z component of the constant B field in Tesla - only meaningful if hasConstantBField()
+    double constantBz() const { return _constantBz ; }
+
+    /// the z component of the B field in Tesla at given position - no field look up for a constant field
+    double getBz( const Vector3D& xx ) const {
+      return ( _constantBField ? _constantBz : getBField( xx ).z() ) ;
+    }
     
+    /** Fill the surfaces that might be intersected by the helix with parameters hp and
+     *  reference point rp (in the first half arc) into surfaces - in the order of getSurfaces().
+     *  The indices are a buffer owned by the caller, so that repeated look ups do not
+     *  allocate memory: on return indices[k] is the index of surfaces[k] in getSurfaces(),
+     *  e.g. for looking up its record in getSurfaceRecords(). The default implementation
+     *  returns all surfaces.
+     */
+    virtual void getCandidateSurfaces( const Vector5& /*hp*/, const Vector3D& /*rp*/,
+				       std::vector<const ISurface*>& surfaces,
+				       std::vector<unsigned>& indices ) const {
+      surfaces = getSurfaces() ;
+      indices.resize( surfaces.size() ) ;
+      for(unsigned i=0 ; i<indices.size() ; ++i)
+	indices[i] = i ;
+    }
+
+    /// the same with a temporary scratch buffer
+    void getCandidateSurfaces( const Vector5& hp, const Vector3D& rp,
+			       std::vector<const ISurface*>& surfaces ) const {
+      std::vector<unsigned> indices ;
+      getCandidateSurfaces( hp, rp, surfaces, indices ) ;
+    }
+    
+    /** The precomputed material constants of the surface, see MaterialCache - NULL if they are not
+     *  cached by the geometry. The default implementation has no cache.
+     */
+    virtual const surfaceMaterial* getSurfaceMaterial( const ISurface* /*surf*/ ) const {
+      return NULL ;
+    }
+
+    /** The flattened surfaces for the hot loops without virtual calls, in the order of getSurfaces(),
+     *  see SurfaceRecords - NULL if the geometry does not provide them (the default).
+     */
+    virtual const SurfaceRecords* getSurfaceRecords() const {
+      return NULL ;
+    }
+
+    /** The hash table from the surface ids to the surfaces, see SurfaceIdMap - NULL if the
+     *  geometry does not provide it (the default).
+     */
+    virtual const SurfaceIdMap* getSurfaceIdMap() const {
+      return NULL ;
+    }
+
+    /** The surface with the id, e.g. the cellID of a hit - NULL if there is none.
+     *  O(1) with the SurfaceIdMap of the geometry, otherwise a linear search.
+     */
+    const ISurface* findSurface( long64 id ) const ;
+
+    /** Resolve n ids, e.g. the cellIDs of the hits of a track: surfaces[i] is the surface
+     *  with the id ids[i] - NULL if there is none. Returns the number of ids found.
+     */
+    unsigned findSurfaces( unsigned n, const long64* ids, const ISurface** surfaces ) const ;
+
     /// d'tor
     virtual ~IGeometry(){}
     
@@ -63,8 +134,21 @@ namespace aidaTT {
     static const IGeometry& instance() ;
 
   protected:
+
+    IGeometry() : _constantBField( false ), _constantBz( 0. ) {}
+
+    /// to be called by implementations if the B field is constant and parallel to z
+    void setConstantBField( double bz ){
+      _constantBField = true ;
+      _constantBz = bz ;
+    }
     
     static IGeometry* _geom ;
+
+  private:
+
+    bool   _constantBField ;
+    double _constantBz ;
   };
   
 
@@ -3,6 +3,7 @@
 
 #include "fiveByFiveMatrix.hh"
 #include "Vector3D.hh"
+#include "IGeometry.hh"
 
 /* the propagation method abstraction is one of the key concepts in the tracking toolkit
  *
@@ -26,6 +27,9 @@
  *
  * NOTE: currently a single bfield value is used -- so it is assumed to be constant for the time!
  *
+ * The second call getJacobian(..., xstart, ..., geometry, ...) additionally gets the start point
+ * and the geometry, so that propagations can follow a non-uniform field ( see rungeKuttaPropagation ).
+ * By default it ignores them and uses the constant field.
  *
  */
 
@@ -35,6 +39,14 @@ namespace aidaTT
     {
         public:
       virtual bool getJacobian(fiveByFiveMatrix& jac, double dw, double qop, const Vector3D& tstart, const Vector3D& tend, const Vector3D& bfield, double NrjLoss) = 0;
+
+      /// jacobian from the start point xstart over the 3d path length dw in the field of the geometry - bfield is the field at the end point
+      virtual bool getJacobian(fiveByFiveMatrix& jac, double dw, double qop, const Vector3D& /*xstart*/, const Vector3D& tstart, const Vector3D& tend,
+			       const Vector3D& bfield, const IGeometry& /*geometry*/, double NrjLoss)
+      {
+	return getJacobian(jac, dw, qop, tstart, tend, bfield, NrjLoss);
+      }
+
             virtual ~IPropagation(){}
 
     };
@@ -0,0 +1,170 @@
+#ifndef INSTRUMENTATION_HH
+#define INSTRUMENTATION_HH
+
+#include <chrono>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace aidaTT
+{
+
+  class InstrumentationSnapshot ;
+
+  /** Timers and counters for the main stages of the track fit, e.g. for monitoring where the
+   *  time goes in a refit. Every thread counts into its own thread local counters, snapshot()
+   *  aggregates the counters of all threads (also of the threads that have finished already).
+   *
+   *  The instrumentation is enabled at compile time with the cmake option AIDATT_INSTRUMENTATION
+   *  ( -DAIDATT_USE_INSTRUMENTATION ) - otherwise the AIDATT_INSTRUMENT_* macros expand to nothing
+   *  and snapshot() returns zeros.
+   *
+   *  The times are inclusive, e.g. the time of the IntersectZCone stage contains the
+   *  iterations of intersectWithSurfaceNewton() for cones that are (almost) disks, which are
+   *  also counted in IntersectNewton.
+   *
+   *  @code
+   *   Instrumentation::reset() ;
+   *   ... refit the tracks ...
+   *   std::cout << Instrumentation::snapshot() ;
+   *  @endcode
+   */
+  class Instrumentation
+  {
+  public:
+
+    /// the instrumented stages
+    enum Stage {
+      IntersectZCylinder = 0,   ///< intersectWithSurface() for z-cylinders - failures are misses
+      IntersectZPlane,          ///< intersectWithSurface() for z-planes - failures are misses
+      IntersectZDisk,           ///< intersectWithSurface() for z-disks - failures are misses
+      IntersectZCone,           ///< intersectWithSurface() for cones - failures are misses
+      IntersectPlane,           ///< intersectWithSurface() for arbitrarily oriented planes - failures are misses
+      IntersectNewton,          ///< intersectWithSurfaceNewton() - items are the iterations, failures are not converged
+      MaterialQMS,              ///< computeQMS()
+      MaterialEnergyLoss,       ///< computeEnergyLoss()
+      Jacobians,                ///< the jacobians in trajectory::prepareForFitting() - items are the trajectory elements
+      GBLFit,                   ///< GBLInterface::fitTrajectory() - failures are invalid fits
+      KalmanFit,                ///< KalmanFitter::fitTrajectory() - failures are invalid fits
+      FitResults,               ///< the transformation of the fit output to fitResults for one label
+      NStages
+    } ;
+
+    /// true if the library has been compiled with the instrumentation
+    static bool enabled() ;
+
+    /// the counters of all threads since the last reset()
+    static InstrumentationSnapshot snapshot() ;
+
+    /// start counting from zero - for all threads
+    static void reset() ;
+
+    /// the name of the stage
+    static const char* stageName( Stage stage ) ;
+
+    /// the current value of the cycle counter ( the time stamp counter on x86, nanoseconds otherwise )
+    static unsigned long long ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc() ;
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() ;
+#endif
+    }
+
+    /// add one call of the stage to the counters of this thread - used by InstrumentationScope
+    static void record( Stage stage, unsigned long long ticks, bool failed, unsigned long long items ) ;
+  } ;
+
+
+
+  /// the aggregated counters of one stage
+  struct stageStatistics{
+    unsigned long long calls ;
+    unsigned long long failures ;
+    unsigned long long items ;
+    double seconds ;
+
+    stageStatistics() : calls( 0 ), failures( 0 ), items( 0 ), seconds( 0. ) {}
+  } ;
+
+
+
+  /** The counters of all stages, aggregated over all threads at the time of
+   *  Instrumentation::snapshot().
+   */
+  class InstrumentationSnapshot
+  {
+    friend class Instrumentation ;
+
+  public:
+
+    InstrumentationSnapshot() : _nThreads( 0 ) {}
+
+    const stageStatistics& operator[]( Instrumentation::Stage stage ) const { return _stages[ stage ] ; }
+
+    /// the number of threads that have been counted
+    unsigned nThreads() const { return _nThreads ; }
+
+    /// print a table with calls, failures, items, total time and time per call of every stage
+    void print( std::ostream& os ) const ;
+
+    /// write the counters as JSON object
+    void writeJSON( std::ostream& os ) const ;
+
+  private:
+    stageStatistics _stages[ Instrumentation::NStages ] ;
+    unsigned _nThreads ;
+  } ;
+
+  /// prints the table of the snapshot
+  std::ostream& operator<<( std::ostream& os, const InstrumentationSnapshot& snapshot ) ;
+
+
+
+  /// times the enclosing scope and counts it as one call of the stage
+  class InstrumentationScope
+  {
+  public:
+
+    explicit InstrumentationScope( Instrumentation::Stage stage ) :
+      _stage( stage ), _start( Instrumentation::ticks() ), _failed( false ), _items( 0 ) {}
+
+    ~InstrumentationScope(){
+      Instrumentation::record( _stage, Instrumentation::ticks() - _start, _failed, _items ) ;
+    }
+
+    void setSuccess( bool success ){ _failed = !success ; }
+
+    void addItems( unsigned long long n ){ _items += n ; }
+
+  private:
+    InstrumentationScope( const InstrumentationScope& ) ;
+    InstrumentationScope& operator=( const InstrumentationScope& ) ;
+
+    Instrumentation::Stage _stage ;
+    unsigned long long _start ;
+    bool _failed ;
+    unsigned long long _items ;
+  } ;
+
+}
+
+
+/** Macros for instrumenting the code - they expand to nothing without AIDATT_USE_INSTRUMENTATION.
+ *  AIDATT_INSTRUMENT_SCOPE( Stage ) times the rest of the enclosing scope, AIDATT_INSTRUMENT_SUCCESS( ok )
+ *  and AIDATT_INSTRUMENT_ITEMS( n ) refer to the timer of this scope. The arguments are not
+ *  evaluated if the instrumentation is disabled.
+ */
+#ifdef AIDATT_USE_INSTRUMENTATION
+#define AIDATT_INSTRUMENT_SCOPE( stage ) aidaTT::InstrumentationScope aidaTT_instrumentationScope( aidaTT::Instrumentation::stage )
+#define AIDATT_INSTRUMENT_SUCCESS( ok ) aidaTT_instrumentationScope.setSuccess( ok )
+#define AIDATT_INSTRUMENT_ITEMS( n ) aidaTT_instrumentationScope.addItems( n )
+#else
+#define AIDATT_INSTRUMENT_SCOPE( stage )
+#define AIDATT_INSTRUMENT_SUCCESS( ok )
+#define AIDATT_INSTRUMENT_ITEMS( n )
+#endif
+
+#endif // INSTRUMENTATION_HH
@@ -0,0 +1,158 @@
+#ifndef REFITENGINE_HH
+#define REFITENGINE_HH
+
+#include "IGeometry.hh"
+#include "IFittingAlgorithm.hh"
+#include "IPropagation.hh"
+#include "trackParameters.hh"
+#include "fitResults.hh"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace aidaTT
+{
+  class trajectory ;
+
+  /// a measurement of a track to be refitted
+  struct refitHit{
+    Vector3D position ;
+    double precision[2] ;      ///< inverse variances in u and v
+    const ISurface* surface ;
+    void* id ;
+  } ;
+
+
+  /// a track to be refitted: the start parameters and the measurements
+  struct refitJob{
+    trackParameters initialParameters ;
+    std::vector<refitHit> hits ;
+
+    refitJob() : initialParameters(), hits() {}
+  } ;
+
+
+  /** Factory for the fitting algorithm and the propagation used by every worker thread
+   *  of the RefitEngine. The engine owns and deletes the created objects.
+   */
+  class IRefitWorkerFactory{
+
+  public:
+    virtual IFittingAlgorithm* createFitter() const = 0 ;
+    virtual IPropagation* createPropagation() const = 0 ;
+
+    virtual ~IRefitWorkerFactory(){}
+  } ;
+
+
+  /// default factory creating the given types with their default constructors, e.g. refitWorkerFactory<GBLInterface,analyticalPropagation>
+  template <class FITTER, class PROPAGATION>
+  class refitWorkerFactory : public IRefitWorkerFactory{
+
+  public:
+    IFittingAlgorithm* createFitter() const { return new FITTER ; }
+    IPropagation* createPropagation() const { return new PROPAGATION ; }
+  } ;
+
+
+  /** Multi-threaded refit of many tracks. The jobs of one call to refit() are distributed
+   *  in contiguous blocks over a pool of worker threads. Workers that run out of jobs steal
+   *  half of the remaining block of another worker, so that the load is balanced also for
+   *  very different track lengths. Every worker has its own fitter, propagation and
+   *  trajectory, which is reused for all its tracks.
+   *
+   *  Every track is refitted as in the lcio_tracks example: the hits are added as measurements
+   *  at the intersections of the start helix with their surfaces - hits on surfaces that are
+   *  not intersected are ignored, of several hits on one surface the last one is used - and all
+   *  other intersected surfaces with material are added as scatterers (if enabled), see
+   *  addHitsAtIntersections(). Tracks with less than three measurements are not fitted.
+   */
+  class RefitEngine{
+
+  public:
+
+    /// create the thread pool - nThreads=0 uses one thread per hardware thread
+    RefitEngine( const IGeometry& geom, const IRefitWorkerFactory& factory, unsigned nThreads=0 ) ;
+
+    /// stops and joins the worker threads
+    ~RefitEngine() ;
+
+    /// the number of worker threads
+    unsigned nThreads() const { return _workers.size() ; }
+
+    /// add scatterers for all intersected surfaces with material and use multiple scattering for the hits ( default: true )
+    void setUseScatterers( bool useScatterers ) { _useScatterers = useScatterers ; }
+
+    /// the mass used in the fit ( default: pion mass )
+    void setMass( double mass ) { _mass = mass ; }
+
+    /** Refit all jobs and return the fit results in the order of the jobs - the results
+     *  of failed fits are not valid. Blocks until all jobs are done.
+     */
+    void refit( const std::vector<refitJob>& jobs, std::vector<fitResults>& results ) ;
+
+  private:
+    RefitEngine( const RefitEngine& ) ;
+    RefitEngine& operator=( const RefitEngine& ) ;
+
+    /// range of jobs [begin,end) assigned to a worker
+    struct jobRange{
+      std::mutex mutex ;
+      unsigned begin ;
+      unsigned end ;
+
+      jobRange() : mutex(), begin(0), end(0) {}
+    } ;
+
+    /// state of one worker thread
+    struct worker{
+      IFittingAlgorithm* fitter ;
+      IPropagation* propagation ;
+      trajectory* traj ;
+      jobRange queue ;
+      /// scratch buffers of addHitsAtIntersections()
+      std::vector< std::pair< const ISurface*, unsigned > > hitOrder ;
+      std::vector<double> precision ;
+
+      worker() : fitter(NULL), propagation(NULL), traj(NULL), queue(), hitOrder(), precision(2) {}
+
+    private:
+      worker( const worker& ) ;
+      worker& operator=( const worker& ) ;
+    } ;
+
+    /// the main loop of the worker threads
+    void _run( unsigned iWorker ) ;
+
+    /// get the next job for the worker - from its own range or stolen from another worker
+    bool _nextJob( unsigned iWorker, unsigned& job ) ;
+
+    /// refit a single track
+    void _refit( worker& w, const refitJob& job, fitResults& result ) ;
+
+    const IGeometry& _geometry ;
+
+    std::vector< worker* > _workers ;
+    std::vector< std::thread > _threads ;
+
+    bool   _useScatterers ;
+    double _mass ;
+
+    /// serializes calls to refit()
+    std::mutex _refitMutex ;
+
+    /// protects the batch state below
+    std::mutex _mutex ;
+    std::condition_variable _startCondition ;
+    std::condition_variable _doneCondition ;
+
+    const std::vector<refitJob>* _jobs ;
+    std::vector<fitResults>* _results ;
+    unsigned _batch ;
+    unsigned _nBusy ;
+    bool _stop ;
+  };
+}
+#endif // REFITENGINE_HH
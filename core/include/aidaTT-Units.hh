@@ -48,16 +48,40 @@ namespace aidaTT
     using  dd4hep::TeV;
     using  dd4hep::PeV;
 
-  static const double convertBr2P_cm = 0.299792458 * (centimeter / meter);
 }
 #else
 
 namespace aidaTT
 {
-    ///TODO
+    // the same system of units as in DD4hep ( and TGeo ): cm and GeV
+    static const double centimeter = 1. ;
+    static const double millimeter = 0.1 * centimeter ;
+    static const double meter      = 100. * centimeter ;
 
-}
-#endif // AIDATT_UNITS_HH
+    static const double mm = millimeter ;
+    static const double cm = centimeter ;
+    static const double m  = meter ;
 
+    static const double gigaelectronvolt = 1. ;
+    static const double megaelectronvolt = 1.e-3 * gigaelectronvolt ;
+    static const double kiloelectronvolt = 1.e-6 * gigaelectronvolt ;
+    static const double electronvolt     = 1.e-9 * gigaelectronvolt ;
+    static const double teraelectronvolt = 1.e3 * gigaelectronvolt ;
+    static const double petaelectronvolt = 1.e6 * gigaelectronvolt ;
+
+    // symbols
+    static const double MeV = megaelectronvolt ;
+    static const double eV  = electronvolt ;
+    static const double keV = kiloelectronvolt ;
+    static const double GeV = gigaelectronvolt ;
+    static const double TeV = teraelectronvolt ;
+    static const double PeV = petaelectronvolt ;
+}
 #endif // AIDATT_USE_DD4HEP
 
+namespace aidaTT
+{
+  static const double convertBr2P_cm = 0.299792458 * (centimeter / meter);
+}
+
+#endif // AIDATT_UNITS_HH
@@ -24,7 +24,7 @@ namespace aidaTT
 
   public:
     /** the default construction, it initializes all entries to zero **/
-    fiveByFiveMatrix(){ _m.Zero() ; }
+    fiveByFiveMatrix(){ _m.setZero() ; }
 
     /** copy construction **/
     fiveByFiveMatrix(const fiveByFiveMatrix& o) : _m(o._m) {} 
@@ -65,7 +65,7 @@ namespace aidaTT
     
     /** make a unit matrix out of the given matrix **/
     inline void Unit(){
-      _m.Identity() ;
+      _m.setIdentity() ;
     };
 
     /** transpose the matrix (in place) */
@@ -73,6 +73,11 @@ namespace aidaTT
       _m.transposeInPlace() ;
     };
 
+    /** direct read access to the underlying Eigen matrix */
+    const Matrix5x5d& matrix() const{
+      return _m ;
+    }
+
     /** get array to construct other matrix representations */
     double* array() const{
       return (double*) _m.data() ;
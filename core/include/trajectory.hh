@@ -12,6 +12,7 @@
 #include "IPropagation.hh"
 #include "IGeometry.hh"
 #include "IFittingAlgorithm.hh"
+#include "IFitOutput.hh"
 
 #include "fitResults.hh"
 
@@ -52,6 +53,17 @@ namespace aidaTT
     /// get the mass used for fitting 
     double getMass() { return _mass ; }
 
+    /// reserve memory for the given number of trajectoryElements (including the initial element),
+    /// i.e. building a trajectory with up to nElements elements causes no further memory allocation
+    void reserve( unsigned nElements ) ;
+
+    /** Reset the trajectory for fitting the next track with the given start parameters:
+     *  all elements, intersections and fit results are removed, while the fitter, propagation, 
+     *  geometry and mass are kept. The allocated memory is reused, i.e. refitting many
+     *  tracks with one trajectory object does not allocate memory once the buffers are large enough.
+     */
+    void reset( const trackParameters& tp ) ;
+
     /// the intial track parameters given at construction
     const trackParameters& initialTrackParameters() const {   return _referenceParameters; };
     
@@ -86,6 +98,12 @@ namespace aidaTT
      *  Can be used to get the right order for call to addScatterer and addMeasurment.
      */
     const IntersectionVec& getIntersectionsWithSurfaces(const SurfaceVec&) ;
+
+    /** Same as above for all surfaces of the geometry - only the candidate surfaces
+     *  provided by IGeometry::getCandidateSurfaces() are checked for intersections,
+     *  using the flattened surfaces of the geometry ( IGeometry::getSurfaceRecords() ) if it has them.
+     */
+    const IntersectionVec& getIntersectionsWithSurfaces() ;
     
     /// the point on the trajectory for a given arc length
     Vector3D pointAt( double s ) ;
@@ -94,8 +112,21 @@ namespace aidaTT
     Vector3D tangentAt( double s ) ;
     
     /// the trajectoryElement that is valid at the given arc length, i.e.
-    /// the one that is defined at the largest arc length less or equal to s
+    /// the one that is defined at the largest arc length less or equal to s -
+    /// binary search, requires the elements to be sorted in s (see prepareForFitting())
     const trajectoryElement* trajectoryElementAt( double s ) ; 
+
+    /** Same as above, starting the search at the element index given by the cursor, which is updated
+     *  to the index of the returned element. Walking along the trajectory with increasing s is O(1)
+     *  per call, otherwise a binary search is done. Start with cursor = 0.
+     */
+    const trajectoryElement* trajectoryElementAt( double s, unsigned& cursor ) ; 
+
+    /// the point on the trajectory for a given arc length, using a cursor for the element search
+    Vector3D pointAt( double s, unsigned& cursor ) ;
+    
+    /// the tangent to the trajectory for a given arc length, using a cursor for the element search
+    Vector3D tangentAt( double s, unsigned& cursor ) ;
     
     ///needs to be called before the actual track fit for internal preparation
     void prepareForFitting();
@@ -103,10 +134,16 @@ namespace aidaTT
     /// fit the track based on the measurements and scatterers added by the user
     bool fit();
 
-    /// return the fit result at the given label, where label==0 corresponds to
-    /// s == 0. 
+    /// return the fit result at the given label, i.e. at trajectoryElements()[label], where label==0 corresponds to
+    /// s == 0 ( see IFitOutput ).
     const fitResults* getFitResults(int label=0) ;
 
+    /// the fit results at all labels ( see IFitOutput::getAllResults() ) - false if not fitted
+    bool getAllFitResults( std::vector<fitResults>& results ) ;
+
+    /// the output of the last fit of this trajectory - NULL if not fitted yet
+    const IFitOutput* fitOutput() const { return ( _fitted ? _fitOutput : NULL ) ; }
+
 
     // methods after fitting
     //~ std::vector<trajectoryElement*> getFittedTrajectoryElements() const;
@@ -121,6 +158,13 @@ namespace aidaTT
     /// inernal helper method for adding an initial start element to the trajectory
     void addElement(const Vector3D&, void* id);
 
+    /// get the next free (or a new) element from the element store and add it to the list of elements
+    trajectoryElement& _nextElement();
+
+    /// helpers for keeping the element pointers valid if the element store is resized
+    void _elementPointersToIndices(std::vector<unsigned>&) const;
+    void _elementIndicesToPointers(const std::vector<unsigned>&);
+
     // disable assignment
     trajectory operator=(const trajectory&);
 
@@ -129,10 +173,23 @@ namespace aidaTT
     IFittingAlgorithm*  _fittingAlgorithm;
     IPropagation*       _propagation;
     const IGeometry* const _geometry;
+    /// the output of the last fit - kept after reset() for reusing its memory in the next fit
+    IFitOutput*         _fitOutput;
+    bool                _fitted;
     
+    /// the trajectory elements are stored by value in contiguous memory
+    std::vector<trajectoryElement>   _elementStore;
+    /// pointers to the elements in _elementStore - sorted in s by prepareForFitting()
     std::vector<trajectoryElement*>  _initialTrajectoryElements;
     std::vector<std::pair<double, const ISurface*> > _intersectionsList;
 
+    /// scratch buffers for creating elements and intersections - reused for every track
+    std::vector<Vector3D> _measDirScratch;
+    std::vector<double>   _residualScratch;
+    std::vector<double>   _precisionScratch;
+    SurfaceVec            _candidateSurfaces;
+    std::vector<unsigned> _candidateIndices;
+
     double _mass ;
     //==============================================================
     
@@ -9,8 +9,6 @@
 #include <vector>
 #include <ostream>
 
-#include <TMath.h>
-#include <TMatrixDSym.h>
 
 namespace aidaTT
 {
@@ -53,20 +51,76 @@ namespace aidaTT
    *
    */
 
+
+  /** The crossing of the track with the surface of a trajectoryElement, computed once when the
+   *  element is added to the trajectory and reused in later stages, e.g. for the energy loss
+   *  in trajectory::prepareForFitting().
+   */
+  struct surfaceCrossing
+  {
+    Vector3D point;         ///< the crossing point
+    Vector2D uv;            ///< the local coordinates of the crossing point
+    Vector3D direction;     ///< the unit direction of the track
+    Vector3D momentum;      ///< the momentum [GeV] of the track parameters of the element, i.e. after the energy loss on the surface
+    double cosIncidence;    ///< |cos| of the angle between the track direction and the surface normal
+    bool valid;             ///< false for elements without a surface
+
+    surfaceCrossing() : point(), uv(), direction(), momentum(), cosIncidence(0.), valid(false) {}
+  };
+
+
+  /** Read only view of one of the small fixed size arrays of a trajectoryElement, e.g. the
+   *  precisions - indexed like a std::vector, but without owning memory.
+   */
+  template <class T>
+  class elementArray
+  {
+  public:
+    elementArray(const T* data, unsigned n) : _data(data), _size(n) {}
+
+    unsigned size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    const T& operator[](unsigned i) const { return _data[i]; }
+
+    const T* begin() const { return _data; }
+    const T* end() const { return _data + _size; }
+
+  private:
+    const T* _data;
+    unsigned _size;
+  };
+
   
   class trajectoryElement 
   {
   public:
     /// Measurement constructor: arc length, surface, measurement direction(s), precision(s) and residual(s) plus the local curvilinear system and some identification
-    trajectoryElement(double arclength, trackParameters* trkParam, const ISurface& surface, std::vector<Vector3D>* measDir, const std::vector<double>& precisions,
-		      const std::vector<double>& residuals, std::pair<Vector3D, Vector3D>* lCLS,  void* id = NULL, bool isScatterer=false, bool hasMeasurement=true);
+    trajectoryElement(double arclength, const trackParameters& trkParam, const ISurface& surface, const std::vector<Vector3D>& measDir, const std::vector<double>& precisions,
+		      const std::vector<double>& residuals, const std::pair<Vector3D, Vector3D>& lCLS,  void* id = NULL, bool isScatterer=false, bool hasMeasurement=true);
     
 
     ///~ constructor B: only the arc length is given and some identification
-    trajectoryElement(double arclength, trackParameters* trkParam, void* id= NULL);
+    trajectoryElement(double arclength, const trackParameters& trkParam, void* id= NULL);
+
+    ///~ elements are stored by value in the trajectory, so they can be copied - all members
+    ///~ have a fixed size, i.e. creating and copying elements does not allocate memory
+    trajectoryElement(const trajectoryElement&);
+    trajectoryElement& operator=(const trajectoryElement&);
 
     ~trajectoryElement();
 
+    /// the maximal number of measurement directions and precisions ( 2 for the measurement plus 3 for a scatterer )
+    static const unsigned maxMeasurementDimension = 2;
+    static const unsigned maxPrecisions = 5;
+
+    /// re-initialize the element as measurement (see constructor) - the memory of the element is reused
+    void set(double arclength, const trackParameters& trkParam, const ISurface& surface, const std::vector<Vector3D>& measDir, const std::vector<double>& precisions,
+	     const std::vector<double>& residuals, const std::pair<Vector3D, Vector3D>& lCLS,  void* id = NULL, bool isScatterer=false, bool hasMeasurement=true);
+
+    /// re-initialize the element with only the arc length and some identification
+    void set(double arclength, const trackParameters& trkParam, void* id= NULL);
+
     /// the getting routines
     const ISurface& surface() const
     {
@@ -79,17 +133,17 @@ namespace aidaTT
     };
 
     const trackParameters* getTrackParameters() const { 
-      return _trkParam ; 
+      return &_trkParam ; 
     }
 
     const fiveByFiveMatrix& jacobian() const
     {
-      return *_jacobianFromPrevious;
+      return _jacobianFromPrevious;
     };
 
     const fiveByFiveMatrix& jacobianFromPrevious() const
     {
-      return *_jacobianFromPrevious;
+      return _jacobianFromPrevious;
     };
 
     trackParameters  fullState() const;
@@ -112,84 +166,109 @@ namespace aidaTT
     // the following depend on the type of element:
     unsigned int measurementDimension() const
     {
-      return _measDirections->size();
+      return _nMeasDirections;
     };
 
     ///~ get the residual: measurement - expected position (!)
-    const std::vector<double>& measurementResiduals() const
+    elementArray<double> measurementResiduals() const
     {
-      return _residuals;
+      return elementArray<double>(_residuals, _nResiduals);
     };
 
-    const std::vector<double>& precisions() const
+    elementArray<double> precisions() const
     //      const TMatrixDSym& precisions() const
     {
-      return _precisions;
+      return elementArray<double>(_precisions, _nPrecisions);
     };
 
     ///~ access the local curvilinear system at the given point
     const std::pair<Vector3D, Vector3D>& localCurvilinearSystem() const
     {
-      return *_localCurvilinearSystem;
+      return _localCurvilinearSystem;
     };
 
     ///~ access the measurement direction (if available) for the corresponding surface
-    const std::vector<Vector3D>& measurementDirections() const
+    elementArray<Vector3D> measurementDirections() const
     {
-      return *_measDirections;
+      return elementArray<Vector3D>(_measDirections, _nMeasDirections);
     };
 
-    ///~ and finally: the projection matrix from the local track frame to the measurement system
-    const std::vector<double>& localToMeasurementProjection() const
+    ///~ and finally: the projection matrix from the local track frame to the measurement system ( 2x2, row wise - empty without measurement directions )
+    elementArray<double> localToMeasurementProjection() const
     {
-      return *_localToMeasurementProjection;
+      return elementArray<double>(_localToMeasurementProjection, ( _nMeasDirections > 0 ? 4 : 0 ));
     };
 
-    ///~ set the jacobian from the previous element -- ownership of the memory is transferred
-    void setJacobian(fiveByFiveMatrix* jacob)
+    ///~ set the jacobian from the previous element
+    void setJacobian(const fiveByFiveMatrix& jacob)
     {
-      if( _jacobianFromPrevious != 0 ) 
-	delete _jacobianFromPrevious ;
-
       _jacobianFromPrevious = jacob;
     }
+
+    ///~ the jacobian from the local curvilinear to the L3 track parameters at this element (set in trajectory::prepareForFitting())
+    const fiveByFiveMatrix& curvilinearToL3Jacobian() const
+    {
+      return _curvilinearToL3Jacobian;
+    }
+
+    void setCurvilinearToL3Jacobian(const fiveByFiveMatrix& jacob)
+    {
+      _curvilinearToL3Jacobian = jacob;
+    }
+
+    ///~ the crossing of the track with the surface (set in trajectory::addMeasurement() and addScatterer())
+    const surfaceCrossing& crossing() const
+    {
+      return _crossing;
+    }
+
+    void setCrossing(const surfaceCrossing& c)
+    {
+      _crossing = c;
+    }
+
   private:
     ///~ no construction without the arc length!
     trajectoryElement();
 
-    ///~ no assigment, no copying
-    trajectoryElement(const trajectoryElement&);
-    trajectoryElement operator=(const trajectoryElement&);
-
     void _calculateMaterial();
     void _calculateLocalToMeasurementProjectionMatrix();
 
+    /// copy the measurement directions, precisions and residuals into the fixed size arrays
+    void _setMeasurement(const std::vector<Vector3D>& measDir, const std::vector<double>& precisions, const std::vector<double>& residuals);
+
     ///~
     double _arclength;
 
-    fiveByFiveMatrix* _jacobianFromPrevious;
+    fiveByFiveMatrix  _jacobianFromPrevious;
+    fiveByFiveMatrix  _curvilinearToL3Jacobian;
     const ISurface*   _surface;
 
     ///~ measurement variables:
     bool _measurement;
-    std::vector<Vector3D>* _measDirections;
-    std::vector<double> _precisions;
+    Vector3D _measDirections[maxMeasurementDimension];
+    unsigned _nMeasDirections;
+    double _precisions[maxPrecisions];
+    unsigned _nPrecisions;
     //TMatrixDSym _precisions;
-    std::vector<double> _residuals;
+    double _residuals[maxMeasurementDimension];
+    unsigned _nResiduals;
 
     ///~ local curvilinear system
-    std::pair<Vector3D, Vector3D>* _localCurvilinearSystem;
+    std::pair<Vector3D, Vector3D> _localCurvilinearSystem;
 
     /// 2x2 matrix for 2D measurements, projection from local cl to measurement system
-    std::vector<double>* _localToMeasurementProjection;
+    double _localToMeasurementProjection[4];
+
+    trackParameters _trkParam ;
 
-    trackParameters* _trkParam ;
+    surfaceCrossing _crossing ;
     
     ///~ scattering info
     bool _scatterer;
     bool _thick;
 
-    const void* const _id; // just store
+    const void* _id; // just store
   };
 
 
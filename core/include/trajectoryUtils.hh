@@ -0,0 +1,82 @@
+#ifndef trajectoryUtils_HH
+#define trajectoryUtils_HH
+
+#include "trajectory.hh"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/** Define helper functions for filling trajectories.
+ *
+ *  @version $Id
+ */
+
+namespace aidaTT {
+
+  /** Add the hits of a track to the trajectory ( reset with the start parameters ) in the order
+   *  of the intersections of the start helix with the surfaces: a measurement for the surfaces
+   *  with a hit and - if useQMS - a scatterer for the other surfaces with material. Hits on
+   *  surfaces that are not intersected are ignored. If several hits are on one surface only the
+   *  last one is used. Returns the number of measurements.
+   *
+   *  HITS gives access to the hits with size(), surface(i) ( NULL if unknown ), position(i),
+   *  precision(i) ( the two inverse variances in u and v ) and id(i).
+   *  hitOrder and precision ( size 2 ) are scratch buffers that can be reused for all tracks.
+   */
+  template <class HITS>
+  unsigned addHitsAtIntersections( trajectory& traj, const HITS& hits, bool useQMS,
+				   std::vector< std::pair< const ISurface*, unsigned > >& hitOrder,
+				   std::vector<double>& precision ){
+
+    // the hits sorted in their surfaces
+    hitOrder.clear() ;
+
+    for( unsigned i=0, n = hits.size() ; i<n ; ++i )
+      if( hits.surface(i) != NULL )
+	hitOrder.push_back( std::make_pair( hits.surface(i) , i ) ) ;
+
+    std::sort( hitOrder.begin() , hitOrder.end() ) ;
+
+    precision.resize( 2 ) ;
+
+    const IntersectionVec& intersections = traj.getIntersectionsWithSurfaces() ;
+
+    unsigned nMeasurements = 0 ;
+
+    for( IntersectionVec::const_iterator it = intersections.begin() ; it != intersections.end() ; ++it ){
+
+      const ISurface* surf = it->second ;
+
+      // the last hit on the surface
+      std::vector< std::pair< const ISurface*, unsigned > >::const_iterator hit =
+	std::upper_bound( hitOrder.begin() , hitOrder.end() ,
+			  std::make_pair( surf , std::numeric_limits<unsigned>::max() ) ) ;
+
+      if( hit != hitOrder.begin() && (--hit)->first == surf ){
+
+	const unsigned i = hit->second ;
+
+	precision[0] = hits.precision(i)[0] ;
+	precision[1] = hits.precision(i)[1] ;
+
+	traj.addMeasurement( hits.position(i), precision, *surf, hits.id(i), useQMS ) ;
+
+	++nMeasurements ;
+
+      } else if( useQMS ) {
+
+	// ignore virtual surfaces with no material (e.g. inside the beam pipe )
+	if( ! ( surf->innerMaterial().density() < 1e-6  &&
+		surf->outerMaterial().density() < 1e-6 )  )
+	  traj.addScatterer( *surf ) ;
+      }
+    }
+
+    return nMeasurements ;
+  }
+
+}
+
+#endif // trajectoryUtils_HH
@@ -14,6 +14,7 @@
 #include "simplifiedPropagation.hh"
 #include "ConstantSolenoidBField.hh"
 #include "GBLInterface.hh"
+#include "KalmanFitter.hh"
 
 //~ and helper classes
 #include "fiveByFiveMatrix.hh"
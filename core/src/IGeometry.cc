@@ -0,0 +1,44 @@
+#include "IGeometry.hh"
+#include "surfaceIdMap.hh"
+
+namespace aidaTT{
+
+  const ISurface* IGeometry::findSurface( long64 id ) const {
+
+    const SurfaceIdMap* idMap = getSurfaceIdMap() ;
+
+    if( idMap != 0 )
+      return idMap->find( id ) ;
+
+    // geometries without a table
+    const std::vector<const ISurface*>& surfaces = getSurfaces() ;
+
+    for( unsigned i=0, n = surfaces.size() ; i<n ; ++i )
+      if( surfaces[i]->id() == id )
+	return surfaces[i] ;
+
+    return 0 ;
+  }
+
+
+  unsigned IGeometry::findSurfaces( unsigned n, const long64* ids, const ISurface** surfaces ) const {
+
+    const SurfaceIdMap* idMap = getSurfaceIdMap() ;
+
+    if( idMap != 0 )
+      return idMap->find( n, ids, surfaces ) ;
+
+    unsigned nFound = 0 ;
+
+    for( unsigned k=0 ; k<n ; ++k ){
+
+      surfaces[k] = findSurface( ids[k] ) ;
+
+      if( surfaces[k] != 0 )
+	++nFound ;
+    }
+
+    return nFound ;
+  }
+
+}
@@ -0,0 +1,290 @@
+#include "Instrumentation.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+namespace aidaTT
+{
+
+  namespace {
+
+    enum { nStages = Instrumentation::NStages } ;
+
+    /// the raw counters of one stage
+    struct rawCounters{
+      unsigned long long calls ;
+      unsigned long long failures ;
+      unsigned long long items ;
+      unsigned long long ticks ;
+    } ;
+
+
+    /** The counters of one stage in one thread. They are only written by their thread, the
+     *  atomics (without read-modify-write) allow to read them concurrently in snapshot().
+     */
+    struct stageCounters{
+      std::atomic<unsigned long long> calls ;
+      std::atomic<unsigned long long> failures ;
+      std::atomic<unsigned long long> items ;
+      std::atomic<unsigned long long> ticks ;
+
+      stageCounters() : calls( 0 ), failures( 0 ), items( 0 ), ticks( 0 ) {}
+
+      void addTo( rawCounters& raw ) const {
+	raw.calls    += calls.load( std::memory_order_relaxed ) ;
+	raw.failures += failures.load( std::memory_order_relaxed ) ;
+	raw.items    += items.load( std::memory_order_relaxed ) ;
+	raw.ticks    += ticks.load( std::memory_order_relaxed ) ;
+      }
+    } ;
+
+
+    inline void increment( std::atomic<unsigned long long>& counter, unsigned long long n ){
+      counter.store( counter.load( std::memory_order_relaxed ) + n , std::memory_order_relaxed ) ;
+    }
+
+
+    struct threadCounters ;
+
+
+    /// all thread counters, the counters of finished threads and the baseline of reset()
+    struct registry{
+      std::mutex mutex ;
+      std::vector<const threadCounters*> threads ;
+      rawCounters retired[ nStages ] ;
+      rawCounters baseline[ nStages ] ;
+      unsigned nRetiredThreads ;
+
+      /// reference points of the cycle counter and the clock for converting ticks to seconds
+      unsigned long long ticks0 ;
+      std::chrono::steady_clock::time_point time0 ;
+
+      registry() : mutex(), threads(), nRetiredThreads( 0 ),
+		   ticks0( Instrumentation::ticks() ), time0( std::chrono::steady_clock::now() ) {
+	std::fill( retired, retired + nStages, rawCounters() ) ;
+	std::fill( baseline, baseline + nStages, rawCounters() ) ;
+      }
+
+      /// the sum of the counters of all threads - to be called with the mutex locked
+      void sum( rawCounters* raw ) const ;
+
+      /// seconds per tick, measured since the creation of the registry
+      double secondsPerTick() ;
+    } ;
+
+
+    registry& theRegistry(){
+      static registry reg ;
+      return reg ;
+    }
+
+
+    /// the counters of one thread - registered for the life time of the thread
+    struct threadCounters{
+      stageCounters stages[ nStages ] ;
+
+      threadCounters(){
+	registry& reg = theRegistry() ;
+	std::lock_guard<std::mutex> lock( reg.mutex ) ;
+	reg.threads.push_back( this ) ;
+      }
+
+      ~threadCounters(){
+	registry& reg = theRegistry() ;
+	std::lock_guard<std::mutex> lock( reg.mutex ) ;
+
+	for( unsigned i=0 ; i<nStages ; ++i )
+	  stages[i].addTo( reg.retired[i] ) ;
+
+	++reg.nRetiredThreads ;
+
+	reg.threads.erase( std::find( reg.threads.begin(), reg.threads.end(), this ) ) ;
+      }
+    } ;
+
+
+    threadCounters& localCounters(){
+      static thread_local threadCounters counters ;
+      return counters ;
+    }
+
+
+    void registry::sum( rawCounters* raw ) const {
+
+      std::copy( retired, retired + nStages, raw ) ;
+
+      for( unsigned t=0, n = threads.size() ; t<n ; ++t )
+	for( unsigned i=0 ; i<nStages ; ++i )
+	  threads[t]->stages[i].addTo( raw[i] ) ;
+    }
+
+
+    double registry::secondsPerTick(){
+#if defined(__x86_64__) || defined(__i386__)
+      // measure over at least one millisecond
+      std::chrono::steady_clock::time_point now ;
+      unsigned long long ticksNow = 0 ;
+
+      do {
+	now = std::chrono::steady_clock::now() ;
+	ticksNow = Instrumentation::ticks() ;
+      } while( now - time0 < std::chrono::milliseconds( 1 ) ) ;
+
+      return std::chrono::duration<double>( now - time0 ).count() / double( ticksNow - ticks0 ) ;
+#else
+      return 1.e-9 ;
+#endif
+    }
+  }
+
+
+  //======================================================================================
+
+  bool Instrumentation::enabled(){
+#ifdef AIDATT_USE_INSTRUMENTATION
+    return true ;
+#else
+    return false ;
+#endif
+  }
+
+
+  void Instrumentation::record( Stage stage, unsigned long long ticks, bool failed, unsigned long long items ){
+
+    stageCounters& counters = localCounters().stages[ stage ] ;
+
+    increment( counters.calls, 1 ) ;
+    increment( counters.ticks, ticks ) ;
+
+    if( failed )
+      increment( counters.failures, 1 ) ;
+
+    if( items != 0 )
+      increment( counters.items, items ) ;
+  }
+
+
+  InstrumentationSnapshot Instrumentation::snapshot(){
+
+    InstrumentationSnapshot snap ;
+
+    registry& reg = theRegistry() ;
+
+    const double secondsPerTick = reg.secondsPerTick() ;
+
+    std::lock_guard<std::mutex> lock( reg.mutex ) ;
+
+    rawCounters raw[ nStages ] ;
+    reg.sum( raw ) ;
+
+    for( unsigned i=0 ; i<nStages ; ++i ){
+
+      stageStatistics& stats = snap._stages[i] ;
+
+      stats.calls    = raw[i].calls    - reg.baseline[i].calls ;
+      stats.failures = raw[i].failures - reg.baseline[i].failures ;
+      stats.items    = raw[i].items    - reg.baseline[i].items ;
+      stats.seconds  = ( raw[i].ticks  - reg.baseline[i].ticks ) * secondsPerTick ;
+    }
+
+    snap._nThreads = reg.threads.size() + reg.nRetiredThreads ;
+
+    return snap ;
+  }
+
+
+  void Instrumentation::reset(){
+
+    registry& reg = theRegistry() ;
+
+    std::lock_guard<std::mutex> lock( reg.mutex ) ;
+
+    // the counters are only written by their threads - reset() moves the baseline
+    reg.sum( reg.baseline ) ;
+  }
+
+
+  const char* Instrumentation::stageName( Stage stage ){
+
+    static const char* names[ NStages ] = {
+      "intersectZCylinder", "intersectZPlane", "intersectZDisk", "intersectZCone", "intersectPlane", "intersectNewton",
+      "materialQMS", "materialEnergyLoss", "jacobians", "gblFit", "kalmanFit", "fitResults"
+    } ;
+
+    return ( stage < NStages ? names[ stage ] : "unknown" ) ;
+  }
+
+
+  //======================================================================================
+
+  void InstrumentationSnapshot::print( std::ostream& os ) const {
+
+    const std::ios::fmtflags flags = os.flags() ;
+    const std::streamsize prec = os.precision() ;
+
+    os << " aidaTT instrumentation - " << _nThreads << " thread(s)"
+       << ( Instrumentation::enabled() ? "" : " - disabled at compile time" ) << std::endl
+       << std::left << std::setw(22) << " stage"
+       << std::right << std::setw(14) << "calls"
+       << std::setw(14) << "failures"
+       << std::setw(14) << "items"
+       << std::setw(14) << "total [ms]"
+       << std::setw(14) << "ns/call" << std::endl ;
+
+    os << std::fixed ;
+
+    for( unsigned i=0 ; i<Instrumentation::NStages ; ++i ){
+
+      const stageStatistics& stats = _stages[i] ;
+
+      os << " " << std::left << std::setw(21) << Instrumentation::stageName( Instrumentation::Stage(i) )
+	 << std::right << std::setw(14) << stats.calls
+	 << std::setw(14) << stats.failures
+	 << std::setw(14) << stats.items
+	 << std::setw(14) << std::setprecision(3) << stats.seconds * 1.e3
+	 << std::setw(14) << std::setprecision(1) << ( stats.calls ? stats.seconds * 1.e9 / stats.calls : 0. )
+	 << std::endl ;
+    }
+
+    os.flags( flags ) ;
+    os.precision( prec ) ;
+  }
+
+
+  void InstrumentationSnapshot::writeJSON( std::ostream& os ) const {
+
+    const std::streamsize prec = os.precision( 9 ) ;
+
+    os << "{" << std::endl
+       << "  \"enabled\": " << ( Instrumentation::enabled() ? "true" : "false" ) << "," << std::endl
+       << "  \"threads\": " << _nThreads << "," << std::endl
+       << "  \"stages\": [" << std::endl ;
+
+    for( unsigned i=0 ; i<Instrumentation::NStages ; ++i ){
+
+      const stageStatistics& stats = _stages[i] ;
+
+      os << "    { \"name\": \"" << Instrumentation::stageName( Instrumentation::Stage(i) ) << "\""
+	 << ", \"calls\": " << stats.calls
+	 << ", \"failures\": " << stats.failures
+	 << ", \"items\": " << stats.items
+	 << ", \"seconds\": " << stats.seconds
+	 << " }" << ( i + 1 < Instrumentation::NStages ? "," : "" ) << std::endl ;
+    }
+
+    os << "  ]" << std::endl
+       << "}" << std::endl ;
+
+    os.precision( prec ) ;
+  }
+
+
+  std::ostream& operator<<( std::ostream& os, const InstrumentationSnapshot& snapshot ){
+    snapshot.print( os ) ;
+    return os ;
+  }
+
+}
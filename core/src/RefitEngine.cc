@@ -0,0 +1,235 @@
+#include "RefitEngine.hh"
+#include "trajectory.hh"
+#include "materialUtils.hh"
+#include "trajectoryUtils.hh"
+
+#include <algorithm>
+#include <exception>
+
+#include "streamlog/streamlog.h"
+
+namespace aidaTT
+{
+
+  RefitEngine::RefitEngine( const IGeometry& geom, const IRefitWorkerFactory& factory, unsigned nThreads ) :
+    _geometry( geom ), _workers(), _threads(), _useScatterers( true ), _mass( pionMass ),
+    _refitMutex(), _mutex(), _startCondition(), _doneCondition(),
+    _jobs( NULL ), _results( NULL ), _batch( 0 ), _nBusy( 0 ), _stop( false ) {
+
+    if( nThreads == 0 )
+      nThreads = std::max( std::thread::hardware_concurrency() , 1u ) ;
+
+    _workers.reserve( nThreads ) ;
+
+    for( unsigned i=0 ; i<nThreads ; ++i ){
+
+      worker* w = new worker ;
+
+      w->fitter      = factory.createFitter() ;
+      w->propagation = factory.createPropagation() ;
+      w->traj        = new trajectory( trackParameters(), w->fitter, w->propagation, &_geometry ) ;
+
+      _workers.push_back( w ) ;
+    }
+
+    _threads.reserve( nThreads ) ;
+
+    for( unsigned i=0 ; i<nThreads ; ++i )
+      _threads.push_back( std::thread( &RefitEngine::_run, this, i ) ) ;
+  }
+
+
+  RefitEngine::~RefitEngine(){
+
+    {
+      std::lock_guard<std::mutex> lock( _mutex ) ;
+      _stop = true ;
+    }
+    _startCondition.notify_all() ;
+
+    for( unsigned i=0 ; i<_threads.size() ; ++i )
+      _threads[i].join() ;
+
+    for( unsigned i=0 ; i<_workers.size() ; ++i ){
+
+      delete _workers[i]->traj ;
+      delete _workers[i]->fitter ;
+      delete _workers[i]->propagation ;
+      delete _workers[i] ;
+    }
+  }
+
+
+  void RefitEngine::refit( const std::vector<refitJob>& jobs, std::vector<fitResults>& results ){
+
+    std::lock_guard<std::mutex> refitLock( _refitMutex ) ;
+
+    results.assign( jobs.size() , fitResults() ) ;
+
+    if( jobs.empty() )
+      return ;
+
+    const unsigned nJobs    = jobs.size() ;
+    const unsigned nWorkers = _workers.size() ;
+
+    // contiguous blocks of jobs - the workers are idle, so no locking is needed
+    for( unsigned i=0 ; i<nWorkers ; ++i ){
+
+      _workers[i]->queue.begin = (unsigned long) nJobs *   i     / nWorkers ;
+      _workers[i]->queue.end   = (unsigned long) nJobs * ( i+1 ) / nWorkers ;
+
+      _workers[i]->traj->setMass( _mass ) ;
+    }
+
+    std::unique_lock<std::mutex> lock( _mutex ) ;
+
+    _jobs    = &jobs ;
+    _results = &results ;
+    _nBusy   = nWorkers ;
+    ++_batch ;
+
+    _startCondition.notify_all() ;
+
+    while( _nBusy > 0 )
+      _doneCondition.wait( lock ) ;
+
+    _jobs    = NULL ;
+    _results = NULL ;
+  }
+
+
+  void RefitEngine::_run( unsigned iWorker ){
+
+    unsigned batch = 0 ;
+
+    while( true ){
+
+      {
+	std::unique_lock<std::mutex> lock( _mutex ) ;
+
+	while( !_stop && _batch == batch )
+	  _startCondition.wait( lock ) ;
+
+	if( _stop )
+	  return ;
+
+	batch = _batch ;
+      }
+
+      worker& w = *_workers[ iWorker ] ;
+
+      unsigned job = 0 ;
+
+      while( _nextJob( iWorker, job ) ){
+
+	try{
+
+	  _refit( w, (*_jobs)[ job ] , (*_results)[ job ] ) ;
+
+	} catch( std::exception& e ){
+
+	  streamlog_out( ERROR ) << " RefitEngine: refit of job " << job << " failed: " << e.what() << std::endl ;
+	}
+      }
+
+      {
+	std::lock_guard<std::mutex> lock( _mutex ) ;
+
+	if( --_nBusy == 0 )
+	  _doneCondition.notify_one() ;
+      }
+    }
+  }
+
+
+  bool RefitEngine::_nextJob( unsigned iWorker, unsigned& job ){
+
+    jobRange& own = _workers[ iWorker ]->queue ;
+
+    {
+      std::lock_guard<std::mutex> lock( own.mutex ) ;
+
+      if( own.begin < own.end ){
+	job = own.begin++ ;
+	return true ;
+      }
+    }
+
+    // steal the upper half of the remaining jobs of another worker
+    const unsigned nWorkers = _workers.size() ;
+
+    for( unsigned k=1 ; k<nWorkers ; ++k ){
+
+      jobRange& victim = _workers[ ( iWorker + k ) % nWorkers ]->queue ;
+
+      unsigned begin = 0, end = 0 ;
+      {
+	std::lock_guard<std::mutex> lock( victim.mutex ) ;
+
+	if( victim.begin < victim.end ){
+
+	  begin = victim.begin + ( victim.end - victim.begin ) / 2 ;
+	  end   = victim.end ;
+
+	  victim.end = begin ;
+	}
+      }
+
+      if( begin < end ){
+
+	std::lock_guard<std::mutex> lock( own.mutex ) ;
+
+	job       = begin ;
+	own.begin = begin + 1 ;
+	own.end   = end ;
+
+	return true ;
+      }
+    }
+
+    return false ;
+  }
+
+
+  namespace {
+
+    /// access to the hits of a refit job for addHitsAtIntersections()
+    class refitJobHits{
+
+    public:
+      explicit refitJobHits( const refitJob& job ) : _hits( job.hits ) {}
+
+      unsigned size() const { return _hits.size() ; }
+      const ISurface* surface( unsigned i ) const { return _hits[i].surface ; }
+      const Vector3D& position( unsigned i ) const { return _hits[i].position ; }
+      const double* precision( unsigned i ) const { return _hits[i].precision ; }
+      void* id( unsigned i ) const { return _hits[i].id ; }
+
+    private:
+      const std::vector<refitHit>& _hits ;
+    } ;
+  }
+
+
+  void RefitEngine::_refit( worker& w, const refitJob& job, fitResults& result ){
+
+    trajectory& traj = *w.traj ;
+
+    traj.reset( job.initialParameters ) ;
+
+    const unsigned nMeasurements = addHitsAtIntersections( traj, refitJobHits( job ), _useScatterers,
+							   w.hitOrder, w.precision ) ;
+
+    if( nMeasurements < 3 )
+      return ;
+
+    traj.prepareForFitting() ;
+
+    traj.fit() ;
+
+    const fitResults* res = traj.getFitResults() ;
+
+    if( res != NULL )
+      result = *res ;
+  }
+}
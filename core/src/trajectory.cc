@@ -9,64 +9,178 @@
 #include "utilities.hh"
 #include "aidaTT-Units.hh"
 #include "materialUtils.hh"
+#include "surfaceRecords.hh"
+#include "Instrumentation.hh"
 
 
 namespace aidaTT {
   
+  namespace {
+
+    /// |cos| of the angle between the track direction and the normal of the surface at xx
+    double cosIncidence( const ISurface& surface, const Vector3D& xx, const Vector3D& mom ){
+      return std::fabs( mom.unit() * surface.normal( xx ) ) ;
+    }
+
+    /// the crossing of the track with momentum mom at xx - the momentum after the energy loss is set by the caller
+    surfaceCrossing makeCrossing( const ISurface& surface, const Vector3D& xx, const Vector2D& uv, const Vector3D& mom ){
+
+      surfaceCrossing c ;
+      c.point = xx ;
+      c.uv = uv ;
+      c.direction = mom.unit() ;
+      c.momentum = mom ;
+      c.cosIncidence = std::fabs( c.direction * surface.normal( xx ) ) ;
+      c.valid = true ;
+
+      return c ;
+    }
+  }
     
 
   trajectory::trajectory(const trackParameters& tp, IFittingAlgorithm* fa, 
 			 IPropagation* pm, const IGeometry* geom) :
-    _referenceParameters(tp) , _fittingAlgorithm(fa) ,  _propagation(pm), _geometry(geom), _mass( pionMass )  {
+    _referenceParameters(tp) , _fittingAlgorithm(fa) ,  _propagation(pm), _geometry(geom), _fitOutput(NULL), _fitted(false),
+    _elementStore(), _initialTrajectoryElements(), _intersectionsList(),
+    _measDirScratch(), _residualScratch(), _precisionScratch(), _candidateSurfaces(), _candidateIndices(), _mass( pionMass )  {
   }
   
 
 
   trajectory::trajectory(const trackParameters& tp, const IGeometry* geom) : 
-    _referenceParameters(tp), _fittingAlgorithm(NULL), _propagation(NULL), _geometry(geom) , _mass( pionMass ) {
+    _referenceParameters(tp), _fittingAlgorithm(NULL), _propagation(NULL), _geometry(geom), _fitOutput(NULL), _fitted(false),
+    _elementStore(), _initialTrajectoryElements(), _intersectionsList(),
+    _measDirScratch(), _residualScratch(), _precisionScratch(), _candidateSurfaces(), _candidateIndices(), _mass( pionMass ) {
   }
 
 
 
   trajectory::trajectory(const trajectory& traj) : _referenceParameters(traj._referenceParameters),
 						   _fittingAlgorithm(traj._fittingAlgorithm), 
-						   _propagation(traj._propagation), _geometry(traj._geometry), _mass( pionMass ) {
+						   _propagation(traj._propagation), _geometry(traj._geometry),
+						   _fitOutput(NULL), _fitted(false), _elementStore(), _initialTrajectoryElements(),
+						   _intersectionsList(), _measDirScratch(), _residualScratch(),
+						   _precisionScratch(), _candidateSurfaces(), _candidateIndices(), _mass( pionMass ) {
   }
 
 
 
   trajectory::~trajectory() {
     
-    for(std::vector<trajectoryElement*>::iterator element = _initialTrajectoryElements.begin(), 
-	  last = _initialTrajectoryElements.end(); element < last; ++element){
-      delete *element;
+    delete _fitOutput ;
+  }
+
+
+  void trajectory::reset( const trackParameters& tp ){
+
+    _referenceParameters = tp ;
+
+    // the fit output is kept for the next fit
+    _fitted = false ;
+
+    // the elements in the store are kept and re-initialized by _nextElement()
+    _initialTrajectoryElements.clear() ;
+    _intersectionsList.clear() ;
+  }
+
+
+  void trajectory::reserve( unsigned nElements ){
+
+    if( nElements <= _elementStore.capacity() )
+      return ;
+
+    std::vector<unsigned> indices ;
+    _elementPointersToIndices( indices ) ;
+
+    _elementStore.reserve( nElements ) ;
+    _initialTrajectoryElements.reserve( nElements ) ;
+
+    _elementIndicesToPointers( indices ) ;
+  }
+
+
+  void trajectory::_elementPointersToIndices( std::vector<unsigned>& indices ) const {
+
+    indices.resize( _initialTrajectoryElements.size() ) ;
+
+    for(unsigned i=0 ; i<indices.size() ; ++i)
+      indices[i] = _initialTrajectoryElements[i] - &_elementStore[0] ;
+  }
+
+
+  void trajectory::_elementIndicesToPointers( const std::vector<unsigned>& indices ){
+
+    for(unsigned i=0 ; i<indices.size() ; ++i)
+      _initialTrajectoryElements[i] = &_elementStore[ indices[i] ] ;
+  }
+
+
+  trajectoryElement& trajectory::_nextElement(){
+
+    const unsigned n = _initialTrajectoryElements.size() ;
+
+    if( n == _elementStore.size() ){
+
+      // make sure the pointers stay valid, if the element store needs to grow
+      if( _elementStore.size() == _elementStore.capacity() )
+	reserve( std::max( 2 * _elementStore.size() , size_t( 16 ) ) ) ;
+
+      _elementStore.push_back( trajectoryElement( 0., _referenceParameters ) ) ;
     }
+
+    trajectoryElement* element = &_elementStore[ n ] ;
+
+    _initialTrajectoryElements.push_back( element ) ;
+
+    return *element ;
   }
 
 
-  const trajectoryElement* trajectory::trajectoryElementAt(double s ) {
-    
-    double prevS = -1.e99 ;
-    const trajectoryElement* prevElement = ( _initialTrajectoryElements.size() > 0 ? 
-					     _initialTrajectoryElements[0]  : 0 ) ;
-    
-    for(std::vector<trajectoryElement*>::iterator it = _initialTrajectoryElements.begin()+1, 
-	  last = _initialTrajectoryElements.end(); it < last; ++it ){
-      
-      const trajectoryElement* element = *it ;
-      
-      double newS = element->arcLength() ;
-      
-      if( prevS <= s &&  s < newS ){
-	break ;
-      }
-      prevElement = element ;
-      prevS = newS ;
+  /// compare arc lengths for the binary search in the (sorted) trajectory elements
+  struct ArcLengthLess{
+
+    bool operator()( double s, const trajectoryElement* element ) const {
+      return s < element->arcLength() ;
     }
+
+  };
+
+
+  const trajectoryElement* trajectory::trajectoryElementAt(double s ) {
     
-    return prevElement ;
+    if( _initialTrajectoryElements.empty() )
+      return 0 ;
+
+    // the first element is also used for all s before the second element
+    ElementVec::const_iterator it = std::upper_bound( _initialTrajectoryElements.begin() + 1 , 
+						       _initialTrajectoryElements.end() , s , ArcLengthLess() ) ;
+    return *( it - 1 ) ;
   }
   
+
+  const trajectoryElement* trajectory::trajectoryElementAt( double s, unsigned& cursor ) {
+
+    const unsigned n = _initialTrajectoryElements.size() ;
+
+    if( n == 0 )
+      return 0 ;
+
+    if( cursor >= n || ( cursor > 0 && s < _initialTrajectoryElements[ cursor ]->arcLength() ) ){
+
+      // we cannot walk forward from the cursor - fall back to the binary search
+      ElementVec::const_iterator it = std::upper_bound( _initialTrajectoryElements.begin() + 1 , 
+							 _initialTrajectoryElements.end() , s , ArcLengthLess() ) ;
+      cursor = ( it - 1 ) - _initialTrajectoryElements.begin() ;
+
+      return *( it - 1 ) ;
+    }
+
+    while( cursor + 1 < n && _initialTrajectoryElements[ cursor + 1 ]->arcLength() <= s )
+      ++cursor ;
+
+    return _initialTrajectoryElements[ cursor ] ;
+  }
+
   
   Vector3D trajectory::pointAt( double s ) {
     
@@ -79,6 +193,16 @@ namespace aidaTT {
   }
   
   
+  Vector3D trajectory::pointAt( double s, unsigned& cursor ) {
+    
+    const trajectoryElement* element =  trajectoryElementAt( s, cursor ) ;
+    
+    if( element != 0 ) 
+      return aidaTT::pointAt(  ( s - element->arcLength() ) , *element->getTrackParameters() ) ;
+    
+    return  aidaTT::pointAt( s, _referenceParameters ) ;
+  }
+  
   
   /// comput the tangent to the trajectory at given s
   Vector3D trajectory::tangentAt( double s ) {
@@ -92,6 +216,18 @@ namespace aidaTT {
   }
 
 
+  Vector3D trajectory::tangentAt( double s, unsigned& cursor ) {
+    
+    const trajectoryElement* element =  trajectoryElementAt( s, cursor ) ;
+    
+    if( element != 0 ) 
+      return aidaTT::calculateTangent( ( s - element->arcLength() ),  *element->getTrackParameters() ) ;
+    
+    return  aidaTT::calculateTangent( s, _referenceParameters ) ;
+  }
+
+
+
 
 
   struct SortWithS{
@@ -129,11 +265,60 @@ namespace aidaTT {
 
     return _intersectionsList;
   }
+
+
+  const IntersectionVec& trajectory::getIntersectionsWithSurfaces()
+  {
+    _candidateSurfaces.clear() ;
+
+    _geometry->getCandidateSurfaces( _referenceParameters.parameters(), _referenceParameters.referencePoint(), _candidateSurfaces,
+				     _candidateIndices ) ;
+
+    const SurfaceRecords* records = _geometry->getSurfaceRecords() ;
+
+    // without the flattened surfaces of the geometry intersect with the ISurfaces
+    if( records == NULL || _candidateIndices.size() != _candidateSurfaces.size() )
+      return getIntersectionsWithSurfaces( _candidateSurfaces ) ;
+
+    double maxS = M_PI * std::fabs( calculateRadius(_referenceParameters) ) ;
+
+    for(unsigned k=0 ; k<_candidateIndices.size() ; ++k){
+
+      const surfaceRecord& surf = (*records)[ _candidateIndices[k] ] ;
+
+      double s = 0.;
+
+      Vector3D xx ;
+      bool intersects = aidaTT::intersectWithSurface( surf, _referenceParameters.parameters() ,
+						      _referenceParameters.referencePoint(), s , xx , +1, true );
+
+      // only keep intersections at positve s in the first half arc
+      if( intersects && s >= 0. && s < maxS )
+	_intersectionsList.push_back(std::make_pair(s, surf.surface));
+    }
+
+    std::sort( _intersectionsList.begin() , _intersectionsList.end() , SortWithS() ) ;
+
+    return _intersectionsList;
+  }
   
   
   const fitResults* trajectory::getFitResults(int label){
 
-    return _fittingAlgorithm->getResults(label);
+    return ( _fitted ? _fitOutput->getResults(label) : NULL ) ;
+  }
+
+
+  bool trajectory::getAllFitResults( std::vector<fitResults>& results ){
+
+    if( ! _fitted ){
+      results.clear() ;
+      return false ;
+    }
+
+    _fitOutput->getAllResults( results ) ;
+
+    return true ;
   }
   
   
@@ -176,47 +361,60 @@ namespace aidaTT {
 
     const Vector2D& referenceUV = surface.globalToLocal( xx ) ;
 
-    trackParameters* trkParam = new  trackParameters( *tP ) ;
+    trackParameters trkParam( *tP ) ;
     
     // move the track paramters to the intersection point
-    moveHelixTo( *trkParam, xx ) ;
+    moveHelixTo( trkParam, xx ) ;
 
 
-    const Vector3D& mom = momentumAtPCA( *trkParam ) ;
+    const Vector3D& mom = momentumAtPCA( trkParam ) ;
+
+    surfaceCrossing crossing = makeCrossing( surface, xx, referenceUV, mom ) ;
 
     const Vector2D& measuredUV = surface.globalToLocal( position ) ;
 
+    // the precomputed material constants of the surface, if cached by the geometry
+    const surfaceMaterial* material = _geometry->getSurfaceMaterial( &surface ) ;
+
     // ********************************************
     // apply the energy loss from this surface
     double energy, beta ;
-    double deltaE = aidaTT::computeEnergyLoss( &surface, measuredUV , mom , energy, beta , _mass ) ; 
-    trkParam->parameters()( OMEGA ) /= ( 1. - deltaE/energy ) ;
+    double deltaE = ( material != NULL ?
+		      aidaTT::computeEnergyLoss( *material, cosIncidence( surface, position, mom ), mom.r(), energy, beta, _mass ) :
+		      aidaTT::computeEnergyLoss( &surface, measuredUV , mom , energy, beta , _mass ) ) ; 
+    trkParam.parameters()( OMEGA ) /= ( 1. - deltaE/energy ) ;
+    crossing.momentum = ( 1. - deltaE/energy ) * mom ;
     // ********************************************
 
 
     /// calculate measurement info
 
-    std::vector<double> residuals;
-    std::vector<Vector3D>* measDir = new std::vector<Vector3D>;
+    std::vector<double>& residuals = _residualScratch ;
+    std::vector<Vector3D>& measDir = _measDirScratch ;
+    residuals.clear() ;
+    measDir.clear() ;
     
     const double udiff = measuredUV.u() - referenceUV.u();
     residuals.push_back( udiff ) ;
-    measDir->push_back( surface.u(position) );
+    measDir.push_back( surface.u(position) );
     
 
     //    if( ! surface.type().isMeasurement1D()  ){
     
     const double vdiff = measuredUV.v() - referenceUV.v();
     residuals.push_back( vdiff ) ;
-    measDir->push_back(surface.v(position));
+    measDir.push_back(surface.v(position));
     // }
     
-    std::vector<double> new_prec = precision ;
+    std::vector<double>& new_prec = _precisionScratch ;
+    new_prec.assign( precision.begin() , precision.end() ) ;
     
     if( isScatterer ){ // also  add a scattering to the trajectory element
       
       
-      double qms = aidaTT::computeQMS( &surface, referenceUV , mom , _mass ) ; 
+      double qms = ( material != NULL ?
+		     aidaTT::computeQMS( *material, crossing.cosIncidence, mom.r(), _mass ) :
+		     aidaTT::computeQMS( &surface, referenceUV , mom , _mass ) ) ; 
       
       // projection of track onto surface vectors
       // const Vector3D& up = mom.unit() ;
@@ -234,7 +432,9 @@ namespace aidaTT {
 
 
     // note: need to get the curvilinear system at s==0. as this is where the local track state is defined
-    _initialTrajectoryElements.push_back(new trajectoryElement(s, trkParam, surface, measDir, new_prec, residuals, calculateLocalCurvilinearSystem(0., *trkParam), id , isScatterer ));
+    trajectoryElement& element = _nextElement() ;
+    element.set(s, trkParam, surface, measDir, new_prec, residuals, calculateLocalCurvilinearSystem(0., trkParam), id , isScatterer );
+    element.setCrossing( crossing ) ;
   }
 
   void trajectory::addScatterer( const ISurface& surface ){
@@ -264,31 +464,42 @@ namespace aidaTT {
     // add this trajectoryElement at the total path lengths from the IP
     s = s + prevS ;
 
-    trackParameters* trkParam = new  trackParameters( *tP ) ;
+    trackParameters trkParam( *tP ) ;
     
     // move the track paramters to the intersection point
-    moveHelixTo( *trkParam, xx ) ;
+    moveHelixTo( trkParam, xx ) ;
     
     Vector2D referenceUV = surface.globalToLocal( xx ) ;
 
-    const Vector3D& mom = momentumAtPCA( *trkParam ) ;
+    const Vector3D& mom = momentumAtPCA( trkParam ) ;
+
+    surfaceCrossing crossing = makeCrossing( surface, xx, referenceUV, mom ) ;
+
+    // the precomputed material constants of the surface, if cached by the geometry
+    const surfaceMaterial* material = _geometry->getSurfaceMaterial( &surface ) ;
+    const double cosTrk = crossing.cosIncidence ;
 
     // ********************************************
     // apply the energy loss from this surface
     double energy, beta ;
-    double deltaE = aidaTT::computeEnergyLoss( &surface, referenceUV , mom , energy, beta , _mass ) ; 
-    trkParam->parameters()( OMEGA ) /= ( 1. - deltaE/energy ) ;
+    double deltaE = ( material != NULL ?
+		      aidaTT::computeEnergyLoss( *material, cosTrk, mom.r(), energy, beta, _mass ) :
+		      aidaTT::computeEnergyLoss( &surface, referenceUV , mom , energy, beta , _mass ) ) ; 
+    trkParam.parameters()( OMEGA ) /= ( 1. - deltaE/energy ) ;
+    crossing.momentum = ( 1. - deltaE/energy ) * mom ;
     // ********************************************
 
-    std::vector<double> residuals(2);
-    residuals[0] = 0 ;
-    residuals[1] = 0 ;
+    std::vector<double>& residuals = _residualScratch ;
+    residuals.assign( 2 , 0. ) ;
 
-    std::vector<Vector3D>* measDir = new std::vector<Vector3D>;
-    measDir->push_back( surface.u( xx ) );
-    measDir->push_back( surface.v( xx ) );
+    std::vector<Vector3D>& measDir = _measDirScratch ;
+    measDir.clear() ;
+    measDir.push_back( surface.u( xx ) );
+    measDir.push_back( surface.v( xx ) );
 
-    double qms = aidaTT::computeQMS( &surface, referenceUV , mom , _mass ) ; 
+    double qms = ( material != NULL ?
+		   aidaTT::computeQMS( *material, cosTrk, mom.r(), _mass ) :
+		   aidaTT::computeQMS( &surface, referenceUV , mom , _mass ) ) ; 
       
     // projection of track onto surface vectors
     // const Vector3D& up = mom.unit() ;
@@ -297,14 +508,17 @@ namespace aidaTT {
 
     //fg: c1,c2 are scalar products of offset directions with track direction
     //    and are by construction 0. in curvilinear !
-    std::vector<double> precision(3) ;
+    std::vector<double>& precision = _precisionScratch ;
+    precision.resize(3) ;
     precision[0] =  qms*qms  ;
     precision[1] = 0. ;
     precision[2] = 0. ;
    
 
     // note: need to get the curvilinear system at s==0. as this is where the local track state is defined
-    _initialTrajectoryElements.push_back(new trajectoryElement(s, trkParam, surface, measDir, precision, residuals, calculateLocalCurvilinearSystem(0., *trkParam), 0 , true, false ));
+    trajectoryElement& element = _nextElement() ;
+    element.set(s, trkParam, surface, measDir, precision, residuals, calculateLocalCurvilinearSystem(0., trkParam), 0 , true, false );
+    element.setCrossing( crossing ) ;
   }
 
 
@@ -313,9 +527,7 @@ namespace aidaTT {
     double s =  calculateSfromXY(point.x(), point.y(), _referenceParameters);
 
     //FIXME: need proper track parameters at this s ....
-    trackParameters* trkParam = new  trackParameters( _referenceParameters ) ;
-
-    _initialTrajectoryElements.push_back(new trajectoryElement(s, trkParam ,  id));
+    _nextElement().set(s, _referenceParameters ,  id);
   }
 
 
@@ -337,13 +549,30 @@ namespace aidaTT {
 
     double prevS = 0. ;
 
+    // the elements are visited in increasing s, so the tangents can be found with a cursor in O(1)
+    unsigned cursor = 0 ;
+
+    // no field look up per element for a constant field
+    const bool constantBField = _geometry->hasConstantBField() ;
+    const Vector3D constBField( 0., 0., _geometry->constantBz() ) ;
+
+    if( _initialTrajectoryElements.empty() )
+      return ;
+
+    AIDATT_INSTRUMENT_SCOPE( Jacobians ) ;
+    AIDATT_INSTRUMENT_ITEMS( _initialTrajectoryElements.size() ) ;
+
     /// the first jacobian is useless, just use an empty 5x5 matrix
-    if(_initialTrajectoryElements.size() > 0)
-      {
-	fiveByFiveMatrix* j = new fiveByFiveMatrix;
-	j->Unit();
-	(_initialTrajectoryElements.at(0))->setJacobian(j);
-      }
+    {
+      fiveByFiveMatrix j;
+      j.Unit();
+      trajectoryElement* first = _initialTrajectoryElements.at(0) ;
+      first->setJacobian(j);
+
+      const trackParameters& trkParam = *first->getTrackParameters() ;
+      const Vector3D BField = ( constantBField ? constBField : _geometry->getBField( trkParam.referencePoint() ) ) ;
+      first->setCurvilinearToL3Jacobian( curvilinearToL3Jacobian( trkParam , BField ) ) ;
+    }
     /// now the really interesting ones
     for(std::vector<trajectoryElement*>::iterator element = _initialTrajectoryElements.begin()+1, last = _initialTrajectoryElements.end(); element < last; ++element)
       {
@@ -351,10 +580,13 @@ namespace aidaTT {
 	const trackParameters& trkParam = *(*element)->getTrackParameters() ;
 
 	const double cosLambda = cos( calculateLambda( trkParam  ) );
-	const Vector3D& BField = _geometry->getBField( trkParam.referencePoint() ) ;
+	const Vector3D BField = ( constantBField ? constBField : _geometry->getBField( trkParam.referencePoint() ) ) ;
 
 	const double qbyp  = calculateQoverP( trkParam , BField.z() ) ;
 
+	// cache the jacobian for the transformation of the fit results
+	(*element)->setCurvilinearToL3Jacobian( curvilinearToL3Jacobian( trkParam , BField ) ) ;
+
 	double currS = (*element)->arcLength();
 
 	///~ calculate 3D arclength 
@@ -367,9 +599,24 @@ namespace aidaTT {
 	  const aidaTT::ISurface& surf = (*element)->surface();
 	  //	  NrjLoss = GetEnergyLoss(  &surf, &trkParam );
 
-	  // check new eloss:
+	  // the crossing has been computed when the element was added - no new intersection and field look up
+	  const surfaceCrossing& crossing = (*element)->crossing() ;
+
 	  double e,b ;
-	  double deltaE = aidaTT::computeEnergyLoss( &surf, trkParam , e, b, _mass ) ;
+	  double deltaE = 0. ;
+
+	  if( crossing.valid ){
+
+	    const surfaceMaterial* material = _geometry->getSurfaceMaterial( &surf ) ;
+
+	    deltaE = ( material != NULL ?
+		       aidaTT::computeEnergyLoss( *material, crossing.cosIncidence, crossing.momentum.r(), e, b, _mass ) :
+		       aidaTT::computeEnergyLoss( &surf, crossing.uv, crossing.momentum, e, b, _mass ) ) ;
+	  } else {
+
+	    deltaE = aidaTT::computeEnergyLoss( &surf, trkParam , e, b, _mass ) ;
+	  }
+
 	  NrjLoss = (2.0*deltaE) / ((b*b)*e);
 
 	  //	  std::cout << " NrjLoss : " << NrjLoss << " - NrjLossNew: " << NrjLossNew << std::endl ;
@@ -378,12 +625,13 @@ namespace aidaTT {
 	// Vector3D tstartOld = calculateTangent(prevS, trkParam);
 	// Vector3D tendOld   = calculateTangent(currS, trkParam);
 
-	Vector3D tstart = tangentAt( prevS ) ;
-	Vector3D tend   = tangentAt( currS ) ;
+	Vector3D xstart = pointAt( prevS, cursor ) ;
+	Vector3D tstart = tangentAt( prevS, cursor ) ;
+	Vector3D tend   = tangentAt( currS, cursor ) ;
 
 
-	fiveByFiveMatrix* jacob = new fiveByFiveMatrix;
-	_propagation->getJacobian(*jacob, dw, qbyp, tstart, tend, BField, NrjLoss);
+	fiveByFiveMatrix jacob;
+	_propagation->getJacobian(jacob, dw, qbyp, xstart, tstart, tend, BField, *_geometry, NrjLoss);
 	(*element)->setJacobian(jacob);
 
 	prevS = currS ;
@@ -394,6 +642,16 @@ namespace aidaTT {
 
   bool trajectory::fit()
   {
-    return _fittingAlgorithm->fit(*this);
+    // the fit output is owned by the trajectory, so that the fitting algorithm
+    // can be shared between trajectories (and threads) - the output of the
+    // previous fit is handed back to the algorithm for reusing its memory
+    IFitOutput* previous = _fitOutput ;
+    _fitOutput = NULL ;
+    _fitted = false ;
+
+    _fitOutput = _fittingAlgorithm->fitTrajectory( *this, previous );
+    _fitted = true ;
+
+    return _fitOutput->isValid();
   }
 }
@@ -2,6 +2,9 @@
 #include "helixUtils.hh"
 #include "utilities.hh"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace aidaTT
 {
   /*
@@ -22,25 +25,23 @@ namespace aidaTT
   
     /// standard constructor for measurements: arc length is given, the surface it belongs to;
     /// the measurement directions, resolution and residuals plus the local curvilinear system and some identification
-  trajectoryElement::trajectoryElement(double arclength, trackParameters* trkParam, const ISurface& surface, std::vector<Vector3D>* measDir, const std::vector<double>& precisions,
-                                         const std::vector<double>& residuals, std::pair<Vector3D, Vector3D>* lCLS, void* id, bool isScatterer, bool hasMeasurement )
-    : _arclength(arclength), _jacobianFromPrevious(NULL), _surface(&surface), _measurement(hasMeasurement),
-	_measDirections(measDir), _precisions(precisions), _residuals(residuals), _localCurvilinearSystem(lCLS), 
-	_trkParam(trkParam), _scatterer( isScatterer ), _thick(false), _id(id)
+  trajectoryElement::trajectoryElement(double arclength, const trackParameters& trkParam, const ISurface& surface, const std::vector<Vector3D>& measDir, const std::vector<double>& precisions,
+                                         const std::vector<double>& residuals, const std::pair<Vector3D, Vector3D>& lCLS, void* id, bool isScatterer, bool hasMeasurement )
+    : _arclength(arclength), _jacobianFromPrevious(), _curvilinearToL3Jacobian(), _surface(&surface), _measurement(hasMeasurement),
+	_measDirections(), _nMeasDirections(0), _precisions(), _nPrecisions(0), _residuals(), _nResiduals(0), _localCurvilinearSystem(lCLS), 
+	_localToMeasurementProjection(), _trkParam(trkParam), _crossing(), _scatterer( isScatterer ), _thick(false), _id(id)
     {
-        _calculateLocalToMeasurementProjectionMatrix();
-
-	//fg: does this prevent using 1D measurements ???
-	if(_precisions.size() == 1)
-	  _precisions.push_back(0.);
+        _setMeasurement(measDir, precisions, residuals);
 
+        _calculateLocalToMeasurementProjectionMatrix();
     }
   
 
     ///~ constructor B: only the arc length is given and some identification
-  trajectoryElement::trajectoryElement(double arclength, trackParameters* trkParam, void* id) : _arclength(arclength), _jacobianFromPrevious(NULL), _surface(NULL), _measurement(false), 
-												_measDirections(NULL), _localCurvilinearSystem(NULL) , _localToMeasurementProjection(NULL),
-												_trkParam(trkParam), _scatterer(false), _id(id)
+  trajectoryElement::trajectoryElement(double arclength, const trackParameters& trkParam, void* id) : _arclength(arclength), _jacobianFromPrevious(), _curvilinearToL3Jacobian(), _surface(NULL), _measurement(false), 
+												_measDirections(), _nMeasDirections(0), _precisions(), _nPrecisions(0), _residuals(), _nResiduals(0),
+												_localCurvilinearSystem(),
+												_localToMeasurementProjection(), _trkParam(trkParam), _crossing(), _scatterer(false), _thick(false), _id(id)
     {}
 
 
@@ -50,27 +51,91 @@ namespace aidaTT
     //~ {}
 
 
+    trajectoryElement::trajectoryElement(const trajectoryElement& o) : _arclength(o._arclength), _jacobianFromPrevious(o._jacobianFromPrevious),
+								       _curvilinearToL3Jacobian(o._curvilinearToL3Jacobian),
+								       _surface(o._surface), _measurement(o._measurement), _measDirections(),
+								       _nMeasDirections(o._nMeasDirections), _precisions(), _nPrecisions(o._nPrecisions), _residuals(),
+								       _nResiduals(o._nResiduals), _localCurvilinearSystem(o._localCurvilinearSystem),
+								       _localToMeasurementProjection(), _trkParam(o._trkParam), _crossing(o._crossing),
+								       _scatterer(o._scatterer), _thick(o._thick), _id(o._id)
+    {
+      std::copy(o._measDirections, o._measDirections + maxMeasurementDimension, _measDirections);
+      std::copy(o._precisions, o._precisions + maxPrecisions, _precisions);
+      std::copy(o._residuals, o._residuals + maxMeasurementDimension, _residuals);
+      std::copy(o._localToMeasurementProjection, o._localToMeasurementProjection + 4, _localToMeasurementProjection);
+    }
+
+
+    trajectoryElement& trajectoryElement::operator=(const trajectoryElement& o)
+    {
+      if( this == &o )
+	return *this ;
+
+      _arclength                    = o._arclength ;
+      _jacobianFromPrevious         = o._jacobianFromPrevious ;
+      _curvilinearToL3Jacobian      = o._curvilinearToL3Jacobian ;
+      _surface                      = o._surface ;
+      _measurement                  = o._measurement ;
+      _nMeasDirections              = o._nMeasDirections ;
+      _nPrecisions                  = o._nPrecisions ;
+      _nResiduals                   = o._nResiduals ;
+      _localCurvilinearSystem       = o._localCurvilinearSystem ;
+      std::copy(o._measDirections, o._measDirections + maxMeasurementDimension, _measDirections);
+      std::copy(o._precisions, o._precisions + maxPrecisions, _precisions);
+      std::copy(o._residuals, o._residuals + maxMeasurementDimension, _residuals);
+      std::copy(o._localToMeasurementProjection, o._localToMeasurementProjection + 4, _localToMeasurementProjection);
+      _trkParam                     = o._trkParam ;
+      _crossing                     = o._crossing ;
+      _scatterer                    = o._scatterer ;
+      _thick                        = o._thick ;
+      _id                           = o._id ;
+
+      return *this ;
+    }
+
 
     trajectoryElement::~trajectoryElement()
     {
-      if(_localCurvilinearSystem){
-	//std::cout << " now i delete the curvilinear system " << std::endl ;
-            delete _localCurvilinearSystem;
-      } 
-      if(_measDirections){
-	//std::cout << " now i delete the measurement directions " << std::endl ;
-            delete _measDirections;
-      }
-      if(_jacobianFromPrevious){
-	//std::cout << " now i delete the jecobian from the previous element " << std::endl ;
-            delete _jacobianFromPrevious;
-      }
-      if(_localToMeasurementProjection){
-	//std::cout << " now i delete the projection from local to measurement system " << std::endl ;
-            delete _localToMeasurementProjection;
-      }
-      if( _trkParam ) delete  _trkParam ;
+    }
 
+
+    void trajectoryElement::set(double arclength, const trackParameters& trkParam, const ISurface& surface, const std::vector<Vector3D>& measDir, const std::vector<double>& precisions,
+				const std::vector<double>& residuals, const std::pair<Vector3D, Vector3D>& lCLS, void* id, bool isScatterer, bool hasMeasurement )
+    {
+      _arclength              = arclength ;
+      _jacobianFromPrevious   = fiveByFiveMatrix() ;
+      _curvilinearToL3Jacobian = fiveByFiveMatrix() ;
+      _surface                = &surface ;
+      _measurement            = hasMeasurement ;
+      _localCurvilinearSystem = lCLS ;
+      _trkParam               = trkParam ;
+      _crossing               = surfaceCrossing() ;
+      _scatterer              = isScatterer ;
+      _thick                  = false ;
+      _id                     = id ;
+
+      _setMeasurement(measDir, precisions, residuals);
+
+      _calculateLocalToMeasurementProjectionMatrix();
+    }
+
+
+    void trajectoryElement::set(double arclength, const trackParameters& trkParam, void* id)
+    {
+      _arclength              = arclength ;
+      _jacobianFromPrevious   = fiveByFiveMatrix() ;
+      _curvilinearToL3Jacobian = fiveByFiveMatrix() ;
+      _surface                = NULL ;
+      _measurement            = false ;
+      _nMeasDirections        = 0 ;
+      _nPrecisions            = 0 ;
+      _nResiduals             = 0 ;
+      _localCurvilinearSystem = std::pair<Vector3D, Vector3D>() ;
+      _trkParam               = trkParam ;
+      _crossing               = surfaceCrossing() ;
+      _scatterer              = false ;
+      _thick                  = false ;
+      _id                     = id ;
     }
 
 
@@ -80,6 +145,31 @@ namespace aidaTT
       //if(!_measurement)
       //      return;
 
-        _localToMeasurementProjection = calculateLocalToMeasurementProjectionMatrix(_localCurvilinearSystem->first, _localCurvilinearSystem->second, *_measDirections);
+        calculateLocalToMeasurementProjectionMatrix(_localCurvilinearSystem.first, _localCurvilinearSystem.second, _measDirections, _nMeasDirections,
+						    _localToMeasurementProjection);
+    }
+
+
+
+    void trajectoryElement::_setMeasurement(const std::vector<Vector3D>& measDir, const std::vector<double>& precisions, const std::vector<double>& residuals)
+    {
+      if( measDir.size() > maxMeasurementDimension || residuals.size() > maxMeasurementDimension )
+	throw std::invalid_argument("Measurement dimensions > 2 are not yet implemented.");
+
+      if( precisions.size() > maxPrecisions )
+	throw std::invalid_argument("trajectoryElement: at most five precisions ( measurement plus scattering ) are supported.");
+
+      _nMeasDirections = measDir.size();
+      std::copy(measDir.begin(), measDir.end(), _measDirections);
+
+      _nResiduals = residuals.size();
+      std::copy(residuals.begin(), residuals.end(), _residuals);
+
+      _nPrecisions = precisions.size();
+      std::copy(precisions.begin(), precisions.end(), _precisions);
+
+      //fg: does this prevent using 1D measurements ???
+      if(_nPrecisions == 1)
+	_precisions[_nPrecisions++] = 0.;
     }
 }
@@ -0,0 +1,74 @@
+#ifdef AIDATT_USE_DD4HEP
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+// aidaTT
+#include "IGeometry.hh"
+#include "FieldMapGrid.hh"
+#include "SnapshotGeometry.hh"
+
+/** Write the tracking geometry of a compact file to a geometry snapshot, which can then be
+ *  loaded in every job with IGeometry::instance( "out.aidaTT" ) or
+ *  SnapshotGeometry::installGlobal( "out.aidaTT" ). A field that is not constant is sampled
+ *  on an r-z grid.
+ */
+int main(int argc, char** argv)
+{
+
+    if(argc != 3 && argc != 7)
+        {
+            std::cout << " usage: ./geometry_snapshot compact.xml out.aidaTT [ nr nz rMax zMax ] " << std::endl
+                      << "   nr nz rMax zMax : the r-z grid for the field map [mm], if the field is not constant - default: 101 301 2000 3000 " << std::endl ;
+            exit(1) ;
+        }
+
+    const std::string inFile = argv[1] ;
+    const std::string outFile = argv[2] ;
+
+    unsigned nr = 101, nz = 301 ;
+    double rMax = 2000., zMax = 3000. ;
+
+    if(argc == 7)
+        {
+            nr = std::atoi(argv[3]) ;
+            nz = std::atoi(argv[4]) ;
+            rMax = std::atof(argv[5]) ;
+            zMax = std::atof(argv[6]) ;
+        }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now() ;
+
+    const aidaTT::IGeometry& geom = aidaTT::IGeometry::instance(inFile) ;
+
+    std::chrono::steady_clock::time_point loaded = std::chrono::steady_clock::now() ;
+
+    aidaTT::FieldMapGrid* field = 0 ;
+
+    if(!geom.hasConstantBField())
+        {
+            // the geometry is in mm
+            field = new aidaTT::FieldMapGrid(rMax, -zMax, zMax, nr, nz) ;
+            field->sample(geom) ;
+        }
+
+    aidaTT::SnapshotGeometry::write(geom, outFile, field) ;
+
+    // time the loading of the snapshot
+    std::chrono::steady_clock::time_point mapStart = std::chrono::steady_clock::now() ;
+
+    aidaTT::SnapshotGeometry snapshot(outFile) ;
+
+    std::chrono::steady_clock::time_point mapped = std::chrono::steady_clock::now() ;
+
+    std::cout << " geometry_snapshot: " << snapshot.getSurfaces().size() << " surfaces written to " << outFile << std::endl
+              << "   compact file loaded in  " << std::chrono::duration<double>(loaded - start).count() << " s" << std::endl
+              << "   snapshot loaded in      " << std::chrono::duration<double>(mapped - mapStart).count() << " s" << std::endl ;
+
+    delete field ;
+
+    return 0;
+}
+
+#endif // AIDATT_USE_DD4HEP
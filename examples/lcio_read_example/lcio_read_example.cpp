@@ -27,19 +27,6 @@ int main(int argc, char** argv)
 
   const aidaTT::IGeometry& geom = aidaTT::IGeometry::instance(inFile) ;
 
-  const std::vector<const aidaTT::ISurface*>& surfaces = geom.getSurfaces() ;
-
-
-  // create map of surfaces
-  std::map< long64, const aidaTT::ISurface* > surfMap ;
-
-
-  for(std::vector<const aidaTT::ISurface*>::const_iterator surf = surfaces.begin() ; surf != surfaces.end() ; ++surf)
-    {
-      surfMap[(*surf)->id() ] = (*surf) ;
-    }
-
-
 
   /// lcio stuff
   std::string lcioFileName = argv[2] ;
@@ -74,7 +61,7 @@ int main(int argc, char** argv)
 	      idDecoder.setValue(id) ;
 	      //      std::cout << " simhit with cellid : " << idDecoder << std::endl ;
 
-	      const aidaTT::ISurface* surf = surfMap[ id ] ;
+	      const aidaTT::ISurface* surf = geom.findSurface( id ) ;
 
 	      std::cout << " surface " << (*surf) << " found for id : " << std::hex << id << std::dec  ;
 	    }
@@ -47,15 +47,6 @@ int main(int argc, char** argv)
     
   const aidaTT::IGeometry& geom = aidaTT::IGeometry::instance(inFile) ;
 
-  const std::vector<const aidaTT::ISurface*>& surfaces = geom.getSurfaces() ;
-
-  // create map of surfaces
-  std::map< long, const aidaTT::ISurface* > surfMap ;
-  
-  for(std::vector<const aidaTT::ISurface*>::const_iterator surf = surfaces.begin() ; surf != surfaces.end() ; ++surf){
-    surfMap[(*surf)->id() ] = (*surf) ;
-  }
-
     
   /// lcio stuff
   std::string lcioFileName = argv[2] ;
@@ -156,7 +147,7 @@ int main(int argc, char** argv)
 
       }
 	
-      const aidaTT::ISurface* surf = surfMap[ hitid ] ;
+      const aidaTT::ISurface* surf = geom.findSurface( hitid ) ;
       
       if(surf == NULL){
 	std::cerr << " lcio_debug_tracks : no surface found for id : " << idDecoder.valueString() << std::endl ;
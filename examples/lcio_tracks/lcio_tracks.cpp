@@ -22,6 +22,7 @@
 #include "analyticalPropagation.hh"
 #include "simplifiedPropagation.hh"
 #include "GBLInterface.hh"
+#include "KalmanFitter.hh"
 #include "fitResults.hh"
 #include "Vector5.hh"
 #include "utilities.hh"
@@ -34,8 +35,6 @@
 #include <TTree.h>
 #include <TFile.h>
 
-#include <map>
-
 using namespace std ;
 using namespace lcio;
 using namespace aidaTT ;
@@ -63,10 +62,14 @@ int maxEvent = 1000 ;
 
 aidaTT::analyticalPropagation* propagation = new aidaTT::analyticalPropagation();
 
+#ifdef USE_GBL
 aidaTT::GBLInterface* fitter = new aidaTT::GBLInterface();
+#else
+aidaTT::KalmanFitter* fitter = new aidaTT::KalmanFitter();
+#endif
 
-typedef std::map< long, const aidaTT::ISurface* > SurfMap ;
-SurfMap surfMap ;
+// converts the LCIO tracks to the fit input and the fitted tracks back to LCIO
+aidaTT::LCIOTrackConverter* converter = 0 ;
 
 //=======================================================================
 
@@ -78,39 +81,7 @@ std::string cellIDString( int detElementID) {
 }
 
 
-void getHitInfo( const EVENT::TrackerHit* hit, double* hitpos, 
-		 std::vector<double>& precision, const aidaTT::ISurface* surf){
-  
-  // get the hit position in dd4hep/aidaTT units
-  for(unsigned int i = 0; i < 3; ++i) hitpos[i] = hit->getPosition()[i] * dd4hep::mm;
-  
-  //---- compute the precision from the hit errors
-  double du,dv ;
-  
-  const TrackerHitPlane* planarhit = dynamic_cast<const TrackerHitPlane*>( hit );
-  if( planarhit != 0 ) {
-    
-    du = planarhit->getdU() * dd4hep::mm  ;
-    dv = planarhit->getdV() * dd4hep::mm  ;
-    
-  } else { // we have a TPC hit which is not yet using the CylinderTrackerHit ...
-    
-    const FloatVec& cov = hit->getCovMatrix();
-    
-    du = sqrt( cov[0] + cov[2] ) * dd4hep::mm  ;
-    dv = sqrt( cov[5]          ) * dd4hep::mm  ;
-  }
-  
-  precision.push_back( 1./ (du*du) );
-  
-  if( ! surf->type().isMeasurement1D()  )
-    precision.push_back( 1./ (dv*dv) );
-  else
-    precision.push_back( 0. );
-}
-
-
-aidaTT::trackParameters createPreFit(aidaTT::trackParameters& tp, const TrackerHitVec& lcioHits ){
+aidaTT::trackParameters createPreFit(aidaTT::trackParameters& tp, const aidaTT::lcioTrackInput& input ){
   
   // create a prefit from the hits w/o QMS and dEdx
   
@@ -119,7 +90,7 @@ aidaTT::trackParameters createPreFit(aidaTT::trackParameters& tp, const TrackerH
   aidaTT::trajectory traj( tp, fitter, propagation ) ; 
   
   // try to use up to 25 or so hits....
-  unsigned nHits = lcioHits.size() ;
+  unsigned nHits = input.size() ;
   
   int step = ( nHits <= 25  ? 1 : int( 1.*nHits/25. )  ) ; 
   
@@ -128,32 +99,26 @@ aidaTT::trackParameters createPreFit(aidaTT::trackParameters& tp, const TrackerH
   
   for(unsigned i=0 ; i < nHits ; i+= step ){
     
-    EVENT::TrackerHit* hit = lcioHits[i] ;
-    
-    long hitid = hit->getCellID0() ;
+    EVENT::TrackerHit* hit = input.hits[i] ;
     
-    SurfMap::iterator it = surfMap.find( hitid ) ;
+    const aidaTT::ISurface* surf = input.surfaces[i] ;
     
-    if( it == surfMap.end() ){
+    if( surf == 0 ){
       
       streamlog_out( DEBUG3 ) << " MarlinAidaTTTrack::createPreFit() : no surface found for id : " 
-			      << cellIDString( hitid ) << std::endl ;
+			      << cellIDString( hit->getCellID0() ) << std::endl ;
       continue;
     }
     
-    const aidaTT::ISurface* surf = it->second ;
-    
-    double hitpos[3] ;
-    std::vector<double> precision ;
-    getHitInfo( hit, hitpos, precision , surf) ;
+    std::vector<double> precision( &input.precisions[ 2*i ], &input.precisions[ 2*i ] + 2 ) ;
     
     streamlog_out( DEBUG2 ) << " MarlinAidaTTTrack::createPreFit() : adding hit for "
-			    <<  cellIDString( hitid ) << " at " 
-			    << aidaTT::Vector3D( hit->getPosition() ) << std::endl ;
+			    <<  cellIDString( hit->getCellID0() ) << " at " 
+			    << input.positions[i] << std::endl ;
     
     
     
-    traj.addMeasurement( hitpos, precision, *surf, hit );
+    traj.addMeasurement( input.positions[i], precision, *surf, hit );
   }
   
   traj.prepareForFitting();
@@ -209,13 +174,11 @@ int main(int argc, char** argv)
 
   const aidaTT::IGeometry& geom = aidaTT::IGeometry::instance( inFile ) ;
 
-  const SurfaceVec& surfaces = geom.getSurfaces() ;
+  // the surfaces of the hits are found with the id table of the geometry
+  converter = new aidaTT::LCIOTrackConverter( geom, trkStateIndex ) ;
 
-  // create map of surfaces
-  
-  for(std::vector<const aidaTT::ISurface*>::const_iterator surf = surfaces.begin() ; surf != surfaces.end() ; ++surf){
-    surfMap[(*surf)->id() ] = (*surf) ;
-  }
+  // the fit input of the tracks of one event - the buffers are reused for all events
+  std::vector<aidaTT::lcioTrackInput> inputs ;
   
   //*********************************************************************
   /// lcio stuff
@@ -243,46 +206,49 @@ int main(int argc, char** argv)
   aidaTT::analyticalPropagation* propagation = new aidaTT::analyticalPropagation();
   //aidaTT::simplifiedPropagation* propagation = new aidaTT::simplifiedPropagation();
 
-  // create the fitter object
+  // create the fitter object - without GBL the native Kalman filter is used
+#ifdef USE_GBL
   aidaTT::GBLInterface* fitter = new aidaTT::GBLInterface();
+#else
+  aidaTT::KalmanFitter* fitter = new aidaTT::KalmanFitter();
+#endif
   
+  // one trajectory object is reused for all tracks - it is reset with the start parameters of every track 
+  aidaTT::trajectory fitTrajectory( aidaTT::trackParameters(), fitter, propagation, &geom);
+
   
   /// event loop
   while( (evt = rdr->readNextEvent()) != 0 &&  ++counter < maxEvent ) {
     
     LCCollection* trackCollection = evt->getCollection(trackCollectionName) ;
     
+    // convert all tracks of the event to the fit input
+    unsigned nTracks = converter->readLCIO( trackCollection, inputs ) ;
+    
     // add output track collection to the event
-    LCCollectionVec* outCol = new LCCollectionVec(LCIO::TRACK) ;
+    LCCollectionVec* outCol = aidaTT::LCIOTrackConverter::createTrackCollection( nTracks ) ;
     
     evt->addCollection( outCol, outColName ) ;
     
-    LCFlagImpl trkFlag(0) ;
-    trkFlag.setBit(LCIO::TRBIT_HITS) ;
-    outCol->setFlag(trkFlag.getFlag()) ;
-
-    int nTracks = trackCollection->getNumberOfElements();
-    
     // loop over all tracks in the collection
     for( unsigned i=0 ; i<nTracks ; ++i){
       
-      TrackImpl* outTrk = new TrackImpl ;
-      outCol->addElement(outTrk) ;
-
-      Track* initialTrack = (Track*) trackCollection->getElementAt(i) ;
-    
-      aidaTT::trackParameters iTP(  aidaTT::readLCIO( initialTrack->getTrackState( trkStateIndex ) )   );  
-    
-      const TrackerHitVec& initialHits = initialTrack->getTrackerHits();
+      const aidaTT::lcioTrackInput& input = inputs[i] ;
+      
+      const TrackerHitVec& initialHits = input.track->getTrackerHits();
       unsigned nHits = initialHits.size() ;
 
-      if( nHits < 3) {
+      if( nHits < 3 || ! input.hasStartParameters ) {
 	
-	streamlog_out( DEBUG5 ) << " less than three hits - track is dropped ..." << std::endl ;
+	streamlog_out( DEBUG5 ) << " less than three hits or no track state - track is dropped ..." << std::endl ;
 	
+	// keep an empty track, so that output track i belongs to input track i
+	outCol->addElement( new TrackImpl ) ;
+
 	continue ;
       }
 
+      aidaTT::trackParameters iTP( input.startParameters ) ;
 
       if( compute_start_helix ) { 
 
@@ -321,111 +287,27 @@ int main(int argc, char** argv)
 	
 	
 	// use this helix as start for the fit:
-	iTP = ( run_prefit ? createPreFit( startHelix , initialHits ) : startHelix  )  ;
+	iTP = ( run_prefit ? createPreFit( startHelix , input ) : startHelix  )  ;
       }
 	
-      TrackStateImpl* ts;
-      bool success;	      
-      
-      aidaTT::trajectory fitTrajectory( iTP, fitter, propagation, &geom);
-      
-      const aidaTT::fitResults* result = 0 ; //fitTrajectory.getFitResults();
+      fitTrajectory.reset( iTP ) ;
       
       streamlog_out( DEBUG1 )  << " magnetic field at origin " 
 			       << fitTrajectory.geometry()->getBField( aidaTT::Vector3D() ) 
 			       << std::endl ;
       
-
-      // copy the hits in order to get strip hits in case of spacepoints
-      TrackerHitVec lcioHits ;
-      for(unsigned i=0 ; i < nHits ; ++i){
-	TrackerHit* trkHit = initialHits[i] ;
-
-	outTrk->addHit( trkHit  ) ;
-
-	if( UTIL::BitSet32( trkHit->getType() )[ UTIL::ILDTrkHitTypeBit::COMPOSITE_SPACEPOINT ]  ){
-	  
-	  const EVENT::LCObjectVec rawObjects = trkHit->getRawHits();                    
-	  
-	  for( unsigned k=0; k< rawObjects.size(); k++ ){
-	    EVENT::TrackerHit* rawHit = dynamic_cast< EVENT::TrackerHit* >( rawObjects[k] );
-	    
-	    lcioHits.push_back( rawHit ) ;
-          }
-	  
-	} else { // normal non composite hit
-
-	  lcioHits.push_back( trkHit ) ;
-	}
-      }
-
-
-      // ==== store hits in a map and in track  ===============
-      std::map< int, EVENT::TrackerHit*> hitMap ;
-      for(unsigned i=0 ; i < lcioHits.size() ; ++i){
-	hitMap[ lcioHits[i]->getCellID0()  ] = lcioHits[i] ;
-      }
-      
-      //==== compute _all_ surface intersections ====================== 
-      const IntersectionVec* intersections = &fitTrajectory.getIntersectionsWithSurfaces( surfaces ) ;
+      //==== add the hits at the intersections of the start helix with the surfaces - 
+      //     scatterers for the surfaces without hit
+      unsigned nMeasurements = converter->fillTrajectory( input, fitTrajectory, useQMS ) ;
       
-      // now we have all surface intersections of the initial track seed
-      // however the hits might be on neighbouring sensors really ...
-
-      // ... to be sorted out ...
-
-      //========= loop over all intersections =========
-      int pointLabel = 0 ; 
-      for( std::vector<std::pair<double, const aidaTT::ISurface*> >::const_iterator it =  
-	     intersections->begin() ; it != intersections->end() ; ++it ){
-	
-	const aidaTT::ISurface* surf = it->second ;
-	
-	EVENT::TrackerHit* hit = hitMap[ surf->id() ] ;
-	
-	streamlog_out(DEBUG4) << "intersection - current pointLabel : " << pointLabel  
-			      << ":  at s = " << it->first <<  " surface id : " 
-			      << cellIDString( surf->id()  ) << std::endl ; 
-
-	streamlog_out(DEBUG1) << aidaTT::pointAt(it->first, iTP ) << std::endl ;
-
-	streamlog_out(DEBUG) << *surf << std::endl ;
-	
-	if( hit != 0 ){ //-------- we have to add a measurement   
-	  
-	  double hitpos[3] ;
-	  std::vector<double> precision ;
-	  getHitInfo( hit, hitpos, precision , surf) ;
-	  
-	  fitTrajectory.addMeasurement( hitpos, precision, *surf, hit , useQMS );
-	  ++pointLabel ;
-
-	  streamlog_out(DEBUG3) << "addMeasurement called for pointLabel : " << pointLabel << std::endl ;
-	  
-	} else  { // we just add a scatterer
-	  
-	  if ( useQMS ){
-	    
-	    // ignore virtual surface with no material (e.g. inside the beam pipe )
-	    
-	    if( ! ( surf->innerMaterial().density() < 1e-6  && 
-		    surf->outerMaterial().density() < 1e-6 )  ) {
-	      
-	      fitTrajectory.addScatterer( *surf ) ;
-	      ++pointLabel ;
-
-	      streamlog_out(DEBUG3) << " addScatterer called for pointLabel : " << pointLabel << std::endl ;
-	    }
-	  }
-	}
-      }
-
+      streamlog_out(DEBUG3) << " measurements added : " << nMeasurements << " of " << input.size() 
+			    << " hits ( " << input.nMissingSurfaces << " without surface )" << std::endl ;
       
       fitTrajectory.prepareForFitting();
       
-      success = fitTrajectory.fit();
+      bool success = fitTrajectory.fit();
       
-      result = fitTrajectory.getFitResults();
+      const aidaTT::fitResults* result = fitTrajectory.getFitResults();
       
       
       //***********************************************************************************************************
@@ -435,39 +317,14 @@ int main(int argc, char** argv)
 			       << std::endl ;
       }
       
-	      
-      
       streamlog_out( DEBUG ) << " End of the loop " << std::endl ;
       streamlog_out( DEBUG ) << " initial values " << std::endl;
       streamlog_out( DEBUG ) << iTP << std::endl;
       streamlog_out( DEBUG ) << " refitted values " << std::endl;
       streamlog_out( DEBUG ) << result->estimatedParameters() << std::endl;
       
-      // add Track State to track:
-      ts = aidaTT::createLCIO( result->estimatedParameters() );
-      //DEBUG: return seed track: ts = aidaTT::createLCIO( iTP );
-      
-      outTrk->setChi2( result->chiSquare() ) ;
-      outTrk->setNdf( result->ndf() ) ;
-      outTrk->subdetectorHitNumbers().resize(10.) ;
-      
-      outTrk->subdetectorHitNumbers()[0] = outTrk->getTrackerHits().size() ;
-      
-      float ref[3] = { 0., 0. , 0. } ;
-      ts->setReferencePoint(ref);	    
-      ts->setLocation(lcio::TrackState::AtIP);
-      
-      
-      // checking the covariance matrix
-      //--------------------------------------------------------------------
-      std::vector<float> cm  =  ts->getCovMatrix();
-      trackParameters finalAidaTP = result->estimatedParameters();
-      fiveByFiveMatrix  finalAidaCovMat = finalAidaTP.covarianceMatrix();
-      
-      //---------------------------------------------------------------------
-      
-      outTrk->addTrackState(ts);
-      
+      // the fitted track with the hits of the initial track
+      outCol->addElement( converter->createLCIO( *result, input.track ) ) ;
     }
 
     wrt->writeEvent(evt) ;
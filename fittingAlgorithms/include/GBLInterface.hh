@@ -3,12 +3,16 @@
 #ifndef GBLINTERFACE_H
 #define GBLINTERFACE_H
 #include "IFittingAlgorithm.hh"
+#include "RefitEngine.hh"
 #include "trajectory.hh"
 #include "fiveByFiveMatrix.hh"
 #include "Vector5.hh"
 
 #include <vector>
 #include <map>
+#include <mutex>
+#include <string>
+#include <sstream>
 
 // GBL:
 #include "GblTrajectory.h"
@@ -29,76 +33,143 @@
 namespace aidaTT
 {
 
-  class GBLInterface : public IFittingAlgorithm
+  /** The output of a GBL fit of one trajectory - holds the GBL trajectory and
+   *  computes the fit results at the requested labels on demand.
+   */
+  class GBLFitOutput : public IFitOutput
   {
     typedef  std::map< int, fitResults* > ResMap ;
 
   public:
-    GBLInterface();
-    ~GBLInterface();
+    /// takes ownership of the GBL trajectory
+    GBLFitOutput(gbl::GblTrajectory* gblTraj, const trajectory& traj, bool valid,
+		 double chisquare, int ndf, double lostweight);
+    ~GBLFitOutput();
 
     /// inherited methods:
-    bool fit(const trajectory&);
-
-    const fitResults* getResults(int label=0) const
-    {
-
-      const fitResults* res = 0 ;
+    bool isValid() const { return _valid ; }
+    double chiSquare() const { return _chisquare ; }
+    unsigned int ndf() const { return _ndf ; }
+    double weightLost() const { return _lostweight ; }
 
-      ResMap::const_iterator it = _theResults.find( label ) ;
-      
-      if( it == _theResults.end() ){
-	
-	res = _fillResults( *_fittedTraj , label ) ; 
+    /// the results at the trajectory element label - from the GBL point label+1
+    const fitResults* getResults(int label=0) const ;
 
-      } else {
-
-	res = it->second ;
-      }
-      
-      return res ;
-    };
+    void getAllResults(std::vector<fitResults>& results) const ;
 
   private:
-    GBLInterface(const GBLInterface&);
-    GBLInterface& operator=(const GBLInterface&);
+    GBLFitOutput(const GBLFitOutput&);
+    GBLFitOutput& operator=(const GBLFitOutput&);
+
+    /// compute the fit results at the label using the given buffers for the GBL results
+    void _computeResults(int label, Eigen::VectorXd& tpCorr, Eigen::MatrixXd& trackcovariance, fitResults& result) const ;
 
     ///< GBL trajectory
     gbl::GblTrajectory* _trajectory;
-    ///< flag for curved track (helix, else straight line)
-    bool _curvature;
 
-    ///< correction vector from GBL fit (for track parameters)
-    Vector5* _correctionVector;
+    ///< the fitted aidaTT trajectory
+    const trajectory* _fittedTraj ;
 
-    ///< covariance matrix from GBL
-    fullCovariance* _covarianceMatrix;
-
-    ///< number of degrees of freedom in GBL fit
-    int _ndf;
+    ///< status of the GBL fit
+    bool _valid ;
 
     ///< chi2 from GBL fit
     double _chisquare;
 
+    ///< number of degrees of freedom in GBL fit
+    int _ndf;
+
     ///< weight lost by down-weighting, not used for now!
     double _lostweight;
 
-    ///< arc-length of reference point
-    double _refPointS;
+    ///< results computed so far
+    mutable ResMap _theResults;
+  };
+
+
+
+  class GBLInterface : public IFittingAlgorithm
+  {
+
+  public:
+    /// fitter without Millepede output
+    GBLInterface();
+
+    /** Fitter writing the Millepede-II binary records of all fits to the given file.
+     *  For multi-threaded alignment data production use one fitter (and file) per
+     *  thread, e.g. with a milleRefitWorkerFactory.
+     */
+    GBLInterface(const std::string& milleFileName);
 
-    ///< label of reference point
-    unsigned int _refPointIndex;
+    ~GBLInterface();
+
+    /// true if the Millepede binary output is enabled
+    bool writesMilleOutput() const { return _milleBinary != NULL ; }
+
+    /** Concatenate the Millepede binary files into one output file - the records are
+     *  self-contained, so the result is equivalent to writing all records into one file.
+     */
+    static void mergeMilleFiles(const std::vector<std::string>& inputFiles, const std::string& outputFile);
+
+    /// inherited methods:
+    bool fit(const trajectory&);
+
+    const fitResults* getResults(int label=0) const
+    {
+      return ( _output != NULL ? _output->getResults( label ) : NULL ) ;
+    };
 
-    const fitResults* _fillResults(const trajectory&, int label=0) const ;
+    /// thread safe fit - the caller owns the returned object
+    IFitOutput* fitTrajectory(const trajectory&) const ;
+
+  private:
+    GBLInterface(const GBLInterface&);
+    GBLInterface& operator=(const GBLInterface&);
 
     void _clear() ;
 
-    const trajectory* _fittedTraj ;
-    
-    mutable ResMap _theResults;
+    ///< output of the last call to fit()
+    IFitOutput* _output ;
 
     gbl::MilleBinary* _milleBinary ;
 
+    ///< serializes the writing to the mille binary
+    mutable std::mutex _milleMutex ;
+  };
+
+
+
+  /** Factory for the RefitEngine creating one GBLInterface with its own Millepede
+   *  binary file per worker: prefix_0.bin, prefix_1.bin, ... The files can be given
+   *  to pede directly or merged with GBLInterface::mergeMilleFiles().
+   */
+  template <class PROPAGATION>
+  class milleRefitWorkerFactory : public IRefitWorkerFactory
+  {
+
+  public:
+    milleRefitWorkerFactory(const std::string& prefix) : _prefix( prefix ), _fileNames(), _mutex() {}
+
+    IFittingAlgorithm* createFitter() const
+    {
+      std::lock_guard<std::mutex> lock( _mutex ) ;
+
+      std::stringstream name ;
+      name << _prefix << "_" << _fileNames.size() << ".bin" ;
+      _fileNames.push_back( name.str() ) ;
+
+      return new GBLInterface( name.str() ) ;
+    }
+
+    IPropagation* createPropagation() const { return new PROPAGATION ; }
+
+    /// the names of the files of all fitters created so far
+    const std::vector<std::string>& fileNames() const { return _fileNames ; }
+
+  private:
+    std::string _prefix ;
+    mutable std::vector<std::string> _fileNames ;
+    mutable std::mutex _mutex ;
   };
 
 }
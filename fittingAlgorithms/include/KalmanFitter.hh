@@ -0,0 +1,140 @@
+#ifndef KALMANFITTER_HH
+#define KALMANFITTER_HH
+
+#include "IFittingAlgorithm.hh"
+#include "IFitOutput.hh"
+#include "trajectory.hh"
+#include "fitResults.hh"
+
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace aidaTT
+{
+
+  /** Output of a KalmanFitter fit: the smoothed corrections to the reference trajectory
+   *  in the local curvilinear system at every trajectory element. The results at a label
+   *  are transformed to L3 track parameters only when requested. The output can be handed
+   *  back to KalmanFitter::fitTrajectory() for the next fit, which then reuses its memory.
+   */
+  class KalmanFitOutput : public IFitOutput
+  {
+  public:
+
+    /// the state at one trajectory element - corrections to the reference in local curvilinear parameters
+    struct state{
+      Eigen::Matrix<double, 5, 1> x ;
+      Eigen::Matrix<double, 5, 5> C ;
+
+      state() : x(), C() {}
+    } ;
+
+    /// the states are filled by the KalmanFitter
+    KalmanFitOutput(const trajectory& traj) ;
+    ~KalmanFitOutput() ;
+
+    /// inherited methods:
+    bool isValid() const { return _valid ; }
+    double chiSquare() const { return _chisquare ; }
+    unsigned int ndf() const { return _ndf ; }
+    double weightLost() const { return 0. ; }
+
+    /// the fit results at the element with index label - NULL for an invalid label
+    const fitResults* getResults(int label=0) const ;
+
+    void getAllResults(std::vector<fitResults>& results) const ;
+
+  private:
+    KalmanFitOutput(const KalmanFitOutput&) ;
+    KalmanFitOutput& operator=(const KalmanFitOutput&) ;
+
+    friend class KalmanFitter ;
+
+    /// transform the state at the label to the fit results in L3 parameters
+    void _computeResults(unsigned label, fitResults& result) const ;
+
+    /// prepare the output for the fit of the trajectory - the allocated memory is kept
+    void _reset(const trajectory& traj) ;
+
+    ///< the fitted aidaTT trajectory
+    const trajectory* _fittedTraj ;
+
+    ///< one state per trajectory element
+    std::vector<state> _states ;
+
+    bool _valid ;
+    double _chisquare ;
+    unsigned int _ndf ;
+
+    ///< results computed so far - indexed by label, valid where _computed is set
+    mutable std::vector<fitResults> _theResults ;
+    mutable std::vector<char> _computed ;
+  };
+
+
+
+  /** Kalman filter with Rauch-Tung-Striebel smoother as alternative to the GBLInterface.
+   *  It fits the same model as GBL - corrections to the reference trajectory in the local
+   *  curvilinear parameters (q/p, u', v', u, v), propagated with the jacobians of the
+   *  trajectory elements, measurements of the offsets and thin scatterers as kinks at the
+   *  inner elements - so that it does not depend on GBL. All 5x5 algebra is done with
+   *  fixed size Eigen types.
+   *
+   *  The filter is started with a wide, but finite prior on the corrections at the first
+   *  element ( see setInitialCovariance() ). The residuals of the first measurements are
+   *  compared to this prior and add only little to the chi2; the ndf is the number of measured
+   *  dimensions minus five, which is exact in the limit of an infinitely wide prior. The results
+   *  at a label are the smoothed parameters downstream of a scatterer at this element.
+   */
+  class KalmanFitter : public IFittingAlgorithm
+  {
+
+  public:
+    KalmanFitter() ;
+
+    ~KalmanFitter() ;
+
+    /** Set the diagonal of the covariance of the prior for the corrections at the first
+     *  element: q/p, the two slopes and the two offsets. It should be large compared to the
+     *  expected corrections but not so large that the filter becomes numerically unstable.
+     */
+    void setInitialCovariance(double qOverP, double slope, double offset) ;
+
+    /// inherited methods:
+    bool fit(const trajectory&) ;
+
+    const fitResults* getResults(int label=0) const
+    {
+      return ( _output != NULL ? _output->getResults( label ) : NULL ) ;
+    };
+
+    /// thread safe fit - the caller owns the returned object
+    IFitOutput* fitTrajectory(const trajectory&) const ;
+
+    /// thread safe fit - reuses output if it is a KalmanFitOutput, otherwise it is deleted
+    IFitOutput* fitTrajectory(const trajectory&, IFitOutput* output) const ;
+
+  private:
+    KalmanFitter(const KalmanFitter&) ;
+    KalmanFitter& operator=(const KalmanFitter&) ;
+
+    /** Add the covariance of the kink angles of a thin scatterer at the element to the slopes.
+     *  The kink is applied downstream of the element, i.e. before the measurement update, as the
+     *  measurement only depends on the offsets.
+     */
+    static void _addScattering(const trajectoryElement& element, bool isInner, Eigen::Matrix<double, 5, 5>& C) ;
+
+    /// filter and smooth the trajectory, the output has been reset for the trajectory
+    void _fit(const trajectory& TRAJ, KalmanFitOutput& out) const ;
+
+    ///< output of the last call to fit()
+    IFitOutput* _output ;
+
+    ///< diagonal of the prior covariance
+    Eigen::Matrix<double, 5, 1> _initialCovariance ;
+  };
+
+}
+
+#endif // KALMANFITTER_HH
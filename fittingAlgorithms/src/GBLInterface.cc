@@ -1,24 +1,53 @@
 #ifdef USE_GBL
 #include "GBLInterface.hh"
 #include "utilities.hh"
+#include "Instrumentation.hh"
 //#include "MilleBinary.h"
 #include "streamlog/streamlog.h"
 
+#include <fstream>
+#include <stdexcept>
+
 
 namespace aidaTT
 {
-  GBLInterface::GBLInterface() : _trajectory(NULL), _correctionVector(NULL), _covarianceMatrix(NULL)
+  GBLInterface::GBLInterface() : _output(NULL), _milleBinary(NULL), _milleMutex()
+  {
+  }
+
+
+
+  GBLInterface::GBLInterface(const std::string& milleFileName) : _output(NULL), _milleBinary(NULL), _milleMutex()
   {
-    _milleBinary = new gbl::MilleBinary() ;
+    _milleBinary = new gbl::MilleBinary( milleFileName ) ;
+  }
+
+
+
+  void GBLInterface::mergeMilleFiles(const std::vector<std::string>& inputFiles, const std::string& outputFile)
+  {
+    std::ofstream out( outputFile.c_str(), std::ios::binary | std::ios::trunc ) ;
+
+    if( !out )
+      throw std::runtime_error( "GBLInterface::mergeMilleFiles: cannot open " + outputFile ) ;
+
+    for(unsigned i = 0 ; i < inputFiles.size() ; ++i)
+      {
+	std::ifstream in( inputFiles[i].c_str(), std::ios::binary ) ;
+
+	if( !in )
+	  throw std::runtime_error( "GBLInterface::mergeMilleFiles: cannot open " + inputFiles[i] ) ;
+
+	// an empty file would set the failbit of the output stream
+	if( in.peek() != std::ifstream::traits_type::eof() )
+	  out << in.rdbuf() ;
+      }
   }
 
 
 
   GBLInterface::~GBLInterface()
   {
-    if(_trajectory != NULL)
-      delete _trajectory;
-    
     delete _milleBinary ;
 
     _clear() ;
@@ -28,22 +57,32 @@ namespace aidaTT
 
   bool GBLInterface::fit(const trajectory& TRAJ)
   {
+    // clear any results from a previous fit
+    _clear() ;
+
+    _output = fitTrajectory( TRAJ ) ;
+
+    return _output->isValid() ;
+  }
+
+
+
+  IFitOutput* GBLInterface::fitTrajectory(const trajectory& TRAJ) const
+  {
+    AIDATT_INSTRUMENT_SCOPE( GBLFit ) ;
+
     /* several bits of information are needed to initialize the gbl:
      *  - a vector of GblPoints, which in turn need a p2p jacobian to be instantiated
      *  -- a measurement GblPoint needs the projection matrix, the residual vector and the precision
      *  -- a scattering GblPoint needs the precision (expected inverse standard deviation)
      */
 
-    // clear any results from a previous fit
-    _clear() ; 
-
-
     /// create vector of GBL points
     std::vector < gbl::GblPoint > theListOfPoints;
 
     const std::vector<trajectoryElement*>& elements = TRAJ.trajectoryElements();
 
-    _fittedTraj = &TRAJ ;
+    theListOfPoints.reserve( elements.size() ) ;
 
     for(std::vector<trajectoryElement*>::const_iterator element = elements.begin(), last = elements.end(); element < last; ++element)
       {
@@ -52,7 +91,7 @@ namespace aidaTT
 	//	std::cout << " input jacobian " << jac << std::endl ;
 
 	///~ initialise point with jacobian from last to the current element
-	gbl::GblPoint point(TMatrixD(5, 5, jac.array()));
+	gbl::GblPoint point( jac.matrix() );
 
 	//std::cout << " ---  GBLInterface::fit - element : " <<  **element << std::endl ;
 
@@ -74,50 +113,24 @@ namespace aidaTT
 	      throw std::invalid_argument("Error: Currently only 1D or 2D measurements are implemented.");
 
 	    //~ 1) projection matrix -- the basis change matrix
-	    const std::vector<double>& projLocal2Meas = (*element)->localToMeasurementProjection();
+	    const elementArray<double> projLocal2Meas = (*element)->localToMeasurementProjection();
 
 
 	    //~ 2) the residuals in the measurement direction
-	    const std::vector<double>& residuals = (*element)->measurementResiduals();
-
-	    //~ convert the vector to an array:
-	    const double* resid = residuals.data();
+	    const elementArray<double> residuals = (*element)->measurementResiduals();
 
 	    //~ 3) the precision of the measurements -- the inverse of the resolution
-	    const std::vector<double>& precision = (*element)->precisions();
-	    //const TMatrixDSym& precision = (*element)->precisions();
-
-	    //~ convert the vector to an array:
-	    const double* prec = precision.data();
+	    const elementArray<double> precision = (*element)->precisions();
 
 	    
-//~~	    if( ! (*element)->surface().type().isMeasurement1D()  ){
-//~~
-//~~	      /// convert the data from the vector into the matrix:
-//~~	      /// convention is that the first row comes first in the data
-//~~	      TMatrixD pL2M(2, 2);
-//~~	      pL2M(0, 0) = projLocal2Meas.at(0);
-//~~	      pL2M(0, 1) = projLocal2Meas.at(1);
-//~~	      pL2M(1, 0) = projLocal2Meas.at(2);
-//~~	      pL2M(1, 1) = projLocal2Meas.at(3);
-//~~	      
-//~~	      // fixed size of arguments: 2D in measurements!
-//~~	      point.addMeasurement(pL2M, TVectorD(2, resid), TVectorD(2, prec));
-//~~
-//~~	    }else{
-//~~
-	    /// convert the data from the vector into the matrix:
+	    /// fixed size Eigen types - no heap allocation
 	    /// convention is that the first row comes first in the data
-	    TMatrixD pL2M(2, 2);
-	    pL2M(0, 0) = projLocal2Meas.at(0);
-	    pL2M(0, 1) = projLocal2Meas.at(1);
-	    pL2M(1, 0) = projLocal2Meas.at(2);
-	    pL2M(1, 1) = projLocal2Meas.at(3);
-	    
+	    Eigen::Matrix2d pL2M;
+	    pL2M << projLocal2Meas[0], projLocal2Meas[1],
+	            projLocal2Meas[2], projLocal2Meas[3];
+
 	    // fixed size of arguments: 2D in measurements!
-	    point.addMeasurement(pL2M, TVectorD(2, resid), TVectorD(2, prec));
-	    
-//~~	    }
+	    point.addMeasurement( pL2M, Eigen::Vector2d( residuals[0], residuals[1] ), Eigen::Vector2d( precision[0], precision[1] ) );
 
 	  }
 	
@@ -152,12 +165,12 @@ namespace aidaTT
 	    //~ convert the vector to an array:
 
 	    // YV: Here we hard-code that the scatterer residuals are 0. One might want to change that if he has prior knowledge about the kink
-	    const double resid[2] = {0.,0.};
+	    const Eigen::Vector2d resid( 0., 0. );
 
 	    //~ 3) precision - MPS
 
 
-	    std::vector<double> precision = (*element)->precisions();
+	    const elementArray<double> precision = (*element)->precisions();
 
 	    unsigned precSize = precision.size() ;
 	    
@@ -170,7 +183,7 @@ namespace aidaTT
 	    double c1 =  precision[  precSize-2	] ;
 	    double c2 =  precision[  precSize-1 ] ;
 
-	    TMatrixDSym Vk_sym(2);
+	    Eigen::Matrix2d Vk_sym;
 	    double Scalar_value = 0 ;
 	    
 	    Scalar_value = ((1 - c1*c1 - c2*c2)) / qms ;
@@ -190,7 +203,7 @@ namespace aidaTT
 				    << "  (*element)->measurementDimension() " <<  (*element)->measurementDimension()
 				    << std::endl ;
 
-	    point.addScatterer( TVectorD(2, resid), Vk_sym);
+	    point.addScatterer( resid, Vk_sym);
 
 	  }
 
@@ -202,55 +215,102 @@ namespace aidaTT
 
     /// TODO :: check validity before continuing!
 
-    // //~ this is not elegant -- delete previous data before starting again
-    // if(_trajectory != NULL)
-    //   delete _trajectory;
+    gbl::GblTrajectory* gblTraj = new gbl::GblTrajectory(theListOfPoints, true); /// TODO: pass info about magnetic field
 
-    _trajectory = new gbl::GblTrajectory(theListOfPoints, true); /// TODO: pass info about magnetic field
+    double chisquare = 0. ;
+    int ndf = 0 ;
+    double lostweight = 0. ;
 
-    unsigned int returnValue = _trajectory->fit(_chisquare, _ndf, _lostweight);
+    unsigned int returnValue = gblTraj->fit(chisquare, ndf, lostweight);
 
+    // alignment output only if requested
+    if( _milleBinary != NULL )
+      {
+	std::lock_guard<std::mutex> lock( _milleMutex ) ;
 
+	gblTraj->milleOut ( *_milleBinary ) ;
+      }
 
-     _trajectory->milleOut ( *_milleBinary ) ;
+    //gblTraj->printTrajectory(100) ;
+    //gblTraj->printPoints(100) ;
 
-    //_trajectory->printTrajectory(100) ;
-    //_trajectory->printPoints(100) ;
+    AIDATT_INSTRUMENT_SUCCESS( returnValue == 0 ) ;
 
+    return new GBLFitOutput( gblTraj, TRAJ, returnValue == 0, chisquare, ndf, lostweight ) ;
+  }
 
-    if(returnValue == 0)
-      {
-	// _fillResults( TRAJ, 0 );
-	return true;
-      }
-    else
-      return false;
+
+
+  GBLFitOutput::GBLFitOutput(gbl::GblTrajectory* gblTraj, const trajectory& traj, bool valid,
+			     double chisquare, int ndf, double lostweight) :
+    _trajectory( gblTraj ), _fittedTraj( &traj ), _valid( valid ),
+    _chisquare( chisquare ), _ndf( ndf ), _lostweight( lostweight ), _theResults() {
   }
 
 
 
-  const fitResults* GBLInterface::_fillResults(const trajectory& aidaTrajectory, int label) const
+  GBLFitOutput::~GBLFitOutput(){
+
+    for( ResMap::iterator it = _theResults.begin() ; it != _theResults.end() ; ++it){
+      delete it->second ;
+    }
+
+    delete _trajectory ;
+  }
+
+
+
+  const fitResults* GBLFitOutput::getResults(int label) const
   {
+    if( label < 0 || unsigned( label ) >= _fittedTraj->trajectoryElements().size() )
+      return NULL ;
 
     ResMap::const_iterator it = _theResults.find( label ) ;
 
     if ( it != _theResults.end() ) 
       return it->second ;
 
+    Eigen::VectorXd tpCorr(5);
+    Eigen::MatrixXd trackcovariance(5, 5);
+
+    fitResults* res = new fitResults ;
+
+    _computeResults( label, tpCorr, trackcovariance, *res ) ;
+  
+    _theResults.insert( std::make_pair(  label , res )  ) ;
+  
+    return res ;
+			
+  }
+
+
+
+  void GBLFitOutput::getAllResults(std::vector<fitResults>& results) const
+  {
+    const unsigned nLabels = _fittedTraj->trajectoryElements().size() ;
+
+    results.resize( nLabels ) ;
+
+    // the GBL result buffers are shared by all labels
+    Eigen::VectorXd tpCorr(5);
+    Eigen::MatrixXd trackcovariance(5, 5);
+
+    for(unsigned label = 0 ; label < nLabels ; ++label)
+      _computeResults( label, tpCorr, trackcovariance, results[label] ) ;
+  }
+
 
-    bool v = true;
-    double chs = _chisquare;
-    unsigned int n = _ndf;
-    double wl = _lostweight;
 
-    TVectorD tpCorr(5);
-    TMatrixDSym trackcovariance(5);
+  void GBLFitOutput::_computeResults(int label, Eigen::VectorXd& tpCorr, Eigen::MatrixXd& trackcovariance, fitResults& result) const
+  {
+    AIDATT_INSTRUMENT_SCOPE( FitResults ) ;
 
     //~ get the results at a given label in local cl track parameters
     //~ the track parameters are corrections to the curvilinear track parameters
-    int error =  _trajectory->getResults( label , tpCorr, trackcovariance)  ;
+    //~ the GBL point labels start at 1: point label+1 was created from the element label
+    int error =  _trajectory->getResults( label + 1 , tpCorr, trackcovariance)  ;
 
-    Vector5 clCorrections(tpCorr[0], tpCorr[1], tpCorr[2], tpCorr[3], tpCorr[4]);
+    Vector5 clCorrections(tpCorr(0), tpCorr(1), tpCorr(2), tpCorr(3), tpCorr(4));
 
     if( error ){
       clCorrections(0) = 0. ;
@@ -263,12 +323,12 @@ namespace aidaTT
 
 
     //fixme: which parameters to take here ( reference point is different !!!??? )
-    const trackParameters& initialTP = *aidaTrajectory.trajectoryElements()[ label ]->getTrackParameters() ;
+    const trajectoryElement& element = *_fittedTraj->trajectoryElements()[ label ] ;
+    const trackParameters& initialTP = *element.getTrackParameters() ;
     //    const trackParameters& initialTP  = aidaTrajectory.getInitialTrackParameters() ;
 
-    const Vector3D bField = aidaTrajectory.geometry()->getBField( initialTP.referencePoint() ) ;
-
-    const fiveByFiveMatrix& cl2L3Jacobian  = curvilinearToL3Jacobian( initialTP , bField ) ;
+    // the jacobian has been computed in trajectory::prepareForFitting()
+    const fiveByFiveMatrix& cl2L3Jacobian  = element.curvilinearToL3Jacobian() ;
     const Vector5& L3corrections           =  cl2L3Jacobian * clCorrections;
 
     const Vector5& fittedParameters = initialTP.parameters()  + L3corrections;
@@ -282,20 +342,12 @@ namespace aidaTT
 
 
 
-    TMatrixD cl2L3_copy(5,5);
-    for(int i = 0 ; i < 5 ; i++)
-      {
-	for(int j = 0 ; j < 5 ; j++)
-	  {
-	    cl2L3_copy(i, j) = cl2L3Jacobian(i, j);
-	  }
-      }
-
     trackParameters tp;
     tp.setTrackParameters( fittedParameters );
     tp.setReferencePoint( initialTP.referencePoint() );
 
-    TMatrixD covarianceMatrix = trackcovariance.Similarity(cl2L3_copy);
+    const Matrix5x5d& J = cl2L3Jacobian.matrix() ;
+    const Matrix5x5d covarianceMatrix = J * trackcovariance * J.transpose() ;
 
     //    fiveByFiveMatrix finalCov;
     for(int i = 0 ; i < 5 ; i++) 
@@ -304,28 +356,14 @@ namespace aidaTT
     
     //    tp.setCovarianceMatrix(finalCov);
 
-    fitResults* res = new fitResults( v, chs, n, wl, tp ) ;
-  
-    _theResults.insert( std::make_pair(  label , res )  ) ;
-  
-    return res ;
-			
+    result.setResults( _valid, _chisquare, _ndf, _lostweight, tp ) ;
   }
 
   void  GBLInterface::_clear(){
 
-    for( ResMap::iterator it = _theResults.begin() ; it != _theResults.end() ; ++it){
-      delete it->second ;
-    } 
-
-    _theResults.clear() ;
+    delete _output ;
 
-    _fittedTraj = 0 ;
-
-    if(_trajectory != NULL){
-      delete _trajectory;
-      _trajectory = 0 ;
-    }
+    _output = 0 ;
   }
 
   
@@ -0,0 +1,318 @@
+#include "KalmanFitter.hh"
+#include "Instrumentation.hh"
+
+#include <Eigen/Cholesky>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace aidaTT
+{
+  typedef Eigen::Matrix<double, 5, 1> kalmanVector ;
+  typedef Eigen::Matrix<double, 5, 5> kalmanMatrix ;
+
+
+  KalmanFitter::KalmanFitter() : _output(NULL), _initialCovariance()
+  {
+    setInitialCovariance( 1.e2 , 1. , 1.e2 ) ;
+  }
+
+
+
+  KalmanFitter::~KalmanFitter()
+  {
+    delete _output ;
+  }
+
+
+
+  void KalmanFitter::setInitialCovariance(double qOverP, double slope, double offset)
+  {
+    _initialCovariance << qOverP, slope, slope, offset, offset ;
+  }
+
+
+
+  bool KalmanFitter::fit(const trajectory& TRAJ)
+  {
+    _output = fitTrajectory( TRAJ, _output ) ;
+
+    return _output->isValid() ;
+  }
+
+
+
+  IFitOutput* KalmanFitter::fitTrajectory(const trajectory& TRAJ) const
+  {
+    return fitTrajectory( TRAJ, NULL ) ;
+  }
+
+
+
+  IFitOutput* KalmanFitter::fitTrajectory(const trajectory& TRAJ, IFitOutput* output) const
+  {
+    KalmanFitOutput* out = dynamic_cast<KalmanFitOutput*>( output ) ;
+
+    if( out != NULL )
+      out->_reset( TRAJ ) ;
+    else
+      {
+	delete output ;
+	out = new KalmanFitOutput( TRAJ ) ;
+      }
+
+    _fit( TRAJ, *out ) ;
+
+    return out ;
+  }
+
+
+
+  void KalmanFitter::_fit(const trajectory& TRAJ, KalmanFitOutput& out) const
+  {
+    AIDATT_INSTRUMENT_SCOPE( KalmanFit ) ;
+
+    const std::vector<trajectoryElement*>& elements = TRAJ.trajectoryElements();
+
+    const unsigned nElements = elements.size() ;
+
+    std::vector<KalmanFitOutput::state>& states = out._states ;
+    states.resize( nElements ) ;
+
+    if( nElements == 0 )
+      {
+	AIDATT_INSTRUMENT_SUCCESS( false ) ;
+	return ;
+      }
+
+    const kalmanMatrix unit = kalmanMatrix::Identity() ;
+
+    kalmanVector x = kalmanVector::Zero() ;
+    kalmanMatrix C = _initialCovariance.asDiagonal() ;
+
+    double chisquare = 0. ;
+    unsigned nMeasured = 0 ;
+    bool valid = true ;
+
+    /// forward filter
+    for(unsigned k = 0 ; k < nElements ; ++k)
+      {
+	const trajectoryElement& element = *elements[k] ;
+
+	///~ predict from the previous element
+	if( k > 0 )
+	  {
+	    const Matrix5x5d& F = element.jacobian().matrix() ;
+
+	    x = F * x ;
+	    C = F * C * F.transpose() ;
+
+	    _addScattering( element, k+1 < nElements, C ) ;
+	  }
+
+	if( element.hasMeasurement() )
+	  {
+	    if( element.measurementDimension() > 2 )
+	      throw std::invalid_argument("Error: Currently only 1D or 2D measurements are implemented.");
+
+	    const elementArray<double> projLocal2Meas = element.localToMeasurementProjection();
+	    const elementArray<double> residuals = element.measurementResiduals();
+	    const elementArray<double> precision = element.precisions();
+
+	    ///~ the precision is diagonal in the measurement system, so the two directions
+	    ///~ can be added one after the other - directions with zero precision are not measured
+	    for(unsigned i = 0 ; i < 2 ; ++i)
+	      {
+		if( !( precision[i] > 0. ) )
+		  continue ;
+
+		// the measurement is a projection of the two offsets
+		kalmanVector h = kalmanVector::Zero() ;
+		h(3) = projLocal2Meas[ 2*i ] ;
+		h(4) = projLocal2Meas[ 2*i + 1 ] ;
+
+		const kalmanVector Ch = C * h ;
+		const double variance = h.dot( Ch ) + 1. / precision[i] ;
+
+		if( !( variance > 0. ) )
+		  {
+		    valid = false ;
+		    continue ;
+		  }
+
+		const double r = residuals[i] - h.dot( x ) ;
+
+		const kalmanVector K = Ch / variance ;
+
+		x += K * r ;
+
+		// Joseph form keeps C symmetric and positive also for the diffuse prior
+		const kalmanMatrix IKH = unit - K * h.transpose() ;
+		C = IKH * C * IKH.transpose() + K * K.transpose() / precision[i] ;
+
+		chisquare += r * r / variance ;
+		++nMeasured ;
+	      }
+	  }
+
+	states[k].x = x ;
+	states[k].C = C ;
+      }
+
+    /// backward smoother (Rauch-Tung-Striebel) - the last filtered state is already smoothed
+    for(unsigned k = nElements-1 ; k-- > 0 ; )
+      {
+	const Matrix5x5d& F = elements[k+1]->jacobian().matrix() ;
+
+	KalmanFitOutput::state& s = states[k] ;
+	const KalmanFitOutput::state& next = states[k+1] ;
+
+	const kalmanVector xPred = F * s.x ;
+	const kalmanMatrix FC    = F * s.C ;
+	kalmanMatrix CPred       = FC * F.transpose() ;
+
+	_addScattering( *elements[k+1], k+2 < nElements, CPred ) ;
+
+	// smoother gain A = C F^T CPred^-1
+	const kalmanMatrix A = CPred.ldlt().solve( FC ).transpose() ;
+
+	s.x += A * ( next.x - xPred ) ;
+	s.C += A * ( next.C - CPred ) * A.transpose() ;
+      }
+
+    out._valid     = valid && nMeasured >= 5 && std::isfinite( chisquare ) ;
+    out._chisquare = chisquare ;
+    out._ndf       = ( nMeasured > 5 ? nMeasured - 5 : 0 ) ;
+
+    AIDATT_INSTRUMENT_SUCCESS( out._valid ) ;
+  }
+
+
+
+  void KalmanFitter::_addScattering(const trajectoryElement& element, bool isInner, Eigen::Matrix<double, 5, 5>& C)
+  {
+    // as in GBL there are no kinks at the first and last element
+    if( !element.isScatterer() || !isInner )
+      return ;
+
+    const elementArray<double> precision = element.precisions();
+
+    const unsigned precSize = precision.size() ;
+
+    const double qms = precision[ precSize-3 ] ;
+    const double c1  = precision[ precSize-2 ] ;
+    const double c2  = precision[ precSize-1 ] ;
+
+    if( !( qms > 0. ) )
+      return ;
+
+    // the precision of the kink angles as in the GBLInterface, inverted to the covariance
+    const double scale = ( 1. - c1*c1 - c2*c2 ) / qms ;
+
+    const double p00 = scale * ( 1. - c1*c1 ) ;
+    const double p01 = -scale * c1 * c2 ;
+    const double p11 = scale * ( 1. - c2*c2 ) ;
+
+    const double det = p00 * p11 - p01 * p01 ;
+
+    if( !( det > 0. ) )
+      return ;
+
+    C(1,1) += p11 / det ;
+    C(1,2) -= p01 / det ;
+    C(2,1) -= p01 / det ;
+    C(2,2) += p00 / det ;
+  }
+
+
+
+  KalmanFitOutput::KalmanFitOutput(const trajectory& traj) :
+    _fittedTraj( &traj ), _states(), _valid( false ), _chisquare( 0. ), _ndf( 0 ), _theResults(), _computed() {
+  }
+
+
+
+  KalmanFitOutput::~KalmanFitOutput(){
+  }
+
+
+
+  void KalmanFitOutput::_reset(const trajectory& traj){
+
+    _fittedTraj = &traj ;
+    _valid      = false ;
+    _chisquare  = 0. ;
+    _ndf        = 0 ;
+
+    // the states are resized by the fit, the results are recomputed on request
+    std::fill( _computed.begin(), _computed.end(), 0 ) ;
+  }
+
+
+
+  const fitResults* KalmanFitOutput::getResults(int label) const
+  {
+    if( label < 0 || unsigned( label ) >= _states.size() )
+      return NULL ;
+
+    // the results are only resized for a new number of states, i.e. once per fit at most
+    if( _theResults.size() != _states.size() )
+      {
+	_theResults.resize( _states.size() ) ;
+	_computed.assign( _states.size() , 0 ) ;
+      }
+
+    if( ! _computed[ label ] )
+      {
+	_computeResults( label, _theResults[ label ] ) ;
+
+	_computed[ label ] = 1 ;
+      }
+
+    return &_theResults[ label ] ;
+  }
+
+
+
+  void KalmanFitOutput::getAllResults(std::vector<fitResults>& results) const
+  {
+    const unsigned nLabels = _states.size() ;
+
+    results.resize( nLabels ) ;
+
+    for(unsigned label = 0 ; label < nLabels ; ++label)
+      _computeResults( label, results[label] ) ;
+  }
+
+
+
+  void KalmanFitOutput::_computeResults(unsigned label, fitResults& result) const
+  {
+    AIDATT_INSTRUMENT_SCOPE( FitResults ) ;
+
+    const state& s = _states[ label ] ;
+
+    Vector5 clCorrections( s.x(0), s.x(1), s.x(2), s.x(3), s.x(4) ) ;
+
+    const trajectoryElement& element = *_fittedTraj->trajectoryElements()[ label ] ;
+    const trackParameters& initialTP = *element.getTrackParameters() ;
+
+    // the jacobian has been computed in trajectory::prepareForFitting()
+    const fiveByFiveMatrix& cl2L3Jacobian = element.curvilinearToL3Jacobian() ;
+
+    trackParameters tp;
+    tp.setTrackParameters( initialTP.parameters() + cl2L3Jacobian * clCorrections );
+    tp.setReferencePoint( initialTP.referencePoint() );
+
+    const Matrix5x5d& J = cl2L3Jacobian.matrix() ;
+    const Matrix5x5d covarianceMatrix = J * s.C * J.transpose() ;
+
+    for(int i = 0 ; i < 5 ; i++)
+      for(int j = 0 ; j < 5 ; j++)
+	tp.covarianceMatrix()(i,j) = covarianceMatrix(i, j);
+
+    result.setResults( _valid, _chisquare, _ndf, 0., tp ) ;
+  }
+}
@@ -4,6 +4,11 @@
 #define DD4HEPGEOMETRY_HH
 
 #include "IGeometry.hh"
+#include "SurfaceIndex.hh"
+#include "materialCache.hh"
+#include "surfaceRecords.hh"
+#include "surfaceIdMap.hh"
+#include "betheBlochTable.hh"
 #include <DD4hep/Detector.h>
 #include <vector>
 
@@ -22,14 +27,55 @@ namespace aidaTT
     /// access the B field in Tesla at given position
     virtual Vector3D getBField( const Vector3D& xx) const ;
     
+    /// the surfaces that might be intersected by the helix - uses a SurfaceIndex
+    virtual void getCandidateSurfaces( const Vector5& hp, const Vector3D& rp,
+				       std::vector<const ISurface*>& surfaces,
+				       std::vector<unsigned>& indices ) const ;
+
+    using IGeometry::getCandidateSurfaces ;
+
+    /// the material constants of the surface - computed for all surfaces at construction
+    virtual const surfaceMaterial* getSurfaceMaterial( const ISurface* surf ) const ;
+
+    /// the flattened surfaces - built at construction, with the annulus of the disks from their solids
+    virtual const SurfaceRecords* getSurfaceRecords() const { return &_surfaceRecords ; }
+
+    /// the surface ids - built at construction
+    virtual const SurfaceIdMap* getSurfaceIdMap() const { return &_surfaceIdMap ; }
+
+    /// tabulate the energy loss of all materials for the mass hypotheses [GeV] - see MaterialCache::tabulate()
+    void tabulateEnergyLoss( const std::vector<double>& masses,
+			     unsigned binsPerDecade = BetheBlochTable::defaultBinsPerDecade ) ;
+
     /// d'tor
-    virtual ~DD4hepGeometry(){}
+    virtual ~DD4hepGeometry() ;
     
 
   private:
+    DD4hepGeometry(const DD4hepGeometry&) ;
+    DD4hepGeometry& operator=(const DD4hepGeometry&) ;
+
+    /** Take the bounds of the planar records from the solids: the annulus of disks from their
+     *  tube, planes need a box. Records of other solids get the type surfaceRecord::Other.
+     */
+    void _setSolidBounds() ;
+
+    /** Flag the B field as constant, if all magnetic fields of the detector are ConstantFields and
+     *  their sum is parallel to z. As consistency check the field is sampled in the tracking volume.
+     */
+    void _checkConstantBField() ;
+
     const dd4hep::Detector& _thedetector ;
 
     std::vector<const ISurface* > _surfaceList;
+
+    SurfaceIndex* _surfaceIndex ;
+
+    MaterialCache _materialCache ;
+
+    SurfaceRecords _surfaceRecords ;
+
+    SurfaceIdMap _surfaceIdMap ;
   };
 }
 #endif // DD4HEPGEOMETRY_HH
@@ -0,0 +1,70 @@
+#ifndef FIELDMAPGEOMETRY_HH
+#define FIELDMAPGEOMETRY_HH
+
+#include "IGeometry.hh"
+#include "FieldMapGrid.hh"
+
+#include <vector>
+
+namespace aidaTT
+{
+  /** Decorator for an IGeometry that answers getBField() from a FieldMapGrid that is
+   *  sampled once from the decorated geometry at construction. Points outside the grid
+   *  are forwarded to the decorated geometry, as are all surface queries.
+   */
+  class FieldMapGeometry : public IGeometry
+  {
+  public:
+
+    /// sample the field of geom into the grid - takes ownership of the grid
+    FieldMapGeometry( const IGeometry& geom, FieldMapGrid* grid ) ;
+
+    /** Replace the global geometry instance ( IGeometry::instance() ) with a FieldMapGeometry
+     *  decorating it, so that also the helix and material utilities use the field map.
+     *  Takes ownership of the grid.
+     */
+    static const IGeometry& installGlobal( FieldMapGrid* grid ) ;
+
+    /// get a list of all surfaces in the tracking geometry - from the decorated geometry
+    virtual const std::vector<const ISurface*>& getSurfaces() const ;
+
+    /// access the B field in Tesla at given position - interpolated in the field map
+    virtual Vector3D getBField( const Vector3D& xx ) const ;
+
+    /// the B field in Tesla at all points (resized to the number of points)
+    void getBField( const std::vector<Vector3D>& points, std::vector<Vector3D>& bfields ) const ;
+
+    /// the surfaces that might be intersected by the helix - from the decorated geometry
+    virtual void getCandidateSurfaces( const Vector5& hp, const Vector3D& rp,
+				       std::vector<const ISurface*>& surfaces,
+				       std::vector<unsigned>& indices ) const ;
+
+    using IGeometry::getCandidateSurfaces ;
+
+    /// the material constants of the surface - from the decorated geometry
+    virtual const surfaceMaterial* getSurfaceMaterial( const ISurface* surf ) const ;
+
+    /// the flattened surfaces - from the decorated geometry
+    virtual const SurfaceRecords* getSurfaceRecords() const ;
+
+    /// the surface ids - from the decorated geometry
+    virtual const SurfaceIdMap* getSurfaceIdMap() const ;
+
+    /// the field map
+    const FieldMapGrid& grid() const { return *_grid ; }
+
+    /// the decorated geometry
+    const IGeometry& decorated() const { return _geometry ; }
+
+    virtual ~FieldMapGeometry() ;
+
+  private:
+    FieldMapGeometry( const FieldMapGeometry& ) ;
+    FieldMapGeometry& operator=( const FieldMapGeometry& ) ;
+
+    const IGeometry& _geometry ;
+
+    FieldMapGrid* _grid ;
+  };
+}
+#endif // FIELDMAPGEOMETRY_HH
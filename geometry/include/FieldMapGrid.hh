@@ -0,0 +1,101 @@
+#ifndef FIELDMAPGRID_HH
+#define FIELDMAPGRID_HH
+
+#include "IGeometry.hh"
+
+namespace aidaTT
+{
+  /** Magnetic field map on a regular grid, either cartesian in (x,y,z) or cylindrical
+   *  in (r,z) for fields that are symmetric in phi. The field values are stored as
+   *  float in one cache line aligned block with four floats per node, i.e. four nodes
+   *  per cache line. The field at a given point is computed with trilinear (x,y,z)
+   *  or bilinear (r,z) interpolation of the surrounding nodes.
+   *
+   *  Typically the grid is filled from another geometry with sample() and then used
+   *  in a FieldMapGeometry.
+   */
+  class FieldMapGrid
+  {
+  public:
+
+    enum GridType{ XYZ, RZ } ;
+
+    /// cartesian grid with nx*ny*nz nodes spanning [min,max] - at least two nodes per coordinate
+    FieldMapGrid( const Vector3D& min, const Vector3D& max, unsigned nx, unsigned ny, unsigned nz ) ;
+
+    /// cylindrical grid with nr*nz nodes spanning [0,rMax]x[zMin,zMax] - at least two nodes per coordinate
+    FieldMapGrid( double rMax, double zMin, double zMax, unsigned nr, unsigned nz ) ;
+
+    /** A grid on external node data, e.g. memory mapped by the SnapshotGeometry, with the number of
+     *  nodes, lower edges and step sizes as returned by nodes(), lowerEdge() and step(). The data has
+     *  the layout of data() and has to be aligned to 64 bytes. It is not copied, i.e. it has to live
+     *  as long as the grid, and cannot be modified with setNode() or sample().
+     */
+    FieldMapGrid( GridType type, const unsigned* n, const double* min, const double* step, const float* data ) ;
+
+    ~FieldMapGrid() ;
+
+    GridType type() const { return _type ; }
+
+    /// the total number of nodes
+    unsigned nNodes() const { return _n[0] * _n[1] * _n[2] ; }
+
+    /// the number of nodes along x (r), y (1 for the (r,z) grid) and z - k=0,1,2
+    unsigned nodes( unsigned k ) const { return _n[k] ; }
+
+    /// the lower edge of the grid along x (r), y and z
+    double lowerEdge( unsigned k ) const { return _min[k] ; }
+
+    /// the step size along x (r), y and z
+    double step( unsigned k ) const { return _step[k] ; }
+
+    /// the field values: four floats per node ( bx,by,bz,0 or br,bphi,bz,0 ) - x (r) runs fastest
+    const float* data() const { return _data ; }
+
+    /// the position of node i - nodes of the (r,z) grid are at phi=0, i.e. at (r,0,z)
+    Vector3D nodePosition( unsigned i ) const ;
+
+    /// set the field (in Tesla) at node i
+    void setNode( unsigned i, const Vector3D& bfield ) ;
+
+    /// fill all nodes with the field of the given geometry
+    void sample( const IGeometry& geom ) ;
+
+    /// true if the point is inside the grid (including the boundaries)
+    bool contains( const Vector3D& xx ) const ;
+
+    /// the interpolated field (in Tesla) at xx - points outside the grid are moved to the closest grid boundary
+    Vector3D fieldAt( const Vector3D& xx ) const ;
+
+    /// compute the interpolated field for n points given as x,y,z triplets in xyz and store it as triplets in bfield
+    void fieldAt( unsigned n, const double* xyz, double* bfield ) const ;
+
+  private:
+    FieldMapGrid( const FieldMapGrid& ) ;
+    FieldMapGrid& operator=( const FieldMapGrid& ) ;
+
+    /// allocate the aligned node storage
+    void _allocate() ;
+
+    /// interpolate the field at x,y,z
+    void _interpolate( double x, double y, double z, double* bfield ) const ;
+
+    /// find the lower node and the fraction to the next node for the coordinate k - clamped to the grid
+    inline void _locate( unsigned k, double c, unsigned& i, double& t ) const ;
+
+    GridType _type ;
+
+    /// number of nodes, lower edge and inverse step size in (x,y,z) or (r,-,z)
+    unsigned _n[3] ;
+    double _min[3] ;
+    double _step[3] ;
+    double _invStep[3] ;
+
+    /// the field values: four floats per node ( bx,by,bz,0 or br,bphi,bz,0 ) - x (r) runs fastest
+    float* _data ;
+
+    /// false for a grid on external data
+    bool _ownsData ;
+  };
+}
+#endif // FIELDMAPGRID_HH
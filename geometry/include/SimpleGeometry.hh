@@ -0,0 +1,344 @@
+#ifndef SIMPLEGEOMETRY_HH
+#define SIMPLEGEOMETRY_HH
+
+#include "IGeometry.hh"
+#include "SurfaceIndex.hh"
+#include "materialCache.hh"
+#include "surfaceRecords.hh"
+#include "surfaceIdMap.hh"
+#include "betheBlochTable.hh"
+
+#include <string>
+#include <vector>
+
+namespace aidaTT
+{
+
+  /** A homogeneous material - in the units of DD4hep: density in g/cm^3, lengths in cm.
+   */
+  class SimpleMaterial : public IMaterial
+  {
+  public:
+
+    SimpleMaterial( const std::string& name, double Z, double A, double density,
+		    double radiationLength, double interactionLength ) ;
+
+    virtual std::string name() const { return _name ; }
+    virtual double Z() const { return _Z ; }
+    virtual double A() const { return _A ; }
+    virtual double density() const { return _density ; }
+    virtual double radiationLength() const { return _radiationLength ; }
+    virtual double interactionLength() const { return _interactionLength ; }
+
+    /// silicon for sensors
+    static const SimpleMaterial& silicon() ;
+
+    /// argon based TPC gas at normal pressure
+    static const SimpleMaterial& tpcGas() ;
+
+    /// air at normal pressure
+    static const SimpleMaterial& air() ;
+
+  private:
+    std::string _name ;
+    double _Z ;
+    double _A ;
+    double _density ;
+    double _radiationLength ;
+    double _interactionLength ;
+  } ;
+
+
+
+  /** Common part of the surfaces of the SimpleGeometry: id, type, origin and the material,
+   *  half of the thickness is on either side of the surface. The material is not copied,
+   *  i.e. it has to live as long as the surface.
+   */
+  class SimpleSurface : public ISurface
+  {
+  public:
+
+    SimpleSurface( long64 id, const Vector3D& origin, double thickness, const IMaterial& material ) ;
+
+    virtual const SurfaceType& type() const { return _type ; }
+    virtual long64 id() const { return _id ; }
+    virtual const Vector3D& origin() const { return _origin ; }
+
+    virtual const IMaterial& innerMaterial() const { return _material ; }
+    virtual const IMaterial& outerMaterial() const { return _material ; }
+    virtual double innerThickness() const { return _thickness / 2. ; }
+    virtual double outerThickness() const { return _thickness / 2. ; }
+
+    /// no lines for drawing
+    virtual std::vector< std::pair<Vector3D, Vector3D> > getLines( unsigned nMax=100 ) ;
+
+    /// mark the surface as not sensitive, e.g. for passive material
+    void setPassive() { _type.setProperty( SurfaceType::Sensitive , false ) ; }
+
+  protected:
+    SurfaceType _type ;
+    long64 _id ;
+    Vector3D _origin ;
+    double _thickness ;
+    const IMaterial& _material ;
+
+  private:
+    SimpleSurface( const SimpleSurface& ) ;
+    SimpleSurface& operator=( const SimpleSurface& ) ;
+  } ;
+
+
+
+  /** A cylinder around the z axis from zCenter-halfLength to zCenter+halfLength,
+   *  measuring in r*phi (u) and z (v).
+   */
+  class SimpleCylinder : public SimpleSurface, public ICylinder
+  {
+  public:
+
+    SimpleCylinder( long64 id, double radius, double halfLength, double thickness,
+		    const IMaterial& material=SimpleMaterial::silicon(), double zCenter=0. ) ;
+
+    virtual bool insideBounds( const Vector3D& point, double epsilon=1.e-4 ) const ;
+
+    virtual Vector3D u( const Vector3D& point=Vector3D() ) const ;
+    virtual Vector3D v( const Vector3D& point=Vector3D() ) const ;
+    virtual Vector3D normal( const Vector3D& point=Vector3D() ) const ;
+
+    virtual Vector2D globalToLocal( const Vector3D& point ) const ;
+    virtual Vector3D localToGlobal( const Vector2D& point ) const ;
+
+    virtual double distance( const Vector3D& point ) const ;
+
+    virtual double length_along_u() const ;
+    virtual double length_along_v() const { return 2. * _halfLength ; }
+
+    virtual double radius() const { return _radius ; }
+    virtual Vector3D center() const { return Vector3D( 0., 0., _zCenter ) ; }
+
+  private:
+    double _radius ;
+    double _halfLength ;
+    double _zCenter ;
+  } ;
+
+
+
+  /** A rectangular plane at origin spanned by the unit vectors u and v, with the full
+   *  lengths along u and v. The normal is u x v.
+   */
+  class SimplePlane : public SimpleSurface
+  {
+  public:
+
+    SimplePlane( long64 id, const Vector3D& origin, const Vector3D& u, const Vector3D& v,
+		 double lengthU, double lengthV, double thickness,
+		 const IMaterial& material=SimpleMaterial::silicon() ) ;
+
+    virtual bool insideBounds( const Vector3D& point, double epsilon=1.e-4 ) const ;
+
+    virtual Vector3D u( const Vector3D& =Vector3D() ) const { return _u ; }
+    virtual Vector3D v( const Vector3D& =Vector3D() ) const { return _v ; }
+    virtual Vector3D normal( const Vector3D& =Vector3D() ) const { return _normal ; }
+
+    virtual Vector2D globalToLocal( const Vector3D& point ) const ;
+    virtual Vector3D localToGlobal( const Vector2D& point ) const ;
+
+    virtual double distance( const Vector3D& point ) const ;
+
+    virtual double length_along_u() const { return _lengthU ; }
+    virtual double length_along_v() const { return _lengthV ; }
+
+  private:
+    Vector3D _u ;
+    Vector3D _v ;
+    Vector3D _normal ;
+    double _lengthU ;
+    double _lengthV ;
+  } ;
+
+
+
+  /** A disk orthogonal to the z axis at z, between the radii rInner and rOuter,
+   *  measuring in x (u) and y (v).
+   */
+  class SimpleDisk : public SimpleSurface
+  {
+  public:
+
+    SimpleDisk( long64 id, double z, double rInner, double rOuter, double thickness,
+		const IMaterial& material=SimpleMaterial::silicon() ) ;
+
+    virtual bool insideBounds( const Vector3D& point, double epsilon=1.e-4 ) const ;
+
+    virtual Vector3D u( const Vector3D& =Vector3D() ) const { return Vector3D( 1., 0., 0. ) ; }
+    virtual Vector3D v( const Vector3D& =Vector3D() ) const { return Vector3D( 0., 1., 0. ) ; }
+    virtual Vector3D normal( const Vector3D& =Vector3D() ) const { return Vector3D( 0., 0., 1. ) ; }
+
+    virtual Vector2D globalToLocal( const Vector3D& point ) const ;
+    virtual Vector3D localToGlobal( const Vector2D& point ) const ;
+
+    virtual double distance( const Vector3D& point ) const { return point.z() - _origin.z() ; }
+
+    virtual double length_along_u() const { return 2. * _rOuter ; }
+    virtual double length_along_v() const { return 2. * _rOuter ; }
+
+    double innerRadius() const { return _rInner ; }
+    double outerRadius() const { return _rOuter ; }
+
+  private:
+    double _rInner ;
+    double _rOuter ;
+  } ;
+
+
+
+  /** A cone around the z axis between (z0,radius0) and (z1,radius1), measuring in r*phi (u)
+   *  and along the cone (v). It also provides the ICylinder interface with the mean radius,
+   *  as intersectWithZCone() starts from the intersection with this cylinder.
+   */
+  class SimpleCone : public SimpleSurface, public ICylinder, public ICone
+  {
+  public:
+
+    SimpleCone( long64 id, double z0, double radius0, double z1, double radius1, double thickness,
+		const IMaterial& material=SimpleMaterial::silicon() ) ;
+
+    virtual bool insideBounds( const Vector3D& point, double epsilon=1.e-4 ) const ;
+
+    virtual Vector3D u( const Vector3D& point=Vector3D() ) const ;
+    virtual Vector3D v( const Vector3D& point=Vector3D() ) const ;
+    virtual Vector3D normal( const Vector3D& point=Vector3D() ) const ;
+
+    virtual Vector2D globalToLocal( const Vector3D& point ) const ;
+    virtual Vector3D localToGlobal( const Vector2D& point ) const ;
+
+    virtual double distance( const Vector3D& point ) const ;
+
+    virtual double length_along_u() const ;
+    virtual double length_along_v() const ;
+
+    virtual double radius() const { return ( _radius0 + _radius1 ) / 2. ; }
+    virtual double radius0() const { return _radius0 ; }
+    virtual double radius1() const { return _radius1 ; }
+    virtual double z0() const { return _z0 ; }
+    virtual double z1() const { return _z1 ; }
+    virtual Vector3D center() const { return Vector3D() ; }
+
+  private:
+    /// the radius of the cone at z
+    double _radiusAt( double z ) const ;
+
+    double _z0 ;
+    double _radius0 ;
+    double _z1 ;
+    double _radius1 ;
+
+    ///< cos and sin of the opening angle
+    double _cosAlpha ;
+    double _sinAlpha ;
+  } ;
+
+
+
+  /** A geometry that is built in memory, e.g. for tests, benchmarks and scaling studies
+   *  without DD4hep and a compact file. The field is constant along z. The geometry owns its
+   *  surfaces; they are kept sorted in radius as in the DD4hepGeometry and are indexed with a
+   *  SurfaceIndex for getCandidateSurfaces().
+   *
+   *  Example - a silicon barrel, forward disks and a TPC:
+   *  @code
+   *   SimpleGeometry* geo = new SimpleGeometry( 3.5 ) ;
+   *   geo->addBarrel( radii, 30., 0.03 ) ;
+   *   geo->addDisks( zPositions, 2., 30., 0.03 ) ;
+   *   geo->addTPC( 220, 33., 180., 235. ) ;
+   *   SimpleGeometry::installGlobal( geo ) ;
+   *  @endcode
+   */
+  class SimpleGeometry : public IGeometry
+  {
+  public:
+
+    /// an empty geometry with the constant field bz [T] along z
+    SimpleGeometry( double bz ) ;
+
+    virtual ~SimpleGeometry() ;
+
+    /// get a list of all surfaces in the geometry - loosely sorted with radius
+    virtual const std::vector<const ISurface*>& getSurfaces() const { return _surfaces ; }
+
+    /// the constant B field in Tesla
+    virtual Vector3D getBField( const Vector3D& ) const { return Vector3D( 0., 0., constantBz() ) ; }
+
+    /// the surfaces that might be intersected by the helix - uses a SurfaceIndex
+    virtual void getCandidateSurfaces( const Vector5& hp, const Vector3D& rp,
+				       std::vector<const ISurface*>& surfaces,
+				       std::vector<unsigned>& indices ) const ;
+
+    using IGeometry::getCandidateSurfaces ;
+
+    /// the material constants of the surface - kept up to date when surfaces are added
+    virtual const surfaceMaterial* getSurfaceMaterial( const ISurface* surf ) const {
+      return _materialCache.find( surf ) ;
+    }
+
+    /// the flattened surfaces - kept up to date when surfaces are added, with the inner radius of the disks
+    virtual const SurfaceRecords* getSurfaceRecords() const { return &_surfaceRecords ; }
+
+    /// the surface ids - kept up to date when surfaces are added
+    virtual const SurfaceIdMap* getSurfaceIdMap() const { return &_surfaceIdMap ; }
+
+    /// tabulate the energy loss of all materials for the mass hypotheses [GeV] - see MaterialCache::tabulate()
+    void tabulateEnergyLoss( const std::vector<double>& masses,
+			     unsigned binsPerDecade = BetheBlochTable::defaultBinsPerDecade ){
+      _materialCache.tabulate( masses, binsPerDecade ) ;
+    }
+
+    /// add the surface - takes ownership
+    const ISurface* addSurface( const ISurface* surface ) ;
+
+    /// add a z-cylinder of the given thickness for every radius - returns the id of the first one
+    long64 addBarrel( const std::vector<double>& radii, double halfLength, double thickness,
+		      const IMaterial& material=SimpleMaterial::silicon() ) ;
+
+    /// add a disk of the given thickness at every z position - returns the id of the first one
+    long64 addDisks( const std::vector<double>& zPositions, double rInner, double rOuter, double thickness,
+		     const IMaterial& material=SimpleMaterial::silicon() ) ;
+
+    /** Add a TPC between rInner and rOuter with nPadRows pad rows: every pad row is a cylinder
+     *  in its middle, carrying the gas of the pad row as material - returns the id of the first one.
+     */
+    long64 addTPC( unsigned nPadRows, double rInner, double rOuter, double halfLength,
+		   const IMaterial& gas=SimpleMaterial::tpcGas() ) ;
+
+    /// the id for the next surface added with the builder methods
+    long64 nextID() const { return _nextID ; }
+
+    /** Make the geometry the global instance ( IGeometry::instance() ) - used e.g. by the
+     *  helix and material utilities. The geometry is not deleted.
+     */
+    static const IGeometry& installGlobal( SimpleGeometry* geometry ) ;
+
+  private:
+    SimpleGeometry( const SimpleGeometry& ) ;
+    SimpleGeometry& operator=( const SimpleGeometry& ) ;
+
+    /// sort the surfaces and rebuild the index, the material cache, the records and the id map after adding surfaces
+    void _update() ;
+
+    std::vector<const ISurface*> _surfaces ;
+
+    SurfaceIndex* _surfaceIndex ;
+
+    MaterialCache _materialCache ;
+
+    SurfaceRecords _surfaceRecords ;
+
+    SurfaceIdMap _surfaceIdMap ;
+
+    long64 _nextID ;
+  } ;
+
+}
+
+#endif // SIMPLEGEOMETRY_HH
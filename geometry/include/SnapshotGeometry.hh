@@ -0,0 +1,208 @@
+#ifndef SNAPSHOTGEOMETRY_HH
+#define SNAPSHOTGEOMETRY_HH
+
+#include "IGeometry.hh"
+#include "SurfaceIndex.hh"
+#include "FieldMapGrid.hh"
+#include "materialCache.hh"
+#include "surfaceRecords.hh"
+#include "surfaceIdMap.hh"
+#include "betheBlochTable.hh"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace aidaTT
+{
+
+  /** The binary snapshot file of a tracking geometry, written with SnapshotGeometry::write().
+   *  The file is read by memory mapping it, i.e. all blocks are plain data in the byte order
+   *  of the writing machine, aligned to 64 bytes:
+   *  header | materials | surfaces | field map nodes (optional, see FieldMapGrid::data()).
+   */
+  struct snapshotHeader{
+    char magic[8] ;                ///< "aidaTTSG"
+    std::uint32_t version ;        ///< the format version - see currentVersion
+    std::uint32_t byteOrder ;      ///< 0x01020304 in the byte order of the writer
+    std::uint32_t headerSize ;     ///< sizeof( snapshotHeader )
+    std::uint32_t materialSize ;   ///< sizeof( snapshotMaterial )
+    std::uint32_t surfaceSize ;    ///< sizeof( snapshotSurface )
+    std::uint32_t nMaterials ;
+    std::uint32_t nSurfaces ;
+    std::uint32_t constantBField ; ///< 1 if the field is constant and parallel to z
+    double constantBz ;            ///< the z component of the constant field [T]
+    std::uint32_t fieldType ;      ///< 0: no field map, 1: FieldMapGrid::XYZ, 2: FieldMapGrid::RZ
+    std::uint32_t fieldNodes[3] ;  ///< see FieldMapGrid::nodes()
+    double fieldMin[3] ;           ///< see FieldMapGrid::lowerEdge()
+    double fieldStep[3] ;          ///< see FieldMapGrid::step()
+    std::uint64_t materialOffset ;
+    std::uint64_t surfaceOffset ;
+    std::uint64_t fieldOffset ;
+    std::uint64_t fileSize ;
+    char reserved[48] ;
+
+    /// version 2: the center of the disks
+    static const std::uint32_t currentVersion = 2 ;
+  } ;
+
+
+  /// a homogeneous material in the snapshot file - see IMaterial
+  struct snapshotMaterial{
+    char name[64] ;                ///< zero terminated, truncated
+    double Z ;
+    double A ;
+    double density ;
+    double radiationLength ;
+    double interactionLength ;
+    char reserved[24] ;
+  } ;
+
+
+  /** A flattened surface in the snapshot file, see surfaceRecord: cylinders and cones are
+   *  rotationally symmetric around an axis parallel to z, all other surfaces are planes.
+   */
+  struct snapshotSurface{
+    std::int64_t id ;
+    std::uint32_t typeBits ;       ///< the properties of the SurfaceType - bit i is property i
+    std::int32_t kind ;            ///< the surfaceRecord::Type
+    std::uint32_t innerMaterial ;  ///< index of the inner material
+    std::uint32_t outerMaterial ;  ///< index of the outer material
+    double innerThickness ;
+    double outerThickness ;
+    double origin[3] ;
+    double normal[3] ;             ///< at the origin
+    double u[3] ;                  ///< at the origin
+    double v[3] ;                  ///< at the origin
+    double lengthU ;
+    double lengthV ;
+    double radius ;                ///< cylinders and cones: ICylinder::radius()
+    double center[3] ;             ///< cylinders and cones: ICylinder::center(), disks: the center of the annulus
+    double slope ;                 ///< cones: dr/dz
+    double zMin, zMax ;            ///< cylinders and cones: the z range
+    double rMin, rMax ;            ///< disks: the radial range around the center
+    double radius0, radius1 ;      ///< cones: ICone::radius0(), radius1()
+    double z0, z1 ;                ///< cones: ICone::z0(), z1()
+  } ;
+
+
+  class SnapshotMaterial ;
+  class SnapshotSurface ;
+
+
+  /** A read-only geometry memory mapped from a binary snapshot file, for a fast start of many
+   *  short jobs: loading the snapshot takes milliseconds instead of the seconds needed for the
+   *  compact file and the DD4hep surfaces, and all processes on a node share the same pages.
+   *
+   *  The snapshot holds the flattened surfaces ( see surfaceRecord ), their materials and the
+   *  field: either the constant field along z or a sampled FieldMapGrid. The surfaces of the
+   *  snapshot describe cylinders and cones around an axis parallel to z and planes with the
+   *  bounds of the records, i.e. rectangles for planes and annuli for disks. Planes with other
+   *  bounds ( e.g. trapezoids, records of type surfaceRecord::Other ) are written with the
+   *  rectangle length_along_u() x length_along_v() and all other surfaces as the tangential
+   *  plane at their origin - write() prints a warning for these. Without the records of the
+   *  geometry the disks have no inner radius.
+   *
+   *  @code
+   *   // once, e.g. with the geometry_snapshot example
+   *   FieldMapGrid* grid = new FieldMapGrid( 200., -300., 300., 101, 301 ) ;
+   *   grid->sample( geom ) ;
+   *   SnapshotGeometry::write( geom, "ILD.aidaTT", grid ) ;
+   *
+   *   // in every job - IGeometry::instance( "ILD.aidaTT" ) also loads snapshots
+   *   SnapshotGeometry::installGlobal( "ILD.aidaTT" ) ;
+   *  @endcode
+   */
+  class SnapshotGeometry : public IGeometry
+  {
+  public:
+
+    /// map the snapshot file - throws std::runtime_error if it cannot be read or has the wrong version
+    explicit SnapshotGeometry( const std::string& fileName ) ;
+
+    virtual ~SnapshotGeometry() ;
+
+    /** Write the surfaces and the field of the geometry to the snapshot file. The field map is
+     *  needed if the field of the geometry is not constant along z, it is written as it is and
+     *  used instead of the constant field if given.
+     *  Throws std::invalid_argument or std::runtime_error.
+     */
+    static void write( const IGeometry& geom, const std::string& fileName, const FieldMapGrid* field=NULL ) ;
+
+    /// true if the file starts like a snapshot file
+    static bool isSnapshot( const std::string& fileName ) ;
+
+    /** Replace the global geometry instance ( IGeometry::instance() ) with the snapshot
+     *  geometry read from the file - the previous instance is not deleted.
+     */
+    static const IGeometry& installGlobal( const std::string& fileName ) ;
+
+    /// get a list of all surfaces in the geometry - in the order of the written geometry
+    virtual const std::vector<const ISurface*>& getSurfaces() const { return _surfaceList ; }
+
+    /// the B field in Tesla - constant or interpolated in the field map
+    virtual Vector3D getBField( const Vector3D& xx ) const ;
+
+    /// the surfaces that might be intersected by the helix - uses a SurfaceIndex
+    virtual void getCandidateSurfaces( const Vector5& hp, const Vector3D& rp,
+				       std::vector<const ISurface*>& surfaces,
+				       std::vector<unsigned>& indices ) const ;
+
+    using IGeometry::getCandidateSurfaces ;
+
+    /// the material constants of the surface - computed for all surfaces when the snapshot is mapped
+    virtual const surfaceMaterial* getSurfaceMaterial( const ISurface* surf ) const {
+      return _materialCache.find( surf ) ;
+    }
+
+    /// the flattened surfaces - with the annulus of the disks
+    virtual const SurfaceRecords* getSurfaceRecords() const { return &_surfaceRecords ; }
+
+    /// the surface ids - built when the snapshot is mapped
+    virtual const SurfaceIdMap* getSurfaceIdMap() const { return &_surfaceIdMap ; }
+
+    /// tabulate the energy loss of all materials for the mass hypotheses [GeV] - see MaterialCache::tabulate()
+    void tabulateEnergyLoss( const std::vector<double>& masses,
+			     unsigned binsPerDecade = BetheBlochTable::defaultBinsPerDecade ){
+      _materialCache.tabulate( masses, binsPerDecade ) ;
+    }
+
+    /// the field map - NULL for a constant field
+    const FieldMapGrid* fieldMap() const { return _field ; }
+
+    /// the header of the mapped file
+    const snapshotHeader& header() const { return *_header ; }
+
+  private:
+    SnapshotGeometry( const SnapshotGeometry& ) ;
+    SnapshotGeometry& operator=( const SnapshotGeometry& ) ;
+
+    /// check the mapped file and create the surfaces, the materials and the field map
+    void _load( const std::string& fileName ) ;
+
+    /// delete everything and unmap the file
+    void _release() ;
+
+    void* _mapping ;
+    std::size_t _mappingSize ;
+
+    const snapshotHeader* _header ;
+
+    std::vector<SnapshotMaterial*> _materials ;
+    std::vector<SnapshotSurface*> _surfaces ;
+    std::vector<const ISurface*> _surfaceList ;
+
+    SurfaceIndex* _surfaceIndex ;
+
+    MaterialCache _materialCache ;
+
+    SurfaceRecords _surfaceRecords ;
+
+    SurfaceIdMap _surfaceIdMap ;
+
+    FieldMapGrid* _field ;
+  } ;
+
+}
+
+#endif // SNAPSHOTGEOMETRY_HH
@@ -0,0 +1,101 @@
+#ifndef SURFACEINDEX_HH
+#define SURFACEINDEX_HH
+
+#include "IGeometry.hh"
+#include "Vector5.hh"
+
+#include <vector>
+
+namespace aidaTT
+{
+  /** Spatial index of the tracking surfaces for a fast look up of the surfaces
+   *  that can be crossed by a helix:
+   *   - z-cylinders are sorted in radius
+   *   - z-disks are sorted in z
+   *   - planes are grouped in radial layers, each with a grid of phi sectors
+   *   - all other surfaces (e.g. cones) are always returned as candidates
+   *
+   *  The look up is conservative, i.e. it can return surfaces that are not intersected
+   *  by the helix, but it never misses a surface that is intersected within the
+   *  first half arc ( 0 <= s < pi*R ) as used in trajectory::getIntersectionsWithSurfaces().
+   */
+  class SurfaceIndex
+  {
+  public:
+
+    /// build the index for the given surfaces - the order of the surfaces is kept in the look up
+    SurfaceIndex( const std::vector<const ISurface*>& surfaces, unsigned nPhiSectors=64 ) ;
+
+    /** Fill the surfaces that can be intersected by the helix (hp,rp) in the first half arc
+     *  into candidates - in the order of the surfaces given at construction. The indices
+     *  are a buffer of the caller, i.e. no memory is allocated once the buffers have grown;
+     *  on return they hold the positions of the added candidates in the surfaces given at construction.
+     */
+    void getCandidates( const Vector5& hp, const Vector3D& rp,
+			std::vector<const ISurface*>& candidates,
+			std::vector<unsigned>& indices ) const ;
+
+    /// the number of indexed surfaces
+    unsigned size() const { return _surfaces.size() ; }
+
+  private:
+
+    /// bounding volume of a surface in cylindrical coordinates
+    struct surfaceBounds{
+      unsigned index ;
+      double key ;
+      double rhoMin ;
+      double rhoMax ;
+      double zMin ;
+      double zMax ;
+      double phiMin ;
+      double phiMax ;
+      bool fullPhi ;
+    } ;
+
+    /// planes in a radial layer sorted into phi sectors (indices into _planes)
+    struct planeLayer{
+      planeLayer( double rMin, double rMax, unsigned nSectors ) :
+	rhoMin( rMin ), rhoMax( rMax ), sectors( nSectors ) {}
+
+      double rhoMin ;
+      double rhoMax ;
+      std::vector< std::vector<unsigned> > sectors ;
+    } ;
+
+    /// compute the bounds of the surface
+    static surfaceBounds computeBounds( const ISurface* surf, unsigned index ) ;
+
+    /// the phi sector for the given angle
+    unsigned sector( double phi ) const ;
+
+    /// add the planes of the sectors [first,first+n) (modulo the number of sectors) that overlap with the given ranges
+    void collectPlanes( const planeLayer& layer, unsigned first, unsigned n,
+			double rhoMin, double rhoMax, double zMin, double zMax,
+			std::vector<unsigned>& indices ) const ;
+
+    /// add the surfaces with key in [lo,hi] that overlap with the given ranges
+    static void collect( const std::vector<surfaceBounds>& bounds, double maxHalfWidth, double lo, double hi,
+			 double rhoMin, double rhoMax, double zMin, double zMax,
+			 std::vector<unsigned>& indices ) ;
+
+    std::vector<const ISurface*> _surfaces ;
+
+    std::vector<surfaceBounds> _cylinders ;
+    double _cylinderHalfWidth ;
+
+    std::vector<surfaceBounds> _disks ;
+    double _diskHalfWidth ;
+
+    std::vector<surfaceBounds> _planes ;
+    std::vector<planeLayer> _layers ;
+
+    std::vector<unsigned> _others ;
+
+    unsigned _nPhiSectors ;
+    double _sectorWidth ;
+  } ;
+
+}
+
+#endif // SURFACEINDEX_HH
@@ -1,10 +1,22 @@
 #ifdef AIDATT_USE_DD4HEP
 
 #include "DD4hepGeometry.hh"
+#include "SnapshotGeometry.hh"
 
 // DD4hep
 #include "DDRec/SurfaceHelper.h"
+#include "DDRec/Surface.h"
 #include "DD4hep/DD4hepUnits.h"
+#include "DD4hep/Fields.h"
+#include "DD4hep/FieldTypes.h"
+
+#include "TGeoTube.h"
+#include "TGeoBBox.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "streamlog/streamlog.h"
 
 namespace aidaTT
 {
@@ -41,13 +53,17 @@ namespace aidaTT
   }
 
 
-  bool sortSurfaces( const ISurface* surf0 ,  const ISurface* surf1  ){
+  /// the surfaces with their sorting parameter - computed once per surface, not per comparison
+  typedef std::pair< float, const ISurface* > SortingKey ;
+
+  bool sortSurfaces( const SortingKey& surf0 ,  const SortingKey& surf1  ){
     
-    return  getSortingPolicy(surf0) < getSortingPolicy(surf1)  ;
+    return  surf0.first < surf1.first  ;
   }
   
 
-  DD4hepGeometry::DD4hepGeometry(const dd4hep::Detector& thedetector ) : _thedetector( thedetector )  {
+  DD4hepGeometry::DD4hepGeometry(const dd4hep::Detector& thedetector ) :
+    IGeometry(), _thedetector( thedetector ), _surfaceList(), _surfaceIndex(NULL), _materialCache(), _surfaceRecords(), _surfaceIdMap()  {
     
     const dd4hep::DetElement& det = thedetector.world() ;
     
@@ -56,20 +72,184 @@ namespace aidaTT
     
     const dd4hep::rec::SurfaceList& sL = surfMan.surfaceList() ;
     
-    _surfaceList.reserve( sL.size() ) ;
+    std::vector< SortingKey > keys ;
+    keys.reserve( sL.size() ) ;
     
     for(dd4hep::rec::SurfaceList::const_iterator it = sL.begin() ; it != sL.end() ; ++it){
-      _surfaceList.push_back( *it );
+      keys.push_back( SortingKey( getSortingPolicy( *it ) , *it ) );
     }
     
-    std::sort( _surfaceList.begin() , _surfaceList.end() , sortSurfaces ) ; 
+    std::sort( keys.begin() , keys.end() , sortSurfaces ) ; 
+
+    _surfaceList.reserve( keys.size() ) ;
+
+    for(unsigned i=0, n=keys.size() ; i<n ; ++i){
+      _surfaceList.push_back( keys[i].second );
+    }
+
+    _surfaceIndex = new SurfaceIndex( _surfaceList ) ;
+
+    _materialCache.build( _surfaceList ) ;
+
+    _surfaceRecords.build( _surfaceList , &_materialCache ) ;
+
+    _setSolidBounds() ;
+
+    _surfaceIdMap.build( _surfaceList ) ;
+
+    _checkConstantBField() ;
   }
-  
+
+
+  void DD4hepGeometry::_setSolidBounds() {
+
+    unsigned nOther = 0 ;
+
+    for(unsigned i=0, n=_surfaceList.size() ; i<n ; ++i){
+
+      surfaceRecord& r = _surfaceRecords[i] ;
+
+      if( r.type != surfaceRecord::ZDisk && r.type != surfaceRecord::ZPlane && r.type != surfaceRecord::Plane )
+	continue ;
+
+      const dd4hep::rec::Surface* surf = dynamic_cast<const dd4hep::rec::Surface*>( _surfaceList[i] ) ;
+
+      const TGeoShape* shape = ( surf != NULL && surf->volume().isValid() ? surf->volume()->GetShape() : NULL ) ;
+
+      if( shape != NULL && r.type == surfaceRecord::ZDisk && shape->IsA() == TGeoTube::Class() ){
+
+	// the annulus of the tube around its axis, i.e. the origin of the volume
+	const TGeoTube* tube = static_cast<const TGeoTube*>( shape ) ;
+
+	const dd4hep::rec::VolSurface& volSurf = surf->volSurface() ;
+	const dd4hep::rec::Vector3D& o = volSurf.origin() ;
+
+	const Vector3D center = surf->localToGlobal( Vector2D( -( o * volSurf.u() ), -( o * volSurf.v() ) ) ) ;
+
+	r.xCenter = center.x() ;
+	r.yCenter = center.y() ;
+	r.rMin    = tube->GetRmin() ;
+	r.rMax    = tube->GetRmax() ;
+
+      } else if( shape == NULL || r.type == surfaceRecord::ZDisk || shape->IsA() != TGeoBBox::Class() ){
+
+	// e.g. trapezoids or tube segments - the record cannot describe the bounds
+	r.type = surfaceRecord::Other ;
+
+	++nOther ;
+      }
+    }
+
+    if( nOther > 0 ){
+      streamlog_out( DEBUG5 ) << " DD4hepGeometry: " << nOther << " planar surfaces without box or tube solid"
+			      << " are intersected with the ISurface " << std::endl ;
+    }
+  }
+
+
+  void DD4hepGeometry::_checkConstantBField() {
+
+    // the field is constant, if all its magnetic components are described as constant fields
+    const dd4hep::OverlayedField::Object* field = _thedetector.field().data<dd4hep::OverlayedField::Object>() ;
+
+    if( field == NULL )
+      return ;
+
+    for(unsigned i=0, n=field->magnetic_components.size() ; i<n ; ++i){
+
+      const dd4hep::CartesianField& component = field->magnetic_components[i] ;
+
+      if( ! component.isValid() || dynamic_cast<const dd4hep::ConstantField*>( component.ptr() ) == NULL ){
+
+	streamlog_out( DEBUG5 ) << " DD4hepGeometry: the magnetic field " << ( component.isValid() ? component.name() : "" )
+				<< " is not a ConstantField - the field is looked up at every point" << std::endl ;
+	return ;
+      }
+    }
+
+    const Vector3D b0 = getBField( Vector3D() ) ;
+
+    const double eps = 1.e-6 * std::max( std::fabs( b0.z() ) , 1. ) ;
+
+    if( std::fabs( b0.x() ) > eps || std::fabs( b0.y() ) > eps ){
+
+      streamlog_out( DEBUG5 ) << " DD4hepGeometry: the constant B field is not parallel to z"
+			      << " - the field is looked up at every point" << std::endl ;
+      return ;
+    }
+
+    // consistency check: sample the field in the volume spanned by the surface origins
+    double rMax = 0. , zMax = 0. ;
+
+    for(unsigned i=0, n=_surfaceList.size() ; i<n ; ++i){
+
+      const Vector3D& o = _surfaceList[i]->origin() ;
+
+      rMax = std::max( rMax , o.rho() ) ;
+      zMax = std::max( zMax , std::fabs( o.z() ) ) ;
+    }
+
+    for(unsigned ir=0 ; ir<=4 ; ++ir){
+      for(unsigned iz=0 ; iz<=4 ; ++iz){
+	for(unsigned iphi=0 ; iphi<4 ; ++iphi){
+
+	  const double r   = rMax * ir / 4. ;
+	  const double z   = zMax * ( iz / 2. - 1. ) ;
+	  const double phi = ( iphi + 0.5 ) * M_PI / 2. ;
+
+	  const Vector3D xx( r * std::cos( phi ) , r * std::sin( phi ) , z ) ;
+	  const Vector3D b = getBField( xx ) ;
+
+	  if( ( b - b0 ).r() > eps ){
+
+	    streamlog_out( WARNING ) << " DD4hepGeometry: the B field is described as constant, but differs by "
+				     << ( b - b0 ).r() << " Tesla from the origin at ( " << xx.x() << " , "
+				     << xx.y() << " , " << xx.z() << " ) - the field is looked up at every point" << std::endl ;
+	    return ;
+	  }
+	}
+      }
+    }
+
+    streamlog_out( DEBUG5 ) << " DD4hepGeometry: constant B field  bz = " << b0.z() << " Tesla" << std::endl ;
+
+    setConstantBField( b0.z() ) ;
+  }
+
+
+  DD4hepGeometry::~DD4hepGeometry(){
+    delete _surfaceIndex ;
+  }
+
+
   const std::vector<const ISurface*>& DD4hepGeometry::getSurfaces() const {
     return _surfaceList ;
   }
   
 
+  void DD4hepGeometry::getCandidateSurfaces( const Vector5& hp, const Vector3D& rp,
+					     std::vector<const ISurface*>& surfaces,
+					     std::vector<unsigned>& indices ) const {
+
+    _surfaceIndex->getCandidates( hp, rp, surfaces, indices ) ;
+  }
+
+
+  const surfaceMaterial* DD4hepGeometry::getSurfaceMaterial( const ISurface* surf ) const {
+
+    return _materialCache.find( surf ) ;
+  }
+
+
+  void DD4hepGeometry::tabulateEnergyLoss( const std::vector<double>& masses, unsigned binsPerDecade ){
+
+    _materialCache.tabulate( masses, binsPerDecade ) ;
+
+    streamlog_out( MESSAGE ) << " DD4hepGeometry: tabulated the energy loss of " << _materialCache.nTables()
+			     << " materials for " << masses.size() << " mass hypotheses " << std::endl ;
+  }
+
+
   Vector3D DD4hepGeometry::getBField( const Vector3D& xx) const {
 
     Vector3D bfield ;
@@ -86,11 +266,20 @@ namespace aidaTT
   
   IGeometry* IGeometry::_geom = 0 ;
   
-  /// return an instance of DD4hepGeometry ( initialize with initString as file name in first call)
+  /** return an instance of DD4hepGeometry ( initialize with initString as file name in first call)
+   *  - or of SnapshotGeometry if the file is a geometry snapshot
+   */
   const IGeometry& IGeometry::instance(const std::string& initString ) {
     
     static bool first = true ;
     
+    if( first && SnapshotGeometry::isSnapshot( initString ) ){
+
+      IGeometry::_geom = new SnapshotGeometry( initString ) ;
+
+      first = false;
+    }
+
     if( first ){
       
       dd4hep::Detector& thedetector = dd4hep::Detector::getInstance();
@@ -0,0 +1,78 @@
+#include "FieldMapGeometry.hh"
+
+#include <stdexcept>
+
+namespace aidaTT
+{
+
+  FieldMapGeometry::FieldMapGeometry( const IGeometry& geom, FieldMapGrid* grid ) :
+    IGeometry(), _geometry( geom ), _grid( grid ) {
+
+    if( _grid == NULL )
+      throw std::invalid_argument( "FieldMapGeometry: no field map grid given" ) ;
+
+    _grid->sample( _geometry ) ;
+
+    if( _geometry.hasConstantBField() )
+      setConstantBField( _geometry.constantBz() ) ;
+  }
+
+
+  FieldMapGeometry::~FieldMapGeometry(){
+    delete _grid ;
+  }
+
+
+  const IGeometry& FieldMapGeometry::installGlobal( FieldMapGrid* grid ){
+
+    // the previous instance is decorated and thus kept alive
+    _geom = new FieldMapGeometry( IGeometry::instance() , grid ) ;
+
+    return *_geom ;
+  }
+
+
+  const std::vector<const ISurface*>& FieldMapGeometry::getSurfaces() const {
+    return _geometry.getSurfaces() ;
+  }
+
+
+  void FieldMapGeometry::getCandidateSurfaces( const Vector5& hp, const Vector3D& rp,
+					       std::vector<const ISurface*>& surfaces,
+					       std::vector<unsigned>& indices ) const {
+    _geometry.getCandidateSurfaces( hp, rp, surfaces, indices ) ;
+  }
+
+
+  const surfaceMaterial* FieldMapGeometry::getSurfaceMaterial( const ISurface* surf ) const {
+    return _geometry.getSurfaceMaterial( surf ) ;
+  }
+
+
+  const SurfaceRecords* FieldMapGeometry::getSurfaceRecords() const {
+    return _geometry.getSurfaceRecords() ;
+  }
+
+
+  const SurfaceIdMap* FieldMapGeometry::getSurfaceIdMap() const {
+    return _geometry.getSurfaceIdMap() ;
+  }
+
+
+  Vector3D FieldMapGeometry::getBField( const Vector3D& xx ) const {
+
+    if( _grid->contains( xx ) )
+      return _grid->fieldAt( xx ) ;
+
+    return _geometry.getBField( xx ) ;
+  }
+
+
+  void FieldMapGeometry::getBField( const std::vector<Vector3D>& points, std::vector<Vector3D>& bfields ) const {
+
+    bfields.resize( points.size() ) ;
+
+    for( unsigned i=0, n = points.size() ; i<n ; ++i )
+      bfields[i] = getBField( points[i] ) ;
+  }
+}
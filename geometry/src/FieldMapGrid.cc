@@ -0,0 +1,248 @@
+#include "FieldMapGrid.hh"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+namespace aidaTT
+{
+
+  FieldMapGrid::FieldMapGrid( const Vector3D& min, const Vector3D& max, unsigned nx, unsigned ny, unsigned nz ) :
+    _type( XYZ ), _data( NULL ), _ownsData( true ) {
+
+    if( nx < 2 || ny < 2 || nz < 2 )
+      throw std::invalid_argument( "FieldMapGrid: need at least two nodes per coordinate" ) ;
+
+    if( !( min.x() < max.x() && min.y() < max.y() && min.z() < max.z() ) )
+      throw std::invalid_argument( "FieldMapGrid: empty grid range" ) ;
+
+    _n[0] = nx ;  _min[0] = min.x() ;  _step[0] = ( max.x() - min.x() ) / ( nx - 1 ) ;
+    _n[1] = ny ;  _min[1] = min.y() ;  _step[1] = ( max.y() - min.y() ) / ( ny - 1 ) ;
+    _n[2] = nz ;  _min[2] = min.z() ;  _step[2] = ( max.z() - min.z() ) / ( nz - 1 ) ;
+
+    _allocate() ;
+  }
+
+
+  FieldMapGrid::FieldMapGrid( double rMax, double zMin, double zMax, unsigned nr, unsigned nz ) :
+    _type( RZ ), _data( NULL ), _ownsData( true ) {
+
+    if( nr < 2 || nz < 2 )
+      throw std::invalid_argument( "FieldMapGrid: need at least two nodes per coordinate" ) ;
+
+    if( !( rMax > 0. && zMin < zMax ) )
+      throw std::invalid_argument( "FieldMapGrid: empty grid range" ) ;
+
+    _n[0] = nr ;  _min[0] = 0.   ;  _step[0] = rMax / ( nr - 1 ) ;
+    _n[1] = 1  ;  _min[1] = 0.   ;  _step[1] = 1. ;
+    _n[2] = nz ;  _min[2] = zMin ;  _step[2] = ( zMax - zMin ) / ( nz - 1 ) ;
+
+    _allocate() ;
+  }
+
+
+  FieldMapGrid::FieldMapGrid( GridType type, const unsigned* n, const double* min, const double* step, const float* data ) :
+    _type( type ), _data( NULL ), _ownsData( false ) {
+
+    if( n[0] < 2 || n[2] < 2 || ( type == XYZ ? n[1] < 2 : n[1] != 1 ) )
+      throw std::invalid_argument( "FieldMapGrid: need at least two nodes per coordinate" ) ;
+
+    if( !( step[0] > 0. && step[1] > 0. && step[2] > 0. ) )
+      throw std::invalid_argument( "FieldMapGrid: empty grid range" ) ;
+
+    if( data == NULL || reinterpret_cast<std::uintptr_t>( data ) % 64 != 0 )
+      throw std::invalid_argument( "FieldMapGrid: the node data has to be aligned to 64 bytes" ) ;
+
+    for( unsigned k=0 ; k<3 ; ++k ){
+      _n[k] = n[k] ;
+      _min[k] = min[k] ;
+      _step[k] = step[k] ;
+      _invStep[k] = 1. / step[k] ;
+    }
+
+    // never written, see setNode()
+    _data = const_cast<float*>( data ) ;
+  }
+
+
+  FieldMapGrid::~FieldMapGrid(){
+    if( _ownsData )
+      free( _data ) ;
+  }
+
+
+  void FieldMapGrid::_allocate(){
+
+    for( unsigned k=0 ; k<3 ; ++k )
+      _invStep[k] = 1. / _step[k] ;
+
+    void* mem = NULL ;
+
+    if( posix_memalign( &mem, 64, nNodes() * 4 * sizeof(float) ) != 0 )
+      throw std::bad_alloc() ;
+
+    _data = static_cast<float*>( mem ) ;
+
+    for( unsigned i=0, n = 4 * nNodes() ; i<n ; ++i )
+      _data[i] = 0.f ;
+  }
+
+
+  Vector3D FieldMapGrid::nodePosition( unsigned i ) const {
+
+    const unsigned ix = i % _n[0] ;
+    const unsigned iy = ( i / _n[0] ) % _n[1] ;
+    const unsigned iz = i / ( _n[0] * _n[1] ) ;
+
+    return Vector3D( _min[0] + ix * _step[0] ,
+		     ( _type == XYZ ? _min[1] + iy * _step[1] : 0. ) ,
+		     _min[2] + iz * _step[2] ) ;
+  }
+
+
+  void FieldMapGrid::setNode( unsigned i, const Vector3D& bfield ){
+
+    if( i >= nNodes() )
+      throw std::out_of_range( "FieldMapGrid::setNode: invalid node index" ) ;
+
+    if( !_ownsData )
+      throw std::logic_error( "FieldMapGrid::setNode: the grid is on external data" ) ;
+
+    // for the (r,z) grid the node is at phi=0, i.e. bx=br and by=bphi
+    float* node = _data + 4 * i ;
+    node[0] = bfield.x() ;
+    node[1] = bfield.y() ;
+    node[2] = bfield.z() ;
+    node[3] = 0.f ;
+  }
+
+
+  void FieldMapGrid::sample( const IGeometry& geom ){
+
+    for( unsigned i=0, n = nNodes() ; i<n ; ++i )
+      setNode( i, geom.getBField( nodePosition( i ) ) ) ;
+  }
+
+
+  bool FieldMapGrid::contains( const Vector3D& xx ) const {
+
+    double c[3] = { xx.x() , xx.y() , xx.z() } ;
+
+    if( _type == RZ ){
+      c[0] = std::sqrt( xx.x() * xx.x() + xx.y() * xx.y() ) ;
+      c[1] = 0. ;
+    }
+
+    for( unsigned k=0 ; k<3 ; ++k ){
+
+      if( c[k] < _min[k] || c[k] > _min[k] + ( _n[k] - 1 ) * _step[k] )
+	return false ;
+    }
+
+    return true ;
+  }
+
+
+  inline void FieldMapGrid::_locate( unsigned k, double c, unsigned& i, double& t ) const {
+
+    double f = ( c - _min[k] ) * _invStep[k] ;
+
+    const unsigned last = _n[k] - 1 ;
+
+    if( f <= 0. ){
+      i = 0 ;
+      t = 0. ;
+    } else if( f >= last ){
+      i = last - 1 ;
+      t = 1. ;
+    } else {
+      i = unsigned( f ) ;
+      t = f - i ;
+    }
+  }
+
+
+  void FieldMapGrid::_interpolate( double x, double y, double z, double* bfield ) const {
+
+    if( _type == XYZ ){
+
+      unsigned ix, iy, iz ;
+      double tx, ty, tz ;
+
+      _locate( 0, x, ix, tx ) ;
+      _locate( 1, y, iy, ty ) ;
+      _locate( 2, z, iz, tz ) ;
+
+      const unsigned dy = 4 * _n[0] ;
+      const unsigned dz = 4 * _n[0] * _n[1] ;
+
+      const float* n000 = _data + 4 * ix + dy * iy + dz * iz ;
+      const float* n001 = n000 + dz ;
+
+      for( unsigned k=0 ; k<3 ; ++k ){
+
+	const double b00 = n000[k]      + tx * ( n000[k+4]      - n000[k]      ) ;
+	const double b10 = n000[k+dy]   + tx * ( n000[k+dy+4]   - n000[k+dy]   ) ;
+	const double b01 = n001[k]      + tx * ( n001[k+4]      - n001[k]      ) ;
+	const double b11 = n001[k+dy]   + tx * ( n001[k+dy+4]   - n001[k+dy]   ) ;
+
+	const double b0 = b00 + ty * ( b10 - b00 ) ;
+	const double b1 = b01 + ty * ( b11 - b01 ) ;
+
+	bfield[k] = b0 + tz * ( b1 - b0 ) ;
+      }
+
+    } else {
+
+      const double r = std::sqrt( x*x + y*y ) ;
+
+      unsigned ir, iz ;
+      double tr, tz ;
+
+      _locate( 0, r, ir, tr ) ;
+      _locate( 2, z, iz, tz ) ;
+
+      const unsigned dz = 4 * _n[0] ;
+
+      const float* n00 = _data + 4 * ir + dz * iz ;
+      const float* n01 = n00 + dz ;
+
+      double b[3] ;
+
+      for( unsigned k=0 ; k<3 ; ++k ){
+
+	const double b0 = n00[k] + tr * ( n00[k+4] - n00[k] ) ;
+	const double b1 = n01[k] + tr * ( n01[k+4] - n01[k] ) ;
+
+	b[k] = b0 + tz * ( b1 - b0 ) ;
+      }
+
+      // rotate ( br, bphi ) to the point - at r == 0 br and bphi are zero for any physical field
+      const double cosPhi = ( r > 0. ? x / r : 1. ) ;
+      const double sinPhi = ( r > 0. ? y / r : 0. ) ;
+
+      bfield[0] = b[0] * cosPhi - b[1] * sinPhi ;
+      bfield[1] = b[0] * sinPhi + b[1] * cosPhi ;
+      bfield[2] = b[2] ;
+    }
+  }
+
+
+  Vector3D FieldMapGrid::fieldAt( const Vector3D& xx ) const {
+
+    double b[3] ;
+
+    _interpolate( xx.x(), xx.y(), xx.z(), b ) ;
+
+    return Vector3D( b[0], b[1], b[2] ) ;
+  }
+
+
+  void FieldMapGrid::fieldAt( unsigned n, const double* xyz, double* bfield ) const {
+
+    for( unsigned i=0 ; i<n ; ++i )
+      _interpolate( xyz[3*i], xyz[3*i+1], xyz[3*i+2], bfield + 3*i ) ;
+  }
+}
@@ -0,0 +1,447 @@
+#include "SimpleGeometry.hh"
+#include "SnapshotGeometry.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace aidaTT
+{
+
+  namespace {
+
+    /// the sorting parameter ( basically the max. radius ) - as for the DD4hepGeometry
+    double sortingRadius( const ISurface* surf ){
+
+      const ICone* cone = dynamic_cast<const ICone*>( surf ) ;
+
+      if( cone != NULL )
+	return std::max( cone->radius0() , cone->radius1() ) ;
+
+      if( surf->type().isZCylinder() )
+	return dynamic_cast<const ICylinder*>( surf )->radius() ;
+
+      if( surf->type().isZDisk() )
+	return std::max( surf->length_along_u(), surf->length_along_v() ) / 2. ;
+
+      return surf->origin().rho() ;
+    }
+
+
+    bool sortSurfaces( const ISurface* surf0 , const ISurface* surf1 ){
+      return sortingRadius( surf0 ) < sortingRadius( surf1 ) ;
+    }
+  }
+
+
+  //======================================================================================
+
+  SimpleMaterial::SimpleMaterial( const std::string& name, double Z, double A, double density,
+				  double radiationLength, double interactionLength ) :
+    _name( name ), _Z( Z ), _A( A ), _density( density ),
+    _radiationLength( radiationLength ), _interactionLength( interactionLength ) {
+  }
+
+
+  const SimpleMaterial& SimpleMaterial::silicon(){
+    static const SimpleMaterial mat( "Silicon", 14., 28.0855, 2.329, 9.370, 46.52 ) ;
+    return mat ;
+  }
+
+
+  const SimpleMaterial& SimpleMaterial::tpcGas(){
+    static const SimpleMaterial mat( "Argon", 18., 39.948, 1.662e-3, 1.176e4, 7.204e4 ) ;
+    return mat ;
+  }
+
+
+  const SimpleMaterial& SimpleMaterial::air(){
+    static const SimpleMaterial mat( "Air", 7.3, 14.6, 1.205e-3, 3.039e4, 7.135e4 ) ;
+    return mat ;
+  }
+
+
+  //======================================================================================
+
+  SimpleSurface::SimpleSurface( long64 id, const Vector3D& origin, double thickness, const IMaterial& material ) :
+    _type(), _id( id ), _origin( origin ), _thickness( thickness ), _material( material ) {
+
+    _type.setProperty( SurfaceType::Sensitive ) ;
+  }
+
+
+  std::vector< std::pair<Vector3D, Vector3D> > SimpleSurface::getLines( unsigned ){
+    // only needed for drawing
+    return std::vector< std::pair<Vector3D, Vector3D> >() ;
+  }
+
+
+  //======================================================================================
+
+  SimpleCylinder::SimpleCylinder( long64 id, double radius, double halfLength, double thickness,
+				  const IMaterial& material, double zCenter ) :
+    SimpleSurface( id, Vector3D( radius, 0., zCenter ), thickness, material ),
+    _radius( radius ), _halfLength( halfLength ), _zCenter( zCenter ) {
+
+    if( radius <= 0. || halfLength <= 0. )
+      throw std::invalid_argument( "SimpleCylinder: radius and half length have to be positive" ) ;
+
+    _type.setProperty( SurfaceType::Cylinder ) ;
+    _type.setProperty( SurfaceType::ParallelToZ ) ;
+  }
+
+
+  bool SimpleCylinder::insideBounds( const Vector3D& point, double epsilon ) const {
+    return std::fabs( distance( point ) ) < epsilon && std::fabs( point.z() - _zCenter ) <= _halfLength ;
+  }
+
+
+  Vector3D SimpleCylinder::u( const Vector3D& point ) const {
+    const double phi = std::atan2( point.y(), point.x() ) ;
+    return Vector3D( -std::sin( phi ), std::cos( phi ), 0. ) ;
+  }
+
+
+  Vector3D SimpleCylinder::v( const Vector3D& ) const {
+    return Vector3D( 0., 0., 1. ) ;
+  }
+
+
+  Vector3D SimpleCylinder::normal( const Vector3D& point ) const {
+    const double phi = std::atan2( point.y(), point.x() ) ;
+    return Vector3D( std::cos( phi ), std::sin( phi ), 0. ) ;
+  }
+
+
+  Vector2D SimpleCylinder::globalToLocal( const Vector3D& point ) const {
+    return Vector2D( _radius * std::atan2( point.y(), point.x() ), point.z() - _zCenter ) ;
+  }
+
+
+  Vector3D SimpleCylinder::localToGlobal( const Vector2D& point ) const {
+    const double phi = point.u() / _radius ;
+    return Vector3D( _radius * std::cos( phi ), _radius * std::sin( phi ), point.v() + _zCenter ) ;
+  }
+
+
+  double SimpleCylinder::distance( const Vector3D& point ) const {
+    return std::sqrt( point.x() * point.x() + point.y() * point.y() ) - _radius ;
+  }
+
+
+  double SimpleCylinder::length_along_u() const {
+    return 2. * M_PI * _radius ;
+  }
+
+
+  //======================================================================================
+
+  SimplePlane::SimplePlane( long64 id, const Vector3D& origin, const Vector3D& u, const Vector3D& v,
+			    double lengthU, double lengthV, double thickness, const IMaterial& material ) :
+    SimpleSurface( id, origin, thickness, material ),
+    _u( u.unit() ), _v( v.unit() ), _normal( _u.cross( _v ) ), _lengthU( lengthU ), _lengthV( lengthV ) {
+
+    if( std::fabs( _u.dot( _v ) ) > 1.e-9 )
+      throw std::invalid_argument( "SimplePlane: u and v have to be orthogonal" ) ;
+
+    _type.setProperty( SurfaceType::Plane ) ;
+
+    if( std::fabs( _normal.z() ) < 1.e-9 )
+      _type.setProperty( SurfaceType::ParallelToZ ) ;
+
+    if( std::fabs( std::fabs( _normal.z() ) - 1. ) < 1.e-9 )
+      _type.setProperty( SurfaceType::OrthogonalToZ ) ;
+  }
+
+
+  bool SimplePlane::insideBounds( const Vector3D& point, double epsilon ) const {
+
+    const Vector3D d = point - _origin ;
+
+    return ( std::fabs( d.dot( _normal ) ) < epsilon &&
+	     std::fabs( d.dot( _u ) ) <= _lengthU / 2. &&
+	     std::fabs( d.dot( _v ) ) <= _lengthV / 2. ) ;
+  }
+
+
+  Vector2D SimplePlane::globalToLocal( const Vector3D& point ) const {
+    const Vector3D d = point - _origin ;
+    return Vector2D( d.dot( _u ), d.dot( _v ) ) ;
+  }
+
+
+  Vector3D SimplePlane::localToGlobal( const Vector2D& point ) const {
+    return _origin + point.u() * _u + point.v() * _v ;
+  }
+
+
+  double SimplePlane::distance( const Vector3D& point ) const {
+    return ( point - _origin ).dot( _normal ) ;
+  }
+
+
+  //======================================================================================
+
+  SimpleDisk::SimpleDisk( long64 id, double z, double rInner, double rOuter, double thickness,
+			  const IMaterial& material ) :
+    SimpleSurface( id, Vector3D( 0., 0., z ), thickness, material ), _rInner( rInner ), _rOuter( rOuter ) {
+
+    if( rInner < 0. || rOuter <= rInner )
+      throw std::invalid_argument( "SimpleDisk: invalid radii" ) ;
+
+    _type.setProperty( SurfaceType::Plane ) ;
+    _type.setProperty( SurfaceType::OrthogonalToZ ) ;
+  }
+
+
+  bool SimpleDisk::insideBounds( const Vector3D& point, double epsilon ) const {
+
+    const double rho = std::sqrt( point.x() * point.x() + point.y() * point.y() ) ;
+
+    return std::fabs( distance( point ) ) < epsilon && rho >= _rInner && rho <= _rOuter ;
+  }
+
+
+  Vector2D SimpleDisk::globalToLocal( const Vector3D& point ) const {
+    return Vector2D( point.x(), point.y() ) ;
+  }
+
+
+  Vector3D SimpleDisk::localToGlobal( const Vector2D& point ) const {
+    return Vector3D( point.u(), point.v(), _origin.z() ) ;
+  }
+
+
+  //======================================================================================
+
+  SimpleCone::SimpleCone( long64 id, double z0, double radius0, double z1, double radius1, double thickness,
+			  const IMaterial& material ) :
+    SimpleSurface( id, Vector3D( ( radius0 + radius1 ) / 2., 0., ( z0 + z1 ) / 2. ), thickness, material ),
+    _z0( z0 ), _radius0( radius0 ), _z1( z1 ), _radius1( radius1 ), _cosAlpha( 0. ), _sinAlpha( 0. ) {
+
+    if( z0 == z1 || radius0 <= 0. || radius1 <= 0. )
+      throw std::invalid_argument( "SimpleCone: invalid cone parameters" ) ;
+
+    const double alpha = std::atan2( radius1 - radius0, z1 - z0 ) ;
+
+    _cosAlpha = std::cos( alpha ) ;
+    _sinAlpha = std::sin( alpha ) ;
+
+    _type.setProperty( SurfaceType::Cone ) ;
+    _type.setProperty( SurfaceType::ParallelToZ ) ;
+  }
+
+
+  double SimpleCone::_radiusAt( double z ) const {
+    return _radius0 + ( z - _z0 ) * ( _radius1 - _radius0 ) / ( _z1 - _z0 ) ;
+  }
+
+
+  bool SimpleCone::insideBounds( const Vector3D& point, double epsilon ) const {
+
+    return ( std::fabs( distance( point ) ) < epsilon &&
+	     point.z() >= std::min( _z0, _z1 ) && point.z() <= std::max( _z0, _z1 ) ) ;
+  }
+
+
+  Vector3D SimpleCone::u( const Vector3D& point ) const {
+    const double phi = std::atan2( point.y(), point.x() ) ;
+    return Vector3D( -std::sin( phi ), std::cos( phi ), 0. ) ;
+  }
+
+
+  Vector3D SimpleCone::v( const Vector3D& point ) const {
+    const double phi = std::atan2( point.y(), point.x() ) ;
+    return Vector3D( _sinAlpha * std::cos( phi ), _sinAlpha * std::sin( phi ), _cosAlpha ) ;
+  }
+
+
+  Vector3D SimpleCone::normal( const Vector3D& point ) const {
+    const double phi = std::atan2( point.y(), point.x() ) ;
+    return Vector3D( _cosAlpha * std::cos( phi ), _cosAlpha * std::sin( phi ), -_sinAlpha ) ;
+  }
+
+
+  Vector2D SimpleCone::globalToLocal( const Vector3D& point ) const {
+    return Vector2D( radius() * std::atan2( point.y(), point.x() ), ( point.z() - _origin.z() ) / _cosAlpha ) ;
+  }
+
+
+  Vector3D SimpleCone::localToGlobal( const Vector2D& point ) const {
+
+    const double phi = point.u() / radius() ;
+    const double z = _origin.z() + point.v() * _cosAlpha ;
+    const double r = _radiusAt( z ) ;
+
+    return Vector3D( r * std::cos( phi ), r * std::sin( phi ), z ) ;
+  }
+
+
+  double SimpleCone::distance( const Vector3D& point ) const {
+
+    const double rho = std::sqrt( point.x() * point.x() + point.y() * point.y() ) ;
+
+    return ( rho - _radiusAt( point.z() ) ) * _cosAlpha ;
+  }
+
+
+  double SimpleCone::length_along_u() const {
+    return 2. * M_PI * radius() ;
+  }
+
+
+  double SimpleCone::length_along_v() const {
+    return std::fabs( _z1 - _z0 ) / _cosAlpha ;
+  }
+
+
+  //======================================================================================
+
+  SimpleGeometry::SimpleGeometry( double bz ) :
+    IGeometry(), _surfaces(), _surfaceIndex( NULL ), _materialCache(), _surfaceRecords(), _surfaceIdMap(), _nextID( 1 ) {
+
+    setConstantBField( bz ) ;
+
+    _surfaceIndex = new SurfaceIndex( _surfaces ) ;
+  }
+
+
+  SimpleGeometry::~SimpleGeometry(){
+
+    delete _surfaceIndex ;
+
+    for( unsigned i=0, n = _surfaces.size() ; i<n ; ++i )
+      delete _surfaces[i] ;
+  }
+
+
+  void SimpleGeometry::getCandidateSurfaces( const Vector5& hp, const Vector3D& rp,
+					     std::vector<const ISurface*>& surfaces,
+					     std::vector<unsigned>& indices ) const {
+    _surfaceIndex->getCandidates( hp, rp, surfaces, indices ) ;
+  }
+
+
+  const ISurface* SimpleGeometry::addSurface( const ISurface* surface ){
+
+    if( surface == NULL )
+      throw std::invalid_argument( "SimpleGeometry::addSurface: no surface given" ) ;
+
+    _surfaces.push_back( surface ) ;
+
+    if( surface->id() >= _nextID )
+      _nextID = surface->id() + 1 ;
+
+    _update() ;
+
+    return surface ;
+  }
+
+
+  long64 SimpleGeometry::addBarrel( const std::vector<double>& radii, double halfLength, double thickness,
+				    const IMaterial& material ){
+    const long64 first = _nextID ;
+
+    for( unsigned i=0, n = radii.size() ; i<n ; ++i )
+      _surfaces.push_back( new SimpleCylinder( _nextID++, radii[i], halfLength, thickness, material ) ) ;
+
+    _update() ;
+
+    return first ;
+  }
+
+
+  long64 SimpleGeometry::addDisks( const std::vector<double>& zPositions, double rInner, double rOuter, double thickness,
+				   const IMaterial& material ){
+    const long64 first = _nextID ;
+
+    for( unsigned i=0, n = zPositions.size() ; i<n ; ++i )
+      _surfaces.push_back( new SimpleDisk( _nextID++, zPositions[i], rInner, rOuter, thickness, material ) ) ;
+
+    _update() ;
+
+    return first ;
+  }
+
+
+  long64 SimpleGeometry::addTPC( unsigned nPadRows, double rInner, double rOuter, double halfLength,
+				 const IMaterial& gas ){
+    if( nPadRows == 0 || rOuter <= rInner )
+      throw std::invalid_argument( "SimpleGeometry::addTPC: invalid pad rows" ) ;
+
+    const long64 first = _nextID ;
+
+    const double pitch = ( rOuter - rInner ) / nPadRows ;
+
+    for( unsigned i=0 ; i<nPadRows ; ++i )
+      _surfaces.push_back( new SimpleCylinder( _nextID++, rInner + ( i + 0.5 ) * pitch, halfLength, pitch, gas ) ) ;
+
+    _update() ;
+
+    return first ;
+  }
+
+
+  void SimpleGeometry::_update(){
+
+    std::stable_sort( _surfaces.begin() , _surfaces.end() , sortSurfaces ) ;
+
+    delete _surfaceIndex ;
+    _surfaceIndex = new SurfaceIndex( _surfaces ) ;
+
+    _materialCache.build( _surfaces ) ;
+
+    _surfaceRecords.build( _surfaces, &_materialCache ) ;
+
+    _surfaceIdMap.build( _surfaces ) ;
+
+    // the inner radius is not known from the ISurface
+    for( unsigned i=0, n = _surfaces.size() ; i<n ; ++i ){
+
+      const SimpleDisk* disk = dynamic_cast<const SimpleDisk*>( _surfaces[i] ) ;
+
+      if( disk != NULL && _surfaceRecords[i].type == surfaceRecord::ZDisk )
+	_surfaceRecords[i].rMin = disk->innerRadius() ;
+    }
+  }
+
+
+  const IGeometry& SimpleGeometry::installGlobal( SimpleGeometry* geometry ){
+
+    if( geometry == NULL )
+      throw std::invalid_argument( "SimpleGeometry::installGlobal: no geometry given" ) ;
+
+    _geom = geometry ;
+
+    return *_geom ;
+  }
+
+
+#ifndef AIDATT_USE_DD4HEP
+
+  /// =============== the global instance of the geometry without DD4hep ===============
+
+  IGeometry* IGeometry::_geom = 0 ;
+
+
+  /** without DD4hep the geometry can only be created from a geometry snapshot file - otherwise
+   *  it has to be installed, e.g. SimpleGeometry::installGlobal()
+   */
+  const IGeometry& IGeometry::instance( const std::string& initString ) {
+
+    if( _geom == 0 && SnapshotGeometry::isSnapshot( initString ) )
+      _geom = new SnapshotGeometry( initString ) ;
+
+    return instance() ;
+  }
+
+
+  const IGeometry& IGeometry::instance() {
+    if( _geom == 0 )
+      throw std::runtime_error( "IGeometry::instance: no geometry installed - use e.g. SimpleGeometry::installGlobal()" ) ;
+    return *_geom ;
+  }
+
+#endif
+
+}
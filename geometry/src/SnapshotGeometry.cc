@@ -0,0 +1,693 @@
+#include "SnapshotGeometry.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "streamlog/streamlog.h"
+
+namespace aidaTT
+{
+
+  static_assert( sizeof( snapshotHeader ) % 64 == 0 , "snapshotHeader has to fill whole cache lines" ) ;
+  static_assert( sizeof( snapshotMaterial ) % 64 == 0 , "snapshotMaterial has to fill whole cache lines" ) ;
+  static_assert( sizeof( snapshotSurface ) % 64 == 0 , "snapshotSurface has to fill whole cache lines" ) ;
+
+
+  namespace {
+
+    const char snapshotMagic[8] = { 'a', 'i', 'd', 'a', 'T', 'T', 'S', 'G' } ;
+
+    const std::uint32_t snapshotByteOrder = 0x01020304 ;
+
+    /// the number of properties of the SurfaceType - see SurfaceType::Unbounded
+    const unsigned nTypeBits = 10 ;
+
+    /// the offset rounded up to the next cache line
+    std::uint64_t alignToCacheLine( std::uint64_t offset ){
+      return ( offset + 63 ) / 64 * 64 ;
+    }
+
+
+    /// the properties of the SurfaceType as bits, bit i is property i
+    std::uint32_t typeBits( const SurfaceType& t ){
+
+      const bool props[ nTypeBits ] = {
+	t.isCylinder(), t.isPlane(), t.isSensitive(), t.isHelper(), t.isParallelToZ(),
+	t.isOrthogonalToZ(), !t.isVisible(), t.isMeasurement1D(), t.isCone(), t.isUnbounded()
+      } ;
+
+      std::uint32_t bits = 0 ;
+
+      for( unsigned i=0 ; i<nTypeBits ; ++i )
+	if( props[i] )
+	  bits |= ( 1u << i ) ;
+
+      return bits ;
+    }
+
+
+    void copy( const Vector3D& v, double* d ){
+      d[0] = v.x() ;  d[1] = v.y() ;  d[2] = v.z() ;
+    }
+
+
+    /// the index of the material in the list - added if it is not in the list yet
+    std::uint32_t materialIndex( std::vector<snapshotMaterial>& materials, const IMaterial& mat ){
+
+      snapshotMaterial m ;
+      std::memset( &m, 0, sizeof( m ) ) ;
+
+      std::strncpy( m.name, mat.name().c_str(), sizeof( m.name ) - 1 ) ;
+      m.Z = mat.Z() ;
+      m.A = mat.A() ;
+      m.density = mat.density() ;
+      m.radiationLength = mat.radiationLength() ;
+      m.interactionLength = mat.interactionLength() ;
+
+      for( unsigned i=0, n = materials.size() ; i<n ; ++i )
+	if( std::memcmp( &materials[i], &m, sizeof( m ) ) == 0 )
+	  return i ;
+
+      materials.push_back( m ) ;
+
+      return materials.size() - 1 ;
+    }
+
+
+    void writeBlock( std::ofstream& out, std::uint64_t offset, const void* data, std::uint64_t size ){
+
+      // pad with zeros up to the offset
+      static const char zeros[64] = { 0 } ;
+
+      while( std::uint64_t( out.tellp() ) < offset )
+	out.write( zeros, std::min< std::uint64_t >( 64, offset - out.tellp() ) ) ;
+
+      if( size > 0 )
+	out.write( static_cast<const char*>( data ), size ) ;
+    }
+
+
+    void throwInvalid( const std::string& fileName, const std::string& what ){
+      throw std::runtime_error( "SnapshotGeometry: " + fileName + " : " + what ) ;
+    }
+  }
+
+
+  //======================================================================================
+
+  /// a material of the snapshot - on the mapped data
+  class SnapshotMaterial : public IMaterial
+  {
+  public:
+
+    explicit SnapshotMaterial( const snapshotMaterial& data ) : _data( data ) {}
+
+    virtual std::string name() const { return _data.name ; }
+    virtual double Z() const { return _data.Z ; }
+    virtual double A() const { return _data.A ; }
+    virtual double density() const { return _data.density ; }
+    virtual double radiationLength() const { return _data.radiationLength ; }
+    virtual double interactionLength() const { return _data.interactionLength ; }
+
+  private:
+    const snapshotMaterial& _data ;
+  } ;
+
+
+
+  /** A surface of the snapshot - on the mapped data. Cylinders and cones are rotationally
+   *  symmetric around their axis, i.e. the vectors at a point are the vectors at the origin
+   *  rotated around the axis. All other surfaces are planes.
+   */
+  class SnapshotSurface : public ISurface, public ICylinder, public ICone
+  {
+  public:
+
+    SnapshotSurface( const snapshotSurface& data, const IMaterial& inner, const IMaterial& outer ) ;
+
+    virtual const SurfaceType& type() const { return _type ; }
+    virtual long64 id() const { return _data.id ; }
+    virtual const Vector3D& origin() const { return _origin ; }
+
+    virtual const IMaterial& innerMaterial() const { return _inner ; }
+    virtual const IMaterial& outerMaterial() const { return _outer ; }
+    virtual double innerThickness() const { return _data.innerThickness ; }
+    virtual double outerThickness() const { return _data.outerThickness ; }
+
+    virtual bool insideBounds( const Vector3D& point, double epsilon=1.e-4 ) const ;
+
+    virtual Vector3D u( const Vector3D& point=Vector3D() ) const { return _rotated( _data.u, point ) ; }
+    virtual Vector3D v( const Vector3D& point=Vector3D() ) const { return _rotated( _data.v, point ) ; }
+    virtual Vector3D normal( const Vector3D& point=Vector3D() ) const { return _rotated( _data.normal, point ) ; }
+
+    virtual Vector2D globalToLocal( const Vector3D& point ) const ;
+    virtual Vector3D localToGlobal( const Vector2D& point ) const ;
+
+    virtual double distance( const Vector3D& point ) const ;
+
+    virtual double length_along_u() const { return _data.lengthU ; }
+    virtual double length_along_v() const { return _data.lengthV ; }
+
+    /// no lines for drawing
+    virtual std::vector< std::pair<Vector3D, Vector3D> > getLines( unsigned ){
+      return std::vector< std::pair<Vector3D, Vector3D> >() ;
+    }
+
+    virtual double radius() const { return _data.radius ; }
+    virtual double radius0() const { return _data.radius0 ; }
+    virtual double radius1() const { return _data.radius1 ; }
+    virtual double z0() const { return _data.z0 ; }
+    virtual double z1() const { return _data.z1 ; }
+    virtual Vector3D center() const { return Vector3D( _data.center[0], _data.center[1], _data.center[2] ) ; }
+
+  private:
+    SnapshotSurface( const SnapshotSurface& ) ;
+    SnapshotSurface& operator=( const SnapshotSurface& ) ;
+
+    /// true for cylinders and cones
+    bool _isRotational() const {
+      return _data.kind == surfaceRecord::ZCylinder || _data.kind == surfaceRecord::Cone ;
+    }
+
+    /// the vector at the origin rotated around the axis to the azimuth of the point (for cylinders and cones)
+    Vector3D _rotated( const double* w, const Vector3D& point ) const ;
+
+    const snapshotSurface& _data ;
+    const IMaterial& _inner ;
+    const IMaterial& _outer ;
+
+    SurfaceType _type ;
+    Vector3D _origin ;
+
+    /// cylinders and cones: the radius at the origin, the azimuth of the origin and cos of the opening angle
+    double _rOrigin ;
+    double _phiOrigin ;
+    double _cosAlpha ;
+
+    /// cylinders and cones: +1 if the normal points away from the axis and if u points along phi
+    double _normalSign ;
+    double _uSign ;
+  } ;
+
+
+  SnapshotSurface::SnapshotSurface( const snapshotSurface& data, const IMaterial& inner, const IMaterial& outer ) :
+    _data( data ), _inner( inner ), _outer( outer ), _type(),
+    _origin( data.origin[0], data.origin[1], data.origin[2] ),
+    _rOrigin( 0. ), _phiOrigin( 0. ), _cosAlpha( 1. ), _normalSign( 1. ), _uSign( 1. ) {
+
+    for( unsigned i=0 ; i<nTypeBits ; ++i )
+      _type.setProperty( i , ( data.typeBits >> i ) & 1u ) ;
+
+    if( _isRotational() ){
+
+      const double dx = data.origin[0] - data.center[0] ;
+      const double dy = data.origin[1] - data.center[1] ;
+
+      _rOrigin   = std::sqrt( dx*dx + dy*dy ) ;
+      _phiOrigin = std::atan2( dy, dx ) ;
+      _cosAlpha  = 1. / std::sqrt( 1. + data.slope * data.slope ) ;
+
+      _normalSign = ( data.normal[0] * dx + data.normal[1] * dy >= 0. ? 1. : -1. ) ;
+      _uSign      = ( - data.u[0] * dy + data.u[1] * dx >= 0. ? 1. : -1. ) ;
+    }
+  }
+
+
+  Vector3D SnapshotSurface::_rotated( const double* w, const Vector3D& point ) const {
+
+    if( !_isRotational() )
+      return Vector3D( w[0], w[1], w[2] ) ;
+
+    const double dx = point.x() - _data.center[0] ;
+    const double dy = point.y() - _data.center[1] ;
+    const double rho = std::sqrt( dx*dx + dy*dy ) ;
+
+    if( !( rho > 0. && _rOrigin > 0. ) )
+      return Vector3D( w[0], w[1], w[2] ) ;
+
+    // the rotation from the origin to the point
+    const double ox = ( _data.origin[0] - _data.center[0] ) / _rOrigin ;
+    const double oy = ( _data.origin[1] - _data.center[1] ) / _rOrigin ;
+
+    const double cosD = ( ox * dx + oy * dy ) / rho ;
+    const double sinD = ( ox * dy - oy * dx ) / rho ;
+
+    return Vector3D( w[0] * cosD - w[1] * sinD, w[0] * sinD + w[1] * cosD, w[2] ) ;
+  }
+
+
+  double SnapshotSurface::distance( const Vector3D& point ) const {
+
+    if( _isRotational() ){
+
+      const double dx = point.x() - _data.center[0] ;
+      const double dy = point.y() - _data.center[1] ;
+      const double rho = std::sqrt( dx*dx + dy*dy ) ;
+
+      const double r = _rOrigin + _data.slope * ( point.z() - _data.origin[2] ) ;
+
+      return _normalSign * ( rho - r ) * _cosAlpha ;
+    }
+
+    return ( ( point.x() - _data.origin[0] ) * _data.normal[0] +
+	     ( point.y() - _data.origin[1] ) * _data.normal[1] +
+	     ( point.z() - _data.origin[2] ) * _data.normal[2] ) ;
+  }
+
+
+  bool SnapshotSurface::insideBounds( const Vector3D& point, double epsilon ) const {
+
+    if( !( std::fabs( distance( point ) ) < epsilon ) )
+      return false ;
+
+    if( _isRotational() )
+      return point.z() >= _data.zMin && point.z() <= _data.zMax ;
+
+    const double dx = point.x() - _data.origin[0] ;
+    const double dy = point.y() - _data.origin[1] ;
+    const double dz = point.z() - _data.origin[2] ;
+
+    if( _data.kind == surfaceRecord::ZDisk ){
+      const double cx = point.x() - _data.center[0] ;
+      const double cy = point.y() - _data.center[1] ;
+      const double rho2 = cx*cx + cy*cy ;
+      return rho2 >= _data.rMin * _data.rMin && rho2 <= _data.rMax * _data.rMax ;
+    }
+
+    return ( std::fabs( dx * _data.u[0] + dy * _data.u[1] + dz * _data.u[2] ) <= _data.lengthU / 2. &&
+	     std::fabs( dx * _data.v[0] + dy * _data.v[1] + dz * _data.v[2] ) <= _data.lengthV / 2. ) ;
+  }
+
+
+  Vector2D SnapshotSurface::globalToLocal( const Vector3D& point ) const {
+
+    if( _isRotational() ){
+
+      // r*phi and the length along the cone, measured from the origin
+      double dphi = std::atan2( point.y() - _data.center[1], point.x() - _data.center[0] ) - _phiOrigin ;
+
+      while( dphi >  M_PI ) dphi -= 2.*M_PI ;
+      while( dphi < -M_PI ) dphi += 2.*M_PI ;
+
+      return Vector2D( _uSign * _data.radius * dphi, ( point.z() - _data.origin[2] ) / _data.v[2] ) ;
+    }
+
+    const double dx = point.x() - _data.origin[0] ;
+    const double dy = point.y() - _data.origin[1] ;
+    const double dz = point.z() - _data.origin[2] ;
+
+    return Vector2D( dx * _data.u[0] + dy * _data.u[1] + dz * _data.u[2],
+		     dx * _data.v[0] + dy * _data.v[1] + dz * _data.v[2] ) ;
+  }
+
+
+  Vector3D SnapshotSurface::localToGlobal( const Vector2D& point ) const {
+
+    if( _isRotational() ){
+
+      const double phi = _phiOrigin + _uSign * point.u() / _data.radius ;
+      const double z = _data.origin[2] + point.v() * _data.v[2] ;
+      const double r = _rOrigin + _data.slope * ( z - _data.origin[2] ) ;
+
+      return Vector3D( _data.center[0] + r * std::cos( phi ), _data.center[1] + r * std::sin( phi ), z ) ;
+    }
+
+    return Vector3D( _data.origin[0] + point.u() * _data.u[0] + point.v() * _data.v[0],
+		     _data.origin[1] + point.u() * _data.u[1] + point.v() * _data.v[1],
+		     _data.origin[2] + point.u() * _data.u[2] + point.v() * _data.v[2] ) ;
+  }
+
+
+  //======================================================================================
+
+  SnapshotGeometry::SnapshotGeometry( const std::string& fileName ) :
+    IGeometry(), _mapping( NULL ), _mappingSize( 0 ), _header( NULL ), _materials(), _surfaces(),
+    _surfaceList(), _surfaceIndex( NULL ), _materialCache(), _surfaceRecords(), _surfaceIdMap(), _field( NULL ) {
+
+    const int fd = open( fileName.c_str(), O_RDONLY ) ;
+
+    if( fd < 0 )
+      throwInvalid( fileName, "cannot open file" ) ;
+
+    struct stat st ;
+
+    if( fstat( fd, &st ) != 0 || std::size_t( st.st_size ) < sizeof( snapshotHeader ) ){
+      close( fd ) ;
+      throwInvalid( fileName, "not a snapshot file" ) ;
+    }
+
+    // shared and read only: all processes use the same pages of the page cache
+    void* mapping = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 ) ;
+
+    close( fd ) ;
+
+    if( mapping == MAP_FAILED )
+      throwInvalid( fileName, "cannot map file" ) ;
+
+    _mapping = mapping ;
+    _mappingSize = st.st_size ;
+
+    try {
+
+      _load( fileName ) ;
+
+    } catch( ... ) {
+
+      _release() ;
+      throw ;
+    }
+
+    streamlog_out( DEBUG5 ) << " SnapshotGeometry: mapped " << _surfaceList.size() << " surfaces and "
+			    << _materials.size() << " materials from " << fileName << std::endl ;
+  }
+
+
+  SnapshotGeometry::~SnapshotGeometry(){
+    _release() ;
+  }
+
+
+  void SnapshotGeometry::_release(){
+
+    delete _field ;
+    _field = NULL ;
+
+    delete _surfaceIndex ;
+    _surfaceIndex = NULL ;
+
+    for( unsigned i=0, n = _surfaces.size() ; i<n ; ++i )
+      delete _surfaces[i] ;
+
+    for( unsigned i=0, n = _materials.size() ; i<n ; ++i )
+      delete _materials[i] ;
+
+    _surfaces.clear() ;
+    _surfaceList.clear() ;
+    _materials.clear() ;
+
+    if( _mapping != NULL )
+      munmap( _mapping, _mappingSize ) ;
+
+    _mapping = NULL ;
+    _header = NULL ;
+  }
+
+
+  void SnapshotGeometry::_load( const std::string& fileName ){
+
+    const char* base = static_cast<const char*>( _mapping ) ;
+
+    _header = reinterpret_cast<const snapshotHeader*>( base ) ;
+
+    const snapshotHeader& h = *_header ;
+
+    if( std::memcmp( h.magic, snapshotMagic, sizeof( snapshotMagic ) ) != 0 )
+      throwInvalid( fileName, "not a snapshot file" ) ;
+
+    if( h.byteOrder != snapshotByteOrder )
+      throwInvalid( fileName, "written on a machine with a different byte order" ) ;
+
+    if( h.version != snapshotHeader::currentVersion ){
+      std::stringstream sst ;
+      sst << "version " << h.version << " is not supported - expected " << unsigned( snapshotHeader::currentVersion ) ;
+      throwInvalid( fileName, sst.str() ) ;
+    }
+
+    if( h.headerSize != sizeof( snapshotHeader ) || h.materialSize != sizeof( snapshotMaterial ) ||
+	h.surfaceSize != sizeof( snapshotSurface ) )
+      throwInvalid( fileName, "inconsistent record sizes" ) ;
+
+    const std::uint64_t fieldSize = ( h.fieldType != 0 ? std::uint64_t( 4 ) * sizeof( float ) * h.fieldNodes[0] * h.fieldNodes[1] * h.fieldNodes[2] : 0 ) ;
+
+    if( h.fileSize != _mappingSize ||
+	h.materialOffset % 64 != 0 || h.surfaceOffset % 64 != 0 || h.fieldOffset % 64 != 0 ||
+	h.materialOffset < sizeof( snapshotHeader ) ||
+	h.materialOffset + std::uint64_t( h.nMaterials ) * sizeof( snapshotMaterial ) > h.surfaceOffset ||
+	h.surfaceOffset + std::uint64_t( h.nSurfaces ) * sizeof( snapshotSurface ) > h.fieldOffset ||
+	h.fieldOffset + fieldSize > _mappingSize )
+      throwInvalid( fileName, "truncated or inconsistent file" ) ;
+
+    // the materials
+    const snapshotMaterial* materials = reinterpret_cast<const snapshotMaterial*>( base + h.materialOffset ) ;
+
+    _materials.reserve( h.nMaterials ) ;
+
+    for( unsigned i=0 ; i<h.nMaterials ; ++i )
+      _materials.push_back( new SnapshotMaterial( materials[i] ) ) ;
+
+    // the surfaces
+    const snapshotSurface* surfaces = reinterpret_cast<const snapshotSurface*>( base + h.surfaceOffset ) ;
+
+    _surfaces.reserve( h.nSurfaces ) ;
+    _surfaceList.reserve( h.nSurfaces ) ;
+
+    for( unsigned i=0 ; i<h.nSurfaces ; ++i ){
+
+      const snapshotSurface& s = surfaces[i] ;
+
+      if( s.innerMaterial >= h.nMaterials || s.outerMaterial >= h.nMaterials )
+	throwInvalid( fileName, "invalid material index" ) ;
+
+      _surfaces.push_back( new SnapshotSurface( s, *_materials[ s.innerMaterial ], *_materials[ s.outerMaterial ] ) ) ;
+      _surfaceList.push_back( _surfaces.back() ) ;
+    }
+
+    _surfaceIndex = new SurfaceIndex( _surfaceList ) ;
+
+    _materialCache.build( _surfaceList ) ;
+
+    _surfaceRecords.build( _surfaceList, &_materialCache ) ;
+
+    _surfaceIdMap.build( _surfaceList ) ;
+
+    // the annulus of the disks is not known from the ISurface
+    for( unsigned i=0 ; i<h.nSurfaces ; ++i ){
+
+      if( _surfaceRecords[i].type != surfaceRecord::ZDisk )
+	continue ;
+
+      surfaceRecord& r = _surfaceRecords[i] ;
+
+      r.rMin = surfaces[i].rMin ;
+      r.rMax = surfaces[i].rMax ;
+      r.xCenter = surfaces[i].center[0] ;
+      r.yCenter = surfaces[i].center[1] ;
+    }
+
+    // the field
+    if( h.fieldType != 0 ){
+
+      const unsigned n[3] = { h.fieldNodes[0], h.fieldNodes[1], h.fieldNodes[2] } ;
+
+      _field = new FieldMapGrid( h.fieldType == 1 ? FieldMapGrid::XYZ : FieldMapGrid::RZ, n, h.fieldMin, h.fieldStep,
+				 reinterpret_cast<const float*>( base + h.fieldOffset ) ) ;
+    }
+
+    // the field map is used if it has been written, even for a constant field
+    if( _field == NULL ){
+
+      if( !h.constantBField )
+	throwInvalid( fileName, "neither a constant field nor a field map" ) ;
+
+      setConstantBField( h.constantBz ) ;
+    }
+  }
+
+
+  Vector3D SnapshotGeometry::getBField( const Vector3D& xx ) const {
+
+    if( _field != NULL )
+      return _field->fieldAt( xx ) ;
+
+    return Vector3D( 0., 0., constantBz() ) ;
+  }
+
+
+  void SnapshotGeometry::getCandidateSurfaces( const Vector5& hp, const Vector3D& rp,
+					       std::vector<const ISurface*>& surfaces,
+					       std::vector<unsigned>& indices ) const {
+    _surfaceIndex->getCandidates( hp, rp, surfaces, indices ) ;
+  }
+
+
+  bool SnapshotGeometry::isSnapshot( const std::string& fileName ){
+
+    std::ifstream in( fileName.c_str(), std::ios::binary ) ;
+
+    char magic[ sizeof( snapshotMagic ) ] ;
+
+    if( !in.read( magic, sizeof( magic ) ) )
+      return false ;
+
+    return std::memcmp( magic, snapshotMagic, sizeof( snapshotMagic ) ) == 0 ;
+  }
+
+
+  const IGeometry& SnapshotGeometry::installGlobal( const std::string& fileName ){
+
+    _geom = new SnapshotGeometry( fileName ) ;
+
+    return *_geom ;
+  }
+
+
+  void SnapshotGeometry::write( const IGeometry& geom, const std::string& fileName, const FieldMapGrid* field ){
+
+    if( field == NULL && !geom.hasConstantBField() )
+      throw std::invalid_argument( "SnapshotGeometry::write: the field is not constant - a field map is needed" ) ;
+
+    const std::vector<const ISurface*>& surfaceList = geom.getSurfaces() ;
+
+    const unsigned nSurfaces = surfaceList.size() ;
+
+    // the records of the geometry know e.g. the annulus of disks and the planes that are not rectangles
+    const SurfaceRecords* records = geom.getSurfaceRecords() ;
+
+    if( records != NULL && records->size() != nSurfaces )
+      records = NULL ;
+
+    std::vector<snapshotMaterial> materials ;
+    std::vector<snapshotSurface> surfaces( nSurfaces ) ;
+
+    unsigned nPlanar = 0 ;
+    unsigned nRectangles = 0 ;
+    unsigned nDisks = 0 ;
+
+    for( unsigned i=0 ; i<nSurfaces ; ++i ){
+
+      const ISurface* surf = surfaceList[i] ;
+
+      const surfaceRecord r = ( records != NULL ? (*records)[i] : surfaceRecord::fromSurface( surf ) ) ;
+
+      snapshotSurface& s = surfaces[i] ;
+      std::memset( &s, 0, sizeof( s ) ) ;
+
+      s.id = surf->id() ;
+      s.typeBits = typeBits( surf->type() ) ;
+      s.kind = r.type ;
+      s.innerMaterial = materialIndex( materials, surf->innerMaterial() ) ;
+      s.outerMaterial = materialIndex( materials, surf->outerMaterial() ) ;
+      s.innerThickness = surf->innerThickness() ;
+      s.outerThickness = surf->outerThickness() ;
+
+      copy( surf->origin(), s.origin ) ;
+      s.normal[0] = r.nx ;  s.normal[1] = r.ny ;  s.normal[2] = r.nz ;
+      s.u[0] = r.ux ;  s.u[1] = r.uy ;  s.u[2] = r.uz ;
+      s.v[0] = r.vx ;  s.v[1] = r.vy ;  s.v[2] = r.vz ;
+
+      s.lengthU = surf->length_along_u() ;
+      s.lengthV = surf->length_along_v() ;
+
+      s.slope = r.slope ;
+      s.zMin = r.zMin ;  s.zMax = r.zMax ;
+      s.rMin = r.rMin ;  s.rMax = r.rMax ;
+
+      const ICylinder* cyl = dynamic_cast<const ICylinder*>( surf ) ;
+
+      if( cyl != NULL ){
+	s.radius = cyl->radius() ;
+	copy( cyl->center(), s.center ) ;
+      }
+
+      const ICone* cone = dynamic_cast<const ICone*>( surf ) ;
+
+      if( cone != NULL ){
+	s.radius0 = cone->radius0() ;  s.radius1 = cone->radius1() ;
+	s.z0 = cone->z0() ;  s.z1 = cone->z1() ;
+      }
+
+      if( r.type == surfaceRecord::ZDisk ){
+	s.center[0] = r.xCenter ;  s.center[1] = r.yCenter ;  s.center[2] = r.oz ;
+
+	if( records == NULL )
+	  ++nDisks ;
+      }
+
+      if( r.type == surfaceRecord::Other ){
+
+	if( surf->type().isPlane() )
+	  ++nRectangles ;
+	else
+	  ++nPlanar ;
+      }
+    }
+
+    if( nPlanar > 0 ){
+      streamlog_out( WARNING ) << " SnapshotGeometry::write: " << nPlanar << " surfaces of unsupported types are"
+			       << " written as the tangential plane at their origin " << std::endl ;
+    }
+
+    if( nRectangles > 0 ){
+      streamlog_out( WARNING ) << " SnapshotGeometry::write: " << nRectangles << " planes with bounds that are not"
+			       << " rectangles ( e.g. trapezoids ) are written with the rectangle length_along_u() x"
+			       << " length_along_v() around their origin " << std::endl ;
+    }
+
+    if( nDisks > 0 ){
+      streamlog_out( WARNING ) << " SnapshotGeometry::write: the geometry has no surface records - " << nDisks
+			       << " disks are written without inner radius and centered on their origin " << std::endl ;
+    }
+
+    // the header
+    snapshotHeader h ;
+    std::memset( &h, 0, sizeof( h ) ) ;
+
+    std::memcpy( h.magic, snapshotMagic, sizeof( snapshotMagic ) ) ;
+    h.version      = snapshotHeader::currentVersion ;
+    h.byteOrder    = snapshotByteOrder ;
+    h.headerSize   = sizeof( snapshotHeader ) ;
+    h.materialSize = sizeof( snapshotMaterial ) ;
+    h.surfaceSize  = sizeof( snapshotSurface ) ;
+    h.nMaterials   = materials.size() ;
+    h.nSurfaces    = nSurfaces ;
+
+    h.constantBField = geom.hasConstantBField() ;
+    h.constantBz     = geom.constantBz() ;
+
+    std::uint64_t fieldSize = 0 ;
+
+    if( field != NULL ){
+
+      h.fieldType = ( field->type() == FieldMapGrid::XYZ ? 1 : 2 ) ;
+
+      for( unsigned k=0 ; k<3 ; ++k ){
+	h.fieldNodes[k] = field->nodes( k ) ;
+	h.fieldMin[k]   = field->lowerEdge( k ) ;
+	h.fieldStep[k]  = field->step( k ) ;
+      }
+
+      fieldSize = std::uint64_t( 4 ) * sizeof( float ) * field->nNodes() ;
+    }
+
+    h.materialOffset = alignToCacheLine( sizeof( snapshotHeader ) ) ;
+    h.surfaceOffset  = alignToCacheLine( h.materialOffset + materials.size() * sizeof( snapshotMaterial ) ) ;
+    h.fieldOffset    = alignToCacheLine( h.surfaceOffset + surfaces.size() * sizeof( snapshotSurface ) ) ;
+    h.fileSize       = h.fieldOffset + fieldSize ;
+
+    std::ofstream out( fileName.c_str(), std::ios::binary | std::ios::trunc ) ;
+
+    if( !out )
+      throw std::runtime_error( "SnapshotGeometry::write: cannot open " + fileName ) ;
+
+    writeBlock( out, 0, &h, sizeof( h ) ) ;
+    writeBlock( out, h.materialOffset, materials.empty() ? NULL : &materials[0], materials.size() * sizeof( snapshotMaterial ) ) ;
+    writeBlock( out, h.surfaceOffset, surfaces.empty() ? NULL : &surfaces[0], surfaces.size() * sizeof( snapshotSurface ) ) ;
+    writeBlock( out, h.fieldOffset, field != NULL ? field->data() : NULL, fieldSize ) ;
+
+    if( !out )
+      throw std::runtime_error( "SnapshotGeometry::write: cannot write " + fileName ) ;
+
+    streamlog_out( MESSAGE ) << " SnapshotGeometry::write: wrote " << nSurfaces << " surfaces and " << materials.size()
+			     << " materials to " << fileName << std::endl ;
+  }
+
+}
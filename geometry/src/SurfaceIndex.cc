@@ -0,0 +1,379 @@
+#include "SurfaceIndex.hh"
+#include "helixUtils.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace aidaTT
+{
+
+  namespace {
+
+    /// tolerance used for all comparisons of lengths
+    const double epsilon = 1.e-3 ;
+
+    /// wrap an angle difference into [-pi,pi]
+    double wrapPhi( double dphi ){
+      while( dphi >  M_PI ) dphi -= 2.*M_PI ;
+      while( dphi < -M_PI ) dphi += 2.*M_PI ;
+      return dphi ;
+    }
+
+    /// distance of the origin to the segment (x0,y0) - (x1,y1)
+    double distanceToSegment( double x0, double y0, double x1, double y1 ){
+
+      const double dx = x1 - x0 ;
+      const double dy = y1 - y0 ;
+      const double l2 = dx*dx + dy*dy ;
+
+      double t = ( l2 > 0. ? - ( x0*dx + y0*dy ) / l2 : 0. ) ;
+      t = std::max( 0., std::min( 1., t ) ) ;
+
+      return std::sqrt( ( x0 + t*dx )*( x0 + t*dx ) + ( y0 + t*dy )*( y0 + t*dy ) ) ;
+    }
+
+    struct sortByKey{
+      template <class T>
+      bool operator()( const T& b0, const T& b1 ) const { return b0.key < b1.key ; }
+      template <class T>
+      bool operator()( const T& b, double k ) const { return b.key < k ; }
+    } ;
+
+    struct sortByRhoMin{
+      template <class T>
+      bool operator()( const T& b0, const T& b1 ) const { return b0.rhoMin < b1.rhoMin ; }
+    } ;
+  }
+
+
+
+  SurfaceIndex::SurfaceIndex( const std::vector<const ISurface*>& surfaces, unsigned nPhiSectors ) :
+    _surfaces( surfaces ), _cylinders(), _cylinderHalfWidth(0.), _disks(), _diskHalfWidth(0.),
+    _planes(), _layers(), _others(), _nPhiSectors( std::max( nPhiSectors, 1u ) ),
+    _sectorWidth( 2.*M_PI / _nPhiSectors ) {
+
+    for(unsigned i=0, N=_surfaces.size() ; i<N ; ++i){
+
+      const ISurface* surf = _surfaces[i] ;
+
+      const ICylinder* cyl = dynamic_cast<const ICylinder*>( surf ) ;
+
+      if( surf->type().isZCylinder() && cyl != 0 ){
+
+	surfaceBounds b = computeBounds( surf, i ) ;
+	_cylinders.push_back( b ) ;
+	_cylinderHalfWidth = std::max( _cylinderHalfWidth , ( b.rhoMax - b.rhoMin ) / 2. ) ;
+
+      } else if( surf->type().isZDisk() ){
+
+	surfaceBounds b = computeBounds( surf, i ) ;
+	_disks.push_back( b ) ;
+	_diskHalfWidth = std::max( _diskHalfWidth , ( b.zMax - b.zMin ) / 2. ) ;
+
+      } else if( surf->type().isPlane() ){
+
+	_planes.push_back( computeBounds( surf, i ) ) ;
+
+      } else {
+
+	_others.push_back( i ) ;
+      }
+    }
+
+    std::sort( _cylinders.begin(), _cylinders.end(), sortByKey() ) ;
+    std::sort( _disks.begin(), _disks.end(), sortByKey() ) ;
+
+    // group the planes into radial layers - planes with overlapping radial range end up in the same layer
+    std::sort( _planes.begin(), _planes.end(), sortByRhoMin() ) ;
+
+    for(unsigned j=0 ; j<_planes.size() ; ++j){
+
+      const surfaceBounds& b = _planes[j] ;
+
+      if( _layers.empty() || b.rhoMin > _layers.back().rhoMax ){
+
+	_layers.push_back( planeLayer( b.rhoMin, b.rhoMax, _nPhiSectors ) ) ;
+      }
+
+      planeLayer& layer = _layers.back() ;
+      layer.rhoMax = std::max( layer.rhoMax , b.rhoMax ) ;
+
+      if( b.fullPhi ){
+
+	for(unsigned k=0 ; k<_nPhiSectors ; ++k)
+	  layer.sectors[k].push_back( j ) ;
+
+      } else {
+
+	const unsigned first = sector( b.phiMin ) ;
+	const unsigned n = std::min( _nPhiSectors, unsigned( std::ceil( ( b.phiMax - b.phiMin ) / _sectorWidth ) ) + 1 ) ;
+
+	for(unsigned k=0 ; k<n ; ++k)
+	  layer.sectors[ ( first + k ) % _nPhiSectors ].push_back( j ) ;
+      }
+    }
+  }
+
+
+
+  SurfaceIndex::surfaceBounds SurfaceIndex::computeBounds( const ISurface* surf, unsigned index ){
+
+    const double inf = std::numeric_limits<double>::max() ;
+
+    surfaceBounds b ;
+    b.index   = index ;
+    b.key     = 0. ;
+    b.rhoMin  = 0. ;
+    b.rhoMax  = inf ;
+    b.zMin    = -inf ;
+    b.zMax    = inf ;
+    b.phiMin  = -M_PI ;
+    b.phiMax  =  M_PI ;
+    b.fullPhi = true ;
+
+    const Vector3D& o = surf->origin() ;
+
+    const ICylinder* cyl = dynamic_cast<const ICylinder*>( surf ) ;
+
+    if( surf->type().isZCylinder() && cyl != 0 ){
+
+      const Vector3D c = cyl->center() ;
+      const double offset = std::sqrt( c.x()*c.x() + c.y()*c.y() ) ;
+
+      b.key    = cyl->radius() ;
+      b.rhoMin = std::max( 0., cyl->radius() - offset ) ;
+      b.rhoMax = cyl->radius() + offset ;
+
+      // the v direction of a z-cylinder is along z
+      if( surf->length_along_v() > 0. ){
+	b.zMin = c.z() - surf->length_along_v() / 2. ;
+	b.zMax = c.z() + surf->length_along_v() / 2. ;
+      }
+
+    } else if( surf->type().isZDisk() ){
+
+      b.key    = o.z() ;
+      b.zMin   = o.z() ;
+      b.zMax   = o.z() ;
+      b.rhoMax = std::max( surf->length_along_u(), surf->length_along_v() ) / 2.
+	+ std::sqrt( o.x()*o.x() + o.y()*o.y() ) ;
+
+    } else if( surf->type().isPlane() ){
+
+      const Vector3D u = surf->u() ;
+      const Vector3D v = surf->v() ;
+      const double hu = surf->length_along_u() / 2. ;
+      const double hv = surf->length_along_v() / 2. ;
+
+      // the corners of the plane - ordered around the boundary
+      const double su[4] = { 1., 1., -1., -1. } ;
+      const double sv[4] = { 1., -1., -1., 1. } ;
+
+      double cx[4], cy[4] ;
+
+      b.rhoMax = 0. ;
+
+      for(unsigned k=0 ; k<4 ; ++k){
+
+	cx[k] = o.x() + su[k]*hu*u.x() + sv[k]*hv*v.x() ;
+	cy[k] = o.y() + su[k]*hu*u.y() + sv[k]*hv*v.y() ;
+	const double cz = o.z() + su[k]*hu*u.z() + sv[k]*hv*v.z() ;
+
+	b.rhoMax = std::max( b.rhoMax , std::sqrt( cx[k]*cx[k] + cy[k]*cy[k] ) ) ;
+	b.zMin = ( k == 0 ? cz : std::min( b.zMin , cz ) ) ;
+	b.zMax = ( k == 0 ? cz : std::max( b.zMax , cz ) ) ;
+      }
+
+      // the projection of the plane into the xy-plane is a parallelogram -
+      // check if it contains the z-axis, otherwise compute the distance to it
+      int nPos = 0, nNeg = 0 ;
+      double rhoMin = b.rhoMax ;
+
+      for(unsigned k=0 ; k<4 ; ++k){
+
+	const unsigned l = ( k + 1 ) % 4 ;
+
+	const double cross = ( cx[l] - cx[k] ) * ( - cy[k] ) - ( cy[l] - cy[k] ) * ( - cx[k] ) ;
+	if( cross > 0. ) ++nPos ;
+	if( cross < 0. ) ++nNeg ;
+
+	rhoMin = std::min( rhoMin , distanceToSegment( cx[k], cy[k], cx[l], cy[l] ) ) ;
+      }
+
+      b.rhoMin = ( nPos == 0 || nNeg == 0 ? 0. : rhoMin ) ;
+      b.key = ( b.rhoMin + b.rhoMax ) / 2. ;
+
+      if( b.rhoMin > epsilon ){
+
+	const double phiRef = std::atan2( o.y() , o.x() ) ;
+
+	double dMin = 0., dMax = 0. ;
+
+	for(unsigned k=0 ; k<4 ; ++k){
+
+	  const double d = wrapPhi( std::atan2( cy[k], cx[k] ) - phiRef ) ;
+	  dMin = std::min( dMin , d ) ;
+	  dMax = std::max( dMax , d ) ;
+	}
+
+	b.phiMin  = phiRef + dMin ;
+	b.phiMax  = phiRef + dMax ;
+	b.fullPhi = false ;
+      }
+    }
+
+    return b ;
+  }
+
+
+
+  unsigned SurfaceIndex::sector( double phi ) const {
+
+    int i = int( std::floor( ( phi + M_PI ) / _sectorWidth ) ) % int( _nPhiSectors ) ;
+
+    if( i < 0 )
+      i += _nPhiSectors ;
+
+    return i ;
+  }
+
+
+
+  void SurfaceIndex::collect( const std::vector<surfaceBounds>& bounds, double maxHalfWidth, double lo, double hi,
+			      double rhoMin, double rhoMax, double zMin, double zMax,
+			      std::vector<unsigned>& indices ) {
+
+    for( std::vector<surfaceBounds>::const_iterator it =
+	   std::lower_bound( bounds.begin(), bounds.end(), lo - maxHalfWidth, sortByKey() ) ;
+	 it != bounds.end() && it->key <= hi + maxHalfWidth ; ++it ){
+
+      if( it->rhoMax < rhoMin || it->rhoMin > rhoMax || it->zMax < zMin || it->zMin > zMax )
+	continue ;
+
+      indices.push_back( it->index ) ;
+    }
+  }
+
+
+
+  void SurfaceIndex::collectPlanes( const planeLayer& layer, unsigned first, unsigned n,
+				    double rhoMin, double rhoMax, double zMin, double zMax,
+				    std::vector<unsigned>& indices ) const {
+
+    for(unsigned k=0 ; k<n ; ++k){
+
+      const std::vector<unsigned>& planes = layer.sectors[ ( first + k ) % _nPhiSectors ] ;
+
+      for(unsigned j=0 ; j<planes.size() ; ++j){
+
+	const surfaceBounds& b = _planes[ planes[j] ] ;
+
+	if( b.rhoMax < rhoMin || b.rhoMin > rhoMax || b.zMax < zMin || b.zMin > zMax )
+	  continue ;
+
+	indices.push_back( b.index ) ;
+      }
+    }
+  }
+
+
+
+  void SurfaceIndex::getCandidates( const Vector5& hp, const Vector3D& rp,
+				    std::vector<const ISurface*>& candidates,
+				    std::vector<unsigned>& indices ) const {
+
+    candidates.clear() ;
+
+    const double omega = calculateOmega( hp ) ;
+
+    if( omega == 0. ){ // no curvature - no index
+      candidates = _surfaces ;
+      indices.resize( _surfaces.size() ) ;
+      for(unsigned i=0 ; i<indices.size() ; ++i)
+	indices[i] = i ;
+      return ;
+    }
+
+    // extent of the helix in the first half arc (in rho: the full circle)
+    const double radius = calculateRadius( hp ) ;
+    const double xc = calculateXCenter( hp, rp ) ;
+    const double yc = calculateYCenter( hp, rp ) ;
+    const double dc = std::sqrt( xc*xc + yc*yc ) ;
+    const double phic = std::atan2( yc, xc ) ;
+
+    const double rhoMin = std::fabs( dc - radius ) - epsilon ;
+    const double rhoMax = dc + radius + epsilon ;
+
+    const double z0 = calculateZfromS( 0., hp, rp ) ;
+    const double z1 = calculateZfromS( M_PI * radius, hp, rp ) ;
+
+    const double zMin = std::min( z0, z1 ) - epsilon ;
+    const double zMax = std::max( z0, z1 ) + epsilon ;
+
+    indices.assign( _others.begin(), _others.end() ) ;
+
+    collect( _cylinders, _cylinderHalfWidth, rhoMin, rhoMax, rhoMin, rhoMax, zMin, zMax, indices ) ;
+
+    collect( _disks, _diskHalfWidth, zMin, zMax, rhoMin, rhoMax, zMin, zMax, indices ) ;
+
+    for( std::vector<planeLayer>::const_iterator layer = _layers.begin() ; layer != _layers.end() ; ++layer ){
+
+      if( layer->rhoMax < rhoMin || layer->rhoMin > rhoMax )
+	continue ;
+
+      // the helix crosses a circle with radius r at phic +/- alpha(r) with
+      // cos(alpha) = ( r^2 + dc^2 - R^2 ) / ( 2 r dc ) - alpha(r) is monotonic, except for
+      // dc > R where it has its maximum asin( R/dc ) at the tangent point r_t = sqrt( dc^2 - R^2 )
+      const double r[2] = { std::max( layer->rhoMin , rhoMin ) , std::min( layer->rhoMax , rhoMax ) } ;
+
+      if( r[0] <= epsilon || dc <= epsilon ){
+
+	collectPlanes( *layer, 0, _nPhiSectors, rhoMin, rhoMax, zMin, zMax, indices ) ;
+
+      } else {
+
+	double alpha[2] ;
+	for(unsigned k=0 ; k<2 ; ++k){
+	  const double cosAlpha = ( r[k]*r[k] + dc*dc - radius*radius ) / ( 2. * r[k] * dc ) ;
+	  alpha[k] = std::acos( std::max( -1., std::min( 1., cosAlpha ) ) ) ;
+	}
+
+	double alphaMin = std::min( alpha[0] , alpha[1] ) ;
+	double alphaMax = std::max( alpha[0] , alpha[1] ) ;
+
+	if( dc > radius ){
+
+	  const double rt = std::sqrt( dc*dc - radius*radius ) ;
+
+	  if( rt > r[0] && rt < r[1] )
+	    alphaMax = std::max( alphaMax , std::asin( std::min( 1., radius / dc ) ) ) ;
+	}
+
+	for(int sign=-1 ; sign<2 ; sign+=2){
+
+	  // the branch covers the angles phic + sign * [alphaMin,alphaMax]
+	  const double start = phic + ( sign > 0 ? alphaMin : -alphaMax ) ;
+	  const double delta = alphaMax - alphaMin ;
+
+	  // add one sector on either side as safety margin
+	  const unsigned first = sector( start ) + _nPhiSectors - 1 ;
+	  const unsigned n = std::min( _nPhiSectors, unsigned( std::ceil( delta / _sectorWidth ) ) + 3 ) ;
+
+	  // planes in overlapping sectors of the two branches are removed below
+	  collectPlanes( *layer, first, n, rhoMin, rhoMax, zMin, zMax, indices ) ;
+	}
+      }
+    }
+
+    // keep the original order of the surfaces and remove planes found in several sectors
+    std::sort( indices.begin(), indices.end() ) ;
+    indices.erase( std::unique( indices.begin(), indices.end() ), indices.end() ) ;
+
+    candidates.reserve( indices.size() ) ;
+
+    for(unsigned i=0 ; i<indices.size() ; ++i)
+      candidates.push_back( _surfaces[ indices[i] ] ) ;
+  }
+
+}
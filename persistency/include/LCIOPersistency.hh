@@ -4,11 +4,20 @@
 #define LCIOPERSISTENCY_HH
 
 #include "lcio.h"
+#include "EVENT/LCCollection.h"
+#include "EVENT/Track.h"
+#include "EVENT/TrackerHit.h"
+#include "IMPL/LCCollectionVec.h"
 #include "IMPL/TrackImpl.h"
 #include "IMPL/TrackStateImpl.h"
 
 #include "trackParameters.hh"
 #include "trajectory.hh"
+#include "fitResults.hh"
+
+#include <typeinfo>
+#include <utility>
+#include <vector>
 
 namespace aidaTT
 {
@@ -17,15 +26,124 @@ namespace aidaTT
     IMPL::TrackStateImpl* createLCIO(const trackParameters& tp);
 
 
-//~ trajectory readLCIO(const EVENT::Track* const t)
-//~ {
-//~ }
-//~
-//~
-//~
-//~ IMPL::TrackImpl* createLCIO(const trajectory& traj)
-//~ {
-//~ }
+    /** The fit input of one LCIO track in aidaTT units: the start parameters and the hits with
+     *  their surfaces, positions and precisions - as needed for trajectory::addMeasurement().
+     *  Composite space points are replaced by their strip hits. The vectors are reused if the
+     *  input is filled again, i.e. converting the tracks of many events does not allocate
+     *  memory once the buffers are large enough.
+     */
+    struct lcioTrackInput
+    {
+        lcioTrackInput() : track(0), hasStartParameters(false), startParameters(), hits(), surfaces(),
+                           positions(), precisions(), nMissingSurfaces(0) {}
+
+        /// remove all hits - the memory is kept
+        void clear();
+
+        /// the number of (strip) hits
+        unsigned size() const { return hits.size(); }
+
+        /// the converted track
+        const EVENT::Track* track ;
+
+        /// false if the track has no track state at the requested location
+        bool hasStartParameters ;
+        trackParameters startParameters ;
+
+        /// the hits - strip hits instead of composite space points
+        std::vector<EVENT::TrackerHit*> hits ;
+        /// the surfaces of the hits - NULL if there is no surface for the cell id
+        std::vector<const ISurface*> surfaces ;
+        /// the hit positions
+        std::vector<Vector3D> positions ;
+        /// two per hit: 1/du^2 and 1/dv^2 ( 0 for 1D measurements )
+        std::vector<double> precisions ;
+
+        /// the number of hits without a surface
+        unsigned nMissingSurfaces ;
+    } ;
+
+
+
+    /** Convert whole LCIO tracks and track collections to the input of the aidaTT fit and the
+     *  fitted tracks back to LCIO. The surfaces of the hits of a track are resolved at once
+     *  with IGeometry::findSurfaces().
+     *
+     *  @code
+     *   LCIOTrackConverter converter( geom ) ;
+     *   std::vector<lcioTrackInput> inputs ;
+     *   trajectory traj( trackParameters(), fitter, propagation, &geom ) ;
+     *
+     *   // for every event
+     *   unsigned nTracks = converter.readLCIO( evt->getCollection( "MarlinTrkTracks" ), inputs ) ;
+     *   IMPL::LCCollectionVec* outCol = LCIOTrackConverter::createTrackCollection( nTracks ) ;
+     *
+     *   for( unsigned i=0 ; i<nTracks ; ++i ){
+     *     traj.reset( inputs[i].startParameters ) ;
+     *     converter.fillTrajectory( inputs[i], traj ) ;
+     *     traj.prepareForFitting() ;
+     *     if( traj.fit() )
+     *       outCol->addElement( converter.createLCIO( *traj.getFitResults(), inputs[i].track ) ) ;
+     *   }
+     *  @endcode
+     */
+    class LCIOTrackConverter
+    {
+    public:
+
+        /// for the surfaces of the geometry and the track state at the given location ( EVENT::TrackState::AtIP, ... )
+        explicit LCIOTrackConverter(const IGeometry& geom, int trackStateLocation = EVENT::TrackState::AtIP);
+
+        /** Convert the track - returns false if the track has no track state at the location
+         *  ( the hits are converted anyway ).
+         */
+        bool readLCIO(const EVENT::Track* track, lcioTrackInput& input);
+
+        /** Convert all tracks of the collection: the inputs are resized to the number of tracks,
+         *  the existing inputs are reused. Returns the number of tracks.
+         *  Throws std::invalid_argument if the collection is not a track collection.
+         */
+        unsigned readLCIO(const EVENT::LCCollection* tracks, std::vector<lcioTrackInput>& inputs);
+
+        /** Add the hits of the input to the trajectory ( reset with the start parameters ) in the
+         *  order of the intersections of the start helix with the surfaces: a measurement for
+         *  the surfaces with a hit and - if useQMS - a scatterer for the other surfaces with material.
+         *  If several hits are on one surface only the last one of the input is used.
+         *  Returns the number of measurements ( see addHitsAtIntersections() ).
+         */
+        unsigned fillTrajectory(const lcioTrackInput& input, trajectory& traj, bool useQMS = true);
+
+        /** Create the fitted LCIO track: the fitted track state at the location of the converter,
+         *  chi2 and ndf and - if given - the hits, type and subdetector hit numbers of the input track.
+         */
+        IMPL::TrackImpl* createLCIO(const fitResults& result, const EVENT::Track* inputTrack = 0) const;
+
+        /// the surface with the id - NULL if there is none ( see IGeometry::findSurface() )
+        const ISurface* findSurface(long64 id) const { return _geometry.findSurface(id); }
+
+        /// an empty track collection with the hit flag set and room for nTracks tracks
+        static IMPL::LCCollectionVec* createTrackCollection(unsigned nTracks);
+
+    private:
+        LCIOTrackConverter(const LCIOTrackConverter&);
+        LCIOTrackConverter& operator=(const LCIOTrackConverter&);
+
+        /// add the position and the precision of the hit on the surface to the input
+        void _addHitInfo(const EVENT::TrackerHit* hit, const ISurface* surf, lcioTrackInput& input);
+
+        const IGeometry& _geometry ;
+
+        int _location ;
+
+        /// the dynamic type of the last hit and if it is a TrackerHitPlane - hits of one collection are of the same type
+        const std::type_info* _lastHitType ;
+        bool _lastHitIsPlane ;
+
+        /// scratch buffers of readLCIO() and fillTrajectory()
+        std::vector<long64> _ids ;
+        std::vector<std::pair<const ISurface*, unsigned> > _hitOrder ;
+        std::vector<double> _precision ;
+    } ;
 }
 #endif // LCIOPERSISTENCY_HH
 #endif // USE_LCIO
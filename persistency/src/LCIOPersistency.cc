@@ -5,61 +5,68 @@
 #include "Vector5.hh"
 #include "Vector3D.hh"
 #include "utilities.hh"
+#include "aidaTT-Units.hh"
+#include "trajectoryUtils.hh"
+
+#include "EVENT/TrackerHitPlane.h"
+#include "IMPL/LCFlagImpl.h"
+#include "UTIL/BitSet32.h"
+#include "UTIL/ILDConf.h"
+
+#include <cmath>
+#include <stdexcept>
 
 
 
 /* declare and define functions for LCIO interaction:
  * reading and writing LCIO::TrackState from trackParameters
- * reading and writing LCIO::Track from trajectory
+ * reading LCIO::Track collections as fit input and writing the fitted LCIO::Track
  */
 
 namespace aidaTT
 {
-#ifdef AIDATT_USE_DD4HEP
-#include "DD4hep/DD4hepUnits.h"
-
     trackParameters readLCIO(const EVENT::TrackState* const ts)
     {
         trackParameters TP;
         /// track state can be read as L3 parametrization:  [ Omega, tan(lambda), phi_0, d_0, z_0, ]
         Vector5 param;
-        param(OMEGA) = ts->getOmega() / dd4hep::mm;
+        param(OMEGA) = ts->getOmega() / aidaTT::mm;
         param(TANL)  = ts->getTanLambda();
         param(PHI0)  = ts->getPhi();
-        param(D0)    = ts->getD0() * dd4hep::mm;
-        param(Z0)    = ts->getZ0() * dd4hep::mm;
+        param(D0)    = ts->getD0() * aidaTT::mm;
+        param(Z0)    = ts->getZ0() * aidaTT::mm;
 
         //debug: vary the track parameters by 1% :
-        // Vector5 param( 1.01 * ts->getOmega()/dd4hep::mm,
+        // Vector5 param( 1.01 * ts->getOmega()/aidaTT::mm,
         //         1.01 * ts->getTanLambda(),
         //         0.99 * ts->getPhi(),
-        //         0.99 * ts->getD0()*dd4hep::mm,
-        //         1.01  * ts->getZ0()*dd4hep::mm);
+        //         0.99 * ts->getD0()*aidaTT::mm,
+        //         1.01  * ts->getZ0()*aidaTT::mm);
 
         /// get the reference point
-        Vector3D refPoint(ts->getReferencePoint()[0]*dd4hep::mm , ts->getReferencePoint()[1]*dd4hep::mm , ts->getReferencePoint()[2]*dd4hep::mm);
+        Vector3D refPoint(ts->getReferencePoint()[0]*aidaTT::mm , ts->getReferencePoint()[1]*aidaTT::mm , ts->getReferencePoint()[2]*aidaTT::mm);
 
         /// the covariance matrix is stored as lower triangle,
         ///  order of parameters is: d0, phi, omega, z0, tan(lambda)
         fullCovariance covarianceMatrix;
 
         // omega, omega - 0,0
-        covarianceMatrix(0, 0) = ts->getCovMatrix().at(5) / (dd4hep::mm * dd4hep::mm);
+        covarianceMatrix(0, 0) = ts->getCovMatrix().at(5) / (aidaTT::mm * aidaTT::mm);
         // tanLambda,tanLambda (1,1)
         covarianceMatrix(1, 1) = ts->getCovMatrix().at(14);
         // phi,phi (2,2)
         covarianceMatrix(2, 2) = ts->getCovMatrix().at(2);
         // d0,d0 (3,3)
-        covarianceMatrix(3, 3) = ts->getCovMatrix().at(0) * dd4hep::mm * dd4hep::mm;
+        covarianceMatrix(3, 3) = ts->getCovMatrix().at(0) * aidaTT::mm * aidaTT::mm;
         // z0,z0 (4,4)
-        covarianceMatrix(4, 4) = ts->getCovMatrix().at(9) * dd4hep::mm * dd4hep::mm;
+        covarianceMatrix(4, 4) = ts->getCovMatrix().at(9) * aidaTT::mm * aidaTT::mm;
 
         // omega, tanLambda (0,1) - (1,0)
-        covarianceMatrix(1, 0) = ts->getCovMatrix().at(12) / dd4hep::mm;
-        covarianceMatrix(0, 1) = ts->getCovMatrix().at(12) / dd4hep::mm;
+        covarianceMatrix(1, 0) = ts->getCovMatrix().at(12) / aidaTT::mm;
+        covarianceMatrix(0, 1) = ts->getCovMatrix().at(12) / aidaTT::mm;
         // omega, phi (0,2) - (2,0)
-        covarianceMatrix(2, 0) = ts->getCovMatrix().at(4) / dd4hep::mm;
-        covarianceMatrix(0, 2) = ts->getCovMatrix().at(4) / dd4hep::mm;
+        covarianceMatrix(2, 0) = ts->getCovMatrix().at(4) / aidaTT::mm;
+        covarianceMatrix(0, 2) = ts->getCovMatrix().at(4) / aidaTT::mm;
         //omega, d0 (0,3) - (3,0)
         covarianceMatrix(3, 0) = ts->getCovMatrix().at(3);
         covarianceMatrix(0, 3) = ts->getCovMatrix().at(3);
@@ -71,22 +78,22 @@ namespace aidaTT
         covarianceMatrix(1, 2) = ts->getCovMatrix().at(11);
         covarianceMatrix(2, 1) = ts->getCovMatrix().at(11);
         // tanLambda, d0 (1,3) - (3,1)
-        covarianceMatrix(1, 3) = ts->getCovMatrix().at(10) * dd4hep::mm;
-        covarianceMatrix(3, 1) = ts->getCovMatrix().at(10) * dd4hep::mm;
+        covarianceMatrix(1, 3) = ts->getCovMatrix().at(10) * aidaTT::mm;
+        covarianceMatrix(3, 1) = ts->getCovMatrix().at(10) * aidaTT::mm;
         // tanLambda, z0 (1,4) - (4,1)
-        covarianceMatrix(1, 4) = ts->getCovMatrix().at(13) * dd4hep::mm;
-        covarianceMatrix(4, 1) = ts->getCovMatrix().at(13) * dd4hep::mm;
+        covarianceMatrix(1, 4) = ts->getCovMatrix().at(13) * aidaTT::mm;
+        covarianceMatrix(4, 1) = ts->getCovMatrix().at(13) * aidaTT::mm;
 
         // phi, d0 (2,3) - (3,2)
-        covarianceMatrix(3, 2) = ts->getCovMatrix().at(1) * dd4hep::mm;
-        covarianceMatrix(2, 3) = ts->getCovMatrix().at(1) * dd4hep::mm;
+        covarianceMatrix(3, 2) = ts->getCovMatrix().at(1) * aidaTT::mm;
+        covarianceMatrix(2, 3) = ts->getCovMatrix().at(1) * aidaTT::mm;
         // phi, z0 (2,4) - (4,2)
-        covarianceMatrix(2, 4) = ts->getCovMatrix().at(7) * dd4hep::mm;
-        covarianceMatrix(4, 2) = ts->getCovMatrix().at(7) * dd4hep::mm;
+        covarianceMatrix(2, 4) = ts->getCovMatrix().at(7) * aidaTT::mm;
+        covarianceMatrix(4, 2) = ts->getCovMatrix().at(7) * aidaTT::mm;
 
         // d0, z0 (3,4) - (4,3)
-        covarianceMatrix(3, 4) = ts->getCovMatrix().at(6) * dd4hep::mm * dd4hep::mm;
-        covarianceMatrix(4, 3) = ts->getCovMatrix().at(6) * dd4hep::mm * dd4hep::mm;
+        covarianceMatrix(3, 4) = ts->getCovMatrix().at(6) * aidaTT::mm * aidaTT::mm;
+        covarianceMatrix(4, 3) = ts->getCovMatrix().at(6) * aidaTT::mm * aidaTT::mm;
 
         TP.setTrackParameters(param, covarianceMatrix, refPoint);
         return  TP;
@@ -105,64 +112,260 @@ namespace aidaTT
         tsi->setLocation(0);
 
         /// set parameter values
-        tsi->setD0(calculateD0(tp) / dd4hep::mm);
+        tsi->setD0(calculateD0(tp) / aidaTT::mm);
         tsi->setPhi(calculatePhi0(tp));
-        tsi->setOmega(calculateOmega(tp) * dd4hep::mm);
-        tsi->setZ0(calculateZ0(tp)  / dd4hep::mm);
+        tsi->setOmega(calculateOmega(tp) * aidaTT::mm);
+        tsi->setZ0(calculateZ0(tp)  / aidaTT::mm);
         tsi->setTanLambda(calculateTanLambda(tp));
 
         std::vector<float> covm;
 
         // d0,d0 (3,3)
-        covm.push_back(covarianceMatrix(3, 3) / (dd4hep::mm * dd4hep::mm)) ;   // ts->getCovMatrix().at(0);
+        covm.push_back(covarianceMatrix(3, 3) / (aidaTT::mm * aidaTT::mm)) ;   // ts->getCovMatrix().at(0);
         // phi, d0 (2,3) - (3,2)
-        covm.push_back(covarianceMatrix(3, 2) / dd4hep::mm);  // ts->getCovMatrix().at(1);
+        covm.push_back(covarianceMatrix(3, 2) / aidaTT::mm);  // ts->getCovMatrix().at(1);
         // phi,phi (2,2)
         covm.push_back(covarianceMatrix(2, 2));  // ts->getCovMatrix().at(2);
         //omega, d0 (0,3) - (3,0)
         covm.push_back(covarianceMatrix(3, 0));  // ts->getCovMatrix().at(3);
         // omega, phi (0,2) - (2,0)
-        covm.push_back(covarianceMatrix(0, 2) * dd4hep::mm);  // ts->getCovMatrix().at(4);
+        covm.push_back(covarianceMatrix(0, 2) * aidaTT::mm);  // ts->getCovMatrix().at(4);
         // omega, omega - 0,0
-        covm.push_back(covarianceMatrix(0, 0) * (dd4hep::mm * dd4hep::mm));  // ts->getCovMatrix().at(5);
+        covm.push_back(covarianceMatrix(0, 0) * (aidaTT::mm * aidaTT::mm));  // ts->getCovMatrix().at(5);
         // d0, z0 (3,4) - (4,3)
-        covm.push_back(covarianceMatrix(3, 4) / (dd4hep::mm * dd4hep::mm));  // ts->getCovMatrix().at(6);
+        covm.push_back(covarianceMatrix(3, 4) / (aidaTT::mm * aidaTT::mm));  // ts->getCovMatrix().at(6);
         // phi, z0 (2,4) - (4,2)
-        covm.push_back(covarianceMatrix(2, 4) / dd4hep::mm);  // ts->getCovMatrix().at(7);
+        covm.push_back(covarianceMatrix(2, 4) / aidaTT::mm);  // ts->getCovMatrix().at(7);
         // omega, z0 (0,4) - (4,0)
         covm.push_back(covarianceMatrix(4, 0));  // ts->getCovMatrix().at(8);
         // z0,z0 (4,4)
-        covm.push_back(covarianceMatrix(4, 4) / (dd4hep::mm * dd4hep::mm));  // ts->getCovMatrix().at(9);
+        covm.push_back(covarianceMatrix(4, 4) / (aidaTT::mm * aidaTT::mm));  // ts->getCovMatrix().at(9);
         // tanLambda, d0 (1,3) - (3,1)
-        covm.push_back(covarianceMatrix(1, 3) / dd4hep::mm);  // ts->getCovMatrix().at(10);
+        covm.push_back(covarianceMatrix(1, 3) / aidaTT::mm);  // ts->getCovMatrix().at(10);
         // tanLambda, phi (1,2) - (2,1)
         covm.push_back(covarianceMatrix(1, 2));  // ts->getCovMatrix().at(11);
         // omega, tanLambda (0,1) - (1,0)
-        covm.push_back(covarianceMatrix(0, 1) * dd4hep::mm);  // ts->getCovMatrix().at(12);
+        covm.push_back(covarianceMatrix(0, 1) * aidaTT::mm);  // ts->getCovMatrix().at(12);
         // tanLambda, z0 (1,4) - (4,1)
-        covm.push_back(covarianceMatrix(1, 4) / dd4hep::mm);  // ts->getCovMatrix().at(13);
+        covm.push_back(covarianceMatrix(1, 4) / aidaTT::mm);  // ts->getCovMatrix().at(13);
         // tanLambda,tanLambda (1,1)
         covm.push_back(covarianceMatrix(1, 1));  // ts->getCovMatrix().at(14);
 
         tsi->setCovMatrix(covm);
 
         /// set reference point
-        float rp[3] = { float(refPoint.x() / dd4hep::mm) , float(refPoint.y() / dd4hep::mm) , float( refPoint.z() / dd4hep::mm ) } ;
+        float rp[3] = { float(refPoint.x() / aidaTT::mm) , float(refPoint.y() / aidaTT::mm) , float( refPoint.z() / aidaTT::mm ) } ;
         tsi->setReferencePoint(rp);
 
         return tsi;
     }
-#endif // AIDATT_USE_DD4HEP
-
-
-//~ trajectory readLCIO(const EVENT::Track* const t)
-//~ {
-//~ }
-//~
-//~
-//~
-//~ IMPL::TrackImpl* createLCIO(const trajectory& traj)
-//~ {
-//~ }
+
+
+
+    //==================================================================================
+
+    void lcioTrackInput::clear()
+    {
+        track = 0;
+        hasStartParameters = false;
+        hits.clear();
+        surfaces.clear();
+        positions.clear();
+        precisions.clear();
+        nMissingSurfaces = 0;
+    }
+
+
+
+    LCIOTrackConverter::LCIOTrackConverter(const IGeometry& geom, int trackStateLocation) :
+        _geometry(geom), _location(trackStateLocation), _lastHitType(0), _lastHitIsPlane(false), _ids(), _hitOrder(), _precision(2)
+    {
+    }
+
+
+
+    void LCIOTrackConverter::_addHitInfo(const EVENT::TrackerHit* hit, const ISurface* surf, lcioTrackInput& input)
+    {
+        const double* pos = hit->getPosition();
+
+        input.positions.push_back(Vector3D(pos[0] * aidaTT::mm, pos[1] * aidaTT::mm, pos[2] * aidaTT::mm));
+
+        // the dynamic_cast is only needed if the type of the hit changes
+        const std::type_info& hitType = typeid(*hit);
+
+        if(_lastHitType == 0 || *_lastHitType != hitType)
+            {
+                _lastHitType = &hitType;
+                _lastHitIsPlane = (dynamic_cast<const EVENT::TrackerHitPlane*>(hit) != 0);
+            }
+
+        double du, dv;
+
+        if(_lastHitIsPlane)
+            {
+                const EVENT::TrackerHitPlane* planarHit = static_cast<const EVENT::TrackerHitPlane*>(hit);
+
+                du = planarHit->getdU() * aidaTT::mm;
+                dv = planarHit->getdV() * aidaTT::mm;
+            }
+        else
+            {
+                // e.g. TPC hits - the errors from the covariance matrix
+                const EVENT::FloatVec& cov = hit->getCovMatrix();
+
+                du = std::sqrt(cov[0] + cov[2]) * aidaTT::mm;
+                dv = std::sqrt(cov[5]) * aidaTT::mm;
+            }
+
+        input.precisions.push_back(1. / (du * du));
+        input.precisions.push_back(surf != 0 && surf->type().isMeasurement1D() ? 0. : 1. / (dv * dv));
+    }
+
+
+
+    bool LCIOTrackConverter::readLCIO(const EVENT::Track* track, lcioTrackInput& input)
+    {
+        input.clear();
+        input.track = track;
+
+        const EVENT::TrackState* ts = track->getTrackState(_location);
+
+        input.hasStartParameters = (ts != 0);
+
+        if(ts != 0)
+            input.startParameters = aidaTT::readLCIO(ts);
+
+        const EVENT::TrackerHitVec& trackHits = track->getTrackerHits();
+
+        for(unsigned i = 0, n = trackHits.size() ; i < n ; ++i)
+            {
+                EVENT::TrackerHit* hit = trackHits[i];
+
+                if(UTIL::BitSet32(hit->getType())[ UTIL::ILDTrkHitTypeBit::COMPOSITE_SPACEPOINT ])
+                    {
+                        // the raw hits of space points are the strip hits
+                        const EVENT::LCObjectVec& rawHits = hit->getRawHits();
+
+                        for(unsigned k = 0, nRaw = rawHits.size() ; k < nRaw ; ++k)
+                            input.hits.push_back(static_cast<EVENT::TrackerHit*>(rawHits[k]));
+                    }
+                else
+                    {
+                        input.hits.push_back(hit);
+                    }
+            }
+
+        // the surfaces of all hits at once
+        const unsigned nHits = input.hits.size();
+
+        _ids.resize(nHits);
+
+        for(unsigned i = 0 ; i < nHits ; ++i)
+            _ids[i] = input.hits[i]->getCellID0();
+
+        input.surfaces.resize(nHits);
+
+        if(nHits > 0)
+            input.nMissingSurfaces = nHits - _geometry.findSurfaces(nHits, &_ids[0], &input.surfaces[0]);
+
+        for(unsigned i = 0 ; i < nHits ; ++i)
+            _addHitInfo(input.hits[i], input.surfaces[i], input);
+
+        return input.hasStartParameters;
+    }
+
+
+
+    unsigned LCIOTrackConverter::readLCIO(const EVENT::LCCollection* tracks, std::vector<lcioTrackInput>& inputs)
+    {
+        if(tracks->getTypeName() != EVENT::LCIO::TRACK)
+            throw std::invalid_argument("LCIOTrackConverter::readLCIO: not a track collection: " + tracks->getTypeName());
+
+        const unsigned nTracks = tracks->getNumberOfElements();
+
+        // existing inputs are kept with their buffers
+        if(inputs.size() < nTracks)
+            inputs.resize(nTracks);
+
+        for(unsigned i = 0 ; i < nTracks ; ++i)
+            readLCIO(static_cast<const EVENT::Track*>(tracks->getElementAt(i)), inputs[i]);
+
+        for(unsigned i = nTracks, n = inputs.size() ; i < n ; ++i)
+            inputs[i].clear();
+
+        return nTracks;
+    }
+
+
+
+    namespace
+    {
+        /// access to the hits of the fit input for addHitsAtIntersections()
+        class lcioInputHits
+        {
+        public:
+            explicit lcioInputHits(const lcioTrackInput& input) : _input(input) {}
+
+            unsigned size() const { return _input.size(); }
+            const ISurface* surface(unsigned i) const { return _input.surfaces[i]; }
+            const Vector3D& position(unsigned i) const { return _input.positions[i]; }
+            const double* precision(unsigned i) const { return &_input.precisions[2 * i]; }
+            void* id(unsigned i) const { return _input.hits[i]; }
+
+        private:
+            const lcioTrackInput& _input;
+        };
+    }
+
+
+
+    unsigned LCIOTrackConverter::fillTrajectory(const lcioTrackInput& input, trajectory& traj, bool useQMS)
+    {
+        return addHitsAtIntersections(traj, lcioInputHits(input), useQMS, _hitOrder, _precision);
+    }
+
+
+
+    IMPL::TrackImpl* LCIOTrackConverter::createLCIO(const fitResults& result, const EVENT::Track* inputTrack) const
+    {
+        IMPL::TrackImpl* track = new IMPL::TrackImpl();
+
+        IMPL::TrackStateImpl* ts = aidaTT::createLCIO(result.estimatedParameters());
+        ts->setLocation(_location);
+
+        track->addTrackState(ts);
+        track->setChi2(result.chiSquare());
+        track->setNdf(result.ndf());
+
+        if(inputTrack != 0)
+            {
+                track->setType(inputTrack->getType());
+
+                const EVENT::TrackerHitVec& hits = inputTrack->getTrackerHits();
+
+                for(unsigned i = 0, n = hits.size() ; i < n ; ++i)
+                    track->addHit(hits[i]);
+
+                track->subdetectorHitNumbers() = inputTrack->getSubdetectorHitNumbers();
+            }
+
+        return track;
+    }
+
+
+
+    IMPL::LCCollectionVec* LCIOTrackConverter::createTrackCollection(unsigned nTracks)
+    {
+        IMPL::LCCollectionVec* col = new IMPL::LCCollectionVec(EVENT::LCIO::TRACK);
+
+        IMPL::LCFlagImpl trkFlag(0);
+        trkFlag.setBit(EVENT::LCIO::TRBIT_HITS);
+        col->setFlag(trkFlag.getFlag());
+
+        col->reserve(nTracks);
+
+        return col;
+    }
+
 }
 #endif // USE_LCIO
@@ -0,0 +1,83 @@
+#ifndef RUNGEKUTTAPROPAGATION_HH
+#define RUNGEKUTTAPROPAGATION_HH
+
+#include "IPropagation.hh"
+#include "fiveByFiveMatrix.hh"
+#include "Vector3D.hh"
+
+#include <Eigen/Core>
+
+/** Propagation in a non-uniform magnetic field: the track is integrated with an adaptive
+ *  Runge-Kutta-Nystroem method of fourth order through the field of the geometry, and the
+ *  jacobian in curvilinear track parameters (q/p,lambda,phi,x_t,y_t) is transported with the
+ *  same Runge-Kutta stages (semi-analytically, i.e. neglecting the field gradients).
+ *
+ *  Per step the field is evaluated at the middle and the end point of the step. The field at the
+ *  end point of a propagation is cached and reused for the following propagation if it starts at
+ *  the same point - as it does for consecutive trajectory elements. For geometries with a
+ *  constant field no field look up is done at all.
+ *
+ *  Every trajectory needs its own instance.
+ **/
+
+namespace aidaTT
+{
+
+  class rungeKuttaPropagation : public IPropagation
+  {
+  public:
+
+    /** The step size is adapted such that the estimated position error per step is below
+     *  tolerance, within [minStep,maxStep] - all lengths in cm.
+     */
+    rungeKuttaPropagation(double tolerance=1.e-4, double minStep=1.e-2, double maxStep=100.) ;
+
+    /// jacobian in the constant field bfield
+    virtual bool getJacobian(fiveByFiveMatrix& jacobian, double dw, double qop,
+			     const Vector3D& tstart, const Vector3D& tend,
+			     const Vector3D& bfield, double NrjLoss ) ;
+
+    /// jacobian from xstart in the field of the geometry
+    virtual bool getJacobian(fiveByFiveMatrix& jacobian, double dw, double qop, const Vector3D& xstart,
+			     const Vector3D& tstart, const Vector3D& tend,
+			     const Vector3D& bfield, const IGeometry& geometry, double NrjLoss ) ;
+
+    /// number of accepted steps in the last propagation
+    unsigned lastNumberOfSteps() const { return _nSteps ; }
+
+  private:
+    rungeKuttaPropagation(const rungeKuttaPropagation&) ;
+    rungeKuttaPropagation& operator=(const rungeKuttaPropagation&) ;
+
+    typedef Eigen::Vector3d vec3 ;
+
+    /// integrate from xstart over dw and transform the derivatives to the curvilinear system at tend
+    bool _propagate(fiveByFiveMatrix& jacobian, double dw, double qop, const Vector3D& xstart,
+		    const Vector3D& tstart, const Vector3D& tend, double NrjLoss ) ;
+
+    /// the field at x - from the geometry, the cache or the constant field
+    vec3 _field(const vec3& x) ;
+
+    double _tolerance ;
+    double _minStep ;
+    double _maxStep ;
+
+    ///< the step size for the next propagation
+    double _step ;
+
+    unsigned _nSteps ;
+
+    ///< the geometry for the current propagation - NULL for a constant field
+    const IGeometry* _geometry ;
+    vec3 _constantField ;
+
+    ///< the field at the end point of the last propagation
+    bool _cacheValid ;
+    const IGeometry* _cacheGeometry ;
+    vec3 _cachePosition ;
+    vec3 _cacheField ;
+  };
+
+}
+
+#endif //RUNGEKUTTAPROPAGATION_HH
@@ -0,0 +1,235 @@
+#include "rungeKuttaPropagation.hh"
+
+#include "aidaTT-Units.hh"
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <cmath>
+
+namespace aidaTT
+{
+  typedef Eigen::Matrix<double, 3, 3> crossMatrix ;
+  typedef Eigen::Matrix<double, 3, 5> derivatives ;
+
+  /// the matrix M with M*v = v x B
+  static inline crossMatrix crossWith( const Eigen::Vector3d& b ){
+
+    crossMatrix mat ;
+    mat <<   0. ,  b(2) , -b(1) ,
+	  -b(2) ,    0. ,  b(0) ,
+	   b(1) , -b(0) ,    0. ;
+    return mat ;
+  }
+
+
+
+  rungeKuttaPropagation::rungeKuttaPropagation(double tolerance, double minStep, double maxStep) :
+    _tolerance( tolerance ), _minStep( minStep ), _maxStep( maxStep ), _step( maxStep ), _nSteps( 0 ),
+    _geometry( NULL ), _constantField(), _cacheValid( false ), _cacheGeometry( NULL ),
+    _cachePosition(), _cacheField() {
+  }
+
+
+
+  bool rungeKuttaPropagation::getJacobian(fiveByFiveMatrix& jac, double dw, double qop, const Vector3D& tStart, const Vector3D& tEnd,
+					  const Vector3D& bfield, double NrjLoss)
+  {
+    _geometry = NULL ;
+    _constantField = vec3( bfield.x(), bfield.y(), bfield.z() ) ;
+
+    return _propagate( jac, dw, qop, Vector3D(), tStart, tEnd, NrjLoss ) ;
+  }
+
+
+
+  bool rungeKuttaPropagation::getJacobian(fiveByFiveMatrix& jac, double dw, double qop, const Vector3D& xStart, const Vector3D& tStart,
+					  const Vector3D& tEnd, const Vector3D& bfield, const IGeometry& geometry, double NrjLoss)
+  {
+    if( geometry.hasConstantBField() ){
+
+      _geometry = NULL ;
+      _constantField = vec3( 0., 0., geometry.constantBz() ) ;
+
+    } else {
+
+      _geometry = &geometry ;
+      _constantField = vec3( bfield.x(), bfield.y(), bfield.z() ) ;
+    }
+
+    return _propagate( jac, dw, qop, xStart, tStart, tEnd, NrjLoss ) ;
+  }
+
+
+
+  rungeKuttaPropagation::vec3 rungeKuttaPropagation::_field(const vec3& x)
+  {
+    if( _geometry == NULL )
+      return _constantField ;
+
+    if( _cacheValid && _cacheGeometry == _geometry && ( x - _cachePosition ).squaredNorm() < _tolerance * _tolerance )
+      return _cacheField ;
+
+    const Vector3D b = _geometry->getBField( Vector3D( x(0), x(1), x(2) ) ) ;
+
+    return vec3( b.x(), b.y(), b.z() ) ;
+  }
+
+
+
+  bool rungeKuttaPropagation::_propagate(fiveByFiveMatrix& jac, double dw, double qop, const Vector3D& xStart,
+					 const Vector3D& tStart, const Vector3D& tEnd, double NrjLoss)
+  {
+    // the equation of motion in the field B [T] is d^2x/ds^2 = k * ( dx/ds x B )
+    const double k = convertBr2P_cm * qop ;
+
+    vec3 x( xStart.x(), xStart.y(), xStart.z() ) ;
+    vec3 T( tStart.x(), tStart.y(), tStart.z() ) ;
+    T.normalize() ;
+
+    // curvilinear system at the start
+    const double coslambdaStart = std::sqrt( T(0) * T(0) + T(1) * T(1) ) ;
+
+    if( !( coslambdaStart > 0. ) )
+      return false ;
+
+    const vec3 u1( -T(1) / coslambdaStart, T(0) / coslambdaStart, 0. ) ;
+    const vec3 v1 = T.cross( u1 ) ;
+
+    // derivatives of the position and direction w.r.t. the curvilinear parameters at the start
+    derivatives dX = derivatives::Zero() ;
+    derivatives dT = derivatives::Zero() ;
+
+    dX.col(3) = u1 ;
+    dX.col(4) = v1 ;
+    dT.col(1) = v1 ;
+    dT.col(2) = coslambdaStart * u1 ;
+
+    const double direction = ( dw < 0. ? -1. : 1. ) ;
+    double remaining = std::fabs( dw ) ;
+
+    double h = std::min( std::max( _step, _minStep ), _maxStep ) ;
+
+    vec3 B1 = _field( x ) ;
+
+    _nSteps = 0 ;
+
+    /// the maximum number of rejected steps per propagation, to guarantee termination
+    unsigned nRejected = 0 ;
+    static const unsigned maxRejected = 1000 ;
+
+    while( remaining > 0. )
+      {
+	const double step = std::min( h, remaining ) ;
+	const double hs   = direction * step ;
+
+	const crossMatrix M1 = crossWith( B1 ) ;
+	const vec3 k1 = k * ( M1 * T ) ;
+
+	const vec3 x2 = x + 0.5 * hs * T + 0.125 * hs * hs * k1 ;
+	const vec3 T2 = T + 0.5 * hs * k1 ;
+
+	const crossMatrix M2 = crossWith( _field( x2 ) ) ;
+	const vec3 k2 = k * ( M2 * T2 ) ;
+
+	const vec3 T3 = T + 0.5 * hs * k2 ;
+	const vec3 k3 = k * ( M2 * T3 ) ;
+
+	const vec3 x4 = x + hs * T + 0.5 * hs * hs * k3 ;
+	const vec3 T4 = T + hs * k3 ;
+
+	const crossMatrix M4 = crossWith( _field( x4 ) ) ;
+	const vec3 k4 = k * ( M4 * T4 ) ;
+
+	// estimate of the position error of this step
+	const double error = hs * hs * ( k1 - k2 - k3 + k4 ).lpNorm<1>() ;
+
+	if( error > _tolerance && step > _minStep && nRejected < maxRejected )
+	  {
+	    ++nRejected ;
+	    h = std::max( step * std::max( 0.25 , 0.9 * std::pow( _tolerance / error , 0.25 ) ) , _minStep ) ;
+	    continue ;
+	  }
+
+	/// transport the derivatives with the same stages - the derivative of k w.r.t. q/p enters in column 0
+	derivatives dk1 = k * ( M1 * dT ) ;
+	dk1.col(0) += convertBr2P_cm * ( M1 * T ) ;
+
+	const derivatives dT2 = dT + 0.5 * hs * dk1 ;
+	derivatives dk2 = k * ( M2 * dT2 ) ;
+	dk2.col(0) += convertBr2P_cm * ( M2 * T2 ) ;
+
+	const derivatives dT3 = dT + 0.5 * hs * dk2 ;
+	derivatives dk3 = k * ( M2 * dT3 ) ;
+	dk3.col(0) += convertBr2P_cm * ( M2 * T3 ) ;
+
+	const derivatives dT4 = dT + hs * dk3 ;
+	derivatives dk4 = k * ( M4 * dT4 ) ;
+	dk4.col(0) += convertBr2P_cm * ( M4 * T4 ) ;
+
+	dX += hs * dT + ( hs * hs / 6. ) * ( dk1 + dk2 + dk3 ) ;
+	dT += ( hs / 6. ) * ( dk1 + 2. * dk2 + 2. * dk3 + dk4 ) ;
+
+	x += hs * T + ( hs * hs / 6. ) * ( k1 + k2 + k3 ) ;
+	T += ( hs / 6. ) * ( k1 + 2. * k2 + 2. * k3 + k4 ) ;
+	T.normalize() ;
+
+	remaining -= step ;
+	++_nSteps ;
+
+	B1 = _field( x ) ;
+
+	// adapt the step size - a step shortened to the end point gives no information
+	if( step == h )
+	  {
+	    const double scale = ( error > 0. ? 0.9 * std::pow( _tolerance / error , 0.25 ) : 4. ) ;
+	    h = std::min( step * std::min( std::max( scale , 0.25 ) , 4. ) , _maxStep ) ;
+	  }
+      }
+
+    _step = h ;
+
+    if( _geometry != NULL )
+      {
+	_cacheValid    = true ;
+	_cacheGeometry = _geometry ;
+	_cachePosition = x ;
+	_cacheField    = B1 ;
+      }
+
+    /// the curvilinear system at the end point
+    vec3 Te( tEnd.x(), tEnd.y(), tEnd.z() ) ;
+    Te.normalize() ;
+
+    const double coslambdaEnd = std::sqrt( Te(0) * Te(0) + Te(1) * Te(1) ) ;
+
+    if( !( coslambdaEnd > 0. ) )
+      return false ;
+
+    const vec3 u2( -Te(1) / coslambdaEnd, Te(0) / coslambdaEnd, 0. ) ;
+    const vec3 v2 = Te.cross( u2 ) ;
+
+    const vec3 dTds = k * ( crossWith( B1 ) * T ) ;
+    const double tt = Te.dot( T ) ;
+
+    // move the varied end points along the track into the curvilinear plane
+    for(unsigned j = 0 ; j < 5 ; ++j)
+      {
+	const double ds = -Te.dot( dX.col(j) ) / tt ;
+
+	const vec3 dx = dX.col(j) + ds * T ;
+	const vec3 dt = dT.col(j) + ds * dTds ;
+
+	jac(0, j) = 0. ;
+	jac(1, j) = v2.dot( dt ) ;
+	jac(2, j) = u2.dot( dt ) / coslambdaEnd ;
+	jac(3, j) = u2.dot( dx ) ;
+	jac(4, j) = v2.dot( dx ) ;
+      }
+
+    // 1/P
+    jac(0, 0) = 1. + NrjLoss ;
+
+    return true ;
+  }
+}
@@ -12,6 +12,20 @@
 #include "unitTests/helixCalculations.hh"
 #include "unitTests/initialTrackTest.hh"
 #include "unitTests/finalTrackTest.hh"
+#ifdef USE_LCIO
+#include "unitTests/lcioConversionTest.hh"
+#endif
+#include "unitTests/helixBatchTest.hh"
+#include "unitTests/fieldMapTest.hh"
+#include "unitTests/rungeKuttaTest.hh"
+#include "unitTests/simpleGeometryTest.hh"
+#include "unitTests/snapshotGeometryTest.hh"
+#include "unitTests/instrumentationTest.hh"
+#include "unitTests/materialCacheTest.hh"
+#include "unitTests/trajectoryResetTest.hh"
+#include "unitTests/kalmanFitterTest.hh"
+#include "unitTests/refitEngineTest.hh"
+#include "unitTests/fitLabelTest.hh"
 using namespace UnitTesting;
 using namespace std;
 
@@ -26,6 +40,20 @@ void addSimpleTests(UnitTestSuite& _test)
     _test.addTest(new helixCalculations);
     _test.addTest(new initialTrackTest);
     _test.addTest(new finalTrackTest);
+#ifdef USE_LCIO
+    _test.addTest(new lcioConversionTest);
+#endif
+    _test.addTest(new helixBatchTest);
+    _test.addTest(new fieldMapTest);
+    _test.addTest(new rungeKuttaTest);
+    _test.addTest(new simpleGeometryTest);
+    _test.addTest(new snapshotGeometryTest);
+    _test.addTest(new instrumentationTest);
+    _test.addTest(new materialCacheTest);
+    _test.addTest(new trajectoryResetTest);
+    _test.addTest(new kalmanFitterTest);
+    _test.addTest(new refitEngineTest);
+    _test.addTest(new fitLabelTest);
 }
 
 
@@ -0,0 +1,187 @@
+#include "fieldMapTest.hh"
+
+#include <cmath>
+
+using namespace std;
+using namespace aidaTT;
+
+namespace
+{
+    /// geometry without surfaces with a field that is linear in x,y and z,
+    /// i.e. it is reproduced exactly by the interpolation
+    class linearFieldGeometry : public IGeometry
+    {
+        public:
+            linearFieldGeometry() : _surfaces() {}
+
+            const std::vector<const ISurface*>& getSurfaces() const
+            {
+                return _surfaces;
+            }
+
+            Vector3D getBField(const Vector3D& xx) const
+            {
+                // a solenoid like field with a small radial component: div B = 0
+                return Vector3D(1.e-4 * xx.x(), 1.e-4 * xx.y(), 3.5 - 2.e-4 * xx.z());
+            }
+
+        private:
+            std::vector<const ISurface*> _surfaces;
+    };
+
+
+    /// geometry with a constant solenoid field
+    class constantFieldGeometry : public IGeometry
+    {
+        public:
+            constantFieldGeometry() : _surfaces()
+            {
+                setConstantBField(3.5);
+            }
+
+            const std::vector<const ISurface*>& getSurfaces() const
+            {
+                return _surfaces;
+            }
+
+            Vector3D getBField(const Vector3D&) const
+            {
+                return Vector3D(0., 0., 3.5);
+            }
+
+        private:
+            std::vector<const ISurface*> _surfaces;
+    };
+}
+
+
+
+fieldMapTest::fieldMapTest() : UnitTest("FieldMapTest", __FILE__), _points()
+{
+    for(unsigned i = 0 ; i < 100 ; ++i)
+        {
+            const double phi = 0.1 + i * 2. * M_PI / 100.;
+            const double r   = 1. + 2.9 * i;
+            _points.push_back(Vector3D(r * cos(phi), r * sin(phi), -280. + 5.7 * i));
+        }
+}
+
+
+
+void fieldMapTest::_testXYZ()
+{
+    linearFieldGeometry geom;
+
+    FieldMapGeometry fmg(geom, new FieldMapGrid(Vector3D(-300., -300., -300.), Vector3D(300., 300., 300.), 31, 31, 31));
+
+    test_(fmg.grid().type() == FieldMapGrid::XYZ);
+    test_(fmg.grid().nNodes() == 31 * 31 * 31);
+
+    for(unsigned i = 0 ; i < _points.size() ; ++i)
+        {
+            test_(fmg.grid().contains(_points[i]));
+
+            const Vector3D b0 = geom.getBField(_points[i]);
+            const Vector3D b1 = fmg.getBField(_points[i]);
+
+            test_(roughFloatCompare(b1.x(), b0.x()));
+            test_(roughFloatCompare(b1.y(), b0.y()));
+            test_(roughFloatCompare(b1.z(), b0.z()));
+        }
+
+    // outside of the grid the decorated geometry is used
+    const Vector3D outside(0., 0., 500.);
+    test_(! fmg.grid().contains(outside));
+    test_(floatCompare(fmg.getBField(outside).z(), geom.getBField(outside).z()));
+}
+
+
+
+void fieldMapTest::_testRZ()
+{
+    linearFieldGeometry geom;
+
+    FieldMapGeometry fmg(geom, new FieldMapGrid(400., -300., 300., 41, 61));
+
+    test_(fmg.grid().type() == FieldMapGrid::RZ);
+    test_(fmg.grid().nNodes() == 41 * 61);
+
+    for(unsigned i = 0 ; i < _points.size() ; ++i)
+        {
+            const Vector3D b0 = geom.getBField(_points[i]);
+            const Vector3D b1 = fmg.getBField(_points[i]);
+
+            test_(roughFloatCompare(b1.x(), b0.x()));
+            test_(roughFloatCompare(b1.y(), b0.y()));
+            test_(roughFloatCompare(b1.z(), b0.z()));
+        }
+
+    // on the z axis
+    const Vector3D b = fmg.getBField(Vector3D(0., 0., 100.));
+    test_(floatCompare(b.x(), 0.));
+    test_(floatCompare(b.y(), 0.));
+    test_(roughFloatCompare(b.z(), 3.48));
+}
+
+
+
+void fieldMapTest::_testBatch()
+{
+    linearFieldGeometry geom;
+
+    FieldMapGeometry fmg(geom, new FieldMapGrid(400., -300., 300., 41, 61));
+
+    std::vector<Vector3D> bfields;
+    fmg.getBField(_points, bfields);
+
+    test_(bfields.size() == _points.size());
+
+    std::vector<double> xyz, b(3 * _points.size());
+    for(unsigned i = 0 ; i < _points.size() ; ++i)
+        {
+            xyz.push_back(_points[i].x());
+            xyz.push_back(_points[i].y());
+            xyz.push_back(_points[i].z());
+        }
+    fmg.grid().fieldAt(_points.size(), &xyz[0], &b[0]);
+
+    for(unsigned i = 0 ; i < _points.size() ; ++i)
+        {
+            const Vector3D b0 = fmg.getBField(_points[i]);
+
+            test_(floatCompare(bfields[i].x(), b0.x()));
+            test_(floatCompare(bfields[i].z(), b0.z()));
+            test_(floatCompare(b[3 * i], b0.x()));
+            test_(floatCompare(b[3 * i + 1], b0.y()));
+            test_(floatCompare(b[3 * i + 2], b0.z()));
+        }
+}
+
+
+
+void fieldMapTest::_testConstantField()
+{
+    linearFieldGeometry linear;
+    test_(! linear.hasConstantBField());
+    test_(floatCompare(linear.getBz(Vector3D(0., 0., 100.)), 3.48));
+
+    constantFieldGeometry geom;
+    test_(geom.hasConstantBField());
+    test_(floatCompare(geom.constantBz(), 3.5));
+    test_(floatCompare(geom.getBz(Vector3D(10., 20., 30.)), 3.5));
+
+    // the decorator keeps the flag
+    FieldMapGeometry fmg(geom, new FieldMapGrid(400., -300., 300., 5, 5));
+    test_(fmg.hasConstantBField());
+    test_(floatCompare(fmg.getBz(Vector3D(10., 20., 30.)), 3.5));
+}
+
+
+
+void fieldMapTest::run()
+{
+    _testXYZ();
+    _testRZ();
+    _testBatch();
+    _testConstantField();
+}
@@ -0,0 +1,26 @@
+#ifndef FIELDMAPTEST_HH
+#define FIELDMAPTEST_HH
+
+/// compare the interpolated field of a FieldMapGeometry to the sampled field
+#include "FieldMapGeometry.hh"
+
+#include "UnitTest.hh"
+#include <vector>
+
+class fieldMapTest : public UnitTesting::UnitTest
+{
+    public:
+        fieldMapTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testXYZ();
+        void _testRZ();
+        void _testBatch();
+        void _testConstantField();
+
+        std::vector<aidaTT::Vector3D> _points;
+};
+#endif // FIELDMAPTEST_HH
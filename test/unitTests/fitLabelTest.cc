@@ -0,0 +1,271 @@
+#include "fitLabelTest.hh"
+
+#include "SimpleGeometry.hh"
+#include "KalmanFitter.hh"
+#include "analyticalPropagation.hh"
+#include "trajectory.hh"
+#include "helixUtils.hh"
+#include "aidaTT-Units.hh"
+
+#ifdef USE_GBL
+#include "GBLInterface.hh"
+#endif
+
+#include <cmath>
+
+using namespace std;
+using namespace aidaTT;
+
+namespace
+{
+    const double bz = 3.5;
+    const double resolution = 0.001;
+
+
+    SimpleGeometry& barrelGeometry()
+    {
+        static SimpleGeometry geo(bz);
+
+        if(geo.getSurfaces().empty())
+            {
+                vector<double> radii;
+                for(unsigned i = 0 ; i < 12 ; ++i)
+                    radii.push_back(5. + 15. * i);
+
+                geo.addBarrel(radii, 300., 0.03);
+            }
+
+        return geo;
+    }
+
+
+    /** The true track from the origin - in the bending plane: for dipped tracks the conversion of
+     *  the fitted corrections to L3 parameters is only approximate for seeds as far off as below.
+     */
+    trackParameters trueParameters()
+    {
+        Vector5 hp;
+        hp(OMEGA) = convertBr2P_cm * bz / 4.;
+        hp(TANL) = 0.;
+        hp(PHI0) = 0.7;
+        hp(D0) = 0.;
+        hp(Z0) = 0.;
+
+        fiveByFiveMatrix covariance;
+        covariance.Unit();
+
+        trackParameters tp;
+        tp.setTrackParameters(hp, covariance, Vector3D());
+
+        return tp;
+    }
+
+
+    /** The seed is displaced in phi0 and d0, so that the corrections of the fit change from
+     *  element to element: the results of a neighbouring element are far off the hits.
+     */
+    trackParameters seedParameters()
+    {
+        trackParameters tp = trueParameters();
+
+        Vector5 hp = tp.parameters();
+        hp(PHI0) += 0.005;
+        hp(D0) += 0.05;
+
+        tp.setTrackParameters(hp);
+
+        return tp;
+    }
+
+
+    /** Add the hits of the true track - displaced by up to one sigma - as measurements without
+     *  scatterers to the trajectory of the seed, in the order of the intersections of the seed.
+     */
+    void fillTrajectory(trajectory& traj, vector<Vector3D>& hits)
+    {
+        const trackParameters truth = trueParameters();
+        const vector<double> precision(2, 1. / (resolution * resolution));
+
+        hits.clear();
+
+        // the intersections are copied, since adding the measurements reuses the buffers of the trajectory
+        const IntersectionVec intersections = traj.getIntersectionsWithSurfaces();
+
+        for(unsigned i = 0 ; i < intersections.size() ; ++i)
+            {
+                const ISurface& surface = *intersections[i].second;
+
+                double s = 0.;
+                Vector3D xx;
+
+                if(!intersectWithSurface(&surface, truth.parameters(), truth.referencePoint(), s, xx, +1, true))
+                    continue;
+
+                const double du = resolution * (int((i * 7) % 11) - 5) / 5.;
+                const double dv = resolution * (int((i * 5) % 7) - 3) / 3.;
+
+                hits.push_back(xx + du * surface.u(xx) + dv * surface.v(xx));
+
+                traj.addMeasurement(hits.back(), precision, surface, 0, false);
+            }
+
+        traj.prepareForFitting();
+    }
+}
+
+
+
+fitLabelTest::fitLabelTest() : UnitTest("FitLabelTest", __FILE__)
+{
+}
+
+
+
+void fitLabelTest::_checkLabels(IFittingAlgorithm& fitter)
+{
+    SimpleGeometry& geo = barrelGeometry();
+
+    // the momentum at the measurements is computed with the global geometry
+    SimpleGeometry::installGlobal(&geo);
+
+    analyticalPropagation propagation;
+
+    trajectory traj(seedParameters(), &fitter, &propagation, &geo);
+
+    vector<Vector3D> hits;
+    fillTrajectory(traj, hits);
+
+    const ElementVec& elements = traj.trajectoryElements();
+
+    // the initial element and one element per hit
+    test_(hits.size() > 5);
+    test_(elements.size() == hits.size() + 1);
+
+    test_(traj.fit());
+
+    vector<fitResults> results;
+    test_(traj.getAllFitResults(results));
+
+    test_(results.size() == elements.size());
+
+    for(unsigned i = 0 ; i < results.size() && i < elements.size() ; ++i)
+        {
+            const trackParameters& fitted = results[i].estimatedParameters();
+
+            test_(results[i].areValid());
+
+            // the results are given at the reference point of the element, i.e. at its crossing
+            test_((fitted.referencePoint() - elements[i]->getTrackParameters()->referencePoint()).r() < 1e-9);
+
+            if(i > 0)
+                {
+                    test_((fitted.referencePoint() - elements[i]->crossing().point).r() < 1e-9);
+
+                    // the fitted track crosses the surface of the element at its hit
+                    double s = 0.;
+                    Vector3D xx;
+
+                    test_(intersectWithSurface(&elements[i]->surface(), fitted.parameters(), fitted.referencePoint(),
+                                               s, xx, 0, false));
+                    test_((xx - hits[i - 1]).r() < 5. * resolution);
+                }
+
+            // the single label gives the same results
+            const fitResults* single = traj.getFitResults(i);
+
+            test_(single != NULL);
+
+            if(single != NULL)
+                for(unsigned j = 0 ; j < 5 ; ++j)
+                    test_(single->estimatedParameters().parameters()(j) == fitted.parameters()(j));
+        }
+
+    // no results for labels without element
+    test_(traj.getFitResults(elements.size()) == NULL);
+    test_(traj.getFitResults(-1) == NULL);
+}
+
+
+
+void fitLabelTest::_testKalmanLabels()
+{
+    KalmanFitter fitter;
+
+    _checkLabels(fitter);
+}
+
+
+
+void fitLabelTest::_testGBLLabels()
+{
+#ifdef USE_GBL
+    GBLInterface fitter;
+
+    _checkLabels(fitter);
+#endif
+}
+
+
+
+void fitLabelTest::_testFitterAgreement()
+{
+#ifdef USE_GBL
+    SimpleGeometry& geo = barrelGeometry();
+
+    SimpleGeometry::installGlobal(&geo);
+
+    KalmanFitter kalman;
+    GBLInterface gbl;
+    analyticalPropagation propagation;
+
+    // the same trajectory is fitted with both fitters - without scatterers they fit the same model
+    trajectory traj(seedParameters(), &kalman, &propagation, &geo);
+
+    vector<Vector3D> hits;
+    fillTrajectory(traj, hits);
+
+    IFitOutput* kalmanOutput = kalman.fitTrajectory(traj);
+    IFitOutput* gblOutput = gbl.fitTrajectory(traj);
+
+    test_(kalmanOutput->isValid());
+    test_(gblOutput->isValid());
+    test_(kalmanOutput->ndf() == gblOutput->ndf());
+
+    vector<fitResults> kalmanResults;
+    vector<fitResults> gblResults;
+    kalmanOutput->getAllResults(kalmanResults);
+    gblOutput->getAllResults(gblResults);
+
+    test_(kalmanResults.size() == traj.trajectoryElements().size());
+    test_(gblResults.size() == kalmanResults.size());
+
+    for(unsigned i = 0 ; i < kalmanResults.size() && i < gblResults.size() ; ++i)
+        {
+            const trackParameters& tk = kalmanResults[i].estimatedParameters();
+            const trackParameters& tg = gblResults[i].estimatedParameters();
+
+            test_((tk.referencePoint() - tg.referencePoint()).r() < 1e-9);
+
+            // the Kalman filter starts with a wide but finite prior
+            for(unsigned j = 0 ; j < 5 ; ++j)
+                {
+                    const double sigma = sqrt(tg.covarianceMatrix()(j, j));
+
+                    test_(fabs(tk.parameters()(j) - tg.parameters()(j)) < 0.05 * sigma);
+                    test_(fabs(sqrt(tk.covarianceMatrix()(j, j)) - sigma) < 0.05 * sigma);
+                }
+        }
+
+    delete kalmanOutput;
+    delete gblOutput;
+#endif
+}
+
+
+
+void fitLabelTest::run()
+{
+    _testKalmanLabels();
+    _testGBLLabels();
+    _testFitterAgreement();
+}
@@ -0,0 +1,25 @@
+#ifndef FITLABELTEST_HH
+#define FITLABELTEST_HH
+
+/// the fit results at a label belong to the trajectory element with this index - for all fitters
+#include "IFittingAlgorithm.hh"
+
+#include "UnitTest.hh"
+
+class fitLabelTest : public UnitTesting::UnitTest
+{
+    public:
+        fitLabelTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testKalmanLabels();
+        void _testGBLLabels();
+        void _testFitterAgreement();
+
+        /// fit a track with the fitter and check the results at all labels against the elements
+        void _checkLabels(aidaTT::IFittingAlgorithm& fitter);
+};
+#endif // FITLABELTEST_HH
@@ -0,0 +1,209 @@
+#include "helixBatchTest.hh"
+#include "helixUtils.hh"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+using namespace aidaTT;
+
+helixBatchTest::helixBatchTest() : UnitTest("HelixBatchTest", __FILE__), _helices(), _hp(), _rp()
+{
+    // a fan of helices with both charges starting close to the origin
+    for(unsigned i = 0 ; i < 64 ; ++i)
+        {
+            const double omega = ( i % 2 ? 1. : -1. ) * ( 0.001 + 0.0005 * ( i % 7 ) );
+            const double phi0  = -M_PI + ( i + 0.5 ) * 2. * M_PI / 64.;
+            const double tanl  = -1.5 + 3. * ( i % 11 ) / 10.;
+
+            Vector5 hp(omega, tanl, phi0, 0.01 * ( i % 3 ), 0.1 * ( i % 5 ));
+            Vector3D rp(0.1, -0.2, 0.3);
+
+            _helices.push_back(hp, rp);
+            _hp.push_back(hp);
+            _rp.push_back(rp);
+        }
+}
+
+
+
+void helixBatchTest::_testCylinder()
+{
+    SimpleGeometry geo(3.5);
+    geo.addSurface(new SimpleCylinder(1, 50., 1000., 0.03));
+
+    const surfaceRecord& cyl = (*geo.getSurfaceRecords())[0];
+
+    helixBatchIntersections res;
+    intersectWithZCylinder(_helices, cyl, +1, true, res);
+
+    test_(res.size() == _helices.size());
+
+    for(unsigned i = 0 ; i < res.size() ; ++i)
+        {
+            test_(res.hit[i]);
+            test_(res.s[i] > 0.);
+
+            // the point is on the cylinder and on the helix
+            const Vector3D xx = res.point(i);
+            test_(roughFloatCompare(sqrt(xx.x() * xx.x() + xx.y() * xx.y()), 50.));
+            test_(roughFloatCompare((xx - pointAt(res.s[i], _hp[i], _rp[i])).r(), 0.));
+        }
+
+    // the negative solution is on the other side of the circle
+    intersectWithZCylinder(_helices, cyl, -1, true, res);
+    for(unsigned i = 0 ; i < res.size() ; ++i)
+        test_(res.hit[i] && res.s[i] < 0.);
+
+    // a cylinder that is too short in z
+    SimpleGeometry shortGeo(3.5);
+    shortGeo.addSurface(new SimpleCylinder(1, 50., 0.5, 0.03, SimpleMaterial::silicon(), 1000.5));
+
+    intersectWithZCylinder(_helices, (*shortGeo.getSurfaceRecords())[0], +1, true, res);
+    for(unsigned i = 0 ; i < res.size() ; ++i)
+        test_(! res.hit[i]);
+
+    // the batched functions only accept records of their type
+    bool thrown = false;
+    try
+        {
+            intersectWithZDisk(_helices, cyl, +1, true, res);
+        }
+    catch(std::invalid_argument&)
+        {
+            thrown = true;
+        }
+    test_(thrown);
+}
+
+
+
+void helixBatchTest::_testPlane()
+{
+    // plane at x = 30, u along y, v along z
+    SimpleGeometry geo(3.5);
+    geo.addSurface(new SimplePlane(1, Vector3D(30., 0., 0.), Vector3D(0., 1., 0.), Vector3D(0., 0., 1.), 2000., 2000., 0.03));
+
+    const surfaceRecord& plane = (*geo.getSurfaceRecords())[0];
+
+    helixBatchIntersections res;
+    intersectWithZPlane(_helices, plane, 0, true, res);
+
+    for(unsigned i = 0 ; i < res.size() ; ++i)
+        {
+            if(! res.hit[i])
+                continue;
+
+            const Vector3D xx = res.point(i);
+            test_(roughFloatCompare(xx.x(), 30.));
+            test_(roughFloatCompare((xx - pointAt(res.s[i], _hp[i], _rp[i])).r(), 0.));
+        }
+
+    // helices going in +x direction hit the plane at positive s
+    intersectWithZPlane(_helices, plane, +1, true, res);
+    test_(res.hit[32] && res.s[32] > 0.);
+}
+
+
+
+void helixBatchTest::_testDisk()
+{
+    SimpleGeometry geo(3.5);
+    geo.addSurface(new SimpleDisk(1, 40., 0., 1000., 0.03));
+
+    helixBatchIntersections res;
+    intersectWithZDisk(_helices, (*geo.getSurfaceRecords())[0], 0, true, res);
+
+    for(unsigned i = 0 ; i < res.size() ; ++i)
+        {
+            test_(res.hit[i] == (calculateTanLambda(_hp[i]) != 0.));
+
+            if(res.hit[i])
+                test_(roughFloatCompare((res.point(i) - pointAt(res.s[i], _hp[i], _rp[i])).r(), 0.));
+        }
+
+    // a disk with a hole: the batch agrees with the bounds check of the surface
+    SimpleGeometry ringGeo(3.5);
+    ringGeo.addSurface(new SimpleDisk(1, 40., 20., 30., 0.03));
+
+    const ISurface* ring = ringGeo.getSurfaces()[0];
+
+    intersectWithZDisk(_helices, (*ringGeo.getSurfaceRecords())[0], 0, true, res);
+
+    unsigned nInside = 0, nOutside = 0;
+
+    for(unsigned i = 0 ; i < res.size() ; ++i)
+        {
+            double s = 0.;
+            Vector3D xx;
+
+            const bool found = intersectWithZDisk(ring, _hp[i], _rp[i], s, xx, 0, true);
+
+            test_(bool(res.hit[i]) == found);
+
+            const bool crossesPlane = intersectWithZDisk(ring, _hp[i], _rp[i], s, xx, 0, false);
+
+            nInside  += ( found ? 1 : 0 );
+            nOutside += ( crossesPlane && ! found ? 1 : 0 );
+        }
+
+    test_(nInside > 0 && nOutside > 0);
+}
+
+
+
+void helixBatchTest::_testLayer()
+{
+    SimpleGeometry geo(3.5);
+    geo.addSurface(new SimpleCylinder(1, 80., 1000., 0.03));
+    geo.addSurface(new SimpleCylinder(2, 20., 1000., 0.03));
+
+    // the geometry sorts the cylinders in radius
+    const SurfaceRecords& records = *geo.getSurfaceRecords();
+
+    std::vector<const surfaceRecord*> layer;
+    layer.push_back(&records[1]);
+    layer.push_back(&records[0]);
+
+    test_(records[0].radius == 20.);
+
+    helixBatchIntersections res, scratch;
+    intersectWithLayer(_helices, layer, +1, true, res, scratch);
+
+    // the first crossing is always with the inner cylinder
+    for(unsigned i = 0 ; i < res.size() ; ++i)
+        test_(res.hit[i] && res.surface[i] == 1);
+
+    // other surface types are intersected helix by helix
+    SimpleGeometry coneGeo(3.5);
+    coneGeo.addSurface(new SimpleCone(1, 20., 30., 150., 60., 0.03));
+
+    const surfaceRecord& cone = (*coneGeo.getSurfaceRecords())[0];
+
+    test_(cone.type == surfaceRecord::Cone);
+
+    intersectWithSurface(_helices, cone, +1, true, res);
+
+    for(unsigned i = 0 ; i < res.size() ; ++i)
+        {
+            double s = 0.;
+            Vector3D xx;
+
+            const bool found = intersectWithSurface(cone, _hp[i], _rp[i], s, xx, +1, true);
+
+            test_(bool(res.hit[i]) == found);
+
+            if(found)
+                test_(roughFloatCompare(res.s[i], s));
+        }
+}
+
+
+
+void helixBatchTest::run()
+{
+    _testCylinder();
+    _testPlane();
+    _testDisk();
+    _testLayer();
+}
@@ -0,0 +1,29 @@
+#ifndef HELIXBATCHTEST_HH
+#define HELIXBATCHTEST_HH
+
+/// compare the batched helix intersections to the helix parametrization
+#include "helixBatch.hh"
+#include "SimpleGeometry.hh"
+
+#include "UnitTest.hh"
+#include <vector>
+
+class helixBatchTest : public UnitTesting::UnitTest
+{
+    public:
+        helixBatchTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testCylinder();
+        void _testPlane();
+        void _testDisk();
+        void _testLayer();
+
+        aidaTT::helixBatch _helices;
+        std::vector<aidaTT::Vector5> _hp;
+        std::vector<aidaTT::Vector3D> _rp;
+};
+#endif // HELIXBATCHTEST_HH
@@ -0,0 +1,121 @@
+#include "instrumentationTest.hh"
+
+#include "SimpleGeometry.hh"
+#include "helixUtils.hh"
+#include "aidaTT-Units.hh"
+
+#include <sstream>
+#include <thread>
+
+using namespace std;
+using namespace aidaTT;
+
+namespace
+{
+    /// intersect a 10 GeV track in the transverse plane with the cylinder nTimes
+    void intersectCylinder(const ISurface* cylinder, unsigned nTimes)
+    {
+        Vector5 hp;
+        hp(OMEGA) = convertBr2P_cm * 3.5 / 10.;
+        hp(TANL) = 0.;
+        hp(PHI0) = 0.3;
+        hp(D0) = 0.;
+        hp(Z0) = 0.;
+
+        double s = 0.;
+        Vector3D xx;
+
+        for(unsigned i = 0 ; i < nTimes ; ++i)
+            intersectWithSurface(cylinder, hp, Vector3D(), s, xx, 0, true);
+    }
+}
+
+
+
+instrumentationTest::instrumentationTest() : UnitTest("InstrumentationTest", __FILE__)
+{
+}
+
+
+
+void instrumentationTest::_testIntersections()
+{
+    const SimpleCylinder cylinder(1, 40., 100., 0.03);
+    const SimpleCylinder shortCylinder(2, 40., 10., 0.03, SimpleMaterial::silicon(), 50.);
+
+    Instrumentation::reset();
+
+    intersectCylinder(&cylinder, 10);
+    intersectCylinder(&shortCylinder, 3);
+
+    const InstrumentationSnapshot snap = Instrumentation::snapshot();
+    const stageStatistics& stats = snap[Instrumentation::IntersectZCylinder];
+
+    if(Instrumentation::enabled())
+        {
+            test_(stats.calls == 13);
+            test_(stats.failures == 3);
+            test_(stats.seconds > 0.);
+        }
+    else
+        {
+            test_(stats.calls == 0);
+            test_(stats.seconds == 0.);
+        }
+
+    test_(snap[Instrumentation::IntersectZPlane].calls == 0);
+
+    // nothing after the reset
+    Instrumentation::reset();
+    test_(Instrumentation::snapshot()[Instrumentation::IntersectZCylinder].calls == 0);
+}
+
+
+
+void instrumentationTest::_testThreads()
+{
+    const SimpleCylinder cylinder(1, 40., 100., 0.03);
+
+    Instrumentation::reset();
+
+    // the counters of finished threads are kept
+    thread first(intersectCylinder, &cylinder, 20);
+    thread second(intersectCylinder, &cylinder, 30);
+    first.join();
+    second.join();
+
+    intersectCylinder(&cylinder, 5);
+
+    const InstrumentationSnapshot snap = Instrumentation::snapshot();
+
+    test_(snap[Instrumentation::IntersectZCylinder].calls == (Instrumentation::enabled() ? 55u : 0u));
+    test_(snap.nThreads() >= (Instrumentation::enabled() ? 3u : 0u));
+}
+
+
+
+void instrumentationTest::_testOutput()
+{
+    const InstrumentationSnapshot snap = Instrumentation::snapshot();
+
+    stringstream table;
+    table << snap;
+
+    for(unsigned i = 0 ; i < Instrumentation::NStages ; ++i)
+        test_(table.str().find(Instrumentation::stageName(Instrumentation::Stage(i))) != string::npos);
+
+    stringstream json;
+    snap.writeJSON(json);
+
+    test_(json.str().find("\"stages\": [") != string::npos);
+    test_(json.str().find("\"name\": \"fitResults\"") != string::npos);
+}
+
+
+
+void instrumentationTest::run()
+{
+    _testIntersections();
+    _testThreads();
+    _testOutput();
+}
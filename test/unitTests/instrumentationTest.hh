@@ -0,0 +1,22 @@
+#ifndef INSTRUMENTATIONTEST_HH
+#define INSTRUMENTATIONTEST_HH
+
+/// the per stage counters of aidaTT::Instrumentation - with and without the instrumentation compiled in
+#include "Instrumentation.hh"
+
+#include "UnitTest.hh"
+
+class instrumentationTest : public UnitTesting::UnitTest
+{
+    public:
+        instrumentationTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testIntersections();
+        void _testThreads();
+        void _testOutput();
+};
+#endif // INSTRUMENTATIONTEST_HH
@@ -0,0 +1,369 @@
+#include "kalmanFitterTest.hh"
+
+#include "SimpleGeometry.hh"
+#include "analyticalPropagation.hh"
+#include "helixUtils.hh"
+#include "materialUtils.hh"
+#include "aidaTT-Units.hh"
+
+#include <cmath>
+#include <map>
+
+using namespace std;
+using namespace aidaTT;
+
+namespace
+{
+    const double bz = 3.5;
+    const double resolution = 0.005;
+    const double scattererRadius = 42.;
+
+    /// reproducible normal distributed numbers: linear congruential generator and Box-Muller
+    class gaussianSequence
+    {
+        public:
+            gaussianSequence() : _state(12345), _spare(0.), _hasSpare(false) {}
+
+            double next()
+            {
+                if(_hasSpare)
+                    {
+                        _hasSpare = false;
+                        return _spare;
+                    }
+
+                const double u1 = _uniform();
+                const double u2 = _uniform();
+
+                const double r = sqrt(-2. * log(u1));
+
+                _spare = r * sin(2. * M_PI * u2);
+                _hasSpare = true;
+
+                return r * cos(2. * M_PI * u2);
+            }
+
+        private:
+            /// uniform in (0,1]
+            double _uniform()
+            {
+                _state = _state * 6364136223846793005ULL + 1442695040888963407ULL;
+                return ((_state >> 11) + 1.) / 9007199254740992.;
+            }
+
+            unsigned long long _state;
+            double _spare;
+            bool _hasSpare;
+    };
+
+
+    /// a silicon barrel with a thick passive cylinder in between
+    SimpleGeometry& barrelGeometry(const ISurface*& scatterer)
+    {
+        static SimpleGeometry geo(bz);
+        static const ISurface* passive = 0;
+
+        if(geo.getSurfaces().empty())
+            {
+                vector<double> radii;
+                for(unsigned i = 0 ; i < 12 ; ++i)
+                    radii.push_back(5. + 15. * i);
+
+                geo.addBarrel(radii, 300., 0.03);
+
+                passive = geo.addSurface(new SimpleCylinder(geo.nextID(), scattererRadius, 300., 0.5));
+            }
+
+        scatterer = passive;
+
+        return geo;
+    }
+
+
+    /** The hits of the track with the true parameters hp (at the origin) on the measurement layers:
+     *  the track gets a kink at the scatterer with the multiple scattering angle of the material,
+     *  the hits are smeared with the resolution in u and v. No energy loss is simulated.
+     */
+    void simulateHits(const SimpleGeometry& geo, const ISurface* scatterer, const Vector5& hp,
+                      gaussianSequence& gauss, map<const ISurface*, Vector3D>& hits)
+    {
+        hits.clear();
+
+        const Vector3D origin;
+
+        double s = 0.;
+        Vector3D xx;
+
+        // the helix after the scatterer, with the crossing point as reference point
+        Vector5 hpOut(hp);
+        Vector3D rpOut;
+
+        if(intersectWithSurface(scatterer, hp, origin, s, xx, +1, true))
+            {
+                const double theta0 = computeQMS(scatterer, hp, origin, pionMass);
+
+                // moved to the crossing point with d0 = z0 = 0
+                const Vector3D t = calculateTangent(s, hp);
+
+                const double lambda = asin(t.z());
+                const double newLambda = lambda + theta0 * gauss.next();
+
+                hpOut(OMEGA) = hp(OMEGA) * cos(lambda) / cos(newLambda);
+                hpOut(TANL) = tan(newLambda);
+                hpOut(PHI0) = atan2(t.y(), t.x()) + theta0 * gauss.next() / cos(lambda);
+                hpOut(D0) = 0.;
+                hpOut(Z0) = 0.;
+
+                rpOut = xx;
+            }
+
+        const vector<const ISurface*>& surfaces = geo.getSurfaces();
+
+        for(unsigned i = 0 ; i < surfaces.size() ; ++i)
+            {
+                const ISurface* surf = surfaces[i];
+
+                if(surf == scatterer)
+                    continue;
+
+                // the layers outside of the scatterer enclose its crossing point
+                const bool outside = surf->distance(rpOut) < 0.;
+
+                const bool found = (outside ?
+                                    intersectWithSurface(surf, hpOut, rpOut, s, xx, +1, true) :
+                                    intersectWithSurface(surf, hp, origin, s, xx, +1, true));
+                if(!found)
+                    continue;
+
+                const double du = resolution * gauss.next();
+                const double dv = resolution * gauss.next();
+
+                hits[surf] = xx + du * surf->u(xx) + dv * surf->v(xx);
+            }
+    }
+
+
+    /// the measurements of the hits and the scatterer in the order of the intersections of the seed
+    void fillTrajectory(trajectory& traj, const ISurface* scatterer, const map<const ISurface*, Vector3D>& hits)
+    {
+        const vector<double> precision(2, 1. / (resolution * resolution));
+
+        const IntersectionVec intersections = traj.getIntersectionsWithSurfaces();
+
+        for(unsigned i = 0 ; i < intersections.size() ; ++i)
+            {
+                const ISurface* surf = intersections[i].second;
+
+                if(surf == scatterer)
+                    {
+                        traj.addScatterer(*surf);
+                        continue;
+                    }
+
+                map<const ISurface*, Vector3D>::const_iterator it = hits.find(surf);
+
+                if(it != hits.end())
+                    traj.addMeasurement(it->second, precision, *surf, 0, false);
+            }
+
+        traj.prepareForFitting();
+    }
+
+
+    /// the true parameters of the i-th track
+    Vector5 trueParameters(unsigned i)
+    {
+        const double pt = 5. + 5. * (i % 4);
+
+        Vector5 hp;
+        hp(OMEGA) = (i % 2 == 0 ? 1. : -1.) * convertBr2P_cm * bz / pt;
+        hp(TANL) = -0.5 + 0.1 * (i % 11);
+        hp(PHI0) = -3. + 0.03 * i;
+        hp(D0) = 0.002 * (int(i % 5) - 2);
+        hp(Z0) = 0.003 * (int(i % 3) - 1);
+
+        return hp;
+    }
+
+
+    /// the seed is displaced from the truth by much less than the resolution of the fit
+    trackParameters seedParameters(const Vector5& truth)
+    {
+        Vector5 hp(truth);
+        hp(OMEGA) *= 1.002;
+        hp(TANL) += 2.e-4;
+        hp(PHI0) -= 2.e-4;
+        hp(D0) += 0.003;
+        hp(Z0) -= 0.003;
+
+        fiveByFiveMatrix covariance;
+        covariance.Unit();
+
+        trackParameters tp;
+        tp.setTrackParameters(hp, covariance, Vector3D());
+
+        return tp;
+    }
+}
+
+
+
+kalmanFitterTest::kalmanFitterTest() : UnitTest("KalmanFitterTest", __FILE__)
+{
+}
+
+
+
+void kalmanFitterTest::_testSmearedTracks()
+{
+    const ISurface* scatterer = 0;
+    SimpleGeometry& geo = barrelGeometry(scatterer);
+
+    // the momentum at the measurements is computed with the global geometry
+    SimpleGeometry::installGlobal(&geo);
+
+    KalmanFitter fitter;
+    analyticalPropagation propagation;
+
+    gaussianSequence gauss;
+    map<const ISurface*, Vector3D> hits;
+
+    const unsigned nTracks = 200;
+
+    unsigned nValid = 0;
+    double sumChi2 = 0.;
+    double sumNdf = 0.;
+    double sumPull2[5] = { 0., 0., 0., 0., 0. };
+    unsigned nLargePulls = 0;
+
+    for(unsigned i = 0 ; i < nTracks ; ++i)
+        {
+            const Vector5 truth = trueParameters(i);
+
+            simulateHits(geo, scatterer, truth, gauss, hits);
+
+            trajectory traj(seedParameters(truth), &fitter, &propagation, &geo);
+            fillTrajectory(traj, scatterer, hits);
+
+            // one element at the start, one per hit and the scatterer
+            test_(traj.trajectoryElements().size() == hits.size() + 2);
+
+            if(!traj.fit())
+                continue;
+
+            ++nValid;
+
+            const IFitOutput& output = *traj.fitOutput();
+
+            test_(output.ndf() == 2 * hits.size() - 5);
+
+            sumChi2 += output.chiSquare();
+            sumNdf += output.ndf();
+
+            const fitResults* result = traj.getFitResults(0);
+
+            if(result == NULL)
+                continue;
+
+            const trackParameters fitted = result->estimatedParameters();
+
+            for(unsigned j = 0 ; j < 5 ; ++j)
+                {
+                    const double pull = (fitted.parameters()(j) - truth(j)) / sqrt(fitted.covarianceMatrix()(j, j));
+
+                    sumPull2[j] += pull * pull;
+
+                    if(!(fabs(pull) < 5.))
+                        ++nLargePulls;
+                }
+        }
+
+    test_(nValid == nTracks);
+    test_(nLargePulls == 0);
+
+    // the chi2 follows the ndf and the errors describe the deviations from the truth
+    const double chi2PerNdf = sumChi2 / sumNdf;
+    test_(chi2PerNdf > 0.85 && chi2PerNdf < 1.15);
+
+    for(unsigned j = 0 ; j < 5 ; ++j)
+        {
+            const double rmsPull = sqrt(sumPull2[j] / nValid);
+            test_(rmsPull > 0.8 && rmsPull < 1.2);
+        }
+}
+
+
+
+void kalmanFitterTest::_testOutputReuse()
+{
+    const ISurface* scatterer = 0;
+    SimpleGeometry& geo = barrelGeometry(scatterer);
+
+    SimpleGeometry::installGlobal(&geo);
+
+    KalmanFitter fitter;
+    analyticalPropagation propagation;
+
+    gaussianSequence gauss;
+    map<const ISurface*, Vector3D> hits;
+
+    // an output of a track with more elements is reused for a shorter track
+    const Vector5 first = trueParameters(3);
+    Vector5 second = trueParameters(8);
+    second(TANL) = 2.5;
+
+    simulateHits(geo, scatterer, first, gauss, hits);
+    trajectory longTrack(seedParameters(first), &fitter, &propagation, &geo);
+    fillTrajectory(longTrack, scatterer, hits);
+
+    simulateHits(geo, scatterer, second, gauss, hits);
+    trajectory shortTrack(seedParameters(second), &fitter, &propagation, &geo);
+    fillTrajectory(shortTrack, scatterer, hits);
+
+    test_(shortTrack.trajectoryElements().size() < longTrack.trajectoryElements().size());
+
+    IFitOutput* output = fitter.fitTrajectory(longTrack);
+    test_(output->isValid());
+    test_(output->getResults(0) != NULL);
+
+    IFitOutput* reused = fitter.fitTrajectory(shortTrack, output);
+    IFitOutput* fresh = fitter.fitTrajectory(shortTrack);
+
+    // the memory of the output is reused
+    test_(reused == output);
+
+    test_(reused->isValid() == fresh->isValid());
+    test_(reused->ndf() == fresh->ndf());
+    test_(floatCompare(reused->chiSquare(), fresh->chiSquare()));
+
+    // no results of the previous fit are left over
+    test_(reused->getResults(shortTrack.trajectoryElements().size()) == NULL);
+
+    vector<fitResults> reusedResults;
+    vector<fitResults> freshResults;
+    reused->getAllResults(reusedResults);
+    fresh->getAllResults(freshResults);
+
+    test_(reusedResults.size() == shortTrack.trajectoryElements().size());
+    test_(reusedResults.size() == freshResults.size());
+
+    for(unsigned i = 0 ; i < reusedResults.size() && i < freshResults.size() ; ++i)
+        {
+            const trackParameters tr = reused->getResults(i)->estimatedParameters();
+            const trackParameters tf = freshResults[i].estimatedParameters();
+
+            for(unsigned j = 0 ; j < 5 ; ++j)
+                test_(floatCompare(tr.parameters()(j), tf.parameters()(j)));
+        }
+
+    delete reused;
+    delete fresh;
+}
+
+
+
+void kalmanFitterTest::run()
+{
+    _testSmearedTracks();
+    _testOutputReuse();
+}
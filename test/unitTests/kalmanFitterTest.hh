@@ -0,0 +1,21 @@
+#ifndef KALMANFITTERTEST_HH
+#define KALMANFITTERTEST_HH
+
+/// fits of simulated tracks with the KalmanFitter: parameters against the truth and the chi2 distribution
+#include "KalmanFitter.hh"
+
+#include "UnitTest.hh"
+
+class kalmanFitterTest : public UnitTesting::UnitTest
+{
+    public:
+        kalmanFitterTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testSmearedTracks();
+        void _testOutputReuse();
+};
+#endif // KALMANFITTERTEST_HH
@@ -0,0 +1,240 @@
+#ifdef USE_LCIO
+
+#include "lcioConversionTest.hh"
+
+#include "helixUtils.hh"
+#include "aidaTT-Units.hh"
+#include "UTIL/ILDConf.h"
+
+#include <cmath>
+
+using namespace std;
+using namespace aidaTT;
+
+namespace
+{
+    /// the start parameters of the test tracks - 2 GeV in 3.5 T
+    trackParameters testParameters()
+    {
+        Vector5 hp;
+        hp(OMEGA) = convertBr2P_cm * 3.5 / 2.;
+        hp(TANL) = 0.3;
+        hp(PHI0) = 0.5;
+        hp(D0) = 0.;
+        hp(Z0) = 0.;
+
+        trackParameters tp(hp, Vector3D());
+        tp.covarianceMatrix().Unit();
+
+        return tp;
+    }
+
+
+    /// a planar hit with 10 micron errors at the position [cm]
+    IMPL::TrackerHitPlaneImpl* createHit(int cellID, const Vector3D& xx)
+    {
+        IMPL::TrackerHitPlaneImpl* hit = new IMPL::TrackerHitPlaneImpl();
+
+        const double pos[3] = { xx.x() / mm, xx.y() / mm, xx.z() / mm };
+
+        hit->setCellID0(cellID);
+        hit->setPosition(pos);
+        hit->setdU(0.01);
+        hit->setdV(0.01);
+
+        return hit;
+    }
+}
+
+
+
+lcioConversionTest::lcioConversionTest() : UnitTest("LCIOConversionTest", __FILE__), _geometry(3.5),
+    _hits(EVENT::LCIO::TRACKERHITPLANE), _tracks(EVENT::LCIO::TRACK)
+{
+    vector<double> radii;
+    for(unsigned i = 0 ; i < 5 ; ++i)
+        radii.push_back(10. + 10. * i);
+
+    _geometry.addBarrel(radii, 100., 0.03);
+
+    _tracks.addElement(_createTrack(testParameters()));
+
+    // a track without a track state
+    IMPL::TrackImpl* noState = new IMPL::TrackImpl();
+    noState->addHit(static_cast<EVENT::TrackerHit*>(_hits[0]));
+    _tracks.addElement(noState);
+}
+
+
+
+IMPL::TrackImpl* lcioConversionTest::_createTrack(const trackParameters& tp)
+{
+    IMPL::TrackImpl* track = new IMPL::TrackImpl();
+
+    IMPL::TrackStateImpl* ts = createLCIO(tp);
+    ts->setLocation(EVENT::TrackState::AtIP);
+    track->addTrackState(ts);
+
+    const vector<const ISurface*>& surfaces = _geometry.getSurfaces();
+
+    IMPL::TrackerHitPlaneImpl* spacePoint = new IMPL::TrackerHitPlaneImpl();
+    spacePoint->setType(1 << UTIL::ILDTrkHitTypeBit::COMPOSITE_SPACEPOINT);
+
+    for(unsigned i = 0 ; i < surfaces.size() ; ++i)
+        {
+            double s = 0.;
+            Vector3D xx;
+
+            intersectWithSurface(surfaces[i], tp, s, xx, 0, true);
+
+            IMPL::TrackerHitPlaneImpl* hit = createHit(surfaces[i]->id(), xx);
+            _hits.addElement(hit);
+
+            // the strip hits of the outer two layers are combined to a space point
+            if(i < 3)
+                track->addHit(hit);
+            else
+                spacePoint->rawHits().push_back(hit);
+        }
+
+    _hits.addElement(spacePoint);
+    track->addHit(spacePoint);
+
+    // a hit on a surface that is not in the geometry
+    IMPL::TrackerHitPlaneImpl* unknown = createHit(123456, Vector3D(0., 70., 0.));
+    _hits.addElement(unknown);
+    track->addHit(unknown);
+
+    track->subdetectorHitNumbers().assign(4, 0);
+    track->subdetectorHitNumbers()[0] = 6;
+
+    return track;
+}
+
+
+
+void lcioConversionTest::_testReadTracks()
+{
+    LCIOTrackConverter converter(_geometry);
+
+    const vector<const ISurface*>& surfaces = _geometry.getSurfaces();
+
+    for(unsigned i = 0 ; i < surfaces.size() ; ++i)
+        test_(converter.findSurface(surfaces[i]->id()) == surfaces[i]);
+
+    test_(converter.findSurface(123456) == 0);
+
+    vector<lcioTrackInput> inputs;
+
+    test_(converter.readLCIO(&_tracks, inputs) == 2);
+    test_(inputs.size() == 2);
+
+    const lcioTrackInput& input = inputs[0];
+
+    test_(input.track == _tracks[0]);
+    test_(input.hasStartParameters);
+    test_(! inputs[1].hasStartParameters);
+    test_(inputs[1].size() == 1);
+
+    // the space point is replaced by its two strip hits
+    test_(input.size() == 6);
+    test_(input.surfaces.size() == 6);
+    test_(input.positions.size() == 6);
+    test_(input.precisions.size() == 12);
+    test_(input.nMissingSurfaces == 1);
+    test_(input.surfaces[5] == 0);
+
+    const trackParameters tp = testParameters();
+
+    test_(floatCompare(input.startParameters.parameters()(OMEGA), tp.parameters()(OMEGA)));
+    test_(floatCompare(input.startParameters.parameters()(PHI0), tp.parameters()(PHI0)));
+
+    for(unsigned i = 0 ; i < 5 ; ++i)
+        {
+            test_(input.surfaces[i] == surfaces[i]);
+            test_(fabs(input.surfaces[i]->distance(input.positions[i])) < 1.e-6);
+            // the errors are stored as float
+            test_(fabs(input.precisions[2 * i] * (0.01 * mm * 0.01 * mm) - 1.) < 1.e-6);
+            test_(fabs(input.precisions[2 * i + 1] * (0.01 * mm * 0.01 * mm) - 1.) < 1.e-6);
+        }
+
+    // the buffers are reused
+    const EVENT::TrackerHit* const* hitBuffer = &inputs[0].hits[0];
+
+    test_(converter.readLCIO(&_tracks, inputs) == 2);
+    test_(&inputs[0].hits[0] == hitBuffer);
+    test_(inputs[0].size() == 6);
+}
+
+
+
+void lcioConversionTest::_testFillTrajectory()
+{
+    LCIOTrackConverter converter(_geometry);
+
+    lcioTrackInput input;
+    test_(converter.readLCIO(static_cast<const EVENT::Track*>(_tracks[0]), input));
+
+    // the momentum of the measurements is computed in the field of the global geometry
+    SimpleGeometry::installGlobal(&_geometry);
+
+    trajectory traj(input.startParameters, &_geometry);
+
+    test_(converter.fillTrajectory(input, traj, true) == 5);
+
+    // the initial element and the measurements
+    test_(traj.trajectoryElements().size() == 6);
+
+    unsigned nMeasurements = 0;
+
+    for(unsigned i = 0 ; i < traj.trajectoryElements().size() ; ++i)
+        if(traj.trajectoryElements()[i]->hasMeasurement())
+            ++nMeasurements;
+
+    test_(nMeasurements == 5);
+}
+
+
+
+void lcioConversionTest::_testWriteTracks()
+{
+    LCIOTrackConverter converter(_geometry);
+
+    const trackParameters tp = testParameters();
+    const EVENT::Track* input = static_cast<const EVENT::Track*>(_tracks[0]);
+
+    IMPL::LCCollectionVec* col = LCIOTrackConverter::createTrackCollection(2);
+
+    test_(col->getTypeName() == EVENT::LCIO::TRACK);
+    test_(col->capacity() >= 2);
+
+    col->addElement(converter.createLCIO(fitResults(true, 12.5, 7, 0., tp), input));
+
+    const EVENT::Track* track = static_cast<const EVENT::Track*>(col->getElementAt(0));
+
+    test_(floatCompare(track->getChi2(), 12.5));
+    test_(track->getNdf() == 7);
+    test_(track->getTrackerHits().size() == input->getTrackerHits().size());
+    test_(track->getSubdetectorHitNumbers().size() == 4);
+    test_(track->getSubdetectorHitNumbers()[0] == 6);
+
+    const EVENT::TrackState* ts = track->getTrackState(EVENT::TrackState::AtIP);
+
+    test_(ts != 0);
+
+    if(ts != 0)
+        test_(floatCompare(ts->getOmega(), input->getTrackState(EVENT::TrackState::AtIP)->getOmega()));
+
+    delete col;
+}
+
+
+
+void lcioConversionTest::run()
+{
+    _testReadTracks();
+    _testFillTrajectory();
+    _testWriteTracks();
+}
+
+#endif // USE_LCIO
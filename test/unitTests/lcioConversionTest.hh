@@ -0,0 +1,39 @@
+#ifdef USE_LCIO
+
+#ifndef LCIOCONVERSIONTEST_HH
+#define LCIOCONVERSIONTEST_HH
+
+/// convert LCIO tracks with hits on a SimpleGeometry to the fit input and back
+
+#include "AidaTT.hh"
+#include "SimpleGeometry.hh"
+#include "lcio.h"
+#include "IMPL/TrackImpl.h"
+#include "IMPL/TrackerHitPlaneImpl.h"
+#include "IMPL/LCCollectionVec.h"
+#include "UnitTest.hh"
+#include "LCIOPersistency.hh"
+
+class lcioConversionTest : public UnitTesting::UnitTest
+{
+    public:
+        lcioConversionTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testReadTracks();
+        void _testFillTrajectory();
+        void _testWriteTracks();
+
+        /// a track with hits at the intersections of the helix with the barrel, the last hit is a space point
+        IMPL::TrackImpl* _createTrack(const aidaTT::trackParameters& tp);
+
+        aidaTT::SimpleGeometry _geometry;
+        IMPL::LCCollectionVec _hits;
+        IMPL::LCCollectionVec _tracks;
+};
+#endif // LCIOCONVERSIONTEST_HH
+
+#endif // USE_LCIO
@@ -0,0 +1,314 @@
+#include "materialCacheTest.hh"
+
+#include "SimpleGeometry.hh"
+#include "betheBlochTable.hh"
+#include "trajectory.hh"
+#include "helixUtils.hh"
+#include "aidaTT-Units.hh"
+
+#include <cmath>
+
+using namespace std;
+using namespace aidaTT;
+
+namespace
+{
+    /// the analytic Bethe-Bloch formula as copied from KalTest - the reference for the precomputed constants
+    double referenceBetheBloch(const IMaterial& mat, double mom, double mass)
+    {
+        static const double kK   = 0.307075e-3;
+        static const double kMe  = 0.510998902e-3;
+
+        double dnsty = mat.density();
+        double A     = mat.A();
+        double Z     = mat.Z();
+        double I    = (9.76 * Z + 58.8 * pow(Z, -0.19)) * 1.e-9;
+        double hwp  = 28.816 * sqrt(dnsty * Z / A) * 1.e-9;
+        double bg2  = (mom * mom) / (mass * mass);
+        double gm2  = 1. + bg2;
+        double meM  = kMe / mass;
+        double x    = log10(sqrt(bg2));
+        double C0   = - (2. * log(I / hwp) + 1.);
+        double a    = -C0 / 27.;
+        double del;
+        if(x >= 3.)                del = 4.606 * x + C0;
+        else if(0. <= x && x < 3.) del = 4.606 * x + C0 + a * pow(3. - x, 3.);
+        else                       del = 0.;
+        double tmax = 2.*kMe * bg2 / (1. + meM * (2.*sqrt(gm2) + meM));
+
+        return kK * Z / A * gm2 / bg2 * (0.5 * log(2.*kMe * bg2 * tmax / (I * I)) - bg2 / gm2 - del);
+    }
+
+
+    bool relativeCompare(double x1, double x2, double epsilon = 1.e-10)
+    {
+        return fabs(x1 - x2) <= epsilon * max(fabs(x1), fabs(x2));
+    }
+}
+
+
+
+materialCacheTest::materialCacheTest() : UnitTest("MaterialCacheTest", __FILE__)
+{
+}
+
+
+
+void materialCacheTest::_testBetheBloch()
+{
+    const IMaterial* materials[] = { &SimpleMaterial::silicon(), &SimpleMaterial::tpcGas(), &SimpleMaterial::air() };
+    const double masses[] = { 0.000510998902, 0.105658, pionMass, 0.938272 };
+
+    for(unsigned i = 0 ; i < 3 ; ++i)
+        {
+            const materialLayer layer(*materials[i], 1.);
+
+            for(unsigned j = 0 ; j < 4 ; ++j)
+                for(double mom = 0.05 ; mom < 500. ; mom *= 1.7)
+                    {
+                        const double reference = referenceBetheBloch(*materials[i], mom, masses[j]);
+
+                        test_(relativeCompare(computeBetheBloch(layer, mom, masses[j]), reference));
+                        test_(relativeCompare(computeBetheBloch(*materials[i], mom, masses[j]), reference));
+                    }
+        }
+}
+
+
+
+void materialCacheTest::_testMaterialEffects()
+{
+    const SimpleCylinder cylinder(1, 40., 100., 0.03);
+    const surfaceMaterial material(cylinder);
+
+    test_(material.surface == &cylinder);
+    test_(floatCompare(material.thickness, 0.03));
+    test_(floatCompare(material.X0eff, 1. / 9.37));
+    test_(floatCompare(material.inner.thickness, 0.015));
+
+    for(unsigned i = 0 ; i < 10 ; ++i)
+        {
+            // crossing under different angles
+            const double theta = 0.1 + 0.15 * i;
+            const double mom = 0.3 + 2. * i;
+
+            const Vector3D xx(0., 40., 10.);
+            const Vector3D p(mom * sin(theta), mom * cos(theta), 0.3 * mom);
+            const Vector2D uv = cylinder.globalToLocal(xx);
+
+            const double cosTrk = fabs(p.unit() * cylinder.normal(xx));
+
+            test_(relativeCompare(computeQMS(material, cosTrk, p.r(), pionMass), computeQMS(&cylinder, uv, p, pionMass)));
+
+            double e0 = 0., b0 = 0., e1 = 0., b1 = 0.;
+            const double deltaE = computeEnergyLoss(material, cosTrk, p.r(), e0, b0, pionMass);
+
+            test_(relativeCompare(deltaE, computeEnergyLoss(&cylinder, uv, p, e1, b1, pionMass)));
+            test_(relativeCompare(e0, e1));
+            test_(relativeCompare(b0, b1));
+        }
+
+    // no material without thickness
+    const SimpleCylinder empty(2, 40., 100., 0.);
+    test_(computeQMS(surfaceMaterial(empty), 1., 1., pionMass) == 0.);
+}
+
+
+
+void materialCacheTest::_testCache()
+{
+    SimpleGeometry geo(3.5);
+
+    vector<double> radii;
+    for(unsigned i = 0 ; i < 10 ; ++i)
+        radii.push_back(5. + 10. * i);
+
+    geo.addBarrel(radii, 100., 0.03);
+    geo.addTPC(50, 110., 180., 235.);
+
+    // a surface with an id that is used already
+    const ISurface* duplicate = geo.addSurface(new SimpleCylinder(3, 200., 100., 0.1));
+
+    const vector<const ISurface*>& surfaces = geo.getSurfaces();
+
+    for(unsigned i = 0 ; i < surfaces.size() ; ++i)
+        {
+            const surfaceMaterial* material = geo.getSurfaceMaterial(surfaces[i]);
+
+            test_(material != NULL);
+
+            if(material != NULL)
+                {
+                    test_(material->surface == surfaces[i]);
+                    test_(material->id == surfaces[i]->id());
+                }
+        }
+
+    test_(floatCompare(geo.getSurfaceMaterial(duplicate)->thickness, 0.1));
+
+    // not in the geometry
+    const SimpleCylinder other(1, 40., 100., 0.03);
+    test_(geo.getSurfaceMaterial(&other) == NULL);
+
+    MaterialCache cache;
+    test_(cache.size() == 0);
+    test_(cache.find(&other) == NULL);
+
+    cache.build(surfaces);
+    test_(cache.size() == surfaces.size());
+}
+
+
+
+void materialCacheTest::_testTabulation()
+{
+    SimpleGeometry geo(3.5);
+
+    vector<double> radii;
+    radii.push_back(5.);
+    radii.push_back(15.);
+
+    geo.addBarrel(radii, 100., 0.03);
+    geo.addTPC(10, 110., 180., 235.);
+
+    const vector<const ISurface*>& surfaces = geo.getSurfaces();
+
+    vector<double> masses;
+    masses.push_back(pionMass);
+    masses.push_back(0.938272);
+
+    MaterialCache cache;
+    cache.build(surfaces);
+    test_(cache.nTables() == 0);
+
+    // silicon and the TPC gas
+    cache.tabulate(masses, BetheBlochTable::defaultBinsPerDecade);
+    test_(cache.nTables() == 2);
+
+    const surfaceMaterial* silicon = cache.find(surfaces[0]);
+    const BetheBlochTable* table = silicon->inner.table;
+
+    test_(table != NULL);
+    test_(silicon->outer.table == table);
+    test_(table->maxRelativeError() > 0. && table->maxRelativeError() < 3.e-5);
+
+    for(unsigned j = 0 ; j < masses.size() ; ++j)
+        for(double bg = 0.1 ; bg < 1.e5 ; bg *= 1.13)
+            {
+                double dedx = 0.;
+                const double mom = bg * masses[j];
+
+                test_(table->dEdx(mom, masses[j], dedx));
+                test_(relativeCompare(dedx, computeBetheBloch(silicon->inner, mom, masses[j]), 3.e-5));
+
+                // the energy loss on the surface is interpolated as well
+                double e0 = 0., b0 = 0., e1 = 0., b1 = 0.;
+                const double deltaE = computeEnergyLoss(*silicon, 0.8, mom, e0, b0, masses[j]);
+
+                test_(relativeCompare(deltaE, computeEnergyLoss(surfaces[0], Vector2D(), Vector3D(mom, 0., 0.), e1, b1, masses[j]) / 0.8, 3.e-5));
+            }
+
+    // the kinks of the density effect are nodes of the table
+    double dedx = 0.;
+    test_(table->dEdx(pionMass, pionMass, dedx));
+    test_(relativeCompare(dedx, computeBetheBloch(silicon->inner, pionMass, pionMass)));
+
+    // out of range or not tabulated
+    test_(!table->dEdx(0.05 * pionMass, pionMass, dedx));
+    test_(!table->dEdx(2.e5 * pionMass, pionMass, dedx));
+    test_(!table->dEdx(1., 0.105658, dedx));
+
+    // the analytic formula is used instead
+    double e0 = 0., b0 = 0.;
+    const surfaceMaterial plain(*surfaces[0]);
+    test_(relativeCompare(computeEnergyLoss(*silicon, 1., 1., e0, b0, 0.105658), computeEnergyLoss(plain, 1., 1., e0, b0, 0.105658)));
+
+    // the tables are kept when the cache is rebuilt
+    cache.build(surfaces);
+    test_(cache.nTables() == 2);
+    test_(cache.find(surfaces[0])->inner.table != NULL);
+
+    cache.tabulate(vector<double>(), BetheBlochTable::defaultBinsPerDecade);
+    test_(cache.nTables() == 0);
+    test_(cache.find(surfaces[0])->inner.table == NULL);
+
+    // and in the geometry
+    geo.tabulateEnergyLoss(masses);
+    test_(geo.getSurfaceMaterial(surfaces[0])->inner.table != NULL);
+}
+
+
+
+void materialCacheTest::_testCrossings()
+{
+    // the momentum of the track parameters is computed with the field of the global geometry
+    static SimpleGeometry geo(3.5);
+
+    if(geo.getSurfaces().empty())
+        {
+            vector<double> radii;
+            for(unsigned i = 0 ; i < 8 ; ++i)
+                radii.push_back(5. + 10. * i);
+
+            geo.addBarrel(radii, 100., 0.03);
+        }
+
+    SimpleGeometry::installGlobal(&geo);
+
+    Vector5 hp;
+    hp(OMEGA) = convertBr2P_cm * 3.5 / 1.2;
+    hp(TANL) = 0.5;
+    hp(PHI0) = 0.3;
+    hp(D0) = 0.;
+    hp(Z0) = 0.;
+
+    fiveByFiveMatrix covariance;
+    covariance.Unit();
+
+    trackParameters tp;
+    tp.setTrackParameters(hp, covariance, Vector3D());
+
+    trajectory traj(tp, &geo);
+
+    const vector<const ISurface*>& surfaces = geo.getSurfaces();
+
+    for(unsigned i = 0 ; i < surfaces.size() ; ++i)
+        traj.addScatterer(*surfaces[i]);
+
+    const ElementVec& elements = traj.trajectoryElements();
+
+    // the initial element has no surface
+    test_(elements.size() == surfaces.size() + 1);
+    test_(!elements[0]->crossing().valid);
+
+    for(unsigned i = 1 ; i < elements.size() ; ++i)
+        {
+            const trajectoryElement& element = *elements[i];
+            const surfaceCrossing& crossing = element.crossing();
+
+            test_(crossing.valid);
+            test_(fabs(element.surface().distance(crossing.point)) < 1.e-6);
+            test_(floatCompare(crossing.direction.r(), 1.));
+            test_(floatCompare(crossing.cosIncidence, fabs(crossing.direction * element.surface().normal(crossing.point))));
+
+            // the momentum is the one of the track parameters of the element, i.e. after the energy loss
+            test_(relativeCompare(crossing.momentum.r(), momentumAtPCA(*element.getTrackParameters()).r()));
+
+            // the energy loss from the crossing is the one from a new intersection of the track parameters
+            double e0 = 0., b0 = 0., e1 = 0., b1 = 0.;
+            const double deltaE = computeEnergyLoss(&element.surface(), crossing.uv, crossing.momentum, e0, b0, pionMass);
+
+            test_(relativeCompare(deltaE, computeEnergyLoss(&element.surface(), *element.getTrackParameters(), e1, b1, pionMass), 1.e-8));
+        }
+}
+
+
+
+void materialCacheTest::run()
+{
+    _testBetheBloch();
+    _testMaterialEffects();
+    _testCache();
+    _testTabulation();
+    _testCrossings();
+}
@@ -0,0 +1,24 @@
+#ifndef MATERIALCACHETEST_HH
+#define MATERIALCACHETEST_HH
+
+/// the precomputed material constants of the surfaces (MaterialCache) and the material effects computed from them
+#include "materialUtils.hh"
+
+#include "UnitTest.hh"
+
+class materialCacheTest : public UnitTesting::UnitTest
+{
+    public:
+        materialCacheTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testBetheBloch();
+        void _testMaterialEffects();
+        void _testCache();
+        void _testTabulation();
+        void _testCrossings();
+};
+#endif // MATERIALCACHETEST_HH
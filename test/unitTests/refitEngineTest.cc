@@ -0,0 +1,322 @@
+#include "refitEngineTest.hh"
+
+#include "SimpleGeometry.hh"
+#include "KalmanFitter.hh"
+#include "analyticalPropagation.hh"
+#include "trajectory.hh"
+#include "helixUtils.hh"
+#include "aidaTT-Units.hh"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+using namespace aidaTT;
+
+namespace
+{
+    const double bz = 3.5;
+    const double resolution = 0.001;
+
+    /// the z0 of the track that the throwingFitter refuses to fit
+    const double throwZ0 = 0.0123;
+
+
+    /// a silicon barrel and a TPC - tracks have from a few up to about 230 hits
+    SimpleGeometry& trackerGeometry()
+    {
+        static SimpleGeometry geo(bz);
+
+        if(geo.getSurfaces().empty())
+            {
+                vector<double> radii;
+                for(unsigned i = 0 ; i < 6 ; ++i)
+                    radii.push_back(5. + 5. * i);
+
+                geo.addBarrel(radii, 150., 0.03);
+                geo.addTPC(220, 40., 180., 235.);
+            }
+
+        return geo;
+    }
+
+
+    /// the start parameters of the i-th track - the tracks differ in phi0
+    trackParameters seedParameters(unsigned i, double z0 = 0.)
+    {
+        Vector5 hp;
+        hp(OMEGA) = (i % 2 == 0 ? 1. : -1.) * convertBr2P_cm * bz / (2. + 0.5 * (i % 7));
+        hp(TANL) = -0.4 + 0.1 * (i % 9);
+        hp(PHI0) = -3. + 0.13 * i;
+        hp(D0) = 0.001;
+        hp(Z0) = z0;
+
+        fiveByFiveMatrix covariance;
+        covariance.Unit();
+
+        trackParameters tp;
+        tp.setTrackParameters(hp, covariance, Vector3D());
+
+        return tp;
+    }
+
+
+    /// a job with the first nHits hits of the seed, displaced by up to 0.1 sigma
+    refitJob createJob(const SimpleGeometry& geo, const trackParameters& seed, unsigned nHits)
+    {
+        refitJob job;
+        job.initialParameters = seed;
+
+        trajectory traj(seed, &geo);
+
+        const IntersectionVec& intersections = traj.getIntersectionsWithSurfaces();
+
+        for(unsigned i = 0 ; i < intersections.size() && i < nHits ; ++i)
+            {
+                const ISurface& surface = *intersections[i].second;
+                const Vector3D xx = pointAt(intersections[i].first, seed);
+
+                const double du = 0.1 * resolution * (int((i * 7) % 11) - 5) / 5.;
+                const double dv = 0.1 * resolution * (int((i * 5) % 7) - 3) / 3.;
+
+                refitHit hit;
+                hit.position = xx + du * surface.u(xx) + dv * surface.v(xx);
+                hit.precision[0] = 1. / (resolution * resolution);
+                hit.precision[1] = 1. / (resolution * resolution);
+                hit.surface = &surface;
+                hit.id = 0;
+
+                job.hits.push_back(hit);
+            }
+
+        return job;
+    }
+
+
+    /// jobs of very different sizes: full tracks, barrel tracks, minimal tracks and one with too few hits
+    void createJobs(const SimpleGeometry& geo, unsigned nJobs, vector<refitJob>& jobs)
+    {
+        jobs.clear();
+
+        for(unsigned i = 0 ; i < nJobs ; ++i)
+            {
+                unsigned nHits = 3 + (i * 37) % 100;
+
+                if(i % 5 == 0)
+                    nHits = 1000;
+                else if(i % 5 == 1)
+                    nHits = 6;
+                else if(i % 5 == 2)
+                    nHits = 3;
+
+                if(i == 7)
+                    nHits = 2;
+
+                jobs.push_back(createJob(geo, seedParameters(i), nHits));
+            }
+    }
+
+
+    /// the KalmanFitter throws for the track with z0 = throwZ0
+    class throwingFitter : public KalmanFitter
+    {
+        public:
+            using KalmanFitter::fitTrajectory;
+
+            IFitOutput* fitTrajectory(const trajectory& traj, IFitOutput* output) const
+            {
+                if(traj.initialTrackParameters().parameters()(Z0) == throwZ0)
+                    {
+                        delete output;
+                        throw std::runtime_error("throwingFitter: refusing to fit the track");
+                    }
+
+                return KalmanFitter::fitTrajectory(traj, output);
+            }
+    };
+
+
+    class throwingFactory : public IRefitWorkerFactory
+    {
+        public:
+            IFittingAlgorithm* createFitter() const { return new throwingFitter; }
+            IPropagation* createPropagation() const { return new analyticalPropagation; }
+    };
+}
+
+
+
+refitEngineTest::refitEngineTest() : UnitTest("RefitEngineTest", __FILE__)
+{
+}
+
+
+
+void refitEngineTest::_compareResults(const vector<fitResults>& r0, const vector<fitResults>& r1)
+{
+    test_(r0.size() == r1.size());
+
+    for(unsigned i = 0 ; i < r0.size() && i < r1.size() ; ++i)
+        {
+            test_(r0[i].areValid() == r1[i].areValid());
+            test_(r0[i].ndf() == r1[i].ndf());
+            test_(r0[i].chiSquare() == r1[i].chiSquare());
+
+            const trackParameters& t0 = r0[i].estimatedParameters();
+            const trackParameters& t1 = r1[i].estimatedParameters();
+
+            for(unsigned j = 0 ; j < 5 ; ++j)
+                test_(t0.parameters()(j) == t1.parameters()(j));
+
+            for(unsigned j = 0 ; j < 5 ; ++j)
+                for(unsigned k = 0 ; k < 5 ; ++k)
+                    test_(t0.covarianceMatrix()(j, k) == t1.covarianceMatrix()(j, k));
+        }
+}
+
+
+
+void refitEngineTest::_testMixedJobs()
+{
+    SimpleGeometry& geo = trackerGeometry();
+
+    // the momentum at the measurements is computed with the global geometry
+    SimpleGeometry::installGlobal(&geo);
+
+    vector<refitJob> jobs;
+    createJobs(geo, 40, jobs);
+
+    test_(jobs[0].hits.size() > 200);
+    test_(jobs[2].hits.size() == 3);
+    test_(jobs[7].hits.size() == 2);
+
+    refitWorkerFactory<KalmanFitter, analyticalPropagation> factory;
+
+    RefitEngine single(geo, factory, 1);
+    RefitEngine parallel(geo, factory, 4);
+
+    test_(single.nThreads() == 1);
+    test_(parallel.nThreads() == 4);
+
+    vector<fitResults> reference;
+    single.refit(jobs, reference);
+
+    vector<fitResults> results;
+    parallel.refit(jobs, results);
+
+    _compareResults(reference, results);
+
+    // the results are in the order of the jobs: the fitted parameters are those of the job
+    for(unsigned i = 0 ; i < results.size() ; ++i)
+        {
+            // the track with two hits is not fitted
+            if(i == 7)
+                {
+                    test_(!results[i].areValid());
+                    continue;
+                }
+
+            test_(results[i].areValid());
+
+            const Vector5& fitted = results[i].estimatedParameters().parameters();
+            const Vector5& seed = jobs[i].initialParameters.parameters();
+
+            test_(fabs(fitted(PHI0) - seed(PHI0)) < 0.01);
+            test_(fabs(fitted(OMEGA) - seed(OMEGA)) < 0.01 * fabs(seed(OMEGA)));
+        }
+
+    // a second call with the same engine gives the same results
+    parallel.refit(jobs, results);
+
+    _compareResults(reference, results);
+}
+
+
+
+void refitEngineTest::_testMoreThreadsThanJobs()
+{
+    SimpleGeometry& geo = trackerGeometry();
+
+    SimpleGeometry::installGlobal(&geo);
+
+    vector<refitJob> jobs;
+    createJobs(geo, 3, jobs);
+
+    refitWorkerFactory<KalmanFitter, analyticalPropagation> factory;
+
+    RefitEngine single(geo, factory, 1);
+    RefitEngine parallel(geo, factory, 8);
+
+    vector<fitResults> reference;
+    single.refit(jobs, reference);
+
+    vector<fitResults> results;
+    parallel.refit(jobs, results);
+
+    _compareResults(reference, results);
+
+    for(unsigned i = 0 ; i < results.size() ; ++i)
+        test_(results[i].areValid());
+
+    // no jobs at all
+    jobs.clear();
+    parallel.refit(jobs, results);
+
+    test_(results.empty());
+}
+
+
+
+void refitEngineTest::_testThrowingJob()
+{
+    SimpleGeometry& geo = trackerGeometry();
+
+    SimpleGeometry::installGlobal(&geo);
+
+    vector<refitJob> jobs;
+    createJobs(geo, 20, jobs);
+
+    // job 4 has many hits, so that the failing fit ends in the middle of the block of its worker
+    const unsigned failing = 4;
+    jobs[failing] = createJob(geo, seedParameters(failing, throwZ0), 1000);
+
+    refitWorkerFactory<KalmanFitter, analyticalPropagation> factory;
+    throwingFactory throwing;
+
+    RefitEngine single(geo, factory, 1);
+    RefitEngine parallel(geo, throwing, 3);
+
+    vector<fitResults> reference;
+    single.refit(jobs, reference);
+
+    test_(reference[failing].areValid());
+
+    vector<fitResults> results;
+    parallel.refit(jobs, results);
+
+    test_(results.size() == jobs.size());
+
+    // the result of the failing job is invalid - all other jobs are refitted
+    test_(!results[failing].areValid());
+
+    results[failing] = reference[failing];
+
+    _compareResults(reference, results);
+
+    // the engine is still usable
+    jobs[failing] = createJob(geo, seedParameters(failing), 1000);
+
+    single.refit(jobs, reference);
+    parallel.refit(jobs, results);
+
+    _compareResults(reference, results);
+}
+
+
+
+void refitEngineTest::run()
+{
+    _testMixedJobs();
+    _testMoreThreadsThanJobs();
+    _testThrowingJob();
+}
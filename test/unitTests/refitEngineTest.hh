@@ -0,0 +1,25 @@
+#ifndef REFITENGINETEST_HH
+#define REFITENGINETEST_HH
+
+/// multi-threaded refits with the RefitEngine: the results must not depend on the number of threads
+#include "RefitEngine.hh"
+
+#include "UnitTest.hh"
+
+class refitEngineTest : public UnitTesting::UnitTest
+{
+    public:
+        refitEngineTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testMixedJobs();
+        void _testMoreThreadsThanJobs();
+        void _testThrowingJob();
+
+        /// the results of the two refits are identical
+        void _compareResults(const std::vector<aidaTT::fitResults>& r0, const std::vector<aidaTT::fitResults>& r1);
+};
+#endif // REFITENGINETEST_HH
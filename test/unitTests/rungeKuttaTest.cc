@@ -0,0 +1,122 @@
+#include "rungeKuttaTest.hh"
+#include "aidaTT-Units.hh"
+
+#include <cmath>
+
+using namespace std;
+using namespace aidaTT;
+
+namespace
+{
+    /// geometry with a homogeneous field that is not flagged as constant, i.e. it is integrated
+    class uniformFieldGeometry : public IGeometry
+    {
+        public:
+            uniformFieldGeometry() : _surfaces() {}
+
+            const std::vector<const ISurface*>& getSurfaces() const
+            {
+                return _surfaces;
+            }
+
+            Vector3D getBField(const Vector3D&) const
+            {
+                return Vector3D(0., 0., 3.5);
+            }
+
+        private:
+            std::vector<const ISurface*> _surfaces;
+    };
+
+
+    /// direction after the 3d path length dw in the field bz along z
+    Vector3D directionAfter(double lambda, double phi, double qop, double bz, double dw)
+    {
+        const double phiEnd = phi - convertBr2P_cm * qop * bz * dw;
+
+        return Vector3D(cos(lambda) * cos(phiEnd), cos(lambda) * sin(phiEnd), sin(lambda));
+    }
+}
+
+
+
+rungeKuttaTest::rungeKuttaTest() : UnitTest("RungeKuttaTest", __FILE__)
+{
+}
+
+
+
+void rungeKuttaTest::_testConstantField()
+{
+    analyticalPropagation analytical;
+    rungeKuttaPropagation rungeKutta(1.e-6);
+
+    IPropagation& ap = analytical;
+    IPropagation& rp = rungeKutta;
+
+    const Vector3D bfield(0., 0., 3.5);
+
+    for(unsigned i = 0 ; i < 8 ; ++i)
+        {
+            const double lambda = -0.8 + 0.2 * i;
+            const double phi    = -M_PI + 0.7 * i;
+            const double qop    = ( i % 2 ? -1. : 1. ) / ( 0.3 + 0.5 * i );
+            const double dw     = 5. + 15. * i;
+
+            const Vector3D tstart(cos(lambda) * cos(phi), cos(lambda) * sin(phi), sin(lambda));
+            const Vector3D tend = directionAfter(lambda, phi, qop, bfield.z(), dw);
+
+            fiveByFiveMatrix ja, jr;
+
+            test_(ap.getJacobian(ja, dw, qop, tstart, tend, bfield, 0.));
+            test_(rp.getJacobian(jr, dw, qop, tstart, tend, bfield, 0.));
+
+            for(unsigned r = 0 ; r < 5 ; ++r)
+                for(unsigned c = 0 ; c < 5 ; ++c)
+                    test_(roughFloatCompare(jr(r, c), ja(r, c)));
+        }
+}
+
+
+
+void rungeKuttaTest::_testGeometryField()
+{
+    rungeKuttaPropagation rungeKutta;
+    IPropagation& rp = rungeKutta;
+
+    uniformFieldGeometry geometry;
+
+    const Vector3D bfield(0., 0., 3.5);
+
+    const double lambda = 0.4, phi = 1.2, qop = -0.8, dw = 60.;
+
+    const Vector3D xstart(1., -2., 10.);
+    const Vector3D tstart(cos(lambda) * cos(phi), cos(lambda) * sin(phi), sin(lambda));
+    const Vector3D tend = directionAfter(lambda, phi, qop, bfield.z(), dw);
+
+    // the field from the geometry gives the same jacobian as the constant field
+    fiveByFiveMatrix jc, jg;
+    test_(rp.getJacobian(jc, dw, qop, tstart, tend, bfield, 0.));
+    test_(rp.getJacobian(jg, dw, qop, xstart, tstart, tend, bfield, geometry, 0.));
+    test_(rungeKutta.lastNumberOfSteps() > 0);
+
+    for(unsigned r = 0 ; r < 5 ; ++r)
+        for(unsigned c = 0 ; c < 5 ; ++c)
+            test_(roughFloatCompare(jg(r, c), jc(r, c)));
+
+    // no path length: unit matrix, with the energy loss in the q/p element
+    fiveByFiveMatrix j0;
+    test_(rp.getJacobian(j0, 0., qop, xstart, tstart, tstart, bfield, geometry, 0.1));
+
+    for(unsigned r = 0 ; r < 5 ; ++r)
+        for(unsigned c = 0 ; c < 5 ; ++c)
+            test_(floatCompare(j0(r, c), ( r == c ? ( r == 0 ? 1.1 : 1. ) : 0. )));
+}
+
+
+
+void rungeKuttaTest::run()
+{
+    _testConstantField();
+    _testGeometryField();
+}
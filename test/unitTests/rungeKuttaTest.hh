@@ -0,0 +1,22 @@
+#ifndef RUNGEKUTTATEST_HH
+#define RUNGEKUTTATEST_HH
+
+/// compare the Runge-Kutta propagation to the analytical propagation in a constant field
+#include "rungeKuttaPropagation.hh"
+#include "analyticalPropagation.hh"
+
+#include "UnitTest.hh"
+
+class rungeKuttaTest : public UnitTesting::UnitTest
+{
+    public:
+        rungeKuttaTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testConstantField();
+        void _testGeometryField();
+};
+#endif // RUNGEKUTTATEST_HH
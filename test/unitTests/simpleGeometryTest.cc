@@ -0,0 +1,708 @@
+#include "simpleGeometryTest.hh"
+
+#include "helixUtils.hh"
+#include "trajectory.hh"
+#include "surfaceRecords.hh"
+#include "surfaceIdMap.hh"
+#include "aidaTT-Units.hh"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace aidaTT;
+
+namespace
+{
+    /// the first root of the distance to the surface along the helix in the direction dir, by sampling and bisection - 0 if there is none within two turns
+    double firstRoot(const ISurface& surf, const Vector5& hp, const Vector3D& rp, int dir)
+    {
+        const double step = dir * 2. * M_PI / fabs(hp(OMEGA)) / 1000.;
+
+        double a = 0.;
+        double fa = surf.distance(pointAt(a, hp, rp));
+
+        for(unsigned i = 1 ; i <= 2000 ; ++i)
+            {
+                double b = i * step;
+                const double fb = surf.distance(pointAt(b, hp, rp));
+
+                if(fa * fb < 0.)
+                    {
+                        for(unsigned k = 0 ; k < 100 ; ++k)
+                            {
+                                const double c = 0.5 * (a + b);
+                                const double fc = surf.distance(pointAt(c, hp, rp));
+                                if(fc * fa < 0.)
+                                    b = c;
+                                else
+                                    {
+                                        a = c;
+                                        fa = fc;
+                                    }
+                            }
+                        return 0.5 * (a + b);
+                    }
+
+                a = b;
+                fa = fb;
+            }
+
+        return 0.;
+    }
+}
+
+
+
+simpleGeometryTest::simpleGeometryTest() : UnitTest("SimpleGeometryTest", __FILE__)
+{
+}
+
+
+
+void simpleGeometryTest::_testCylinder()
+{
+    const SimpleCylinder cyl(7, 40., 150., 0.03);
+
+    test_(cyl.id() == 7);
+    test_(cyl.type().isZCylinder());
+    test_(cyl.type().isSensitive());
+    test_(floatCompare(cyl.radius(), 40.));
+    test_(floatCompare(cyl.length_along_v(), 300.));
+    test_(floatCompare(cyl.innerThickness() + cyl.outerThickness(), 0.03));
+    test_(cyl.innerMaterial().name() == "Silicon");
+
+    const Vector3D xx(40. * cos(0.7), 40. * sin(0.7), 100.);
+
+    test_(cyl.insideBounds(xx));
+    test_(! cyl.insideBounds(Vector3D(40., 0., 151.)));
+    test_(floatCompare(cyl.distance(Vector3D(0., 45., 0.)), 5.));
+    test_(floatCompare(cyl.normal(xx).dot(cyl.u(xx)), 0.));
+
+    const Vector3D back = cyl.localToGlobal(cyl.globalToLocal(xx));
+
+    test_(floatCompare(back.x(), xx.x()));
+    test_(floatCompare(back.y(), xx.y()));
+    test_(floatCompare(back.z(), xx.z()));
+}
+
+
+
+void simpleGeometryTest::_testPlane()
+{
+    const SimplePlane plane(1, Vector3D(0., 30., 0.), Vector3D(-1., 0., 0.), Vector3D(0., 0., 1.), 10., 20., 0.03);
+
+    test_(plane.type().isZPlane());
+    test_(floatCompare(plane.normal().y(), 1.));
+    test_(floatCompare(plane.distance(Vector3D(1., 32., 3.)), 2.));
+    test_(plane.insideBounds(Vector3D(4.9, 30., -9.9)));
+    test_(! plane.insideBounds(Vector3D(5.1, 30., 0.)));
+
+    const Vector2D local = plane.globalToLocal(Vector3D(2., 30., 3.));
+
+    test_(floatCompare(local.u(), -2.));
+    test_(floatCompare(local.v(), 3.));
+}
+
+
+
+void simpleGeometryTest::_testDisk()
+{
+    const SimpleDisk disk(1, -100., 10., 150., 0.03);
+
+    test_(disk.type().isZDisk());
+    test_(floatCompare(disk.distance(Vector3D(0., 0., -90.)), 10.));
+    test_(disk.insideBounds(Vector3D(0., 50., -100.)));
+    test_(! disk.insideBounds(Vector3D(0., 5., -100.)));
+    test_(! disk.insideBounds(Vector3D(0., 151., -100.)));
+    test_(floatCompare(disk.length_along_u(), 300.));
+}
+
+
+
+void simpleGeometryTest::_testCone()
+{
+    const SimpleCone cone(1, 20., 30., 150., 60., 0.03);
+
+    test_(cone.type().isZCone());
+    test_(! cone.type().isZCylinder());
+    test_(floatCompare(cone.radius(), 45.));
+
+    // a point on the cone at z = 85
+    const Vector3D xx(45. * cos(-1.2), 45. * sin(-1.2), 85.);
+
+    test_(cone.insideBounds(xx));
+    test_(! cone.insideBounds(Vector3D(45., 0., 0.)));
+    test_(cone.distance(Vector3D(50., 0., 85.)) > 0.);
+    test_(floatCompare(cone.normal(xx).dot(cone.v(xx)), 0.));
+
+    const Vector3D back = cone.localToGlobal(cone.globalToLocal(xx));
+
+    test_(roughFloatCompare(back.x(), xx.x()));
+    test_(roughFloatCompare(back.y(), xx.y()));
+    test_(roughFloatCompare(back.z(), xx.z()));
+}
+
+
+
+void simpleGeometryTest::_testBuilder()
+{
+    SimpleGeometry geo(3.5);
+
+    test_(geo.hasConstantBField());
+    test_(floatCompare(geo.getBField(Vector3D(1., 2., 3.)).z(), 3.5));
+
+    vector<double> radii;
+    radii.push_back(22.);
+    radii.push_back(1.6);
+    radii.push_back(6.);
+
+    vector<double> zPositions;
+    zPositions.push_back(-20.);
+    zPositions.push_back(20.);
+
+    test_(geo.addBarrel(radii, 30., 0.03) == 1);
+    test_(geo.addDisks(zPositions, 2., 25., 0.03) == 4);
+    test_(geo.addTPC(100, 33., 180., 235.) == 6);
+    test_(geo.nextID() == 106);
+
+    const vector<const ISurface*>& surfaces = geo.getSurfaces();
+
+    test_(surfaces.size() == 105);
+
+    // sorted in radius
+    test_(floatCompare(dynamic_cast<const ICylinder*>(surfaces[0])->radius(), 1.6));
+    test_(surfaces.back()->innerMaterial().name() == "Argon");
+    test_(floatCompare(dynamic_cast<const ICylinder*>(surfaces.back())->radius(), 180. - 0.735));
+
+    for(unsigned i = 1 ; i < surfaces.size() ; ++i)
+        test_(surfaces[i]->origin().rho() >= surfaces[i - 1]->origin().rho() || surfaces[i - 1]->type().isZDisk() || surfaces[i]->type().isZDisk());
+}
+
+
+
+void simpleGeometryTest::_testIntersections()
+{
+    SimpleGeometry geo(3.5);
+
+    vector<double> radii;
+    for(unsigned i = 0 ; i < 5 ; ++i)
+        radii.push_back(10. + 10. * i);
+
+    geo.addBarrel(radii, 100., 0.03);
+    geo.addSurface(new SimpleCone(100, 60., 80., 200., 100., 0.03));
+
+    // a 10 GeV track in the transverse plane crosses all layers of the barrel
+    Vector5 hp;
+    hp(OMEGA) = convertBr2P_cm * 3.5 / 10.;
+    hp(TANL) = 0.;
+    hp(PHI0) = 0.3;
+    hp(D0) = 0.;
+    hp(Z0) = 0.;
+
+    for(unsigned i = 0 ; i < radii.size() ; ++i)
+        {
+            const ISurface* surf = geo.getSurfaces()[i];
+
+            double s = 0.;
+            Vector3D xx;
+
+            test_(intersectWithSurface(surf, hp, Vector3D(), s, xx, 0, true));
+            test_(roughFloatCompare(xx.rho(), radii[i]));
+        }
+
+    // the candidates contain all intersected surfaces
+    vector<const ISurface*> candidates;
+    geo.getCandidateSurfaces(hp, Vector3D(), candidates);
+
+    test_(candidates.size() >= radii.size());
+
+    // a forward track crosses the cone
+    hp(TANL) = 1.;
+
+    double s = 0.;
+    Vector3D xx;
+
+    const ISurface* cone = geo.getSurfaces().back();
+
+    test_(cone->id() == 100);
+    test_(intersectWithSurface(cone, hp, Vector3D(), s, xx, 0, true));
+    test_(fabs(cone->distance(xx)) < 1.e-3);
+}
+
+
+
+void simpleGeometryTest::_testPlaneCandidates()
+{
+    SimpleGeometry geo(3.5);
+
+    // 128 radial planes between 5 cm and 45 cm and two layers of ladders
+    for(unsigned k = 0 ; k < 128 ; ++k)
+        {
+            const double phi = 2. * M_PI * k / 128.;
+            geo.addSurface(new SimplePlane(geo.nextID(), Vector3D(25. * cos(phi), 25. * sin(phi), 0.), Vector3D(cos(phi), sin(phi), 0.), Vector3D(0., 0., 1.), 40., 100., 0.03));
+        }
+
+    for(unsigned k = 0 ; k < 16 ; ++k)
+        {
+            const double phi = 2. * M_PI * k / 16.;
+            geo.addSurface(new SimplePlane(geo.nextID(), Vector3D(8. * cos(phi), 8. * sin(phi), 0.), Vector3D(-sin(phi), cos(phi), 0.), Vector3D(0., 0., 1.), 3.5, 100., 0.03));
+        }
+
+    for(unsigned k = 0 ; k < 48 ; ++k)
+        {
+            const double phi = 2. * M_PI * k / 48.;
+            geo.addSurface(new SimplePlane(geo.nextID(), Vector3D(35. * cos(phi), 35. * sin(phi), 0.), Vector3D(-sin(phi), cos(phi), 0.), Vector3D(0., 0., 1.), 5., 100., 0.03));
+        }
+
+    const vector<const ISurface*>& surfaces = geo.getSurfaces();
+    vector<const ISurface*> candidates;
+
+    unsigned nCrossings = 0;
+
+    // displaced and low pt helices - for d0 larger than the radius the helix does not contain the origin
+    for(unsigned i = 0 ; i < 2000 ; ++i)
+        {
+            const double pt = 0.05 + 0.0005 * (i % 997);
+
+            Vector5 hp;
+            hp(OMEGA) = (i % 2 ? -1. : 1.) * convertBr2P_cm * 3.5 / pt;
+            hp(TANL) = 0.2 * ((i % 7) - 3.);
+            hp(PHI0) = -M_PI + 2. * M_PI * ((i * 37) % 1000) / 1000.;
+            hp(D0) = -40. + 80. * ((i * 53) % 1009) / 1009.;
+            hp(Z0) = 5. * ((i % 11) - 5.);
+
+            const Vector3D rp((i % 3) * 1.5, -(i % 5) * 0.7, 0.);
+
+            geo.getCandidateSurfaces(hp, rp, candidates);
+
+            // the crossings in the first half arc as in trajectory::getIntersectionsWithSurfaces()
+            const double maxS = M_PI * fabs(calculateRadius(hp));
+
+            for(unsigned j = 0 ; j < surfaces.size() ; ++j)
+                {
+                    double s = 0.;
+                    Vector3D xx;
+
+                    if(!intersectWithSurface(surfaces[j], hp, rp, s, xx, +1, true) || s < 0. || s >= maxS)
+                        continue;
+
+                    ++nCrossings;
+
+                    test_(std::find(candidates.begin(), candidates.end(), surfaces[j]) != candidates.end());
+                }
+        }
+
+    test_(nCrossings > 2000);
+
+    // the indices are the positions of the candidates - also for a helix without curvature,
+    // after a look up that left fewer indices in the buffer
+    vector<unsigned> indices;
+
+    Vector5 hp;
+    hp(OMEGA) = convertBr2P_cm * 3.5 / 0.1;
+    hp(TANL) = 0.2;
+    hp(PHI0) = 0.4;
+
+    geo.getCandidateSurfaces(hp, Vector3D(), candidates, indices);
+
+    test_(candidates.size() < surfaces.size());
+    test_(indices.size() == candidates.size());
+
+    hp(OMEGA) = 0.;
+
+    geo.getCandidateSurfaces(hp, Vector3D(), candidates, indices);
+
+    test_(candidates.size() == surfaces.size());
+    test_(indices.size() == candidates.size());
+
+    for(unsigned k = 0 ; k < indices.size() && k < candidates.size() ; ++k)
+        {
+            test_(indices[k] == k);
+            test_(surfaces[indices[k]] == candidates[k]);
+        }
+}
+
+
+
+void simpleGeometryTest::_testTiltedIntersections()
+{
+    // a petal of a forward disk tilted by 0.3 rad and cones opening forward and backward
+    const double tilt = 0.3;
+    const SimplePlane petal(1, Vector3D(0., 0., 150.), Vector3D(1., 0., 0.), Vector3D(0., cos(tilt), sin(tilt)), 400., 400., 0.03);
+
+    test_(petal.type().isPlane() && !petal.type().isZPlane() && !petal.type().isZDisk());
+
+    const SimpleCone forwardCone(2, 60., 80., 200., 100., 0.03);
+    const SimpleCone backwardCone(3, -200., 100., -60., 30., 0.03);
+
+    const Vector3D rp(0.5, -0.3, 1.);
+
+    for(unsigned i = 0 ; i < 40 ; ++i)
+        {
+            const double pt = 0.5 + 0.5 * i;
+
+            Vector5 hp;
+            hp(OMEGA) = (i % 2 ? -1. : 1.) * convertBr2P_cm * 3.5 / pt;
+            hp(TANL) = (i % 4 < 2 ? 1. : -1.) * (1.2 + 0.05 * i);
+            hp(PHI0) = -M_PI + 0.157 * i;
+            hp(D0) = 0.01 * i;
+            hp(Z0) = -0.02 * i;
+
+            double s = 0.;
+            Vector3D xx;
+
+            // the petal is in the forward direction
+            if(hp(TANL) > 0.)
+                {
+                    test_(intersectWithSurface(&petal, hp, rp, s, xx, 0, false));
+                    test_(s > 0.);
+                    test_(fabs(petal.distance(xx)) < 1.e-6);
+                    test_((xx - pointAt(s, hp, rp)).r() < 1.e-6);
+                    test_(!intersectWithSurface(&petal, hp, rp, s, xx, -1, false));
+                }
+
+            const SimpleCone& cone = (hp(TANL) > 0. ? forwardCone : backwardCone);
+
+            if(!intersectWithZCylinder(&cone, hp, rp, s, xx, 1, false))
+                continue;
+
+            // the result of the general newtonian method
+            double sNewton = s;
+            Vector3D xxNewton;
+            const bool newton = intersectWithSurfaceNewton(&cone, hp, rp, sNewton, xxNewton, 1, false);
+
+            const bool found = intersectWithSurface(&cone, hp, rp, s, xx, 1, false);
+
+            // the newtonian method fails as well if the helix does not reach the cone
+            test_(found || !newton);
+
+            if(!found)
+                continue;
+
+            test_(fabs(cone.distance(xx)) < 1.e-6);
+            test_((xx - pointAt(s, hp, rp)).r() < 1.e-6);
+
+            if(newton)
+                test_(fabs(s - sNewton) < 1.e-3);
+        }
+}
+
+
+
+void simpleGeometryTest::_testIntersectionDirections()
+{
+    const Vector3D rp(0.5, -0.3, 1.);
+
+    // a cone around the reference point - crossed by the helices in both directions
+    const SimpleCone cone(2, -100., 30., 100., 50., 0.03);
+
+    unsigned nPlane = 0, nCone = 0;
+
+    for(unsigned i = 0 ; i < 40 ; ++i)
+        {
+            const double pt = 0.5 + 0.1 * i;
+
+            Vector5 hp;
+            hp(OMEGA) = (i % 2 ? -1. : 1.) * convertBr2P_cm * 3.5 / pt;
+            hp(TANL) = (i % 4 < 2 ? 1. : -1.) * (0.02 + 0.005 * i);
+            hp(PHI0) = -M_PI + 0.157 * i;
+            hp(D0) = 0.01 * i;
+            hp(Z0) = -0.02 * i;
+
+            // a slightly tilted plane parallel to the direction at the reference point, between the
+            // reference point and the center of the helix circle: crossed once in each direction
+            const double radius = 1. / fabs(hp(OMEGA));
+            const double sign = (hp(OMEGA) > 0. ? 1. : -1.);
+            const Vector3D u(cos(hp(PHI0)), sin(hp(PHI0)), 0.);
+            const Vector3D toCenter(sign * sin(hp(PHI0)), -sign * cos(hp(PHI0)), 0.);
+            const Vector3D normal = cos(0.05) * toCenter + Vector3D(0., 0., sin(0.05));
+
+            const SimplePlane plane(1, rp + 0.5 * radius * toCenter, u, normal.cross(u), 1.e4, 1.e4, 0.03);
+
+            test_(plane.type().isPlane() && !plane.type().isZPlane());
+
+            const surfaceRecord record = surfaceRecord::fromSurface(&plane);
+
+            for(int mode = -1 ; mode <= 1 ; mode += 2)
+                {
+                    const double sExpected = firstRoot(plane, hp, rp, mode);
+
+                    test_(mode * sExpected > 0.);
+
+                    double s = 0., sRecord = 0.;
+                    Vector3D xx, xxRecord;
+
+                    test_(intersectWithSurface(&plane, hp, rp, s, xx, mode, false));
+                    test_(intersectWithSurface(record, hp, rp, sRecord, xxRecord, mode, false));
+
+                    test_(fabs(s - sExpected) < 1.e-6);
+                    test_(fabs(sRecord - sExpected) < 1.e-6);
+                    test_(fabs(plane.distance(xx)) < 1.e-6);
+                    test_((xx - pointAt(s, hp, rp)).r() < 1.e-6);
+
+                    ++nPlane;
+                }
+
+            // the shortest solution is one of the two
+            double s = 0.;
+            Vector3D xx;
+            test_(intersectWithSurface(&plane, hp, rp, s, xx, 0, false));
+            test_(fabs(plane.distance(xx)) < 1.e-6);
+
+            // the cone in both directions - starting from the intersections with the middle cylinder
+            for(int mode = -1 ; mode <= 1 ; mode += 2)
+                {
+                    if(!intersectWithSurface(&cone, hp, rp, s, xx, mode, false))
+                        continue;
+
+                    test_(mode * s > 0.);
+                    test_(fabs(cone.distance(xx)) < 1.e-6);
+                    test_((xx - pointAt(s, hp, rp)).r() < 1.e-6);
+
+                    // no crossing of the cone before
+                    test_(fabs(s) <= fabs(firstRoot(cone, hp, rp, mode)) + 1.e-6);
+
+                    ++nCone;
+                }
+        }
+
+    test_(nPlane == 80);
+    test_(nCone > 60);
+}
+
+
+
+void simpleGeometryTest::_testSurfaceRecords()
+{
+    SimpleGeometry geo(3.5);
+
+    vector<double> radii;
+    for(unsigned i = 0 ; i < 5 ; ++i)
+        radii.push_back(10. + 10. * i);
+
+    vector<double> zPositions;
+    zPositions.push_back(-120.);
+    zPositions.push_back(120.);
+
+    geo.addBarrel(radii, 100., 0.03);
+    geo.addDisks(zPositions, 15., 60., 0.03);
+    geo.addSurface(new SimpleCone(geo.nextID(), 60., 80., 200., 100., 0.03));
+    geo.addSurface(new SimplePlane(geo.nextID(), Vector3D(0., 30., 0.), Vector3D(-1., 0., 0.), Vector3D(0., 0., 1.), 40., 200., 0.03));
+    geo.addSurface(new SimplePlane(geo.nextID(), Vector3D(0., 0., 150.), Vector3D(1., 0., 0.), Vector3D(0., cos(0.3), sin(0.3)), 100., 100., 0.03));
+
+    const vector<const ISurface*>& surfaces = geo.getSurfaces();
+
+    test_(geo.getSurfaceRecords() != NULL);
+
+    const SurfaceRecords& records = *geo.getSurfaceRecords();
+
+    test_(records.size() == surfaces.size());
+    test_(sizeof(surfaceRecord) % 64 == 0);
+    test_(reinterpret_cast<size_t>(records.begin()) % 64 == 0);
+
+    unsigned nTypes[surfaceRecord::Other + 1] = { 0, 0, 0, 0, 0, 0 };
+
+    for(unsigned i = 0 ; i < records.size() ; ++i)
+        {
+            test_(records[i].surface == surfaces[i]);
+            test_(records[i].id == surfaces[i]->id());
+            test_(records[i].material == geo.getSurfaceMaterial(surfaces[i]));
+            ++nTypes[records[i].type];
+        }
+
+    test_(nTypes[surfaceRecord::ZCylinder] == 5);
+    test_(nTypes[surfaceRecord::ZDisk] == 2);
+    test_(nTypes[surfaceRecord::Cone] == 1);
+    test_(nTypes[surfaceRecord::ZPlane] == 1);
+    test_(nTypes[surfaceRecord::Plane] == 1);
+    test_(nTypes[surfaceRecord::Other] == 0);
+
+    // the records give the same intersections as the surfaces
+    const Vector3D rp(0.5, -0.3, 1.);
+
+    unsigned nFound = 0;
+
+    for(unsigned i = 0 ; i < 40 ; ++i)
+        {
+            Vector5 hp;
+            hp(OMEGA) = (i % 2 ? -1. : 1.) * convertBr2P_cm * 3.5 / (0.5 + 0.5 * i);
+            hp(TANL) = (i % 4 < 2 ? 1. : -1.) * (0.2 + 0.05 * i);
+            hp(PHI0) = -M_PI + 0.157 * i;
+            hp(D0) = 0.01 * i;
+            hp(Z0) = -0.02 * i;
+
+            for(unsigned j = 0 ; j < records.size() ; ++j)
+                {
+                    for(int mode = -1 ; mode <= 1 ; ++mode)
+                        {
+                            double s = 0., sRecord = 0.;
+                            Vector3D xx, xxRecord;
+
+                            const bool found = intersectWithSurface(surfaces[j], hp, rp, s, xx, mode, true);
+                            const bool foundRecord = intersectWithSurface(records[j], hp, rp, sRecord, xxRecord, mode, true);
+
+                            test_(found == foundRecord);
+
+                            if(!(found && foundRecord))
+                                continue;
+
+                            ++nFound;
+
+                            test_(fabs(s - sRecord) < 1.e-6);
+                            test_((xx - xxRecord).r() < 1.e-6);
+                            test_((surfaceNormal(records[j], xxRecord) - surfaces[j]->normal(xxRecord)).r() < 1.e-9);
+                        }
+                }
+        }
+
+    test_(nFound > 100);
+
+    // the trajectory intersects with the records of the candidates - the same crossings as with all surfaces
+    fiveByFiveMatrix covariance;
+    covariance.Unit();
+
+    unsigned nCrossings = 0;
+
+    for(unsigned i = 0 ; i < 40 ; ++i)
+        {
+            Vector5 hp;
+            hp(OMEGA) = (i % 2 ? -1. : 1.) * convertBr2P_cm * 3.5 / (0.5 + 0.5 * i);
+            hp(TANL) = (i % 4 < 2 ? 1. : -1.) * (0.2 + 0.05 * i);
+            hp(PHI0) = -M_PI + 0.157 * i;
+            hp(D0) = 0.01 * i;
+            hp(Z0) = -0.02 * i;
+
+            trackParameters tp;
+            tp.setTrackParameters(hp, covariance, rp);
+
+            trajectory withRecords(tp, &geo);
+            trajectory withSurfaces(tp, &geo);
+
+            const IntersectionVec& crossings = withRecords.getIntersectionsWithSurfaces();
+            const IntersectionVec& expected = withSurfaces.getIntersectionsWithSurfaces(surfaces);
+
+            test_(crossings.size() == expected.size());
+
+            for(unsigned k = 0 ; k < std::min(crossings.size(), expected.size()) ; ++k)
+                {
+                    test_(crossings[k].second == expected[k].second);
+                    test_(fabs(crossings[k].first - expected[k].first) < 1.e-6);
+                }
+
+            nCrossings += crossings.size();
+        }
+
+    test_(nCrossings > 40);
+}
+
+
+
+namespace
+{
+    /// a geometry without a SurfaceIdMap - for the fall back of IGeometry::findSurface()
+    class surfaceListGeometry : public IGeometry
+    {
+    public:
+        explicit surfaceListGeometry(const IGeometry& geo) : _geo(geo) {}
+
+        const vector<const ISurface*>& getSurfaces() const { return _geo.getSurfaces(); }
+        Vector3D getBField(const Vector3D& xx) const { return _geo.getBField(xx); }
+
+    private:
+        const IGeometry& _geo;
+    };
+}
+
+
+
+void simpleGeometryTest::_testSurfaceIdMap()
+{
+    SimpleGeometry geo(3.5);
+
+    // ladders of a vertex detector with cellID like ids: the layer in the high word, the module in the low word
+    for(long64 layer = 1 ; layer <= 5 ; ++layer)
+        for(long64 module = 0 ; module < 40 ; ++module)
+            {
+                const double phi = 2. * M_PI * module / 40.;
+                const Vector3D origin(10. * layer * cos(phi), 10. * layer * sin(phi), 0.);
+
+                geo.addSurface(new SimplePlane((layer << 32) | module, origin, Vector3D(-sin(phi), cos(phi), 0.), Vector3D(0., 0., 1.), 3., 20., 0.03));
+            }
+
+    const vector<const ISurface*>& surfaces = geo.getSurfaces();
+
+    test_(surfaces.size() == 200);
+    test_(geo.getSurfaceIdMap() != NULL);
+
+    const SurfaceIdMap& idMap = *geo.getSurfaceIdMap();
+
+    test_(idMap.size() == surfaces.size());
+    test_(idMap.capacity() >= 2 * idMap.size());
+    test_((idMap.capacity() & (idMap.capacity() - 1)) == 0);
+
+    surfaceListGeometry listGeo(geo);
+
+    test_(listGeo.getSurfaceIdMap() == NULL);
+
+    vector<long64> ids;
+
+    for(unsigned i = 0 ; i < surfaces.size() ; ++i)
+        {
+            test_(idMap.find(surfaces[i]->id()) == surfaces[i]);
+            test_(geo.findSurface(surfaces[i]->id()) == surfaces[i]);
+            test_(listGeo.findSurface(surfaces[i]->id()) == surfaces[i]);
+
+            ids.push_back(surfaces[i]->id());
+        }
+
+    // unknown ids
+    test_(geo.findSurface(0) == NULL);
+    test_(geo.findSurface((long64(6) << 32) | 1) == NULL);
+    test_(listGeo.findSurface(0) == NULL);
+
+    ids.push_back(0);
+    ids.push_back(long64(1) << 32 | 40);
+
+    vector<const ISurface*> found(ids.size());
+
+    test_(geo.findSurfaces(ids.size(), &ids[0], &found[0]) == surfaces.size());
+
+    for(unsigned i = 0 ; i < surfaces.size() ; ++i)
+        test_(found[i] == surfaces[i]);
+
+    test_(found[surfaces.size()] == NULL);
+    test_(found[surfaces.size() + 1] == NULL);
+
+    vector<const ISurface*> listFound(ids.size());
+
+    test_(listGeo.findSurfaces(ids.size(), &ids[0], &listFound[0]) == surfaces.size());
+    test_(listFound == found);
+
+    // the table follows the geometry
+    const ISurface* extra = geo.addSurface(new SimplePlane(geo.nextID(), Vector3D(0., 0., 100.), Vector3D(1., 0., 0.), Vector3D(0., 1., 0.), 10., 10., 0.03));
+
+    test_(geo.findSurface(extra->id()) == extra);
+    test_(geo.getSurfaceIdMap()->size() == 201);
+
+    // an empty table finds nothing
+    SurfaceIdMap emptyMap;
+    test_(emptyMap.find(long64(1) << 32) == NULL);
+}
+
+
+
+void simpleGeometryTest::run()
+{
+    _testCylinder();
+    _testPlane();
+    _testDisk();
+    _testCone();
+    _testBuilder();
+    _testIntersections();
+    _testPlaneCandidates();
+    _testTiltedIntersections();
+    _testIntersectionDirections();
+    _testSurfaceRecords();
+    _testSurfaceIdMap();
+}
@@ -0,0 +1,30 @@
+#ifndef SIMPLEGEOMETRYTEST_HH
+#define SIMPLEGEOMETRYTEST_HH
+
+/// the surfaces and the builder of the SimpleGeometry, the in-memory geometry without DD4hep
+#include "SimpleGeometry.hh"
+
+#include "UnitTest.hh"
+
+class simpleGeometryTest : public UnitTesting::UnitTest
+{
+    public:
+        simpleGeometryTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testCylinder();
+        void _testPlane();
+        void _testDisk();
+        void _testCone();
+        void _testBuilder();
+        void _testIntersections();
+        void _testPlaneCandidates();
+        void _testTiltedIntersections();
+        void _testIntersectionDirections();
+        void _testSurfaceRecords();
+        void _testSurfaceIdMap();
+};
+#endif // SIMPLEGEOMETRYTEST_HH
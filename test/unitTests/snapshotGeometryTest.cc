@@ -0,0 +1,403 @@
+#include "snapshotGeometryTest.hh"
+
+#include "helixUtils.hh"
+#include "trajectory.hh"
+#include "surfaceRecords.hh"
+#include "aidaTT-Units.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+using namespace aidaTT;
+
+namespace
+{
+    /// geometry without surfaces with a field that is linear in r and z
+    class linearFieldGeometry : public IGeometry
+    {
+        public:
+            linearFieldGeometry() : _surfaces() {}
+
+            const std::vector<const ISurface*>& getSurfaces() const
+            {
+                return _surfaces;
+            }
+
+            Vector3D getBField(const Vector3D& xx) const
+            {
+                return Vector3D(1.e-4 * xx.x(), 1.e-4 * xx.y(), 3.5 - 2.e-4 * xx.z());
+            }
+
+        private:
+            std::vector<const ISurface*> _surfaces;
+    };
+
+
+    /// the surfaces of a geometry with the annulus of the disks moved off the origin - as for DD4hep disks
+    class shiftedDiskGeometry : public IGeometry
+    {
+        public:
+            shiftedDiskGeometry(const IGeometry& geom, double dx, double dy) : _geom(geom), _records()
+            {
+                _records.build(geom.getSurfaces());
+
+                // the records of the geometry, with the inner radius of the disks
+                for(unsigned i = 0 ; i < _records.size() ; ++i)
+                    _records[i] = (*geom.getSurfaceRecords())[i];
+
+                for(unsigned i = 0 ; i < _records.size() ; ++i)
+                    if(_records[i].type == surfaceRecord::ZDisk)
+                        {
+                            _records[i].xCenter += dx;
+                            _records[i].yCenter += dy;
+                        }
+
+                setConstantBField(geom.constantBz());
+            }
+
+            const std::vector<const ISurface*>& getSurfaces() const
+            {
+                return _geom.getSurfaces();
+            }
+
+            Vector3D getBField(const Vector3D& xx) const
+            {
+                return _geom.getBField(xx);
+            }
+
+            const SurfaceRecords* getSurfaceRecords() const
+            {
+                return &_records;
+            }
+
+        private:
+            const IGeometry& _geom;
+            SurfaceRecords _records;
+    };
+
+
+    /// true if loading the snapshot file throws
+    bool loadFails(const string& fileName)
+    {
+        try
+            {
+                SnapshotGeometry snapshot(fileName);
+            }
+        catch(const std::runtime_error&)
+            {
+                return true;
+            }
+        return false;
+    }
+}
+
+
+
+snapshotGeometryTest::snapshotGeometryTest() : UnitTest("SnapshotGeometryTest", __FILE__), _geometry(3.5), _fileName()
+{
+    stringstream name;
+    name << "/tmp/snapshotGeometryTest_" << getpid() << ".aidaTT";
+    _fileName = name.str();
+
+    vector<double> radii;
+    for(unsigned i = 0 ; i < 5 ; ++i)
+        radii.push_back(10. + 10. * i);
+
+    vector<double> zPositions;
+    zPositions.push_back(-120.);
+    zPositions.push_back(120.);
+
+    _geometry.addBarrel(radii, 100., 0.03);
+    _geometry.addDisks(zPositions, 15., 60., 0.03);
+    _geometry.addSurface(new SimpleCone(_geometry.nextID(), 60., 80., 200., 100., 0.03));
+    _geometry.addSurface(new SimplePlane(_geometry.nextID(), Vector3D(0., 30., 0.), Vector3D(-1., 0., 0.), Vector3D(0., 0., 1.), 40., 200., 0.03));
+    _geometry.addSurface(new SimplePlane(_geometry.nextID(), Vector3D(0., 0., 150.), Vector3D(1., 0., 0.), Vector3D(0., cos(0.3), sin(0.3)), 100., 100., 0.03));
+}
+
+
+
+void snapshotGeometryTest::_testSurfaces()
+{
+    SnapshotGeometry::write(_geometry, _fileName);
+
+    test_(SnapshotGeometry::isSnapshot(_fileName));
+
+    const SnapshotGeometry snapshot(_fileName);
+
+    test_(snapshot.header().version == snapshotHeader::currentVersion);
+    test_(snapshot.hasConstantBField());
+    test_(floatCompare(snapshot.constantBz(), 3.5));
+    test_(floatCompare(snapshot.getBField(Vector3D(10., 20., 30.)).z(), 3.5));
+    test_(snapshot.fieldMap() == NULL);
+
+    const vector<const ISurface*>& surfaces = _geometry.getSurfaces();
+    const vector<const ISurface*>& mapped = snapshot.getSurfaces();
+
+    test_(mapped.size() == surfaces.size());
+
+    if(mapped.size() != surfaces.size())
+        return;
+
+    const SurfaceRecords& records = *_geometry.getSurfaceRecords();
+    const SurfaceRecords& mappedRecords = *snapshot.getSurfaceRecords();
+
+    for(unsigned i = 0 ; i < surfaces.size() ; ++i)
+        {
+            const ISurface& surf = *surfaces[i];
+            const ISurface& copy = *mapped[i];
+
+            test_(copy.id() == surf.id());
+            test_(copy.type().isZCylinder() == surf.type().isZCylinder());
+            test_(copy.type().isZDisk() == surf.type().isZDisk());
+            test_(copy.type().isCone() == surf.type().isCone());
+            test_(copy.type().isSensitive() == surf.type().isSensitive());
+            test_(copy.innerMaterial().name() == surf.innerMaterial().name());
+            test_(floatCompare(copy.innerThickness() + copy.outerThickness(), surf.innerThickness() + surf.outerThickness()));
+
+            test_(mappedRecords[i].type == records[i].type);
+            test_(floatCompare(mappedRecords[i].rMin, records[i].rMin));
+            test_(floatCompare(mappedRecords[i].rMax, records[i].rMax));
+            test_(floatCompare(snapshot.getSurfaceMaterial(&copy)->X0eff, _geometry.getSurfaceMaterial(&surf)->X0eff));
+
+            // distances, normals and local coordinates at points around the origin
+            for(unsigned j = 0 ; j < 10 ; ++j)
+                {
+                    const Vector3D xx = surf.origin() + Vector3D(3. * cos(0.6 * j), 2. * sin(0.6 * j), 4. - j);
+
+                    test_(fabs(copy.distance(xx) - surf.distance(xx)) < 1.e-9);
+                    test_((copy.normal(xx) - surf.normal(xx)).r() < 1.e-9);
+                    test_((copy.u(xx) - surf.u(xx)).r() < 1.e-9);
+                }
+
+            const Vector3D onSurface = surf.localToGlobal(Vector2D(1.5, -2.));
+            const Vector3D back = copy.localToGlobal(copy.globalToLocal(onSurface));
+
+            test_(copy.insideBounds(onSurface) == surf.insideBounds(onSurface));
+            test_((back - onSurface).r() < 1.e-9);
+        }
+}
+
+
+
+void snapshotGeometryTest::_testIntersections()
+{
+    const SnapshotGeometry snapshot(_fileName);
+
+    const vector<const ISurface*>& surfaces = _geometry.getSurfaces();
+    const vector<const ISurface*>& mapped = snapshot.getSurfaces();
+
+    const Vector3D rp(0.5, -0.3, 1.);
+
+    unsigned nFound = 0;
+
+    for(unsigned i = 0 ; i < 40 ; ++i)
+        {
+            Vector5 hp;
+            hp(OMEGA) = (i % 2 ? -1. : 1.) * convertBr2P_cm * 3.5 / (0.5 + 0.5 * i);
+            hp(TANL) = (i % 4 < 2 ? 1. : -1.) * (0.2 + 0.05 * i);
+            hp(PHI0) = -M_PI + 0.157 * i;
+            hp(D0) = 0.01 * i;
+            hp(Z0) = -0.02 * i;
+
+            for(unsigned j = 0 ; j < surfaces.size() ; ++j)
+                {
+                    double s = 0., sMapped = 0.;
+                    Vector3D xx, xxMapped;
+
+                    const bool found = intersectWithSurface(surfaces[j], hp, rp, s, xx, 0, true);
+                    const bool foundMapped = intersectWithSurface(mapped[j], hp, rp, sMapped, xxMapped, 0, true);
+
+                    test_(found == foundMapped);
+
+                    if(!(found && foundMapped))
+                        continue;
+
+                    ++nFound;
+
+                    test_(fabs(s - sMapped) < 1.e-6);
+                    test_((xx - xxMapped).r() < 1.e-6);
+                }
+        }
+
+    test_(nFound > 50);
+
+    // the candidates are found with the same index
+    Vector5 hp;
+    hp(OMEGA) = convertBr2P_cm * 3.5 / 2.;
+    hp(TANL) = 0.3;
+    hp(PHI0) = 0.4;
+    hp(D0) = 0.;
+    hp(Z0) = 0.;
+
+    vector<const ISurface*> candidates, mappedCandidates;
+    _geometry.getCandidateSurfaces(hp, rp, candidates);
+    snapshot.getCandidateSurfaces(hp, rp, mappedCandidates);
+
+    test_(candidates.size() == mappedCandidates.size());
+}
+
+
+
+void snapshotGeometryTest::_testDiskAnnulus()
+{
+    const shiftedDiskGeometry shifted(_geometry, 4., -3.);
+
+    SnapshotGeometry::write(shifted, _fileName);
+
+    const SnapshotGeometry snapshot(_fileName);
+
+    const vector<const ISurface*>& mapped = snapshot.getSurfaces();
+    const SurfaceRecords& records = *shifted.getSurfaceRecords();
+    const SurfaceRecords& mappedRecords = *snapshot.getSurfaceRecords();
+
+    test_(mappedRecords.size() == records.size());
+
+    unsigned nDisks = 0;
+
+    for(unsigned i = 0 ; i < mappedRecords.size() && i < records.size() ; ++i)
+        {
+            if(records[i].type != surfaceRecord::ZDisk)
+                continue;
+
+            ++nDisks;
+
+            test_(mappedRecords[i].type == surfaceRecord::ZDisk);
+            test_(floatCompare(mappedRecords[i].xCenter, 4.));
+            test_(floatCompare(mappedRecords[i].yCenter, -3.));
+            test_(floatCompare(mappedRecords[i].rMin, 15.));
+            test_(floatCompare(mappedRecords[i].rMax, 60.));
+
+            // points on the disk in the hole, in the annulus and outside - around the shifted center
+            const double z = records[i].oz;
+
+            for(unsigned j = 0 ; j < 8 ; ++j)
+                {
+                    const double r = 5. + 10. * j;
+                    const Vector3D xx(4. + r * cos(0.8 * j), -3. + r * sin(0.8 * j), z);
+
+                    const bool inside = (r >= 15. && r <= 60.);
+
+                    test_(mapped[i]->insideBounds(xx) == inside);
+                    test_(insideBounds(mappedRecords[i], xx) == inside);
+                    test_(insideBounds(records[i], xx) == inside);
+                }
+        }
+
+    test_(nDisks == 2);
+}
+
+
+
+void snapshotGeometryTest::_testFieldMap()
+{
+    linearFieldGeometry field;
+
+    FieldMapGrid grid(400., -300., 300., 41, 61);
+    grid.sample(field);
+
+    SnapshotGeometry::write(_geometry, _fileName, &grid);
+
+    const SnapshotGeometry snapshot(_fileName);
+
+    test_(snapshot.fieldMap() != NULL);
+    test_(! snapshot.hasConstantBField());
+
+    if(snapshot.fieldMap() == NULL)
+        return;
+
+    test_(snapshot.fieldMap()->type() == FieldMapGrid::RZ);
+    test_(snapshot.fieldMap()->nNodes() == grid.nNodes());
+    test_(reinterpret_cast<size_t>(snapshot.fieldMap()->data()) % 64 == 0);
+
+    for(unsigned i = 0 ; i < 20 ; ++i)
+        {
+            const Vector3D xx(15. * i * cos(0.3 * i), 15. * i * sin(0.3 * i), -280. + 29. * i);
+
+            const Vector3D b0 = grid.fieldAt(xx);
+            const Vector3D b1 = snapshot.getBField(xx);
+
+            test_(floatCompare(b1.x(), b0.x()));
+            test_(floatCompare(b1.y(), b0.y()));
+            test_(floatCompare(b1.z(), b0.z()));
+            test_(roughFloatCompare(b1.z(), field.getBField(xx).z()));
+        }
+
+    // a field that is not constant needs a field map
+    bool thrown = false;
+    try
+        {
+            SnapshotGeometry::write(field, _fileName);
+        }
+    catch(const std::invalid_argument&)
+        {
+            thrown = true;
+        }
+    test_(thrown);
+}
+
+
+
+void snapshotGeometryTest::_testInvalidFiles()
+{
+    SnapshotGeometry::write(_geometry, _fileName);
+
+    std::vector<char> content;
+    {
+        ifstream in(_fileName.c_str(), ios::binary);
+        content.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+
+    test_(content.size() > sizeof(snapshotHeader));
+    test_(content.size() % 64 == 0);
+
+    const string badFile = _fileName + ".bad";
+
+    // a newer version
+    {
+        std::vector<char> bad(content);
+        reinterpret_cast<snapshotHeader*>(&bad[0])->version = snapshotHeader::currentVersion + 1;
+
+        ofstream out(badFile.c_str(), ios::binary);
+        out.write(&bad[0], bad.size());
+    }
+    test_(SnapshotGeometry::isSnapshot(badFile));
+    test_(loadFails(badFile));
+
+    // a truncated file
+    {
+        ofstream out(badFile.c_str(), ios::binary);
+        out.write(&content[0], content.size() - 64);
+    }
+    test_(loadFails(badFile));
+
+    // not a snapshot
+    {
+        ofstream out(badFile.c_str(), ios::binary);
+        out << "<lccdd> </lccdd>";
+    }
+    test_(! SnapshotGeometry::isSnapshot(badFile));
+    test_(loadFails(badFile));
+
+    test_(! SnapshotGeometry::isSnapshot(badFile + ".missing"));
+    test_(loadFails(badFile + ".missing"));
+
+    remove(badFile.c_str());
+}
+
+
+
+void snapshotGeometryTest::run()
+{
+    _testSurfaces();
+    _testIntersections();
+    _testDiskAnnulus();
+    _testFieldMap();
+    _testInvalidFiles();
+
+    remove(_fileName.c_str());
+}
@@ -0,0 +1,29 @@
+#ifndef SNAPSHOTGEOMETRYTEST_HH
+#define SNAPSHOTGEOMETRYTEST_HH
+
+/// write a SimpleGeometry to a geometry snapshot and compare the mapped geometry to the original
+#include "SnapshotGeometry.hh"
+#include "SimpleGeometry.hh"
+
+#include "UnitTest.hh"
+#include <string>
+
+class snapshotGeometryTest : public UnitTesting::UnitTest
+{
+    public:
+        snapshotGeometryTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testSurfaces();
+        void _testIntersections();
+        void _testDiskAnnulus();
+        void _testFieldMap();
+        void _testInvalidFiles();
+
+        aidaTT::SimpleGeometry _geometry;
+        std::string _fileName;
+};
+#endif // SNAPSHOTGEOMETRYTEST_HH
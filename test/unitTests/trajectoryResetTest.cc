@@ -0,0 +1,156 @@
+#include "trajectoryResetTest.hh"
+
+#include "SimpleGeometry.hh"
+#include "KalmanFitter.hh"
+#include "analyticalPropagation.hh"
+#include "helixUtils.hh"
+#include "aidaTT-Units.hh"
+
+#include <cmath>
+
+using namespace std;
+using namespace aidaTT;
+
+namespace
+{
+    /// the start parameters of a track from the origin
+    trackParameters seedParameters(double pt, double tanl, double phi0, double bz)
+    {
+        Vector5 hp;
+        hp(OMEGA) = convertBr2P_cm * bz / pt;
+        hp(TANL) = tanl;
+        hp(PHI0) = phi0;
+        hp(D0) = 0.001;
+        hp(Z0) = -0.002;
+
+        fiveByFiveMatrix covariance;
+        covariance.Unit();
+
+        trackParameters tp;
+        tp.setTrackParameters(hp, covariance, Vector3D());
+
+        return tp;
+    }
+
+
+    /// add the hits of the seed displaced by up to one sigma to the trajectory and fit it
+    bool fitTrack(trajectory& traj, const trackParameters& seed, double resolution)
+    {
+        const vector<double> precision(2, 1. / (resolution * resolution));
+
+        // the intersections are copied, since adding the measurements reuses the buffers of the trajectory
+        const IntersectionVec intersections = traj.getIntersectionsWithSurfaces();
+
+        for(unsigned i = 0 ; i < intersections.size() ; ++i)
+            {
+                const ISurface& surface = *intersections[i].second;
+                const Vector3D xx = pointAt(intersections[i].first, seed);
+
+                const double du = resolution * (int((i * 7) % 11) - 5) / 5.;
+                const double dv = resolution * (int((i * 5) % 7) - 3) / 3.;
+
+                traj.addMeasurement(xx + du * surface.u(xx) + dv * surface.v(xx), precision, surface, 0, true);
+            }
+
+        traj.prepareForFitting();
+
+        return traj.fit();
+    }
+}
+
+
+
+trajectoryResetTest::trajectoryResetTest() : UnitTest("TrajectoryResetTest", __FILE__)
+{
+}
+
+
+
+void trajectoryResetTest::_testResetFit()
+{
+    const double bz = 3.5;
+    const double resolution = 0.001;
+
+    static SimpleGeometry geo(bz);
+
+    if(geo.getSurfaces().empty())
+        {
+            vector<double> radii;
+            for(unsigned i = 0 ; i < 12 ; ++i)
+                radii.push_back(5. + 15. * i);
+
+            geo.addBarrel(radii, 300., 0.03);
+        }
+
+    // the momentum at the measurements is computed with the global geometry
+    SimpleGeometry::installGlobal(&geo);
+
+    static KalmanFitter fitter;
+    static analyticalPropagation propagation;
+
+    // a first track of higher momentum and a second one with fewer hits in the barrel
+    const trackParameters first = seedParameters(10., 0.2, 0.4, bz);
+    const trackParameters second = seedParameters(1.5, -2.5, 2.1, bz);
+
+    trajectory reused(first, &fitter, &propagation, &geo);
+    test_(fitTrack(reused, first, resolution));
+
+    vector<fitResults> firstResults;
+    test_(reused.getAllFitResults(firstResults));
+
+    // the reset removes the fit results
+    reused.reset(second);
+    test_(reused.fitOutput() == NULL);
+    test_(reused.getFitResults() == NULL);
+
+    trajectory fresh(second, &fitter, &propagation, &geo);
+
+    test_(fitTrack(reused, second, resolution));
+    test_(fitTrack(fresh, second, resolution));
+
+    test_(reused.trajectoryElements().size() == fresh.trajectoryElements().size());
+    test_(reused.trajectoryElements().size() < firstResults.size());
+
+    test_(reused.fitOutput()->isValid() == fresh.fitOutput()->isValid());
+    test_(reused.fitOutput()->ndf() == fresh.fitOutput()->ndf());
+    test_(floatCompare(reused.fitOutput()->chiSquare(), fresh.fitOutput()->chiSquare()));
+
+    vector<fitResults> reusedResults;
+    vector<fitResults> freshResults;
+    test_(reused.getAllFitResults(reusedResults));
+    test_(fresh.getAllFitResults(freshResults));
+
+    test_(reusedResults.size() == freshResults.size());
+
+    for(unsigned i = 0 ; i < reusedResults.size() && i < freshResults.size() ; ++i)
+        {
+            const trackParameters tr = reusedResults[i].estimatedParameters();
+            const trackParameters tf = freshResults[i].estimatedParameters();
+
+            test_(reusedResults[i].areValid() == freshResults[i].areValid());
+
+            for(unsigned j = 0 ; j < 5 ; ++j)
+                test_(floatCompare(tr.parameters()(j), tf.parameters()(j)));
+
+            for(unsigned j = 0 ; j < 5 ; ++j)
+                for(unsigned k = 0 ; k < 5 ; ++k)
+                    test_(floatCompare(tr.covarianceMatrix()(j, k), tf.covarianceMatrix()(j, k)));
+        }
+
+    // the results at a single label agree with the results of the fresh trajectory
+    const fitResults* reusedStart = reused.getFitResults(0);
+    const fitResults* freshStart = fresh.getFitResults(0);
+
+    test_(reusedStart != NULL && freshStart != NULL);
+
+    if(reusedStart != NULL && freshStart != NULL)
+        for(unsigned j = 0 ; j < 5 ; ++j)
+            test_(floatCompare(reusedStart->estimatedParameters().parameters()(j), freshStart->estimatedParameters().parameters()(j)));
+}
+
+
+
+void trajectoryResetTest::run()
+{
+    _testResetFit();
+}
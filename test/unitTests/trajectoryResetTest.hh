@@ -0,0 +1,20 @@
+#ifndef TRAJECTORYRESETTEST_HH
+#define TRAJECTORYRESETTEST_HH
+
+/// refitting tracks with one trajectory object: trajectory::reset() must give the same results as a new trajectory
+#include "trajectory.hh"
+
+#include "UnitTest.hh"
+
+class trajectoryResetTest : public UnitTesting::UnitTest
+{
+    public:
+        trajectoryResetTest();
+        void run();
+
+    private:
+        // the test calls in different blocks
+        // the distinctions are arbitrary:
+        void _testResetFit();
+};
+#endif // TRAJECTORYRESETTEST_HH
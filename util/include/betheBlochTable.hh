@@ -0,0 +1,63 @@
+#ifndef betheBlochTable_HH
+#define betheBlochTable_HH
+
+#include "materialCache.hh"
+
+#include <vector>
+
+namespace aidaTT {
+
+  /** The Bethe-Bloch energy loss of one material tabulated for a set of mass hypotheses,
+   *  to replace the analytic formula in computeEnergyLoss() for surfaceMaterial by a
+   *  table lookup - see MaterialCache::tabulate().
+   *
+   *  The table stores beta^2 dE/dx, which is smooth apart from the kinks of the density
+   *  effect at beta gamma = 1 and 1000, at equidistant nodes in log(beta gamma) with
+   *  the nodes on the decades. The linear interpolation between the nodes has a relative
+   *  error below 3e-5 for the default 50 bins per decade (below 2e-6 for 200) - the largest
+   *  error of the table at the bin centers is computed when filling it, see maxRelativeError().
+   *
+   *  Outside of 0.1 <= beta gamma <= 1e5 and for other masses than the tabulated
+   *  ones dEdx() returns false and the analytic formula has to be used.
+   */
+  class BetheBlochTable{
+
+  public:
+
+    static const unsigned defaultBinsPerDecade = 50 ;
+
+    /// fill the table for the material ( its thickness is ignored ) and the mass hypotheses [GeV]
+    BetheBlochTable( const materialLayer& mat, const std::vector<double>& masses,
+		     unsigned binsPerDecade = defaultBinsPerDecade ) ;
+
+    /// true if the table has been filled for the material, i.e. a layer of the same material constants
+    bool matches( const materialLayer& mat ) const ;
+
+    /** The interpolated energy loss per unit density and path length ( see computeBetheBloch() )
+     *  for the momentum mom [GeV] - false if the mass is not tabulated or beta gamma out of range.
+     */
+    bool dEdx( double mom, double mass, double& value ) const ;
+
+    /// the tabulated mass hypotheses
+    const std::vector<double>& masses() const { return _masses ; }
+
+    /// the largest relative deviation of the interpolation from the analytic formula at the bin centers
+    double maxRelativeError() const { return _maxRelativeError ; }
+
+    /// the tabulated range
+    double minBetaGamma() const ;
+    double maxBetaGamma() const ;
+
+  private:
+    double _density ;
+    double _ZoverA ;
+    double _lnTwoMeOverI ;
+    std::vector<double> _masses ;
+    unsigned _nNodes ;
+    double _invStep ;              ///< 1 / bin width in log(beta gamma)
+    std::vector<double> _values ;  ///< beta^2 dE/dx, _nNodes per mass
+    double _maxRelativeError ;
+  } ;
+
+}
+#endif
@@ -0,0 +1,115 @@
+#ifndef helixBatch_HH
+#define helixBatch_HH
+
+#include <vector>
+
+#include "Vector5.hh"
+#include "IGeometry.hh"
+#include "surfaceRecords.hh"
+
+/** Batched versions of the helix intersection calculations in helixUtils.hh.
+ *  The helix parameters of many tracks are stored as structure of arrays in a
+ *  helixBatch and are intersected with a flattened surface, see surfaceRecords.hh
+ *  (or a layer of surfaces), so that the inner loops over the tracks
+ *  have no virtual calls, no branches and no calls into libm and are vectorized
+ *  by the compiler with #pragma omp simd (helixBatch.cc is compiled with -O3 -fno-math-errno
+ *  -fno-trapping-math -fopenmp-simd; the full vector width is used with -march=native,
+ *  see AIDATT_NATIVE_ARCH).
+ *
+ *  The mode has the same meaning as for the scalar functions: the solution with
+ *  negative (-1) or positive (+1) or shortest (0) path length s is returned.
+ *  The bounds check is the same as insideBounds() for the surfaceRecord, i.e. the rectangle
+ *  for planes, the z-range for cylinders and the annulus for disks.
+ *  Helices with omega == 0 are not supported and reported as not intersecting.
+ */
+
+namespace aidaTT
+{
+
+  /// structure of arrays holding the helix parameters and reference points of many tracks
+  struct helixBatch{
+
+    std::vector<double> omega ;
+    std::vector<double> tanl ;
+    std::vector<double> phi0 ;
+    std::vector<double> d0 ;
+    std::vector<double> z0 ;
+    std::vector<double> refX ;
+    std::vector<double> refY ;
+    std::vector<double> refZ ;
+
+    helixBatch() : omega(), tanl(), phi0(), d0(), z0(), refX(), refY(), refZ() {}
+
+    unsigned size() const { return omega.size() ; }
+
+    void resize( unsigned n ) ;
+
+    void reserve( unsigned n ) ;
+
+    void clear() { resize( 0 ) ; }
+
+    /// set the helix at index i
+    void set( unsigned i, const Vector5& hp, const Vector3D& rp ) ;
+
+    /// add a helix at the end
+    void push_back( const Vector5& hp, const Vector3D& rp ) ;
+  } ;
+
+
+  /// the results of a batch intersection: path lengths, points and a hit mask
+  struct helixBatchIntersections{
+
+    std::vector<double> s ;
+    std::vector<double> x ;
+    std::vector<double> y ;
+    std::vector<double> z ;
+    std::vector<unsigned char> hit ;
+
+    /// the index of the surface in the layer that is intersected ( -1 if none )
+    std::vector<int> surface ;
+
+    helixBatchIntersections() : s(), x(), y(), z(), hit(), surface() {}
+
+    unsigned size() const { return s.size() ; }
+
+    void resize( unsigned n ) ;
+
+    /// the intersection point of helix i
+    Vector3D point( unsigned i ) const { return Vector3D( x[i], y[i], z[i] ) ; }
+  } ;
+
+
+  /** Intersect all helices with the cylinder - see intersectWithZCylinder() in helixUtils.hh.
+   *  Throws std::invalid_argument if the record is not a surfaceRecord::ZCylinder.
+   */
+  void intersectWithZCylinder( const helixBatch& helices, const surfaceRecord& cyl,
+			       int mode, bool checkBounds, helixBatchIntersections& result ) ;
+
+  /// intersect all helices with the plane ( a surfaceRecord::ZPlane ) - see intersectWithZPlane() in helixUtils.hh
+  void intersectWithZPlane( const helixBatch& helices, const surfaceRecord& plane,
+			    int mode, bool checkBounds, helixBatchIntersections& result ) ;
+
+  /// intersect all helices with the disk ( a surfaceRecord::ZDisk ) - see intersectWithZDisk() in helixUtils.hh
+  void intersectWithZDisk( const helixBatch& helices, const surfaceRecord& disk,
+			   int mode, bool checkBounds, helixBatchIntersections& result ) ;
+
+  /** Intersect all helices with the surface, using the batched functions above for z-cylinders,
+   *  z-planes and z-disks. Records of the other types are intersected helix by helix with
+   *  intersectWithSurface() for surfaceRecords.
+   */
+  void intersectWithSurface( const helixBatch& helices, const surfaceRecord& surf,
+			     int mode, bool checkBounds, helixBatchIntersections& result ) ;
+
+
+  /** Intersect all helices with a layer of surfaces, e.g. the records of the sensors of a
+   *  barrel layer from IGeometry::getSurfaceRecords(). For every helix the intersection
+   *  with the shortest |s| (within the given mode) is returned and the index of the
+   *  intersected surface in the layer is stored in result.surface. The scratch object is used
+   *  for intermediate results and can be reused between calls to avoid allocations.
+   */
+  void intersectWithLayer( const helixBatch& helices, const std::vector<const surfaceRecord*>& layer,
+			   int mode, bool checkBounds, helixBatchIntersections& result,
+			   helixBatchIntersections& scratch ) ;
+
+}
+#endif // helixBatch_HH
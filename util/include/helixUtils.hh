@@ -18,6 +18,8 @@
 namespace aidaTT
 {
 
+  struct surfaceRecord ;
+
   /// unsigned radius in xy-plane from helix parameters
   double calculateRadius(const Vector5& hp) ;
 
@@ -148,7 +150,8 @@ namespace aidaTT
    *  solution with negative (-1) or positive (+1)  or shortest (0) path length s is returned.
    *  If chckBounds==true, only solutions inside the boundary of the surface are returned.
    *  Calls one of the following methods: intersectWithZCylinder(), intersectWithZPlane(),
-   *  intersectWithZDisk() depending on the type of the surface.
+   *  intersectWithZDisk(), intersectWithZCone() or intersectWithPlane() depending on the
+   *  type of the surface.
    *  @fixme: need intersection with arbitrary surface.
    */
   bool intersectWithSurface( const ISurface* surf, const Vector5& hp, const Vector3D& rp, 
@@ -161,6 +164,20 @@ namespace aidaTT
   }
 
 
+  /** Calculates the intersection of a helix with the flattened surface, see surfaceRecords.hh -
+   *  as intersectWithSurface() above, but without virtual calls and with the bounds of the record.
+   *  Records of the type surfaceRecord::Other are intersected with their ISurface.
+   */
+  bool intersectWithSurface( const surfaceRecord& surf, const Vector5& hp, const Vector3D& rp,
+			     double& s, Vector3D& xx, int mode, bool checkBounds=true )  ;
+
+  inline bool intersectWithSurface( const surfaceRecord& surf, const trackParameters& tp,
+				    double& s, Vector3D& xx, int mode, bool checkBounds=true ){
+
+    return intersectWithSurface( surf, tp.parameters() , tp.referencePoint(), s, xx, mode, checkBounds ) ;
+  }
+
+
   /** Calculates the intersection of a helix with the surface. Depending on mode, either the 
    *  solution with negative (-1) or positive (+1)  or shortest (0) path length s is returned.
    *  If chckBounds==true, only solutions inside the boundary of the surface are returned.
@@ -189,10 +206,23 @@ namespace aidaTT
   /** Calculates the intersection of a helix with the surface. Depending on mode, either the 
    *  solution with negative (-1) or positive (+1)  or shortest (0) path length s is returned.
    *  If chckBounds==true, only solutions inside the boundary of the surface are returned.
+   *  Starts from the intersection with the middle cylinder and solves for the cone with at
+   *  most 10 Newton steps on the analytic radial distance (no virtual calls per step).
    */
   bool intersectWithZCone( const ISurface* surf, const Vector5& hp, const Vector3D& rp, 
 			   double& s, Vector3D& xx, int mode, bool checkBounds=true )  ;
 
+
+  /** Calculates the intersection of a helix with an arbitrarily oriented plane, e.g. tilted
+   *  petals of forward disks. Depending on mode, either the solution with negative (-1) or
+   *  positive (+1) or shortest (0) path length s is returned. If chckBounds==true, only
+   *  solutions inside the boundary of the surface are returned. Starts with the straight line
+   *  along the tangent at the reference point and solves with at most 10 Newton steps on the
+   *  analytic distance, i.e. the crossing next to the reference point is found.
+   */
+  bool intersectWithPlane( const ISurface* surf, const Vector5& hp, const Vector3D& rp, 
+			   double& s, Vector3D& xx, int mode, bool checkBounds=true )  ;
+
   /** Calculates the intersection of a helix with an arbitrary surface using a newtonian 
    *  method. Depending on mode, either the solution with negative (-1) or positive (+1)  
    *  or shortest (0) path length s is returned.
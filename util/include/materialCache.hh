@@ -0,0 +1,94 @@
+#ifndef materialCache_HH
+#define materialCache_HH
+
+#include "IGeometry.hh"
+
+#include <vector>
+
+namespace aidaTT {
+
+  class BetheBlochTable ;
+
+  /** The constants of one material layer of a surface (inner or outer side) for the
+   *  Bethe-Bloch formula, as used in computeBetheBloch(): they only depend on the material.
+   */
+  struct materialLayer{
+    double thickness ;       ///< [cm]
+    double density ;         ///< [g/cm^3]
+    double ZoverA ;          ///< Z/A
+    double lnTwoMeOverI ;    ///< log( 2 m_e / I ) with the mean excitation energy I
+    double C0 ;              ///< the density effect constant -( 2 log(I/hwp) + 1 )
+    double a ;               ///< the density effect constant -C0/27
+    const BetheBlochTable* table ;  ///< the tabulated energy loss of the material - NULL if not tabulated
+
+    materialLayer() : thickness( 0. ), density( 0. ), ZoverA( 0. ), lnTwoMeOverI( 0. ), C0( 0. ), a( 0. ), table( 0 ) {}
+
+    materialLayer( const IMaterial& mat, double thick ) ;
+  } ;
+
+
+  /** The material of a surface, flattened into the constants needed for the multiple
+   *  scattering and the energy loss of a crossing track - see computeQMS() and
+   *  computeEnergyLoss() for surfaceMaterial.
+   */
+  struct surfaceMaterial{
+    const ISurface* surface ;
+    long64 id ;
+    double thickness ;       ///< inner + outer thickness [cm]
+    double X0eff ;           ///< the effective inverse radiation length ( r_i/X0_i + r_o/X0_o ) / thickness [1/cm]
+    materialLayer inner ;
+    materialLayer outer ;
+
+    surfaceMaterial() : surface( 0 ), id( 0 ), thickness( 0. ), X0eff( 0. ), inner(), outer() {}
+
+    /// compute the constants for the surface
+    explicit surfaceMaterial( const ISurface& surf ) ;
+  } ;
+
+
+  /** Cache of the surfaceMaterial of all surfaces of a geometry, sorted by ISurface::id().
+   *  To be built once when the geometry is loaded, e.g. by the DD4hepGeometry and the
+   *  SimpleGeometry - see IGeometry::getSurfaceMaterial().
+   *  Optionally the energy loss is tabulated for every distinct material, see tabulate().
+   */
+  class MaterialCache{
+
+  public:
+
+    MaterialCache() : _materials(), _tables(), _masses(), _binsPerDecade( 0 ) {}
+
+    ~MaterialCache() ;
+
+    /// (re)build the cache for the given surfaces - with the tables if tabulate() has been called
+    void build( const std::vector<const ISurface*>& surfaces ) ;
+
+    /** Tabulate the energy loss of all materials for the given mass hypotheses [GeV], now
+     *  and whenever the cache is rebuilt - see BetheBlochTable. No masses switch the tables off.
+     */
+    void tabulate( const std::vector<double>& masses, unsigned binsPerDecade ) ;
+
+    /// the number of energy loss tables, i.e. of distinct materials if tabulated
+    unsigned nTables() const { return _tables.size() ; }
+
+    /// the material of the surface - NULL if the surface is not in the cache
+    const surfaceMaterial* find( const ISurface* surf ) const ;
+
+    /// the number of cached surfaces
+    unsigned size() const { return _materials.size() ; }
+
+  private:
+    MaterialCache( const MaterialCache& ) ;
+    MaterialCache& operator=( const MaterialCache& ) ;
+
+    /// link the material layers to the tables, creating one table per distinct material
+    void _tabulate() ;
+    void _clearTables() ;
+
+    std::vector<surfaceMaterial> _materials ;
+    std::vector<BetheBlochTable*> _tables ;
+    std::vector<double> _masses ;
+    unsigned _binsPerDecade ;
+  } ;
+
+}
+#endif
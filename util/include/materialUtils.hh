@@ -3,6 +3,7 @@
 
 #include "trackParameters.hh"
 #include "IGeometry.hh"
+#include "materialCache.hh"
 
 /** Define helper functions for material effects.
  *
@@ -68,6 +69,31 @@ namespace aidaTT {
 			    double& energy, double& beta,
 			    double mass ) ; //=pionMass  ) ;
 
+
+  /** Compute the multiple scattering amplitude for a track with momentum mom [GeV] crossing
+   *  the surface with the precomputed material under an angle with cosTrk = |cos| to the normal.
+   *  Same approximation as above, but without any virtual call - returns 0 without material.
+   */
+  double computeQMS( const surfaceMaterial& material, double cosTrk, double mom, double mass ) ;
+
+
+  /** Compute the Bethe-Bloch energy loss (per unit density and path length) for the
+   *  precomputed material layer - identical to computeBetheBloch( const IMaterial&,...),
+   *  always with the analytic formula, i.e. also for tabulated materials.
+   */
+  double computeBetheBloch( const materialLayer& mat, double mom, double mass ) ;
+
+
+  /** Compute the expected energy loss [GeV] for a track with momentum mom [GeV] crossing
+   *  the surface with the precomputed material under an angle with cosTrk = |cos| to the normal.
+   *  The total energy and beta of the particle are also returned. The particle dependent
+   *  parts of the Bethe-Bloch formula are computed only once for both material layers.
+   *  For tabulated materials ( MaterialCache::tabulate() ) the energy loss is interpolated
+   *  in the BetheBlochTable if the mass and momentum are covered by the table.
+   */
+  double computeEnergyLoss( const surfaceMaterial& material, double cosTrk, double mom,
+			    double& energy, double& beta, double mass ) ;
+
   
   
 
@@ -0,0 +1,76 @@
+#ifndef surfaceIdMap_HH
+#define surfaceIdMap_HH
+
+#include "IGeometry.hh"
+
+#include <vector>
+
+namespace aidaTT {
+
+  /** Hash table from the surface id ( ISurface::id(), i.e. the cellID of the hits on the
+   *  surface ) to the surface, for associating hits to surfaces in O(1). Open addressing with
+   *  linear probing in one contiguous array of ( id, surface ) slots, at most half filled,
+   *  i.e. a lookup typically reads one cache line.
+   *  To be built once when the geometry is loaded - see IGeometry::findSurface().
+   *  If several surfaces have the same id, the first one is found.
+   */
+  class SurfaceIdMap{
+
+  public:
+
+    SurfaceIdMap() : _slots(), _mask( 0 ), _size( 0 ) {}
+
+    /// (re)build the table for the surfaces
+    void build( const std::vector<const ISurface*>& surfaces ) ;
+
+    /// the surface with the id - NULL if there is none
+    const ISurface* find( long64 id ) const {
+
+      if( _slots.empty() )
+	return 0 ;
+
+      for( unsigned i = hash( id ) & _mask ; _slots[i].surface != 0 ; i = ( i + 1 ) & _mask )
+	if( _slots[i].id == id )
+	  return _slots[i].surface ;
+
+      return 0 ;
+    }
+
+    /** Resolve n ids at once: surfaces[i] is the surface with the id ids[i] - NULL if there is none.
+     *  The slots of the following ids are prefetched while an id is resolved. Returns the number
+     *  of ids that have been found.
+     */
+    unsigned find( unsigned n, const long64* ids, const ISurface** surfaces ) const ;
+
+    /// the number of distinct ids
+    unsigned size() const { return _size ; }
+
+    /// the number of slots of the table - a power of two
+    unsigned capacity() const { return _slots.size() ; }
+
+    /// the hash of the id - the bits of the id fields are mixed, as cellIDs differ only in a few bits
+    static unsigned hash( long64 id ){
+      unsigned long long h = id ;
+      h ^= h >> 33 ;
+      h *= 0xff51afd7ed558ccdULL ;
+      h ^= h >> 33 ;
+      return unsigned( h ) ;
+    }
+
+  private:
+    SurfaceIdMap( const SurfaceIdMap& ) ;
+    SurfaceIdMap& operator=( const SurfaceIdMap& ) ;
+
+    /// an empty slot has no surface
+    struct slot{
+      long64 id ;
+      const ISurface* surface ;
+    } ;
+
+    std::vector<slot> _slots ;
+    unsigned _mask ;
+    unsigned _size ;
+  } ;
+
+}
+#endif
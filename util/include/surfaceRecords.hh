@@ -0,0 +1,102 @@
+#ifndef surfaceRecords_HH
+#define surfaceRecords_HH
+
+#include "IGeometry.hh"
+
+#include <vector>
+
+namespace aidaTT {
+
+  struct surfaceMaterial ;
+  class MaterialCache ;
+
+  /** A surface flattened into plain data: the type tag, the geometry at the origin, the bounds
+   *  and a summary of the material. Used in the hot loops instead of the virtual ISurface calls,
+   *  e.g. by intersectWithSurface() for surfaceRecords in helixUtils.hh. The records of a
+   *  geometry are stored contiguously in SurfaceRecords, aligned to cache lines.
+   *
+   *  The bounds are the flat description of the surface: the rectangle for planes, the z-range
+   *  for cylinders and cones and the annulus for disks. The records are also the surface
+   *  description of the batched intersections in helixBatch.hh.
+   */
+  struct alignas(64) surfaceRecord{
+
+    /// the type tag - selects the intersection method and the meaning of the bounds
+    enum Type { ZCylinder = 0, ZPlane, ZDisk, Cone, Plane, Other } ;
+
+    int type ;
+    bool sensitive ;
+
+    double ox, oy, oz ;          ///< origin
+    double nx, ny, nz ;          ///< normal at the origin
+    double ux, uy, uz ;          ///< u direction at the origin
+    double vx, vy, vz ;          ///< v direction at the origin
+
+    double radius ;              ///< cylinders: the radius, cones: the radius at the origin
+    double xCenter, yCenter ;    ///< cylinders and cones: the axis parallel to z, disks: the center
+    double slope ;               ///< cones: dr/dz
+
+    double zMin, zMax ;          ///< cylinders and cones: the z range
+    double halfU, halfV ;        ///< planes: the half lengths along u and v
+    double rMin, rMax ;          ///< disks: the inner and outer radius around the center
+
+    double thickness ;           ///< the material: inner + outer thickness [cm]
+    double X0eff ;               ///< the material: effective inverse radiation length [1/cm]
+
+    const surfaceMaterial* material ;  ///< the cached material - NULL if not cached
+    const ISurface* surface ;
+    long64 id ;
+
+    /** Flatten the surface - surfaces that cannot be described by the record get the type Other,
+     *  i.e. the users have to fall back to the ISurface. The annulus of disks is not known
+     *  from the ISurface: it is centered at the origin with the inner radius 0 - the geometries
+     *  set the real annulus in the records they provide ( see IGeometry::getSurfaceRecords() ).
+     */
+    static surfaceRecord fromSurface( const ISurface* surf, const surfaceMaterial* mat = 0 ) ;
+  } ;
+
+
+  /// true if the point (on the surface) is inside the bounds of the record
+  bool insideBounds( const surfaceRecord& surf, const Vector3D& xx ) ;
+
+  /// the normal of the surface at the point (on the surface)
+  Vector3D surfaceNormal( const surfaceRecord& surf, const Vector3D& xx ) ;
+
+
+  /** The surfaceRecords of all surfaces of a geometry, in one contiguous array aligned to
+   *  cache lines and in the order of IGeometry::getSurfaces(). To be built when the geometry
+   *  is loaded, after the MaterialCache - see IGeometry::getSurfaceRecords().
+   */
+  class SurfaceRecords{
+
+  public:
+
+    SurfaceRecords() : _buffer(), _records( 0 ), _size( 0 ) {}
+
+    /// (re)build the records for the surfaces - with the material from the cache if given
+    void build( const std::vector<const ISurface*>& surfaces, const MaterialCache* materials = 0 ) ;
+
+    /// the number of records
+    unsigned size() const { return _size ; }
+
+    const surfaceRecord& operator[]( unsigned i ) const { return _records[i] ; }
+
+    /// modify the record, e.g. for bounds that are only known to the geometry
+    surfaceRecord& operator[]( unsigned i ) { return _records[i] ; }
+
+    const surfaceRecord* begin() const { return _records ; }
+
+    const surfaceRecord* end() const { return _records + _size ; }
+
+  private:
+    SurfaceRecords( const SurfaceRecords& ) ;
+    SurfaceRecords& operator=( const SurfaceRecords& ) ;
+
+    /// the storage - the records start at the first cache line boundary
+    std::vector<char> _buffer ;
+    surfaceRecord* _records ;
+    unsigned _size ;
+  } ;
+
+}
+#endif
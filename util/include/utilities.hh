@@ -48,9 +48,13 @@ namespace aidaTT
   //fiveByFiveMatrix L3ToCurvilinearJacobian(const trackParameters&, const Vector3D&);
 
 
-  std::pair<Vector3D, Vector3D>* calculateLocalCurvilinearSystem(double, const trackParameters&);
+  std::pair<Vector3D, Vector3D> calculateLocalCurvilinearSystem(double, const trackParameters&);
   
-  std::vector<double>* calculateLocalToMeasurementProjectionMatrix(const Vector3D&, const Vector3D&, const std::vector<Vector3D>&);
+  /// the projection (2x2 matrix, row wise) from the local curvilinear system (U,V) to the measurement directions
+  void calculateLocalToMeasurementProjectionMatrix(const Vector3D&, const Vector3D&, const std::vector<Vector3D>&, std::vector<double>&);
+
+  /// the same for n measurement directions given as array, the four matrix elements are written to ret
+  void calculateLocalToMeasurementProjectionMatrix(const Vector3D&, const Vector3D&, const Vector3D* measDirs, unsigned n, double* ret);
   
 }
 
@@ -0,0 +1,121 @@
+#include "betheBlochTable.hh"
+
+#include "materialUtils.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace aidaTT{
+
+  namespace {
+
+    /// the tabulated range in log10( beta gamma ) - decades, such that the kinks at 0 and 3 are nodes
+    const int minDecade = -1 ;
+    const int maxDecade =  5 ;
+
+    /// the interpolated value at ln( beta gamma ) in the nodes of one mass - false if out of range
+    inline bool interpolate( const double* nodes, unsigned nNodes, double invStep, double lnBg, double& value ){
+
+      const double t = ( lnBg - minDecade * M_LN10 ) * invStep ;
+
+      // also excludes NaN
+      if( !( t >= 0. ) || t > nNodes - 1 )
+	return false ;
+
+      unsigned i = unsigned( t ) ;
+
+      if( i == nNodes - 1 )
+	--i ;
+
+      const double f = t - i ;
+
+      value = nodes[i] + ( nodes[i+1] - nodes[i] ) * f ;
+
+      return true ;
+    }
+  }
+
+
+  BetheBlochTable::BetheBlochTable( const materialLayer& mat, const std::vector<double>& masses,
+				    unsigned binsPerDecade ) :
+    _density( mat.density ), _ZoverA( mat.ZoverA ), _lnTwoMeOverI( mat.lnTwoMeOverI ),
+    _masses( masses ), _nNodes( ( maxDecade - minDecade ) * std::max( binsPerDecade, 1u ) + 1 ),
+    _invStep( std::max( binsPerDecade, 1u ) / M_LN10 ), _values( _masses.size() * _nNodes ),
+    _maxRelativeError( 0. ) {
+
+    // the analytic formula - without a table
+    materialLayer layer( mat ) ;
+    layer.table = 0 ;
+
+    const double step = 1. / _invStep ;
+    const double lnBgMin = minDecade * M_LN10 ;
+
+    for( unsigned m=0, nm = _masses.size() ; m<nm ; ++m ){
+
+      const double mass = _masses[m] ;
+      double* nodes = &_values[ m * _nNodes ] ;
+
+      for( unsigned i=0 ; i<_nNodes ; ++i ){
+
+	const double bg = std::exp( lnBgMin + i * step ) ;
+
+	nodes[i] = computeBetheBloch( layer, bg * mass, mass ) * bg*bg / ( 1. + bg*bg ) ;
+      }
+
+      for( unsigned i=0 ; i+1<_nNodes ; ++i ){
+
+	const double lnBg = lnBgMin + ( i + 0.5 ) * step ;
+	const double bg = std::exp( lnBg ) ;
+
+	const double exact = computeBetheBloch( layer, bg * mass, mass ) ;
+
+	double interpolated = 0. ;
+	interpolate( nodes, _nNodes, _invStep, lnBg, interpolated ) ;
+	interpolated *= 1. + 1. / ( bg*bg ) ;
+
+	if( exact != 0. )
+	  _maxRelativeError = std::max( _maxRelativeError, std::fabs( interpolated / exact - 1. ) ) ;
+      }
+    }
+  }
+
+
+  bool BetheBlochTable::matches( const materialLayer& mat ) const {
+
+    return mat.density == _density && mat.ZoverA == _ZoverA && mat.lnTwoMeOverI == _lnTwoMeOverI ;
+  }
+
+
+  bool BetheBlochTable::dEdx( double mom, double mass, double& value ) const {
+
+    for( unsigned m=0, nm = _masses.size() ; m<nm ; ++m ){
+
+      if( _masses[m] != mass )
+	continue ;
+
+      const double betaGamma = mom / mass ;
+
+      double v = 0. ;
+
+      if( !interpolate( &_values[ m * _nNodes ], _nNodes, _invStep, std::log( betaGamma ), v ) )
+	return false ;
+
+      // 1/beta^2 = 1 + 1/(beta gamma)^2
+      value = v * ( 1. + 1. / ( betaGamma * betaGamma ) ) ;
+
+      return true ;
+    }
+
+    return false ;
+  }
+
+
+  double BetheBlochTable::minBetaGamma() const {
+    return std::pow( 10., minDecade ) ;
+  }
+
+  double BetheBlochTable::maxBetaGamma() const {
+    return std::pow( 10., maxDecade ) ;
+  }
+
+}
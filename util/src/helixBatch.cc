@@ -0,0 +1,557 @@
+#include "helixBatch.hh"
+#include "trackParameters.hh"
+#include "helixUtils.hh"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+namespace aidaTT
+{
+
+  namespace {
+
+    /* The functions below are inlined into the loops over the helices. They have no branches
+     * and no calls into libm (except sqrt), so that the loops can be vectorized. The sine, cosine
+     * and arc tangent are the polynomial approximations of the Cephes library ( www.netlib.org/cephes ),
+     * accurate to a few ulp.
+     */
+
+    /** sin(x) and cos(x) for |x| < 1e9 - the argument is reduced to [-pi/4,pi/4] by subtracting
+     *  a multiple of pi/2 ( Cody-Waite, pi/2 split into three parts ).
+     */
+    inline void sinCos( double x, double& sinX, double& cosX ){
+
+      static const double twoOverPi = 0.63661977236758134308 ;
+      static const double piO2a = 1.57079625129699707031E0 ;
+      static const double piO2b = 7.54978941586159635335E-8 ;
+      static const double piO2c = 5.39030285815811905290E-15 ;
+
+      const double t = x * twoOverPi ;
+      const int q = int( t + ( t < 0. ? -0.5 : 0.5 ) ) ;
+      const double k = q ;
+
+      const double r = ( ( x - k * piO2a ) - k * piO2b ) - k * piO2c ;
+      const double z = r * r ;
+
+      const double sr = r + r * z * ((((( 1.58962301576546568060E-10 * z - 2.50507477628578072866E-8 ) * z
+					  + 2.75573136213857245213E-6 ) * z - 1.98412698295895385996E-4 ) * z
+					  + 8.33333333332211858878E-3 ) * z - 1.66666666666666307295E-1 ) ;
+
+      const double cr = 1. - 0.5 * z + z * z * ((((( -1.13585365213876817300E-11 * z + 2.08757008419747316778E-9 ) * z
+						   - 2.75573141792967388112E-7 ) * z + 2.48015872888517045348E-5 ) * z
+						   - 1.38888888888730564116E-3 ) * z + 4.16666666666665929218E-2 ) ;
+
+      // the quadrant: x = q*pi/2 + r
+      const bool swap = ( q & 1 ) ;
+      const double sinSign = ( q & 2 ? -1. : 1. ) ;
+      const double cosSign = ( ( q + 1 ) & 2 ? -1. : 1. ) ;
+
+      sinX = sinSign * ( swap ? cr : sr ) ;
+      cosX = cosSign * ( swap ? sr : cr ) ;
+    }
+
+
+    /// atan2(y,x) in [-pi,pi]
+    inline double arcTan2( double y, double x ){
+
+      static const double piO4 = 0.78539816339744830962 ;
+      static const double piO2 = 1.57079632679489661923 ;
+      static const double pi   = 3.14159265358979323846 ;
+      static const double moreBits = 6.123233995736765886130E-17 ;
+
+      const double ax = std::fabs( x ) ;
+      const double ay = std::fabs( y ) ;
+
+      // atan(t) for t = min/max in [0,1], above 0.66 from atan(t) = pi/4 + atan((t-1)/(t+1))
+      const double big = ( ay > ax ? ay : ax ) ;
+      const double t = ( ay > ax ? ax : ay ) / ( big > 0. ? big : 1. ) ;
+
+      const bool upper = t > 0.66 ;
+      const double u = ( upper ? ( t - 1. ) : t ) / ( upper ? ( t + 1. ) : 1. ) ;
+      const double z = u * u ;
+
+      const double p = (((( -8.750608600031904122785E-1 * z - 1.615753718733365076637E1 ) * z
+			   - 7.500855792314704667340E1 ) * z - 1.228866684490136173410E2 ) * z
+			   - 6.485021904942025371773E1 ) ;
+      const double q = ((((( z + 2.485846490142306297962E1 ) * z + 1.650270098316988542046E2 ) * z
+			    + 4.328810604912902668951E2 ) * z + 4.853903996359136964868E2 ) * z
+			    + 1.945506571482613964425E2 ) ;
+
+      double a = u + u * z * p / q ;
+      a = ( upper ? a + piO4 + 0.5 * moreBits : a ) ;
+
+      // back to the octant of (x,y)
+      a = ( ay > ax ? piO2 - a : a ) ;
+      a = ( x < 0. ? pi - a : a ) ;
+
+      return ( y < 0. ? -a : a ) ;
+    }
+
+
+    /** Select one of the two solutions s0, s1 according to mode - same logic as in the scalar
+     *  intersectWithZCylinder() and intersectWithZPlane(). Returns true if s1 is selected; valid is
+     *  false if there is no solution for the mode. For mode 0 the positive solution is preferred if
+     *  both are within tolerance.
+     */
+    inline bool selectSecond( double s0, double s1, int mode, double tolerance, bool& valid ){
+
+      const double sMin = ( s0 < s1 ? s0 : s1 ) ;
+      const double sMax = ( s0 < s1 ? s1 : s0 ) ;
+
+      // one positive and one negative solution: the negative one for mode -1, and for mode 0 if it
+      // is shorter by more than the tolerance - otherwise the closest one
+      const bool mixed = ( sMin < 0. ) & ( sMax >= 0. ) ;
+      const bool takeNegative = ( mode < 0 ) | ( ( mode == 0 ) & ( - sMin + tolerance < sMax ) ) ;
+
+      const double closest = ( std::fabs( s0 ) < std::fabs( s1 ) ? s0 : s1 ) ;
+      const double selected = ( mixed ? ( takeNegative ? sMin : sMax ) : closest ) ;
+
+      valid = mixed | ( ( sMax < 0. ) & ( mode < 1 ) ) | ( ( sMin >= 0. ) & ( mode > -1 ) ) ;
+
+      return selected == s1 ;
+    }
+
+
+    /** Path length at position x,y on the helix - same as calculateSfromXY(), using
+     *  s = -dphi/omega for points on the circle instead of the chord formula. The turning angle
+     *  dphi in [-pi,pi] is computed in the frame of the direction at the PCA x0,y0.
+     */
+    inline double sFromXY( double x, double y, double x0, double y0, double omega,
+			   double sinPhi0, double cosPhi0 ){
+
+      const double dx = x - x0 ;
+      const double dy = y - y0 ;
+
+      const double dphi = arcTan2( - omega * ( dx * cosPhi0 + dy * sinPhi0 ), 1. + omega * ( dy * cosPhi0 - dx * sinPhi0 ) ) ;
+
+      return ( omega != 0. ? - dphi : 0. ) / ( omega != 0. ? omega : 1. ) ;
+    }
+
+
+    /// keep the intersection with the shortest |s| for every helix
+    void mergeLayerResults( const helixBatchIntersections& scratch, int index, helixBatchIntersections& result ){
+
+      const unsigned n = result.size() ;
+
+      if( n == 0 )
+	return ;
+
+      const double* sS = &scratch.s[0] ;
+      const double* sX = &scratch.x[0] ;
+      const double* sY = &scratch.y[0] ;
+      const double* sZ = &scratch.z[0] ;
+      const unsigned char* sHit = &scratch.hit[0] ;
+
+      double* s = &result.s[0] ;
+      double* x = &result.x[0] ;
+      double* y = &result.y[0] ;
+      double* z = &result.z[0] ;
+      unsigned char* hit = &result.hit[0] ;
+      int* surface = &result.surface[0] ;
+
+#pragma omp simd
+      for(unsigned i=0 ; i<n ; ++i){
+
+	const bool better = ( sHit[i] != 0 ) & ( ( hit[i] == 0 ) | ( std::fabs( sS[i] ) < std::fabs( s[i] ) ) ) ;
+
+	s[i] = ( better ? sS[i] : s[i] ) ;
+	x[i] = ( better ? sX[i] : x[i] ) ;
+	y[i] = ( better ? sY[i] : y[i] ) ;
+	z[i] = ( better ? sZ[i] : z[i] ) ;
+	hit[i] = ( hit[i] | sHit[i] ) ;   // better implies sHit[i] == 1
+	surface[i] = ( better ? index : surface[i] ) ;
+      }
+    }
+
+
+    /// throw if the record does not have the type expected by the batched function
+    void checkType( const surfaceRecord& surf, int type, const char* function ){
+
+      if( surf.type == type )
+	return ;
+
+      std::stringstream sst ;
+      sst << " **** " << function << ": wrong type of the surfaceRecord " << surf.type << " for surface "
+	  << *surf.surface ;
+      throw std::invalid_argument( sst.str() ) ;
+    }
+
+  }
+
+
+  //===================================================================================================
+
+  void helixBatch::resize( unsigned n ){
+    omega.resize( n ) ;
+    tanl.resize( n ) ;
+    phi0.resize( n ) ;
+    d0.resize( n ) ;
+    z0.resize( n ) ;
+    refX.resize( n ) ;
+    refY.resize( n ) ;
+    refZ.resize( n ) ;
+  }
+
+  void helixBatch::reserve( unsigned n ){
+    omega.reserve( n ) ;
+    tanl.reserve( n ) ;
+    phi0.reserve( n ) ;
+    d0.reserve( n ) ;
+    z0.reserve( n ) ;
+    refX.reserve( n ) ;
+    refY.reserve( n ) ;
+    refZ.reserve( n ) ;
+  }
+
+  void helixBatch::set( unsigned i, const Vector5& hp, const Vector3D& rp ){
+    omega[i] = calculateOmega( hp ) ;
+    tanl[i]  = calculateTanLambda( hp ) ;
+    phi0[i]  = calculatePhi0( hp ) ;
+    d0[i]    = calculateD0( hp ) ;
+    z0[i]    = calculateZ0( hp ) ;
+    refX[i]  = rp.x() ;
+    refY[i]  = rp.y() ;
+    refZ[i]  = rp.z() ;
+  }
+
+  void helixBatch::push_back( const Vector5& hp, const Vector3D& rp ){
+    resize( size() + 1 ) ;
+    set( size() - 1 , hp, rp ) ;
+  }
+
+  void helixBatchIntersections::resize( unsigned n ){
+    s.resize( n ) ;
+    x.resize( n ) ;
+    y.resize( n ) ;
+    z.resize( n ) ;
+    hit.resize( n ) ;
+    surface.resize( n ) ;
+  }
+
+
+  //===================================================================================================
+
+  //===================================================================================================
+
+  void intersectWithZCylinder( const helixBatch& helices, const surfaceRecord& cyl,
+			       int mode, bool checkBounds, helixBatchIntersections& result ){
+
+    checkType( cyl, surfaceRecord::ZCylinder, "intersectWithZCylinder" ) ;
+
+    const unsigned n = helices.size() ;
+
+    result.resize( n ) ;
+
+    if( n == 0 )
+      return ;
+
+    const double* omega = &helices.omega[0] ;
+    const double* tanl  = &helices.tanl[0] ;
+    const double* phi0  = &helices.phi0[0] ;
+    const double* d0    = &helices.d0[0] ;
+    const double* z0    = &helices.z0[0] ;
+    const double* refX  = &helices.refX[0] ;
+    const double* refY  = &helices.refY[0] ;
+    const double* refZ  = &helices.refZ[0] ;
+
+    double* s = &result.s[0] ;
+    double* x = &result.x[0] ;
+    double* y = &result.y[0] ;
+    double* z = &result.z[0] ;
+    unsigned char* hit = &result.hit[0] ;
+    int* surface = &result.surface[0] ;
+
+    const double rho2 = cyl.radius * cyl.radius ;
+
+#pragma omp simd
+    for(unsigned i=0 ; i<n ; ++i){
+
+      const double om = omega[i] ;
+      const double invOm = ( om != 0. ? 1. : 0. ) / ( om != 0. ? om : 1. ) ;
+
+      double sinPhi0, cosPhi0 ;
+      sinCos( phi0[i], sinPhi0, cosPhi0 ) ;
+
+      // PCA and center of the helix circle
+      const double x0 = refX[i] - d0[i] * sinPhi0 ;
+      const double y0 = refY[i] + d0[i] * cosPhi0 ;
+      const double xc = x0 + invOm * sinPhi0 ;
+      const double yc = y0 - invOm * cosPhi0 ;
+
+      // intersection of two circles: the points lie on the line between the centers at
+      // the fraction l of the distance and +/- h perpendicular to it
+      const double ex = xc - cyl.xCenter ;
+      const double ey = yc - cyl.yCenter ;
+      const double d2 = ex*ex + ey*ey ;
+      const double invD2 = ( d2 > 0. ? 1. : 0. ) / ( d2 > 0. ? d2 : 1. ) ;
+
+      const double l  = ( rho2 - invOm*invOm + d2 ) * 0.5 * invD2 ;
+      const double h2 = rho2 - l * l * d2 ;
+      const double h  = std::sqrt( ( h2 > 0. ? h2 : 0. ) * invD2 ) ;
+
+      const double X0 = cyl.xCenter + l * ex - h * ey ;
+      const double Y0 = cyl.yCenter + l * ey + h * ex ;
+      const double X1 = cyl.xCenter + l * ex + h * ey ;
+      const double Y1 = cyl.yCenter + l * ey - h * ex ;
+
+      const double s0 = sFromXY( X0, Y0, x0, y0, om, sinPhi0, cosPhi0 ) ;
+      const double s1 = sFromXY( X1, Y1, x0, y0, om, sinPhi0, cosPhi0 ) ;
+
+      bool valid ;
+      const bool second = selectSecond( s0, s1, mode, 1e-4, valid ) ;
+
+      const double S = ( second ? s1 : s0 ) ;
+      const double Z = refZ[i] + z0[i] + S * tanl[i] ;
+
+      s[i] = S ;
+      x[i] = ( second ? X1 : X0 ) ;
+      y[i] = ( second ? Y1 : Y0 ) ;
+      z[i] = Z ;
+
+      const bool inside = ( ! checkBounds ) | ( ( Z >= cyl.zMin ) & ( Z <= cyl.zMax ) ) ;
+      const bool found = ( om != 0. ) & ( d2 > 0. ) & ( h2 >= 0. ) & valid & inside ;
+
+      hit[i] = found ;
+      surface[i] = ( found ? 0 : -1 ) ;
+    }
+  }
+
+
+
+  void intersectWithZPlane( const helixBatch& helices, const surfaceRecord& plane,
+			    int mode, bool checkBounds, helixBatchIntersections& result ){
+
+    checkType( plane, surfaceRecord::ZPlane, "intersectWithZPlane" ) ;
+
+    const unsigned n = helices.size() ;
+
+    result.resize( n ) ;
+
+    if( n == 0 )
+      return ;
+
+    const double* omega = &helices.omega[0] ;
+    const double* tanl  = &helices.tanl[0] ;
+    const double* phi0  = &helices.phi0[0] ;
+    const double* d0    = &helices.d0[0] ;
+    const double* z0    = &helices.z0[0] ;
+    const double* refX  = &helices.refX[0] ;
+    const double* refY  = &helices.refY[0] ;
+    const double* refZ  = &helices.refZ[0] ;
+
+    double* s = &result.s[0] ;
+    double* x = &result.x[0] ;
+    double* y = &result.y[0] ;
+    double* z = &result.z[0] ;
+    unsigned char* hit = &result.hit[0] ;
+    int* surface = &result.surface[0] ;
+
+    // the straight line in the xy-plane: n * p = dist
+    const double nn = std::sqrt( plane.nx * plane.nx + plane.ny * plane.ny ) ;
+    const double nx = plane.nx / nn ;
+    const double ny = plane.ny / nn ;
+    const double dist = nx * plane.ox + ny * plane.oy ;
+
+#pragma omp simd
+    for(unsigned i=0 ; i<n ; ++i){
+
+      const double om = omega[i] ;
+      const double invOm = ( om != 0. ? 1. : 0. ) / ( om != 0. ? om : 1. ) ;
+
+      double sinPhi0, cosPhi0 ;
+      sinCos( phi0[i], sinPhi0, cosPhi0 ) ;
+
+      const double x0 = refX[i] - d0[i] * sinPhi0 ;
+      const double y0 = refY[i] + d0[i] * cosPhi0 ;
+      const double xc = x0 + invOm * sinPhi0 ;
+      const double yc = y0 - invOm * cosPhi0 ;
+
+      // signed distance of the circle center to the line and the foot point
+      const double dd = nx * xc + ny * yc - dist ;
+      const double h2 = invOm * invOm - dd * dd ;
+      const double h  = std::sqrt( h2 > 0. ? h2 : 0. ) ;
+
+      const double fx = xc - dd * nx ;
+      const double fy = yc - dd * ny ;
+
+      const double X0 = fx + h * ny ;
+      const double Y0 = fy - h * nx ;
+      const double X1 = fx - h * ny ;
+      const double Y1 = fy + h * nx ;
+
+      const double s0 = sFromXY( X0, Y0, x0, y0, om, sinPhi0, cosPhi0 ) ;
+      const double s1 = sFromXY( X1, Y1, x0, y0, om, sinPhi0, cosPhi0 ) ;
+
+      bool valid ;
+      const bool second = selectSecond( s0, s1, mode, 0., valid ) ;
+
+      const double S = ( second ? s1 : s0 ) ;
+      const double X = ( second ? X1 : X0 ) ;
+      const double Y = ( second ? Y1 : Y0 ) ;
+      const double Z = refZ[i] + z0[i] + S * tanl[i] ;
+
+      s[i] = S ;
+      x[i] = X ;
+      y[i] = Y ;
+      z[i] = Z ;
+
+      const double dx = X - plane.ox ;
+      const double dy = Y - plane.oy ;
+      const double dz = Z - plane.oz ;
+
+      const double du = dx * plane.ux + dy * plane.uy + dz * plane.uz ;
+      const double dv = dx * plane.vx + dy * plane.vy + dz * plane.vz ;
+
+      const bool inside = ( ! checkBounds ) | ( ( std::fabs( du ) <= plane.halfU ) & ( std::fabs( dv ) <= plane.halfV ) ) ;
+      const bool found = ( om != 0. ) & ( h2 >= -1e-9 ) & valid & inside ;
+
+      hit[i] = found ;
+      surface[i] = ( found ? 0 : -1 ) ;
+    }
+  }
+
+
+
+  void intersectWithZDisk( const helixBatch& helices, const surfaceRecord& disk,
+			   int mode, bool checkBounds, helixBatchIntersections& result ){
+
+    checkType( disk, surfaceRecord::ZDisk, "intersectWithZDisk" ) ;
+
+    const unsigned n = helices.size() ;
+
+    result.resize( n ) ;
+
+    if( n == 0 )
+      return ;
+
+    const double* omega = &helices.omega[0] ;
+    const double* tanl  = &helices.tanl[0] ;
+    const double* phi0  = &helices.phi0[0] ;
+    const double* d0    = &helices.d0[0] ;
+    const double* z0    = &helices.z0[0] ;
+    const double* refX  = &helices.refX[0] ;
+    const double* refY  = &helices.refY[0] ;
+    const double* refZ  = &helices.refZ[0] ;
+
+    double* s = &result.s[0] ;
+    double* x = &result.x[0] ;
+    double* y = &result.y[0] ;
+    double* z = &result.z[0] ;
+    unsigned char* hit = &result.hit[0] ;
+    int* surface = &result.surface[0] ;
+
+    const double rMin2 = disk.rMin * disk.rMin ;
+    const double rMax2 = disk.rMax * disk.rMax ;
+
+#pragma omp simd
+    for(unsigned i=0 ; i<n ; ++i){
+
+      const double om = omega[i] ;
+      const double tl = tanl[i] ;
+
+      const double S = ( tl != 0. ? disk.oz - refZ[i] - z0[i] : 0. ) / ( tl != 0. ? tl : 1. ) ;
+
+      double sinPhi0, cosPhi0 ;
+      sinCos( phi0[i], sinPhi0, cosPhi0 ) ;
+
+      const double x0 = refX[i] - d0[i] * sinPhi0 ;
+      const double y0 = refY[i] + d0[i] * cosPhi0 ;
+
+      // same as calculateXfromS(), calculateYfromS(): the chord 2/omega*sin(omega*s/2)
+      // in the direction phi0 - omega*s/2
+      double sinHalf, cosHalf ;
+      sinCos( om * S / 2., sinHalf, cosHalf ) ;
+
+      const double chord = ( om != 0. ? 2. * sinHalf : S ) / ( om != 0. ? om : 1. ) ;
+
+      const double X = x0 + chord * ( cosPhi0 * cosHalf + sinPhi0 * sinHalf ) ;
+      const double Y = y0 + chord * ( sinPhi0 * cosHalf - cosPhi0 * sinHalf ) ;
+
+      s[i] = S ;
+      x[i] = X ;
+      y[i] = Y ;
+      z[i] = disk.oz ;
+
+      const double dx = X - disk.xCenter ;
+      const double dy = Y - disk.yCenter ;
+      const double r2 = dx*dx + dy*dy ;
+
+      const bool inside = ( ! checkBounds ) | ( ( r2 >= rMin2 ) & ( r2 <= rMax2 ) ) ;
+      const bool found = ( om != 0. ) & ( tl != 0. ) & ( ( mode * S > 0. ) | ( mode == 0 ) ) & inside ;
+
+      hit[i] = found ;
+      surface[i] = ( found ? 0 : -1 ) ;
+    }
+  }
+
+
+  //===================================================================================================
+
+  void intersectWithSurface( const helixBatch& helices, const surfaceRecord& surf,
+			     int mode, bool checkBounds, helixBatchIntersections& result ){
+
+    switch( surf.type ){
+
+    case surfaceRecord::ZCylinder:
+      intersectWithZCylinder( helices, surf, mode, checkBounds, result ) ;
+      return ;
+
+    case surfaceRecord::ZPlane:
+      intersectWithZPlane( helices, surf, mode, checkBounds, result ) ;
+      return ;
+
+    case surfaceRecord::ZDisk:
+      intersectWithZDisk( helices, surf, mode, checkBounds, result ) ;
+      return ;
+
+    default:
+      break ;
+    }
+
+    // helix by helix for the other types
+    const unsigned n = helices.size() ;
+
+    result.resize( n ) ;
+
+    for(unsigned i=0 ; i<n ; ++i){
+
+      const Vector5 hp( helices.omega[i], helices.tanl[i], helices.phi0[i], helices.d0[i], helices.z0[i] ) ;
+      const Vector3D rp( helices.refX[i], helices.refY[i], helices.refZ[i] ) ;
+
+      double S = 0. ;
+      Vector3D xx ;
+
+      const bool found = ( helices.omega[i] != 0. && intersectWithSurface( surf, hp, rp, S, xx, mode, checkBounds ) ) ;
+
+      result.s[i] = S ;
+      result.x[i] = xx.x() ;
+      result.y[i] = xx.y() ;
+      result.z[i] = xx.z() ;
+      result.hit[i] = found ;
+      result.surface[i] = ( found ? 0 : -1 ) ;
+    }
+  }
+
+
+  void intersectWithLayer( const helixBatch& helices, const std::vector<const surfaceRecord*>& layer,
+			   int mode, bool checkBounds, helixBatchIntersections& result,
+			   helixBatchIntersections& scratch ){
+
+    const unsigned n = helices.size() ;
+
+    result.resize( n ) ;
+
+    std::fill( result.hit.begin(), result.hit.end(), 0 ) ;
+    std::fill( result.surface.begin(), result.surface.end(), -1 ) ;
+
+    for(unsigned j=0 ; j<layer.size() ; ++j){
+
+      intersectWithSurface( helices, *layer[j], mode, checkBounds, scratch ) ;
+
+      mergeLayerResults( scratch, j, result ) ;
+    }
+  }
+
+}
@@ -3,8 +3,11 @@
 #include "IGeometry.hh"
 #include "intersections.hh"
 #include "aidaTT-Units.hh"
+#include "Instrumentation.hh"
+#include "surfaceRecords.hh"
 
 #include <sstream>
+#include <atomic>
 #include "streamlog/streamlog.h"
 
 namespace aidaTT
@@ -172,7 +175,7 @@ namespace aidaTT
     const double phi0  = calculatePhi0(  hp );
     const double tanl  = calculateTanLambda( hp );
 
-    double bfieldZ  = IGeometry::instance().getBField( rp ).z() ;
+    double bfieldZ  = IGeometry::instance().getBz( rp ) ;
     
     double pt = ( fabs(1./omega ) * bfieldZ * aidaTT::convertBr2P_cm  ); 
     
@@ -188,7 +191,7 @@ namespace aidaTT
     double omega = calculateOmega( hp );
     double tanl  = calculateTanLambda( hp ) ;
     
-    double bfieldZ  = IGeometry::instance().getBField( rp ).z() ;
+    double bfieldZ  = IGeometry::instance().getBz( rp ) ;
     
     double pt = ( fabs(1./omega ) * bfieldZ * aidaTT::convertBr2P_cm  ); 
     
@@ -412,212 +415,511 @@ namespace aidaTT
 
   //================ intersection calculations ===================================================
 
-  bool intersectWithZCylinder( const ISurface* surf, 
-			       const Vector5& hp, const Vector3D& rp, 
-			       double& s, Vector3D& xx, int mode, bool checkBounds )  {
-    
+  namespace {
 
-    //// see: L3 internal note 1666 "Helicoidal tracks", J.Alcaraz
-    const ICylinder* cyl = dynamic_cast<const ICylinder*>( surf ) ;
+    /** The helix as function of the path length s in the xy-plane, with the point and the
+     *  derivative d/ds computed together - for the iterative intersections below.
+     */
+    struct helixAtS{
+      double x0, y0, z0, omega, phi0, tanl, sinPhi0, cosPhi0 ;
 
-    if( ! ( surf->type().isParallelToZ() && cyl !=0 ) ){
-      
-      std::stringstream sst ; 
-      sst << " **** _intersectWithZCylinder: surface is not cylinder parallel to z : " << *surf  ;
-      throw std::runtime_error( sst.str() ) ;
+      helixAtS( const Vector5& hp, const Vector3D& rp ) :
+	x0( 0. ), y0( 0. ), z0( rp.z() + calculateZ0( hp ) ), omega( calculateOmega( hp ) ),
+	phi0( calculatePhi0( hp ) ), tanl( calculateTanLambda( hp ) ),
+	sinPhi0( sin( phi0 ) ), cosPhi0( cos( phi0 ) ) {
+
+	const double d0 = calculateD0( hp ) ;
+	x0 = rp.x() - d0 * sinPhi0 ;
+	y0 = rp.y() + d0 * cosPhi0 ;
+      }
+
+      void at( double s, Vector3D& xx, Vector3D& dxds ) const {
+
+	const double phi = phi0 - omega * s ;
+	const double sinPhi = sin( phi ) ;
+	const double cosPhi = cos( phi ) ;
+
+	if( omega != 0. )
+	  xx.fill( x0 + ( sinPhi0 - sinPhi ) / omega, y0 + ( cosPhi - cosPhi0 ) / omega, z0 + s * tanl ) ;
+	else
+	  xx.fill( x0 + s * cosPhi0, y0 + s * sinPhi0, z0 + s * tanl ) ;
+
+	dxds.fill( cosPhi, sinPhi, tanl ) ;
+      }
+    } ;
+
+
+    /// the signed distance of the helix point from a plane and its derivative w.r.t. s
+    struct planeDistance{
+      const helixAtS& helix ;
+      Vector3D normal ;
+      Vector3D origin ;
+
+      planeDistance( const helixAtS& h, const Vector3D& n, const Vector3D& o ) : helix( h ), normal( n ), origin( o ) {}
+
+      bool operator()( double s, Vector3D& xx, double& f, double& dfds ) const {
+	Vector3D dxds ;
+	helix.at( s, xx, dxds ) ;
+	f    = normal * ( xx - origin ) ;
+	dfds = normal * dxds ;
+	return true ;
+      }
+    } ;
+
+
+    /** The radial distance rho - r(z) of the helix point from a cone around an axis parallel
+     *  to z with r(z) = r0 + k * ( z - zr ), and its derivative w.r.t. s.
+     */
+    struct coneDistance{
+      const helixAtS& helix ;
+      double ax, ay, r0, zr, k ;
+
+      coneDistance( const helixAtS& h, double axisX, double axisY, double radius, double zRef, double slope ) :
+	helix( h ), ax( axisX ), ay( axisY ), r0( radius ), zr( zRef ), k( slope ) {}
+
+      bool operator()( double s, Vector3D& xx, double& f, double& dfds ) const {
+	Vector3D dxds ;
+	helix.at( s, xx, dxds ) ;
+
+	const double dx = xx.x() - ax ;
+	const double dy = xx.y() - ay ;
+	const double rho = sqrt( dx*dx + dy*dy ) ;
+
+	if( !( rho > 0. ) )
+	  return false ;
+
+	f    = rho - r0 - k * ( xx.z() - zr ) ;
+	dfds = ( dx * dxds.x() + dy * dxds.y() ) / rho - k * dxds.z() ;
+	return true ;
+      }
+    } ;
+
+
+    /** Newton iterations for the root of the distance function next to the start value s,
+     *  with the analytic derivative - at most maxIterations steps, i.e. a bounded cost per crossing.
+     *  Returns false if the iterations do not converge to the tolerance of intersectWithSurfaceNewton().
+     */
+    template <class Distance>
+    bool solveForS( const Distance& distance, double& s, Vector3D& xx ){
+
+      static const double epsilon       = 1.e-3 * aidaTT::mm ;
+      static const double precision     = 1.e-6 * aidaTT::mm ;
+      static const int    maxIterations = 10 ;
+
+      double f = 0., dfds = 0. ;
+
+      for( int i=0 ; i<maxIterations ; ++i ){
+
+	if( !distance( s, xx, f, dfds ) )
+	  return false ;
+
+	if( std::fabs( f ) < precision )
+	  return true ;
+
+	// the helix is parallel to the surface
+	if( dfds == 0. )
+	  return false ;
+
+	s -= f / dfds ;
+      }
+
+      if( !distance( s, xx, f, dfds ) )
+	return false ;
+
+      return std::fabs( f ) < epsilon ;
     }
 
-    const double omega = calculateOmega( hp );
-    const double phi0  = calculatePhi0(  hp );
-    const double d0    = calculateD0(    hp );
 
-    const double sinph = sin( phi0 ) ;
-    const double cosph = cos( phi0 ) ;
+    /** The first root of the distance function in the direction of mode ( mode * s > 0 ), for mode != 0:
+     *  the distance is sampled into that direction at the Newton steps that go forward by less than
+     *  1/8 turn of the helix ( omega ), otherwise in steps of 1/8 turn, up to two turns. The first
+     *  sign change is refined with Newton iterations that are kept inside the bracket ( bisection for a
+     *  step that leaves it ). Returns false if there is no sign change.
+     */
+    template <class Distance>
+    bool solveForSInDirection( const Distance& distance, double omega, int mode, double& s, Vector3D& xx ){
 
-    const double x0    = rp.x() - d0 * sinph ;
-    const double y0    = rp.y() + d0 * cosph ;
-      
-    const double     rho  = cyl->radius() ;
-    const Vector3D&  cylc = cyl->center() ;
-    const double xrho = cylc.x()  ;
-    const double yrho = cylc.y()  ;
+      static const double precision     = 1.e-6 * aidaTT::mm ;
+      static const double turns         = 2. ;
+      static const int    maxIterations = 50 ;
 
-    //--------
+      if( mode == 0 || omega == 0. )
+	return false ;
 
-    const double dx = xrho - x0 ;
-    const double dy = yrho - y0 ;
+      const double step = ( mode > 0 ? 1. : -1. ) * M_PI / 4. / std::fabs( omega ) ;
 
-    double sox = sinph - omega * dx  ;
-    double coy = cosph + omega * dy ;
-      
-    double gamma = ( 2*dx * sinph - 2 * dy * cosph - omega * rho * rho  - omega * ( dx*dx + dy*dy ) ) ;
-    gamma /= ( 2 * rho * sqrt( sox * sox + coy * coy) ) ;
+      double a = 0., fa = 0., dfds = 0. ;
+
+      if( !distance( a, xx, fa, dfds ) )
+	return false ;
+
+      const double sMax = turns * 8. * std::fabs( step ) ;
+
+      for( int i=0 ; i<maxIterations && std::fabs( a ) < sMax ; ++i ){
+
+	// the Newton step from a if it goes forward by less than the step
+	const double newton = ( dfds != 0. ? - fa / dfds : 0. ) ;
+	const double b = a + ( newton * step > 0. && std::fabs( newton ) < std::fabs( step ) ? newton : step ) ;
+
+	double fb = 0. ;
+
+	if( !distance( b, xx, fb, dfds ) )
+	  return false ;
+
+	if( std::fabs( fb ) < precision ){
+	  s = b ;
+	  return true ;
+	}
+
+	// no sign change in (a,b] - a root at a is only possible for the start point s=0
+	if( fa * fb >= 0. ){
+	  a = b ;
+	  fa = fb ;
+	  continue ;
+	}
+
+	// the bracket [lo,hi] with f(lo) of the sign of f(a), starting with the Newton step from b
+	double lo = a, hi = b ;
+	s = b - fb / dfds ;
+
+	for( int k=0 ; k<maxIterations ; ++k ){
+
+	  if( !( ( s - lo ) * ( s - hi ) < 0. ) )
+	    s = 0.5 * ( lo + hi ) ;
+
+	  double f = 0. ;
+
+	  if( !distance( s, xx, f, dfds ) )
+	    return false ;
+
+	  if( std::fabs( f ) < precision )
+	    return true ;
+
+	  if( ( f < 0. ) == ( fa < 0. ) )
+	    lo = s ;
+	  else
+	    hi = s ;
+
+	  s = ( dfds != 0. ? s - f / dfds : lo ) ;
+	}
+
+	return false ;
+      }
 
-    if( std::fabs( gamma ) > 1. )  // no solution  ( could have faster check at beginning  ...  ) 
       return false ;
+    }
 
-    const double phirho = atan2( sox , coy ) ;
 
-    const double asing = asin( gamma ) ;
+    /// true if the solution s is in the direction given by mode and inside the bounds if requested
+    inline bool acceptSolution( const ISurface* surf, double s, const Vector3D& xx, int mode, bool checkBounds ){
 
-    const double phic0 = asing + phirho ;
+      if( mode * s > 0 || mode == 0 )
+	return  ( checkBounds ? surf->insideBounds(xx) : true ) ;
 
-    double phic1 = ( asing  > 0. ?  M_PI - asing :  - M_PI - asing  ) ;
-    phic1 += phirho ;
+      return false ;
+    }
+
+
+    /** The intersection of the helix with the cylinder of radius rho around the axis parallel
+     *  to z through ( xrho , yrho ), selected with mode - without bounds.
+     *  See: L3 internal note 1666 "Helicoidal tracks", J.Alcaraz
+     */
+    bool zCylinderSolution( const Vector5& hp, const Vector3D& rp, double rho, double xrho, double yrho,
+			    double& s, Vector3D& xx, int mode ){
+
+      const double omega = calculateOmega( hp );
+      const double phi0  = calculatePhi0(  hp );
+      const double d0    = calculateD0(    hp );
+
+      const double sinph = sin( phi0 ) ;
+      const double cosph = cos( phi0 ) ;
+
+      const double x0    = rp.x() - d0 * sinph ;
+      const double y0    = rp.y() + d0 * cosph ;
+
+      //--------
 
-    const double X0 = xrho + rho * cos( phic0 )  ;
-    const double Y0 = yrho + rho * sin( phic0 )  ;
+      const double dx = xrho - x0 ;
+      const double dy = yrho - y0 ;
 
-    const double X1 = xrho + rho * cos( phic1 )  ;
-    const double Y1 = yrho + rho * sin( phic1 )  ;
+      double sox = sinph - omega * dx  ;
+      double coy = cosph + omega * dy ;
       
-    const double s0 = calculateSfromXY( X0 , Y0, hp, rp );
-    const double s1 = calculateSfromXY( X1 , Y1, hp, rp );
+      double gamma = ( 2*dx * sinph - 2 * dy * cosph - omega * rho * rho  - omega * ( dx*dx + dy*dy ) ) ;
+      gamma /= ( 2 * rho * sqrt( sox * sox + coy * coy) ) ;
 
-    const double Z0 = calculateZfromS( s0, hp, rp );
-    const double Z1 = calculateZfromS( s1, hp, rp );
+      if( std::fabs( gamma ) > 1. )  // no solution  ( could have faster check at beginning  ...  ) 
+	return false ;
+
+      const double phirho = atan2( sox , coy ) ;
+
+      const double asing = asin( gamma ) ;
+
+      const double phic0 = asing + phirho ;
 
-    Vector3D sol0( X0, Y0, Z0 );
-    Vector3D sol1( X1, Y1, Z1 );
+      double phic1 = ( asing  > 0. ?  M_PI - asing :  - M_PI - asing  ) ;
+      phic1 += phirho ;
+
+      const double X0 = xrho + rho * cos( phic0 )  ;
+      const double Y0 = yrho + rho * sin( phic0 )  ;
+
+      const double X1 = xrho + rho * cos( phic1 )  ;
+      const double Y1 = yrho + rho * sin( phic1 )  ;
+      
+      const double s0 = calculateSfromXY( X0 , Y0, hp, rp );
+      const double s1 = calculateSfromXY( X1 , Y1, hp, rp );
+
+      const double Z0 = calculateZfromS( s0, hp, rp );
+      const double Z1 = calculateZfromS( s1, hp, rp );
+
+      Vector3D sol0( X0, Y0, Z0 );
+      Vector3D sol1( X1, Y1, Z1 );
     
 
-    // find the right solution depending on mode and the sign of the path lengths:
+      // find the right solution depending on mode and the sign of the path lengths:
     
-    if( s0 < 0. && s1 < 0. ) {
+      if( s0 < 0. && s1 < 0. ) {
       
-      if( mode < 1 ){ // mode=(-1,0)  return closest negative solution
-    	if( s1 < s0 ) {  xx = sol0 ;	s = s0 ; }
-    	else          {  xx = sol1 ;	s = s1 ; }
-      }
-      else  // no positive solution
-    	return false ;
-    } 
-    else if ( s0 < 0. && s1 >= 0. ){
-      
-      if(      mode <  0 ){ xx = sol0 ;   s = s0 ; }
-      else if( mode >  0 ){ xx = sol1 ;   s = s1 ; }
-      else {
-    	if( ( std::fabs(s0) +  1e-4 )  < std::fabs(s1) ) // give preference to positive solution if almost equal
-    	  {   xx = sol0 ;   s = s0 ; }
-    	else{ xx = sol1 ;   s = s1 ; }
-      }
+	if( mode < 1 ){ // mode=(-1,0)  return closest negative solution
+	  if( s1 < s0 ) {  xx = sol0 ;	s = s0 ; }
+	  else          {  xx = sol1 ;	s = s1 ; }
+	}
+	else  // no positive solution
+	  return false ;
+      } 
+      else if ( s0 < 0. && s1 >= 0. ){
       
-    } else if ( s0 >= 0. && s1 < 0. ){
+	if(      mode <  0 ){ xx = sol0 ;   s = s0 ; }
+	else if( mode >  0 ){ xx = sol1 ;   s = s1 ; }
+	else {
+	  if( ( std::fabs(s0) +  1e-4 )  < std::fabs(s1) ) // give preference to positive solution if almost equal
+	    {   xx = sol0 ;   s = s0 ; }
+	  else{ xx = sol1 ;   s = s1 ; }
+	}
       
-      if(      mode >  0 ){ xx = sol0 ;   s = s0 ; }
-      else if( mode <  0 ){ xx = sol1 ;   s = s1 ; }
-      else {
-    	if(std::fabs(s0)  < ( std::fabs(s1) +  1e-4 ) ) // give preference to positive solution if almost equal
-    	  {   xx = sol0 ;   s = s0 ; }
-    	else{ xx = sol1 ;   s = s1 ; }
-      }
+      } else if ( s0 >= 0. && s1 < 0. ){
+      
+	if(      mode >  0 ){ xx = sol0 ;   s = s0 ; }
+	else if( mode <  0 ){ xx = sol1 ;   s = s1 ; }
+	else {
+	  if(std::fabs(s0)  < ( std::fabs(s1) +  1e-4 ) ) // give preference to positive solution if almost equal
+	    {   xx = sol0 ;   s = s0 ; }
+	  else{ xx = sol1 ;   s = s1 ; }
+	}
       
-    } else { // ( s0 >= 0. && s1 >= 0. )
+      } else { // ( s0 >= 0. && s1 >= 0. )
       
-      if( mode > -1 ){ // mode=(0,1)  return closest positive solution
-    	if( s0 < s1 ) {  xx = sol0 ;	s = s0 ; }
-    	else          {  xx = sol1 ;	s = s1 ; }
+	if( mode > -1 ){ // mode=(0,1)  return closest positive solution
+	  if( s0 < s1 ) {  xx = sol0 ;	s = s0 ; }
+	  else          {  xx = sol1 ;	s = s1 ; }
+	}
+	else  // no negative solution
+	  return false ;
       }
-      else  // no negative solution
-    	return false ;
-    }
     
-    return  ( checkBounds ? surf->insideBounds(xx) : true ) ;
-  }
-
-
-  bool intersectWithZPlane( const ISurface* surf, const Vector5& hp, const Vector3D& rp, 
-			    double& s, Vector3D& xx, int mode, bool checkBounds ){
+      return true ;
+    }
 
-    // the straight line: normals plus distance; distance must be positive !
-    const double nx = surf->normal().x();
-    const double ny = surf->normal().y();
 
-    // calculate distance from origin
-    const double dist = fabs(surf->distance(Vector3D()));
+    /** The intersection of the helix with the plane parallel to z with the normal ( nx, ny )
+     *  at the distance dist from the z axis, selected with mode - without bounds.
+     */
+    bool zPlaneSolution( const Vector5& hp, const Vector3D& rp, double nx, double ny, double dist,
+			 double& s, Vector3D& xx, int mode ){
 
-    // define straight line from this
-    straightLine line(nx, ny, dist);
-    // create circle
-    const double radius  = calculateRadius(  hp );
-    const double xcenter = calculateXCenter( hp, rp );
-    const double ycenter = calculateYCenter( hp, rp );
-    circle circ(xcenter, ycenter, radius);
+      // define straight line from this
+      straightLine line(nx, ny, dist);
+      // create circle
+      const double radius  = calculateRadius(  hp );
+      const double xcenter = calculateXCenter( hp, rp );
+      const double ycenter = calculateYCenter( hp, rp );
+      circle circ(xcenter, ycenter, radius);
 
-    intersections candidates = intersectCircleStraightLine(circ, line);
+      intersections candidates = intersectCircleStraightLine(circ, line);
 
-    if(candidates.number() < 1)
-      return false;
+      if(candidates.number() < 1)
+	return false;
     
-    else if(candidates.number() == 1) {
-
-      s = calculateSfromXY( candidates[0].first, candidates[0].second , hp, rp);
-      const double Z = calculateZfromS(s, hp, rp );
-      xx.fill(candidates[0].first, candidates[0].second, Z);
+      else if(candidates.number() == 1) {
 
-      if( mode * s > 0 || mode == 0)
-	return  ( checkBounds ? surf->insideBounds(xx) : true ) ;
-      else
-	return false ;
+	s = calculateSfromXY( candidates[0].first, candidates[0].second , hp, rp);
+	const double Z = calculateZfromS(s, hp, rp );
+	xx.fill(candidates[0].first, candidates[0].second, Z);
 
-    }
+	return ( mode * s > 0 || mode == 0 ) ;
+      }
 
-    ///  else -- the standard case: two solutions index 0 and 1
-    /// calculate all values first, then evaluate
-    const double X0 = candidates[0].first;
-    const double Y0 = candidates[0].second;
-    const double s0 = calculateSfromXY(X0, Y0,  hp, rp);
-    const double Z0 = calculateZfromS(s0, hp, rp);
+      ///  else -- the standard case: two solutions index 0 and 1
+      /// calculate all values first, then evaluate
+      const double X0 = candidates[0].first;
+      const double Y0 = candidates[0].second;
+      const double s0 = calculateSfromXY(X0, Y0,  hp, rp);
+      const double Z0 = calculateZfromS(s0, hp, rp);
 
-    const double X1 = candidates[1].first;
-    const double Y1 = candidates[1].second;
-    const double s1 = calculateSfromXY(X1, Y1,  hp, rp);
-    const double Z1 = calculateZfromS(s1,  hp, rp);
+      const double X1 = candidates[1].first;
+      const double Y1 = candidates[1].second;
+      const double s1 = calculateSfromXY(X1, Y1,  hp, rp);
+      const double Z1 = calculateZfromS(s1,  hp, rp);
 
-    Vector3D sol0(X0, Y0, Z0);
-    Vector3D sol1(X1, Y1, Z1);
+      Vector3D sol0(X0, Y0, Z0);
+      Vector3D sol1(X1, Y1, Z1);
 
-    // find the right solution depending on mode and the sign of the path lengths:
+      // find the right solution depending on mode and the sign of the path lengths:
     
-    if( s0 < 0. && s1 < 0. ) {
+      if( s0 < 0. && s1 < 0. ) {
       
-      if( mode < 1 ){ // mode=(-1,0)  return closest negative solution
-	if( s1 < s0 ) {  xx = sol0 ;	s = s0 ; }
-	else          {  xx = sol1 ;	s = s1 ; }
-      }
-      else  // no positive solution
-	return false ;
-    } 
-    else if ( s0 < 0. && s1 >= 0. ){
-      
-      if(      mode <  0 ){ xx = sol0 ;   s = s0 ; }
-      else if( mode >  0 ){ xx = sol1 ;   s = s1 ; }
-      else {
-	if(std::fabs(s0)  < std::fabs(s1))
-	  {   xx = sol0 ;   s = s0 ; }
-	else{ xx = sol1 ;   s = s1 ; }
-      }
+	if( mode < 1 ){ // mode=(-1,0)  return closest negative solution
+	  if( s1 < s0 ) {  xx = sol0 ;	s = s0 ; }
+	  else          {  xx = sol1 ;	s = s1 ; }
+	}
+	else  // no positive solution
+	  return false ;
+      } 
+      else if ( s0 < 0. && s1 >= 0. ){
       
-    } else if ( s0 >= 0. && s1 < 0. ){
+	if(      mode <  0 ){ xx = sol0 ;   s = s0 ; }
+	else if( mode >  0 ){ xx = sol1 ;   s = s1 ; }
+	else {
+	  if(std::fabs(s0)  < std::fabs(s1))
+	    {   xx = sol0 ;   s = s0 ; }
+	  else{ xx = sol1 ;   s = s1 ; }
+	}
       
-      if(      mode >  0 ){ xx = sol0 ;   s = s0 ; }
-      else if( mode <  0 ){ xx = sol1 ;   s = s1 ; }
-      else {
-	if(std::fabs(s0)  < std::fabs(s1))
-	  {   xx = sol0 ;   s = s0 ; }
-	else{ xx = sol1 ;   s = s1 ; }
-      }
+      } else if ( s0 >= 0. && s1 < 0. ){
       
-    } else { // ( s0 >= 0. && s1 >= 0. )
+	if(      mode >  0 ){ xx = sol0 ;   s = s0 ; }
+	else if( mode <  0 ){ xx = sol1 ;   s = s1 ; }
+	else {
+	  if(std::fabs(s0)  < std::fabs(s1))
+	    {   xx = sol0 ;   s = s0 ; }
+	  else{ xx = sol1 ;   s = s1 ; }
+	}
       
-      if( mode > -1 ){ // mode=(0,1)  return closest positive solution
-	if( s0 < s1 ) {  xx = sol0 ;	s = s0 ; }
-	else          {  xx = sol1 ;	s = s1 ; }
+      } else { // ( s0 >= 0. && s1 >= 0. )
+      
+	if( mode > -1 ){ // mode=(0,1)  return closest positive solution
+	  if( s0 < s1 ) {  xx = sol0 ;	s = s0 ; }
+	  else          {  xx = sol1 ;	s = s1 ; }
+	}
+	else  // no negative solution
+	  return false ;
       }
-      else  // no negative solution
+
+      return true ;
+    }
+
+
+    /// the intersection of the helix with the plane orthogonal to z at planePositionZ, if in the direction given by mode
+    bool zDiskSolution( const Vector5& hp, const Vector3D& rp, double planePositionZ,
+			double& s, Vector3D& xx, int mode ){
+
+      double helixPositionZ = rp.z() + calculateZ0( hp ) ;
+    
+      s = ( planePositionZ - helixPositionZ ) / calculateTanLambda( hp );
+    
+      double x = calculateXfromS(s, hp, rp );
+      double y = calculateYfromS(s, hp, rp );
+    
+      xx.fill(x, y, planePositionZ);
+
+      return ( mode * s > 0 || mode == 0 ) ;
+    }
+
+
+    /** The intersection of the helix with the cone r(z) = r0 + slope * ( z - zr ) around the axis
+     *  parallel to z through ( ax, ay ), in the direction given by mode: the root next to the start
+     *  value s, e.g. of the intersection with the middle cylinder in that direction. If the iterations
+     *  end on the wrong side ( mode * s < 0 ), the first root in the direction of mode is searched.
+     */
+    bool coneSolution( const Vector5& hp, const Vector3D& rp, double ax, double ay, double r0, double zr, double slope,
+		       double& s, Vector3D& xx, int mode ){
+
+      const helixAtS helix( hp, rp ) ;
+      const coneDistance distance( helix, ax, ay, r0, zr, slope ) ;
+
+      if( solveForS( distance, s, xx ) && ( mode * s > 0 || mode == 0 ) )
+	return true ;
+
+      return solveForSInDirection( distance, calculateOmega( hp ), mode, s, xx ) ;
+    }
+
+
+    /** The intersection of the helix with the plane in the direction given by mode: for mode +-1 the
+     *  first one in that direction ( the one next to the reference point if the plane is not crossed
+     *  within two turns ), for mode 0 the one next to the reference point - or the shorter of the first
+     *  ones in both directions if the iterations from the reference point fail, e.g. for a helix
+     *  starting parallel to the plane.
+     */
+    bool planeSolution( const Vector5& hp, const Vector3D& rp, const Vector3D& normal, const Vector3D& origin,
+			double& s, Vector3D& xx, int mode ){
+
+      const helixAtS helix( hp, rp ) ;
+      const planeDistance distance( helix, normal, origin ) ;
+      const double omega = calculateOmega( hp ) ;
+
+      if( mode != 0 && solveForSInDirection( distance, omega, mode, s, xx ) )
+	return true ;
+
+      // start at the reference point, i.e. the first step goes along the tangent
+      s = 0. ;
+
+      if( solveForS( distance, s, xx ) )
+	return ( mode * s > 0 || mode == 0 ) ;
+
+      if( mode != 0 )
 	return false ;
+
+      double sBack = 0. ;
+      Vector3D xxBack ;
+
+      const bool forward  = solveForSInDirection( distance, omega, +1, s, xx ) ;
+      const bool backward = solveForSInDirection( distance, omega, -1, sBack, xxBack ) ;
+
+      if( backward && ( !forward || std::fabs( sBack ) < std::fabs( s ) ) ){
+	s = sBack ;
+	xx = xxBack ;
+      }
+
+      return forward || backward ;
     }
+  }
+
+
+  bool intersectWithZCylinder( const ISurface* surf, 
+			       const Vector5& hp, const Vector3D& rp, 
+			       double& s, Vector3D& xx, int mode, bool checkBounds )  {
     
+    const ICylinder* cyl = dynamic_cast<const ICylinder*>( surf ) ;
+
+    if( ! ( surf->type().isParallelToZ() && cyl !=0 ) ){
+      
+      std::stringstream sst ; 
+      sst << " **** _intersectWithZCylinder: surface is not cylinder parallel to z : " << *surf  ;
+      throw std::runtime_error( sst.str() ) ;
+    }
+
+    const Vector3D& cylc = cyl->center() ;
+
+    if( !zCylinderSolution( hp, rp, cyl->radius(), cylc.x(), cylc.y(), s, xx, mode ) )
+      return false ;
+
+    return  ( checkBounds ? surf->insideBounds(xx) : true ) ;
+  }
+
+
+  bool intersectWithZPlane( const ISurface* surf, const Vector5& hp, const Vector3D& rp, 
+			    double& s, Vector3D& xx, int mode, bool checkBounds ){
+
+    // the straight line: normals plus distance; distance must be positive !
+    const double nx = surf->normal().x();
+    const double ny = surf->normal().y();
+
+    // calculate distance from origin
+    const double dist = fabs(surf->distance(Vector3D()));
+
+    if( !zPlaneSolution( hp, rp, nx, ny, dist, s, xx, mode ) )
+      return false ;
+
     streamlog_out( DEBUG  ) << " --- intersectWithZPlane - found intersection - s : " << s
 			     << " at : " << xx  << std::endl
 			     << " [ inside bounds : " << surf->insideBounds( xx ) << "] "
@@ -634,44 +936,54 @@ namespace aidaTT
 			   double& s, Vector3D& xx, int mode, bool checkBounds ) {
     
     // the z position of the plane
-    double planePositionZ = surf->origin().z();
-    double helixPositionZ = rp.z() + calculateZ0( hp ) ;
-    
-    s = ( planePositionZ - helixPositionZ ) / calculateTanLambda( hp );
-    
-    double x = calculateXfromS(s, hp, rp );
-    double y = calculateYfromS(s, hp, rp );
-    
-    xx.fill(x, y, planePositionZ);
-
-    if( mode * s > 0 || mode == 0 )
-      return  ( checkBounds ? surf->insideBounds(xx) : true ) ;
-    else
+    if( !zDiskSolution( hp, rp, surf->origin().z(), s, xx, mode ) )
       return false ;
 
+    return  ( checkBounds ? surf->insideBounds(xx) : true ) ;
+
   }
   
   bool intersectWithSurface( const ISurface* surf, const Vector5& hp, const Vector3D& rp, 
 			     double& s, Vector3D& xx, int mode, bool checkBounds) {
 
 
-    static int count = 0 ;
+    // atomic, as this function is called concurrently by the RefitEngine
+    static std::atomic<int> count( 0 ) ;
 
     if( surf->type().isZCylinder() ){
 
-      return intersectWithZCylinder( surf, hp, rp, s, xx, mode, checkBounds  ) ; 
+      AIDATT_INSTRUMENT_SCOPE( IntersectZCylinder ) ;
+      const bool found = intersectWithZCylinder( surf, hp, rp, s, xx, mode, checkBounds  ) ; 
+      AIDATT_INSTRUMENT_SUCCESS( found ) ;
+      return found ;
 
     } else if( surf->type().isZPlane() ){  
 
-      return intersectWithZPlane( surf, hp, rp, s, xx, mode, checkBounds  ) ; 
+      AIDATT_INSTRUMENT_SCOPE( IntersectZPlane ) ;
+      const bool found = intersectWithZPlane( surf, hp, rp, s, xx, mode, checkBounds  ) ; 
+      AIDATT_INSTRUMENT_SUCCESS( found ) ;
+      return found ;
 
     } else if( surf->type().isZDisk() ){  
 
-      return intersectWithZDisk( surf, hp, rp, s, xx, mode, checkBounds  ) ; 
+      AIDATT_INSTRUMENT_SCOPE( IntersectZDisk ) ;
+      const bool found = intersectWithZDisk( surf, hp, rp, s, xx, mode, checkBounds  ) ; 
+      AIDATT_INSTRUMENT_SUCCESS( found ) ;
+      return found ;
 
     } else if( surf->type().isCone() ){  
 
-      return intersectWithZCone( surf, hp, rp, s, xx, mode, checkBounds  ) ; 
+      AIDATT_INSTRUMENT_SCOPE( IntersectZCone ) ;
+      const bool found = intersectWithZCone( surf, hp, rp, s, xx, mode, checkBounds  ) ; 
+      AIDATT_INSTRUMENT_SUCCESS( found ) ;
+      return found ;
+
+    } else if( surf->type().isPlane() ){  
+
+      AIDATT_INSTRUMENT_SCOPE( IntersectPlane ) ;
+      const bool found = intersectWithPlane( surf, hp, rp, s, xx, mode, checkBounds  ) ; 
+      AIDATT_INSTRUMENT_SUCCESS( found ) ;
+      return found ;
 
     } else {
 
@@ -683,6 +995,66 @@ namespace aidaTT
     return false ;
   }
 
+  bool intersectWithSurface( const surfaceRecord& surf, const Vector5& hp, const Vector3D& rp,
+			     double& s, Vector3D& xx, int mode, bool checkBounds ){
+
+    switch( surf.type ){
+
+    case surfaceRecord::ZCylinder: {
+
+      AIDATT_INSTRUMENT_SCOPE( IntersectZCylinder ) ;
+      const bool found = ( zCylinderSolution( hp, rp, surf.radius, surf.xCenter, surf.yCenter, s, xx, mode ) &&
+			   ( !checkBounds || insideBounds( surf, xx ) ) ) ;
+      AIDATT_INSTRUMENT_SUCCESS( found ) ;
+      return found ;
+    }
+
+    case surfaceRecord::ZPlane: {
+
+      AIDATT_INSTRUMENT_SCOPE( IntersectZPlane ) ;
+      // as in intersectWithZPlane(): the distance of the straight line must be positive
+      const double dist = std::fabs( surf.nx * surf.ox + surf.ny * surf.oy + surf.nz * surf.oz ) ;
+      const bool found = ( zPlaneSolution( hp, rp, surf.nx, surf.ny, dist, s, xx, mode ) &&
+			   ( !checkBounds || insideBounds( surf, xx ) ) ) ;
+      AIDATT_INSTRUMENT_SUCCESS( found ) ;
+      return found ;
+    }
+
+    case surfaceRecord::ZDisk: {
+
+      AIDATT_INSTRUMENT_SCOPE( IntersectZDisk ) ;
+      const bool found = ( zDiskSolution( hp, rp, surf.oz, s, xx, mode ) &&
+			   ( !checkBounds || insideBounds( surf, xx ) ) ) ;
+      AIDATT_INSTRUMENT_SUCCESS( found ) ;
+      return found ;
+    }
+
+    case surfaceRecord::Cone: {
+
+      AIDATT_INSTRUMENT_SCOPE( IntersectZCone ) ;
+      // start from the intersection with the cylinder through the origin
+      const bool found = ( zCylinderSolution( hp, rp, surf.radius, surf.xCenter, surf.yCenter, s, xx, mode ) &&
+			   coneSolution( hp, rp, surf.xCenter, surf.yCenter, surf.radius, surf.oz, surf.slope, s, xx, mode ) &&
+			   ( !checkBounds || insideBounds( surf, xx ) ) ) ;
+      AIDATT_INSTRUMENT_SUCCESS( found ) ;
+      return found ;
+    }
+
+    case surfaceRecord::Plane: {
+
+      AIDATT_INSTRUMENT_SCOPE( IntersectPlane ) ;
+      const bool found = ( planeSolution( hp, rp, Vector3D( surf.nx, surf.ny, surf.nz ), Vector3D( surf.ox, surf.oy, surf.oz ), s, xx, mode ) &&
+			   ( !checkBounds || insideBounds( surf, xx ) ) ) ;
+      AIDATT_INSTRUMENT_SUCCESS( found ) ;
+      return found ;
+    }
+
+    default:
+      return intersectWithSurface( surf.surface, hp, rp, s, xx, mode, checkBounds ) ;
+    }
+  }
+
+
   bool intersectWithZCone( const ISurface* surf, const Vector5& hp, const Vector3D& rp, 
 			   double& s, Vector3D& xx, int mode, bool checkBounds) {
 
@@ -695,7 +1067,40 @@ namespace aidaTT
     streamlog_out( DEBUG  ) << " --- intersectWithZCone - found intersection with cylinder : s : " << s
 			     << " at : " << xx << std::endl ;
 
-    return intersectWithSurfaceNewton(  surf, hp, rp, s, xx, mode, checkBounds  ) ;
+    // the cone from the surface: axis parallel to z through the center, the radius and the
+    // slope dr/dz at the origin from the direction v along the cone
+    const ICylinder* cyl = dynamic_cast<const ICylinder*>( surf ) ;
+
+    const Vector3D& axis   = cyl->center() ;
+    const Vector3D& origin = surf->origin() ;
+    const Vector3D& v      = surf->v( origin ) ;
+
+    const double dx = origin.x() - axis.x() ;
+    const double dy = origin.y() - axis.y() ;
+    const double r0 = sqrt( dx*dx + dy*dy ) ;
+
+    // a cone that is (almost) a disk - use the general method
+    if( std::fabs( v.z() ) < 1.e-9 || !( r0 > 0. ) )
+      return intersectWithSurfaceNewton(  surf, hp, rp, s, xx, mode, checkBounds  ) ;
+
+    const double slope = ( v.x() * dx + v.y() * dy ) / ( r0 * v.z() ) ;
+
+    if( !coneSolution( hp, rp, axis.x(), axis.y(), r0, origin.z(), slope, s, xx, mode ) )
+      return false ;
+
+    return acceptSolution( surf, s, xx, mode, checkBounds ) ;
+  }
+
+
+  bool intersectWithPlane( const ISurface* surf, const Vector5& hp, const Vector3D& rp, 
+			   double& s, Vector3D& xx, int mode, bool checkBounds ) {
+
+    const Vector3D& origin = surf->origin() ;
+
+    if( !planeSolution( hp, rp, surf->normal( origin ), origin, s, xx, mode ) )
+      return false ;
+
+    return acceptSolution( surf, s, xx, mode, checkBounds ) ;
   }
 
   bool intersectWithSurfaceNewton( const ISurface* surf, const Vector5& hp, const Vector3D& rp, 
@@ -711,6 +1116,8 @@ namespace aidaTT
 
     static const double  alphaDecr = 1./alphaIncr ;
     
+    AIDATT_INSTRUMENT_SCOPE( IntersectNewton ) ;
+
     xx = pointAt( s, hp, rp) ;
     
     Vector3D prevXX( xx );
@@ -740,6 +1147,8 @@ namespace aidaTT
 				<< " s : " << s
 				<< " xx : " << xx
 				<< std::endl ;
+	AIDATT_INSTRUMENT_ITEMS( count ) ;
+	AIDATT_INSTRUMENT_SUCCESS( false ) ;
 	return 0;
       }
 
@@ -803,6 +1212,8 @@ namespace aidaTT
       xx = pointAt( s, hp, rp) ;
     }
     
+    AIDATT_INSTRUMENT_ITEMS( count ) ;
+
     if( mode * s > 0 || mode == 0 )
       return  ( checkBounds ? surf->insideBounds(xx) : true ) ;
     else
@@ -0,0 +1,149 @@
+#include "materialCache.hh"
+
+#include "betheBlochTable.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace aidaTT{
+
+  namespace {
+
+    /// sort and search by id - equal ids keep the order of the geometry
+    bool lessId( const surfaceMaterial& m0, const surfaceMaterial& m1 ){
+      return m0.id < m1.id ;
+    }
+
+    bool lessIdValue( const surfaceMaterial& m, long64 id ){
+      return m.id < id ;
+    }
+  }
+
+
+  materialLayer::materialLayer( const IMaterial& mat, double thick ) :
+    thickness( thick ), density( mat.density() ), ZoverA( mat.Z() / mat.A() ), lnTwoMeOverI( 0. ), C0( 0. ), a( 0. ),
+    table( 0 ) {
+
+    // as in computeBetheBloch()
+    static const double kMe  = 0.510998902e-3;  // electron mass [GeV]
+
+    // vacuum - no energy loss
+    if( !( density > 0. ) )
+      return ;
+
+    const double Z   = mat.Z() ;
+    const double I   = ( 9.76 * Z + 58.8 * std::pow( Z, -0.19 ) ) * 1.e-9 ;  // mean excitation energy [GeV]
+    const double hwp = 28.816 * std::sqrt( density * ZoverA ) * 1.e-9 ;
+
+    lnTwoMeOverI = std::log( 2. * kMe / I ) ;
+    C0 = - ( 2. * std::log( I / hwp ) + 1. ) ;
+    a  = -C0 / 27. ;
+  }
+
+
+  surfaceMaterial::surfaceMaterial( const ISurface& surf ) :
+    surface( &surf ), id( surf.id() ), thickness( 0. ), X0eff( 0. ),
+    inner( surf.innerMaterial(), surf.innerThickness() ),
+    outer( surf.outerMaterial(), surf.outerThickness() ) {
+
+    thickness = inner.thickness + outer.thickness ;
+
+    // no material at all for a surface without thickness
+    if( thickness > 0. )
+      X0eff = ( inner.thickness / surf.innerMaterial().radiationLength() +
+		outer.thickness / surf.outerMaterial().radiationLength() ) / thickness ;
+  }
+
+
+  MaterialCache::~MaterialCache(){
+    _clearTables() ;
+  }
+
+
+  void MaterialCache::build( const std::vector<const ISurface*>& surfaces ){
+
+    _clearTables() ;
+    _materials.clear() ;
+    _materials.reserve( surfaces.size() ) ;
+
+    for( unsigned i=0, n = surfaces.size() ; i<n ; ++i )
+      _materials.push_back( surfaceMaterial( *surfaces[i] ) ) ;
+
+    std::stable_sort( _materials.begin(), _materials.end(), lessId ) ;
+
+    if( !_masses.empty() )
+      _tabulate() ;
+  }
+
+
+  void MaterialCache::tabulate( const std::vector<double>& masses, unsigned binsPerDecade ){
+
+    _masses = masses ;
+    _binsPerDecade = binsPerDecade ;
+
+    _tabulate() ;
+  }
+
+
+  void MaterialCache::_tabulate(){
+
+    _clearTables() ;
+
+    if( _masses.empty() )
+      return ;
+
+    for( unsigned i=0, n = _materials.size() ; i<n ; ++i ){
+
+      materialLayer* layers[2] = { &_materials[i].inner, &_materials[i].outer } ;
+
+      for( unsigned l=0 ; l<2 ; ++l ){
+
+	materialLayer& layer = *layers[l] ;
+
+	// no energy loss in vacuum
+	if( !( layer.density > 0. ) )
+	  continue ;
+
+	for( unsigned t=0, nt = _tables.size() ; t<nt && layer.table == 0 ; ++t )
+	  if( _tables[t]->matches( layer ) )
+	    layer.table = _tables[t] ;
+
+	if( layer.table == 0 ){
+	  _tables.push_back( new BetheBlochTable( layer, _masses, _binsPerDecade ) ) ;
+	  layer.table = _tables.back() ;
+	}
+      }
+    }
+  }
+
+
+  void MaterialCache::_clearTables(){
+
+    for( unsigned i=0, n = _materials.size() ; i<n ; ++i ){
+      _materials[i].inner.table = 0 ;
+      _materials[i].outer.table = 0 ;
+    }
+
+    for( unsigned t=0, nt = _tables.size() ; t<nt ; ++t )
+      delete _tables[t] ;
+
+    _tables.clear() ;
+  }
+
+
+  const surfaceMaterial* MaterialCache::find( const ISurface* surf ) const {
+
+    const long64 id = surf->id() ;
+
+    std::vector<surfaceMaterial>::const_iterator it =
+      std::lower_bound( _materials.begin(), _materials.end(), id, lessIdValue ) ;
+
+    // surfaces with the same id are distinguished by their address
+    for( ; it != _materials.end() && it->id == id ; ++it )
+      if( it->surface == surf )
+	return &( *it ) ;
+
+    return 0 ;
+  }
+
+}
@@ -1,14 +1,70 @@
 #include "materialUtils.hh"
 
+#include "betheBlochTable.hh"
+
 #include "helixUtils.hh"
 #include "IGeometry.hh"
 #include "aidaTT-Units.hh"
+#include "Instrumentation.hh"
 #include <math.h>
 #include <cmath>
 #include "streamlog/streamlog.h"
 
 namespace aidaTT{
 
+  namespace {
+
+    // Bethe-Bloch eq. (Physical Review D P195.) - code copied from KalTest, K.Fujii, KEK
+    const double kK   = 0.307075e-3;     // [GeV*cm^2]
+    const double kMe  = 0.510998902e-3;  // electron mass [GeV]
+
+
+    /// the parts of the Bethe-Bloch formula that only depend on the particle
+    struct betheBlochKinematics{
+      double gm2OverBg2 ;
+      double bg2OverGm2 ;
+      double logTerm ;     ///< log( bg2 ) - 0.5 * log( 1 + m_e/M * ( 2 gamma + m_e/M ) )
+      double x ;           ///< log10( beta gamma )
+    } ;
+
+
+    betheBlochKinematics computeKinematics( double mom, double mass ){
+
+      const double bg2 = (mom*mom) / (mass * mass);
+      const double gm2 = 1. + bg2;
+      const double meM = kMe / mass;
+
+      const double lnBg2 = std::log( bg2 ) ;
+
+      // with tmax = 2 m_e bg2 / D :  0.5 * log( 2 m_e bg2 tmax / I^2 ) = log( 2 m_e / I ) + log( bg2 ) - 0.5 * log( D )
+      const double D = 1. + meM*(2.*std::sqrt(gm2) + meM) ;
+
+      betheBlochKinematics k ;
+      k.gm2OverBg2 = gm2 / bg2 ;
+      k.bg2OverGm2 = bg2 / gm2 ;
+      k.logTerm    = lnBg2 - 0.5 * std::log( D ) ;
+      k.x          = lnBg2 / ( 2. * M_LN10 ) ;
+
+      return k ;
+    }
+
+
+    double betheBloch( const materialLayer& mat, const betheBlochKinematics& k ){
+
+      double del = 0. ;
+
+      if( k.x >= 3. ){
+	del = 4.606 * k.x + mat.C0 ;
+      } else if( k.x >= 0. ){
+	const double d = 3. - k.x ;
+	del = 4.606 * k.x + mat.C0 + mat.a * d*d*d ;
+      }
+
+      return kK * mat.ZoverA * k.gm2OverBg2 * ( mat.lnTwoMeOverI + k.logTerm - k.bg2OverGm2 - del ) ;
+    }
+  }
+
+
 
   double computeQMS( const ISurface* surf, const Vector5& hp, const Vector3D& rp , double mass ) {
     
@@ -26,7 +82,7 @@ namespace aidaTT{
     double tanl  = calculateTanLambda( hp ) ;
     
 
-    double bfieldZ  = IGeometry::instance().getBField( xx ).z() ;
+    double bfieldZ  = IGeometry::instance().getBz( xx ) ;
 
     double pt = ( fabs(1./omega ) * bfieldZ * aidaTT::convertBr2P_cm  ); 
 
@@ -38,8 +94,10 @@ namespace aidaTT{
 
   double computeQMS( const ISurface* surf, const Vector2D& crossingPoint, const Vector3D& momentum , double mass ) {
     
-    const dd4hep::rec::IMaterial& material_inn = surf->innerMaterial();
-    const dd4hep::rec::IMaterial& material_out = surf->outerMaterial();
+    AIDATT_INSTRUMENT_SCOPE( MaterialQMS ) ;
+
+    const IMaterial& material_inn = surf->innerMaterial();
+    const IMaterial& material_out = surf->outerMaterial();
     
     const double r_i = surf->innerThickness();
     const double r_o = surf->outerThickness();
@@ -109,35 +167,72 @@ namespace aidaTT{
 
 
   double computeBetheBloch( const IMaterial &mat, double mom, double mass ){
-    // -----------------------------------------
-    // Bethe-Bloch eq. (Physical Review D P195.)
-    // code copied from KalTest, K.Fujii, KEK
-    // -----------------------------------------
-    static const double kK   = 0.307075e-3;     // [GeV*cm^2]
-    static const double kMe  = 0.510998902e-3;  // electron mass [GeV]
-    
-    double dnsty = mat.density();             // density
-    double A     = mat.A();                   // atomic mass
-    double Z     = mat.Z();                   // atomic number
-    //double I    = Z * 1.e-8;                   // mean excitation energy [GeV]
-    //double I    = (2.4 +Z) * 1.e-8;            // mean excitation energy [GeV]
-    double I    = (9.76 * Z + 58.8 * std::pow(Z, -0.19)) * 1.e-9; // mean excitation energy [GeV]
-    double hwp  = 28.816 * std::sqrt(dnsty * Z/A) * 1.e-9;
-    double bg2  = (mom*mom) / (mass * mass);
-    double gm2  = 1. + bg2;
-    double meM  = kMe / mass;
-    double x    = log10(std::sqrt(bg2));
-    double C0   = - (2. * log(I/hwp) + 1.);
-    double a    = -C0/27.;
-    double del;
-    if (x >= 3.)            del = 4.606 * x + C0;
-    else if (0.<=x && x<3.) del = 4.606 * x + C0 + a * std::pow(3.-x, 3.);
-    else                    del = 0.;
-    double tmax = 2.*kMe*bg2 / (1. + meM*(2.*std::sqrt(gm2) + meM));
-    double dedx = kK * Z/A * gm2/bg2 * (0.5*log(2.*kMe*bg2*tmax / (I*I))
-					  - bg2/gm2 - del);
-
-    return dedx ;
+
+    // the material constants are computed in materialLayer
+    return computeBetheBloch( materialLayer( mat, 0. ), mom, mass ) ;
+  }
+
+
+  double computeBetheBloch( const materialLayer& mat, double mom, double mass ){
+
+    return betheBloch( mat, computeKinematics( mom, mass ) ) ;
+  }
+
+
+  double computeQMS( const surfaceMaterial& material, double cosTrk, double mom, double mass ){
+
+    AIDATT_INSTRUMENT_SCOPE( MaterialQMS ) ;
+
+    const double X_X0 = material.thickness * material.X0eff / cosTrk ;
+
+    if( !( X_X0 > 0. ) )
+      return 0. ;
+
+    const double beta = mom / std::sqrt(mom * mom + mass * mass);
+
+    return 0.0136/(mom*beta) * std::sqrt(X_X0) * (1 + 0.038*(std::log(X_X0)));
+  }
+
+
+  double computeEnergyLoss( const surfaceMaterial& material, double cosTrk, double mom,
+			    double& energy, double& beta, double mass ){
+
+    AIDATT_INSTRUMENT_SCOPE( MaterialEnergyLoss ) ;
+
+    energy = std::sqrt( mom*mom + mass*mass ) ;
+    beta = mom / energy ;
+
+    // the kinematics are only computed if one of the layers is not tabulated
+    betheBlochKinematics k ;
+    bool haveKinematics = false ;
+
+    const materialLayer* layers[2] = { &material.inner, &material.outer } ;
+
+    double deltaE = 0. ;
+
+    for( unsigned l=0 ; l<2 ; ++l ){
+
+      const materialLayer& layer = *layers[l] ;
+
+      if( !( layer.thickness > 0. ) )
+	continue ;
+
+      double dedx = 0. ;
+
+      if( layer.table == 0 || !layer.table->dEdx( mom, mass, dedx ) ){
+
+	if( !haveKinematics ){
+	  k = computeKinematics( mom, mass ) ;
+	  haveKinematics = true ;
+	}
+
+	dedx = betheBloch( layer, k ) ;
+      }
+
+      deltaE += dedx * layer.density * layer.thickness ;
+    }
+
+    return deltaE / cosTrk ;
   }
 
 
@@ -145,8 +240,10 @@ namespace aidaTT{
 			    const Vector3D& momentum, double& energy, double& beta,
 			    double mass ){
     
-    const dd4hep::rec::IMaterial& material_i = surf->innerMaterial(); // crossingPoint
-    const dd4hep::rec::IMaterial& material_o = surf->outerMaterial(); // crossingPoint
+    AIDATT_INSTRUMENT_SCOPE( MaterialEnergyLoss ) ;
+
+    const IMaterial& material_i = surf->innerMaterial(); // crossingPoint
+    const IMaterial& material_o = surf->outerMaterial(); // crossingPoint
     
     double path_i = surf->innerThickness();
     double path_o = surf->outerThickness();
@@ -220,7 +317,7 @@ namespace aidaTT{
     double tanl  = calculateTanLambda( tp ) ;
     
 
-    double bfieldZ  = IGeometry::instance().getBField( xx ).z() ;
+    double bfieldZ  = IGeometry::instance().getBz( xx ) ;
 
     double pt = ( fabs(1./omega ) * bfieldZ * aidaTT::convertBr2P_cm  ); 
 
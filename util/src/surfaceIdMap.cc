@@ -0,0 +1,64 @@
+#include "surfaceIdMap.hh"
+
+namespace aidaTT{
+
+  void SurfaceIdMap::build( const std::vector<const ISurface*>& surfaces ){
+
+    // at least twice as many slots as surfaces, i.e. short probe sequences
+    unsigned capacity = 16 ;
+
+    while( capacity < 2 * surfaces.size() )
+      capacity *= 2 ;
+
+    slot empty ;
+    empty.id = 0 ;
+    empty.surface = 0 ;
+
+    _slots.assign( capacity, empty ) ;
+    _mask = capacity - 1 ;
+    _size = 0 ;
+
+    for( unsigned k=0, n = surfaces.size() ; k<n ; ++k ){
+
+      const long64 id = surfaces[k]->id() ;
+
+      unsigned i = hash( id ) & _mask ;
+
+      while( _slots[i].surface != 0 && _slots[i].id != id )
+	i = ( i + 1 ) & _mask ;
+
+      // the first surface with the id is kept
+      if( _slots[i].surface != 0 )
+	continue ;
+
+      _slots[i].id = id ;
+      _slots[i].surface = surfaces[k] ;
+      ++_size ;
+    }
+  }
+
+
+  unsigned SurfaceIdMap::find( unsigned n, const long64* ids, const ISurface** surfaces ) const {
+
+    // the number of ids ahead that are prefetched
+    static const unsigned distance = 8 ;
+
+    unsigned nFound = 0 ;
+
+    for( unsigned k=0 ; k<n ; ++k ){
+
+#if defined(__GNUC__)
+      if( k + distance < n && !_slots.empty() )
+	__builtin_prefetch( &_slots[ hash( ids[ k + distance ] ) & _mask ] ) ;
+#endif
+
+      surfaces[k] = find( ids[k] ) ;
+
+      if( surfaces[k] != 0 )
+	++nFound ;
+    }
+
+    return nFound ;
+  }
+
+}
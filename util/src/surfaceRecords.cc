@@ -0,0 +1,189 @@
+#include "surfaceRecords.hh"
+
+#include "materialCache.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <new>
+
+namespace aidaTT{
+
+  surfaceRecord surfaceRecord::fromSurface( const ISurface* surf, const surfaceMaterial* mat ){
+
+    surfaceRecord r ;
+
+    const SurfaceType& t = surf->type() ;
+
+    const Vector3D& o = surf->origin() ;
+    const Vector3D n = surf->normal( o ) ;
+    const Vector3D u = surf->u( o ) ;
+    const Vector3D v = surf->v( o ) ;
+
+    r.type = Other ;
+    r.sensitive = t.isSensitive() ;
+
+    r.ox = o.x() ;  r.oy = o.y() ;  r.oz = o.z() ;
+    r.nx = n.x() ;  r.ny = n.y() ;  r.nz = n.z() ;
+    r.ux = u.x() ;  r.uy = u.y() ;  r.uz = u.z() ;
+    r.vx = v.x() ;  r.vy = v.y() ;  r.vz = v.z() ;
+
+    r.radius = 0. ;  r.xCenter = 0. ;  r.yCenter = 0. ;  r.slope = 0. ;
+    r.zMin = 0. ;  r.zMax = 0. ;
+    r.halfU = surf->length_along_u() / 2. ;
+    r.halfV = surf->length_along_v() / 2. ;
+    r.rMin = 0. ;  r.rMax = 0. ;
+
+    r.thickness = ( mat ? mat->thickness : surf->innerThickness() + surf->outerThickness() ) ;
+    r.X0eff     = ( mat ? mat->X0eff : 0. ) ;
+
+    r.material = mat ;
+    r.surface  = surf ;
+    r.id       = surf->id() ;
+
+    // the same order as in intersectWithSurface()
+    if( t.isZCylinder() ){
+
+      const ICylinder* cyl = dynamic_cast<const ICylinder*>( surf ) ;
+
+      if( cyl != 0 ){
+	const Vector3D c = cyl->center() ;
+
+	r.type    = ZCylinder ;
+	r.radius  = cyl->radius() ;
+	r.xCenter = c.x() ;
+	r.yCenter = c.y() ;
+	r.zMin    = c.z() - surf->length_along_v() / 2. ;
+	r.zMax    = c.z() + surf->length_along_v() / 2. ;
+      }
+
+    } else if( t.isZPlane() ){
+
+      r.type = ZPlane ;
+
+    } else if( t.isZDisk() ){
+
+      r.type    = ZDisk ;
+      r.xCenter = o.x() ;
+      r.yCenter = o.y() ;
+      r.rMax    = std::max( surf->length_along_u(), surf->length_along_v() ) / 2. ;
+
+    } else if( t.isCone() ){
+
+      const ICylinder* cyl = dynamic_cast<const ICylinder*>( surf ) ;
+      const ICone* cone = dynamic_cast<const ICone*>( surf ) ;
+
+      if( cyl != 0 && cone != 0 ){
+
+	// as in intersectWithZCone(): the axis through the center, the slope from v at the origin
+	const Vector3D c = cyl->center() ;
+
+	const double dx = o.x() - c.x() ;
+	const double dy = o.y() - c.y() ;
+	const double r0 = std::sqrt( dx*dx + dy*dy ) ;
+
+	// a cone that is (almost) a disk is left to the ISurface
+	if( std::fabs( v.z() ) >= 1.e-9 && r0 > 0. ){
+	  r.type    = Cone ;
+	  r.radius  = r0 ;
+	  r.xCenter = c.x() ;
+	  r.yCenter = c.y() ;
+	  r.slope   = ( v.x() * dx + v.y() * dy ) / ( r0 * v.z() ) ;
+	  r.zMin    = std::min( cone->z0(), cone->z1() ) ;
+	  r.zMax    = std::max( cone->z0(), cone->z1() ) ;
+	}
+      }
+
+    } else if( t.isPlane() ){
+
+      r.type = Plane ;
+    }
+
+    return r ;
+  }
+
+
+  bool insideBounds( const surfaceRecord& surf, const Vector3D& xx ){
+
+    switch( surf.type ){
+
+    case surfaceRecord::ZCylinder:
+    case surfaceRecord::Cone:
+      return xx.z() >= surf.zMin && xx.z() <= surf.zMax ;
+
+    case surfaceRecord::ZPlane:
+    case surfaceRecord::Plane: {
+      const double dx = xx.x() - surf.ox ;
+      const double dy = xx.y() - surf.oy ;
+      const double dz = xx.z() - surf.oz ;
+
+      return ( std::fabs( dx * surf.ux + dy * surf.uy + dz * surf.uz ) <= surf.halfU &&
+	       std::fabs( dx * surf.vx + dy * surf.vy + dz * surf.vz ) <= surf.halfV ) ;
+    }
+
+    case surfaceRecord::ZDisk: {
+      const double dx = xx.x() - surf.xCenter ;
+      const double dy = xx.y() - surf.yCenter ;
+      const double rho2 = dx*dx + dy*dy ;
+
+      return rho2 >= surf.rMin * surf.rMin && rho2 <= surf.rMax * surf.rMax ;
+    }
+
+    default:
+      return surf.surface->insideBounds( xx ) ;
+    }
+  }
+
+
+  Vector3D surfaceNormal( const surfaceRecord& surf, const Vector3D& xx ){
+
+    switch( surf.type ){
+
+    case surfaceRecord::ZCylinder:
+    case surfaceRecord::Cone: {
+      const double dx = xx.x() - surf.xCenter ;
+      const double dy = xx.y() - surf.yCenter ;
+      const double rho = std::sqrt( dx*dx + dy*dy ) ;
+
+      if( !( rho > 0. ) )
+	return Vector3D( surf.nx, surf.ny, surf.nz ) ;
+
+      // the cone rho - r0 - k ( z - z0 ) = 0 has the gradient ( dx/rho, dy/rho, -k ) -
+      // oriented as the normal at the origin
+      const double outward = ( surf.nx * ( surf.ox - surf.xCenter ) + surf.ny * ( surf.oy - surf.yCenter ) >= 0. ? 1. : -1. ) ;
+      const double norm = outward * std::sqrt( 1. + surf.slope * surf.slope ) ;
+
+      return Vector3D( dx / rho / norm, dy / rho / norm, -surf.slope / norm ) ;
+    }
+
+    case surfaceRecord::ZPlane:
+    case surfaceRecord::ZDisk:
+    case surfaceRecord::Plane:
+      return Vector3D( surf.nx, surf.ny, surf.nz ) ;
+
+    default:
+      return surf.surface->normal( xx ) ;
+    }
+  }
+
+
+  //======================================================================================
+
+  void SurfaceRecords::build( const std::vector<const ISurface*>& surfaces, const MaterialCache* materials ){
+
+    static const std::uintptr_t alignment = 64 ;
+
+    _size = surfaces.size() ;
+
+    // one cache line more than needed for aligning the first record
+    _buffer.assign( _size * sizeof( surfaceRecord ) + alignment, 0 ) ;
+
+    const std::uintptr_t address = reinterpret_cast<std::uintptr_t>( &_buffer[0] ) ;
+
+    _records = reinterpret_cast<surfaceRecord*>( &_buffer[0] + ( alignment - address % alignment ) % alignment ) ;
+
+    for( unsigned i=0 ; i<_size ; ++i )
+      new( _records + i ) surfaceRecord( surfaceRecord::fromSurface( surfaces[i], ( materials ? materials->find( surfaces[i] ) : 0 ) ) ) ;
+  }
+
+}
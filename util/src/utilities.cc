@@ -256,7 +256,7 @@ namespace aidaTT
         }
         */
 
- std::pair<Vector3D, Vector3D>* calculateLocalCurvilinearSystem(double s, const trackParameters& tP)
+ std::pair<Vector3D, Vector3D> calculateLocalCurvilinearSystem(double s, const trackParameters& tP)
   {
     const double omega = calculateCurvature(tP);
     const double phi0 = calculatePhi0(tP);
@@ -270,12 +270,24 @@ namespace aidaTT
     const double v1 = - sin(phi0 - omega * s) * sin(lambda);
     const double v2 = cos(lambda);
 
-    return new std::pair<Vector3D, Vector3D> (Vector3D(u0, u1, u2), Vector3D(v0, v1, v2));
+    return std::pair<Vector3D, Vector3D> (Vector3D(u0, u1, u2), Vector3D(v0, v1, v2));
   }
 
 
 
-  std::vector<double>* calculateLocalToMeasurementProjectionMatrix(const Vector3D& clU,  const Vector3D& clV, const std::vector<Vector3D>& measDirs)
+  void calculateLocalToMeasurementProjectionMatrix(const Vector3D& clU,  const Vector3D& clV, const std::vector<Vector3D>& measDirs,
+						   std::vector<double>& retVec)
+  {
+    /// the return matrix, set as four element double vector
+    retVec.resize(4);
+
+    calculateLocalToMeasurementProjectionMatrix(clU, clV, ( measDirs.empty() ? NULL : &measDirs[0] ), measDirs.size(), &retVec[0]);
+  }
+
+
+
+  void calculateLocalToMeasurementProjectionMatrix(const Vector3D& clU,  const Vector3D& clV, const Vector3D* measDirs, unsigned n,
+						   double* retVec)
   {
     // calculate the projection matrix from the local curvilinear system to the measurement system
     // done in two steps: first compute the easier measurement to local projection, then invert the result
@@ -284,8 +296,6 @@ namespace aidaTT
     //             , also the direction does not contribute, since the associated precision is zero
     // NOTE: higher dimensions (up to five) are possible, but have to be implemented
 
-    /// the return matrix, set as four element double vector
-    std::vector<double>* retVec = new std::vector<double>(4);
     double a, b, c, d;
 
     // two cases to cover:
@@ -293,7 +303,7 @@ namespace aidaTT
     //      ! not taken into account, since precision is zero
     // 2D measurements -- straighforward
 
-    if(measDirs.size() == 1)
+    if(n == 1)
       {
 	// construct second orthogonal vector from meas. direction
 	Vector3D mdir = measDirs[0].unit();
@@ -308,7 +318,7 @@ namespace aidaTT
 	c = ortho * clU;
 	d = ortho * clV;
       }
-    else if(measDirs.size() == 2)
+    else if(n == 2)
       {
 	a = measDirs[0] * clU;
 	b = measDirs[0] * clV;
@@ -323,17 +333,15 @@ namespace aidaTT
 
     if(determinant != 0.)
       {
-	(*retVec)[0] =   d  / determinant;
-	(*retVec)[1] = (-b) / determinant;
-	(*retVec)[2] = (-c) / determinant;
-	(*retVec)[3] =   a  / determinant;
+	retVec[0] =   d  / determinant;
+	retVec[1] = (-b) / determinant;
+	retVec[2] = (-c) / determinant;
+	retVec[3] =   a  / determinant;
       }
     else
       {
 	throw std::invalid_argument("Projection matrix can't be inverted, bailing out.");
       }
-
-    return retVec;
   }
 
 }